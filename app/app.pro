@@ -131,6 +131,12 @@ unix:if(!macx|disable-prebuilts) {
                     CONFIG += libplacebo
                 }
             }
+
+            !disable-libavformat {
+                packagesExist(libavformat) {
+                    CONFIG += libavformat
+                }
+            }
         }
 
         !disable-wayland {
@@ -174,8 +180,11 @@ SOURCES += \
     backend/identitymanager.cpp \
     backend/nvcomputer.cpp \
     backend/nvhttp.cpp \
+    backend/nvserverinfo.cpp \
     backend/nvpairingmanager.cpp \
     backend/computermanager.cpp \
+    backend/hostpoller.cpp \
+    backend/hoststore.cpp \
     backend/boxartmanager.cpp \
     backend/richpresencemanager.cpp \
     cli/commandlineparser.cpp \
@@ -191,20 +200,27 @@ SOURCES += \
     streaming/input/keyboard.cpp \
     streaming/input/mouse.cpp \
     streaming/input/reltouch.cpp \
+    streaming/input/inputstats.cpp \
     streaming/session.cpp \
     streaming/audio/audio.cpp \
     streaming/audio/renderers/sdlaud.cpp \
+    streaming/audio/driftcompensator.cpp \
+    streaming/audio/downmixer.cpp \
     gui/computermodel.cpp \
     gui/appmodel.cpp \
     streaming/bandwidth.cpp \
     streaming/streamutils.cpp \
+    streaming/streamrecorder.cpp \
+    streaming/avsyncmonitor.cpp \
     backend/autoupdatechecker.cpp \
     path.cpp \
+    asynclogger.cpp \
     settings/mappingmanager.cpp \
     gui/sdlgamepadkeynavigation.cpp \
     streaming/video/overlaymanager.cpp \
     backend/systemproperties.cpp \
     streaming/video/videoenhancement.cpp \
+    streaming/video/renderertuning.cpp \
     wm.cpp
 
 HEADERS += \
@@ -219,8 +235,11 @@ HEADERS += \
     backend/identitymanager.h \
     backend/nvcomputer.h \
     backend/nvhttp.h \
+    backend/nvserverinfo.h \
     backend/nvpairingmanager.h \
     backend/computermanager.h \
+    backend/hostpoller.h \
+    backend/hoststore.h \
     backend/boxartmanager.h \
     backend/richpresencemanager.h \
     cli/commandlineparser.h \
@@ -229,21 +248,29 @@ HEADERS += \
     cli/startstream.h \
     settings/streamingpreferences.h \
     streaming/input/input.h \
+    streaming/input/inputstats.h \
     streaming/session.h \
     streaming/audio/renderers/renderer.h \
     streaming/audio/renderers/sdl.h \
+    streaming/audio/driftcompensator.h \
+    streaming/audio/downmixer.h \
     gui/computermodel.h \
     gui/appmodel.h \
     streaming/video/decoder.h \
     streaming/bandwidth.h \
     streaming/streamutils.h \
+    streaming/streamrecorder.h \
+    streaming/avsyncmonitor.h \
+    streaming/spscqueue.h \
     backend/autoupdatechecker.h \
     path.h \
+    asynclogger.h \
     settings/mappingmanager.h \
     gui/sdlgamepadkeynavigation.h \
     streaming/video/overlaymanager.h \
     backend/systemproperties.h \
-    streaming/video/videoenhancement.h
+    streaming/video/videoenhancement.h \
+    streaming/video/renderertuning.h
 
 # Platform-specific renderers and decoders
 ffmpeg {
@@ -252,18 +279,30 @@ ffmpeg {
     DEFINES += HAVE_FFMPEG
     SOURCES += \
         streaming/video/ffmpeg.cpp \
+        streaming/video/framesnapshotter.cpp \
         streaming/video/ffmpeg-renderers/genhwaccel.cpp \
+        streaming/video/ffmpeg-renderers/null.cpp \
         streaming/video/ffmpeg-renderers/sdlvid.cpp \
         streaming/video/ffmpeg-renderers/swframemapper.cpp \
         streaming/video/ffmpeg-renderers/pacer/pacer.cpp
 
     HEADERS += \
         streaming/video/ffmpeg.h \
+        streaming/video/framesnapshotter.h \
         streaming/video/ffmpeg-renderers/renderer.h \
         streaming/video/ffmpeg-renderers/genhwaccel.h \
+        streaming/video/ffmpeg-renderers/null.h \
         streaming/video/ffmpeg-renderers/sdlvid.h \
         streaming/video/ffmpeg-renderers/swframemapper.h \
         streaming/video/ffmpeg-renderers/pacer/pacer.h
+
+    INCLUDEPATH += $$PWD/../third-party/stb_image
+}
+libavformat {
+    message(Matroska stream recording enabled)
+
+    PKGCONFIG += libavformat
+    DEFINES += HAVE_LIBAVFORMAT
 }
 libva {
     message(VAAPI renderer selected)
@@ -0,0 +1,167 @@
+#include "asynclogger.h"
+
+// How long the writer sleeps if it misses a wakeup
+#define WRITER_WAIT_TIMEOUT_MS 100
+
+AsyncLogger::AsyncLogger(WriteCallback writeCallback, DropCallback dropCallback)
+    : m_WriteCallback(writeCallback),
+      m_DropCallback(dropCallback),
+      m_EnqueuePos(0),
+      m_DequeuePos(0),
+      m_DroppedRecords(0),
+      m_ReportedDroppedRecords(0),
+      m_WriterSleeping(false),
+      m_Stopping(false),
+      m_RecordsAvailable(nullptr),
+      m_WriterThread(nullptr)
+{
+    for (int i = 0; i < k_RingSize; i++) {
+        m_Cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+AsyncLogger::~AsyncLogger()
+{
+    stop();
+}
+
+void AsyncLogger::start()
+{
+    SDL_assert(m_WriterThread == nullptr);
+
+    m_Stopping = false;
+    m_RecordsAvailable = SDL_CreateSemaphore(0);
+    m_WriterThread = SDL_CreateThread(AsyncLogger::writerThreadProc, "AsyncLogger", this);
+}
+
+void AsyncLogger::stop()
+{
+    if (m_WriterThread != nullptr) {
+        m_Stopping = true;
+        SDL_SemPost(m_RecordsAvailable);
+        SDL_WaitThread(m_WriterThread, nullptr);
+        m_WriterThread = nullptr;
+    }
+
+    if (m_RecordsAvailable != nullptr) {
+        SDL_DestroySemaphore(m_RecordsAvailable);
+        m_RecordsAvailable = nullptr;
+    }
+
+    // Write anything that was queued after the writer exited
+    drain();
+}
+
+bool AsyncLogger::log(LogRecord::Source source, int category, int priority,
+                      qint64 timeMs, const char* text, int textLength)
+{
+    Cell* cell;
+    size_t pos = m_EnqueuePos.load(std::memory_order_relaxed);
+
+    for (;;) {
+        cell = &m_Cells[pos & (k_RingSize - 1)];
+        size_t sequence = cell->sequence.load(std::memory_order_acquire);
+        intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+
+        if (diff == 0) {
+            // This cell is free, so try to claim it
+            if (m_EnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        }
+        else if (diff < 0) {
+            // The writer hasn't caught up yet
+            m_DroppedRecords.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        else {
+            // Another producer claimed it first
+            pos = m_EnqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    LogRecord& record = cell->record;
+    record.source = source;
+    record.category = category;
+    record.priority = priority;
+    record.timeMs = timeMs;
+    if (textLength <= LogRecord::k_InlineTextSize) {
+        SDL_memcpy(record.text, text, textLength);
+        record.textLength = textLength;
+        record.overflowText = nullptr;
+    }
+    else {
+        // Rare, so it's not worth making the records bigger for these
+        record.overflowText = new QString(QString::fromUtf8(text, textLength));
+        record.textLength = 0;
+    }
+
+    cell->sequence.store(pos + 1, std::memory_order_release);
+
+    // Only pay for the wakeup if the writer is waiting for us
+    if (m_WriterSleeping.exchange(false, std::memory_order_acq_rel)) {
+        SDL_SemPost(m_RecordsAvailable);
+    }
+
+    return true;
+}
+
+bool AsyncLogger::drain()
+{
+    bool wroteAny = false;
+
+    for (;;) {
+        Cell* cell = &m_Cells[m_DequeuePos & (k_RingSize - 1)];
+        if (cell->sequence.load(std::memory_order_acquire) != m_DequeuePos + 1) {
+            break;
+        }
+
+        LogRecord& record = cell->record;
+        if (record.overflowText != nullptr) {
+            QByteArray text = record.overflowText->toUtf8();
+            m_WriteCallback(record, text.constData());
+            delete record.overflowText;
+        }
+        else {
+            // Records aren't null-terminated
+            char text[LogRecord::k_InlineTextSize + 1];
+            SDL_memcpy(text, record.text, record.textLength);
+            text[record.textLength] = 0;
+            m_WriteCallback(record, text);
+        }
+
+        cell->sequence.store(m_DequeuePos + k_RingSize, std::memory_order_release);
+        m_DequeuePos++;
+        wroteAny = true;
+    }
+
+    uint32_t dropped = m_DroppedRecords.load(std::memory_order_relaxed);
+    if (dropped != m_ReportedDroppedRecords) {
+        m_DropCallback(dropped - m_ReportedDroppedRecords);
+        m_ReportedDroppedRecords = dropped;
+    }
+
+    return wroteAny;
+}
+
+int AsyncLogger::writerThreadProc(void* context)
+{
+    auto me = reinterpret_cast<AsyncLogger*>(context);
+
+    SDL_SetThreadPriority(SDL_THREAD_PRIORITY_LOW);
+
+    while (!me->m_Stopping) {
+        if (!me->drain()) {
+            // Let producers know they need to wake us, then check once
+            // more to avoid missing a record queued in between.
+            me->m_WriterSleeping = true;
+            if (!me->drain()) {
+                SDL_SemWaitTimeout(me->m_RecordsAvailable, WRITER_WAIT_TIMEOUT_MS);
+            }
+            me->m_WriterSleeping = false;
+        }
+    }
+
+    me->drain();
+    return 0;
+}
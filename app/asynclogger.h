@@ -0,0 +1,81 @@
+#pragma once
+
+#include "SDL_compat.h"
+
+#include <QString>
+
+#include <atomic>
+
+// Fixed-size log record. Messages that don't fit inline are carried
+// in a heap-allocated overflow string instead.
+struct LogRecord
+{
+    enum Source : uint8_t {
+        SourceSdl,
+        SourceQt,
+        SourceFFmpeg,
+
+        // Unprefixed text that continues the previous FFmpeg line
+        SourceFFmpegContinuation,
+    };
+
+    static const int k_InlineTextSize = 480;
+
+    uint8_t source;
+    int category;
+    int priority;
+    qint64 timeMs;
+    QString* overflowText;
+    int textLength;
+    char text[k_InlineTextSize];
+};
+
+// Bounded multi-producer single-consumer queue of log records. Producers
+// never block or allocate for messages that fit inline. If the queue is
+// full, the record is dropped and counted. A single thread formats and
+// writes the records in order.
+class AsyncLogger
+{
+public:
+    typedef void (*WriteCallback)(const LogRecord& record, const char* text);
+    typedef void (*DropCallback)(uint32_t droppedRecords);
+
+    AsyncLogger(WriteCallback writeCallback, DropCallback dropCallback);
+
+    ~AsyncLogger();
+
+    void start();
+
+    // Writes all queued records before returning
+    void stop();
+
+    // Returns false if the record was dropped
+    bool log(LogRecord::Source source, int category, int priority,
+             qint64 timeMs, const char* text, int textLength);
+
+private:
+    static const int k_RingSize = 1024;
+    static_assert((k_RingSize & (k_RingSize - 1)) == 0, "Ring size must be a power of 2");
+
+    struct Cell {
+        std::atomic<size_t> sequence;
+        LogRecord record;
+    };
+
+    bool drain();
+
+    static
+    int writerThreadProc(void* context);
+
+    WriteCallback m_WriteCallback;
+    DropCallback m_DropCallback;
+    Cell m_Cells[k_RingSize];
+    alignas(64) std::atomic<size_t> m_EnqueuePos;
+    alignas(64) size_t m_DequeuePos;
+    std::atomic<uint32_t> m_DroppedRecords;
+    uint32_t m_ReportedDroppedRecords;
+    std::atomic<bool> m_WriterSleeping;
+    std::atomic<bool> m_Stopping;
+    SDL_sem* m_RecordsAvailable;
+    SDL_Thread* m_WriterThread;
+};
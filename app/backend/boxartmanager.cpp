@@ -3,90 +3,247 @@
 
 #include <QImageReader>
 #include <QImageWriter>
+#include <QBuffer>
+#include <QSaveFile>
+#include <QCache>
+#include <QMutex>
+#include <QFileInfo>
+
+// The original image exactly as the host sent it. QImageReader
+// detects the real format from the contents.
+#define BOXART_ORIGINAL_SUFFIX ".img"
+
+// Downscaled copy that the app grid actually displays
+#define BOXART_THUMBNAIL_SUFFIX ".thumb.png"
+
+// Older versions re-encoded the original to PNG
+#define BOXART_LEGACY_SUFFIX ".png"
+
+// App grid tiles are 200x267. Thumbnails are twice that
+// so they still look sharp on HiDPI displays.
+#define BOXART_THUMBNAIL_WIDTH 400
+#define BOXART_THUMBNAIL_HEIGHT 534
+
+// Memory budget for decoded thumbnails (in KB)
+#define BOXART_THUMBNAIL_CACHE_KB (64 * 1024)
+
+// 4 is a good balance between fast loading for large
+// app grids and not crushing GFE with tons of requests
+// and causing UI jank from constantly stalling to decode
+// new images.
+#define BOXART_MAX_ACTIVE_FETCHES 4
+#define BOXART_MAX_ACTIVE_FETCHES_PER_HOST 2
+
+static QMutex s_ThumbnailCacheLock;
+static QCache<QString, QImage> s_ThumbnailCache(BOXART_THUMBNAIL_CACHE_KB);
+
+static QString getThumbnailCacheKey(const QString& uuid, int appId)
+{
+    return uuid + "/" + QString::number(appId);
+}
 
 BoxArtManager::BoxArtManager(QObject *parent) :
-    QObject(parent),
-    m_BoxArtDir(Path::getBoxArtCacheDir()),
-    m_ThreadPool(this)
+    QObject(parent)
 {
-    // 4 is a good balance between fast loading for large
-    // app grids and not crushing GFE with tons of requests
-    // and causing UI jank from constantly stalling to decode
-    // new images.
-    m_ThreadPool.setMaxThreadCount(4);
-    if (!m_BoxArtDir.exists()) {
-        m_BoxArtDir.mkpath(".");
+    QDir boxArtDir(Path::getBoxArtCacheDir());
+    if (!boxArtDir.exists()) {
+        boxArtDir.mkpath(".");
     }
 }
 
+BoxArtManager::~BoxArtManager()
+{
+    // Nobody is going to display anything we haven't fetched yet
+    BoxArtFetchScheduler::get()->cancel(this);
+}
+
 QString
-BoxArtManager::getFilePathForBoxArt(NvComputer* computer, int appId)
+BoxArtManager::getFilePathForBoxArt(const QString& uuid, int appId, const char* suffix)
 {
-    QDir dir = m_BoxArtDir;
+    QDir dir(Path::getBoxArtCacheDir());
 
     // Create the cache directory if it did not already exist
-    if (!dir.exists(computer->uuid)) {
-        dir.mkdir(computer->uuid);
+    if (!dir.exists(uuid)) {
+        dir.mkdir(uuid);
     }
 
     // Change to this computer's box art cache folder
-    dir.cd(computer->uuid);
+    dir.cd(uuid);
 
-    // Try to open the cached file
-    return dir.filePath(QString::number(appId) + ".png");
+    return dir.filePath(QString::number(appId) + suffix);
 }
 
-class NetworkBoxArtLoadTask : public QObject, public QRunnable
+bool
+BoxArtManager::isBoxArtCached(const QString& uuid, int appId)
 {
-    Q_OBJECT
+    // This is called for each grid tile as it scrolls into view,
+    // so avoid touching the disk if we have it in memory.
+    {
+        QMutexLocker locker(&s_ThumbnailCacheLock);
+        if (s_ThumbnailCache.contains(getThumbnailCacheKey(uuid, appId))) {
+            return true;
+        }
+    }
 
+    for (const char* suffix : { BOXART_THUMBNAIL_SUFFIX, BOXART_ORIGINAL_SUFFIX, BOXART_LEGACY_SUFFIX }) {
+        QFileInfo cacheFile(getFilePathForBoxArt(uuid, appId, suffix));
+        if (cacheFile.exists() && cacheFile.size() > 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+QUrl
+BoxArtManager::getBoxArtUrl(const QString& uuid, int appId)
+{
+    return QUrl("image://boxart/" + getThumbnailCacheKey(uuid, appId));
+}
+
+static QImage createThumbnail(const QString& sourcePath)
+{
+    QImageReader reader(sourcePath);
+    QSize originalSize = reader.size();
+
+    // AppView.qml recognizes the GFE 3.0 placeholder image by its exact
+    // dimensions, so that one must be passed through unscaled.
+    bool isKnownPlaceholder = originalSize == QSize(628, 888);
+
+    // Letting the decoder scale is much cheaper than decoding at full size
+    // and scaling afterwards, especially for JPEG.
+    if (originalSize.isValid() && !isKnownPlaceholder &&
+            (originalSize.width() > BOXART_THUMBNAIL_WIDTH || originalSize.height() > BOXART_THUMBNAIL_HEIGHT)) {
+        reader.setScaledSize(originalSize.scaled(BOXART_THUMBNAIL_WIDTH, BOXART_THUMBNAIL_HEIGHT, Qt::KeepAspectRatio));
+    }
+
+    return reader.read();
+}
+
+QImage
+BoxArtManager::loadThumbnail(const QString& uuid, int appId)
+{
+    QString cacheKey = getThumbnailCacheKey(uuid, appId);
+
+    {
+        QMutexLocker locker(&s_ThumbnailCacheLock);
+        QImage* cachedThumbnail = s_ThumbnailCache.object(cacheKey);
+        if (cachedThumbnail != nullptr) {
+            return *cachedThumbnail;
+        }
+    }
+
+    QString thumbnailPath = getFilePathForBoxArt(uuid, appId, BOXART_THUMBNAIL_SUFFIX);
+    QImage thumbnail(thumbnailPath);
+    if (thumbnail.isNull()) {
+        // Generate the thumbnail from the original (or legacy PNG) once and keep it on disk
+        for (const char* suffix : { BOXART_ORIGINAL_SUFFIX, BOXART_LEGACY_SUFFIX }) {
+            QString sourcePath = getFilePathForBoxArt(uuid, appId, suffix);
+            if (QFile::exists(sourcePath)) {
+                thumbnail = createThumbnail(sourcePath);
+                if (!thumbnail.isNull()) {
+                    break;
+                }
+            }
+        }
+
+        if (thumbnail.isNull()) {
+            return QImage();
+        }
+
+        // The grid and the fetch workers may generate the same thumbnail at once,
+        // so it's swapped in only once fully written like the original image.
+        QSaveFile thumbnailFile(thumbnailPath);
+        if (!thumbnailFile.open(QIODevice::WriteOnly) ||
+                !thumbnail.save(&thumbnailFile, "PNG") ||
+                !thumbnailFile.commit()) {
+            qWarning() << "Failed to cache box art thumbnail:" << thumbnailPath;
+        }
+    }
+
+    {
+        QMutexLocker locker(&s_ThumbnailCacheLock);
+        s_ThumbnailCache.insert(cacheKey, new QImage(thumbnail),
+                                qMax(1, thumbnail.bytesPerLine() * thumbnail.height() / 1024));
+    }
+
+    return thumbnail;
+}
+
+class NetworkBoxArtLoadTask : public QRunnable
+{
 public:
-    NetworkBoxArtLoadTask(BoxArtManager* boxArtManager, NvComputer* computer, NvApp& app)
-        : m_Bam(boxArtManager),
+    NetworkBoxArtLoadTask(BoxArtFetchScheduler* scheduler, const NvComputer& computer, int appId, QString key)
+        : m_Scheduler(scheduler),
           m_Computer(computer),
-          m_App(app)
+          m_AppId(appId),
+          m_Key(key)
     {
-        connect(this, &NetworkBoxArtLoadTask::boxArtFetchCompleted,
-                boxArtManager, &BoxArtManager::handleBoxArtLoadComplete);
     }
 
-signals:
-    void boxArtFetchCompleted(NvComputer* computer, NvApp app, QUrl image);
-
 private:
     void run()
     {
-        QUrl image = m_Bam->loadBoxArtFromNetwork(m_Computer, m_App.id);
+        QElapsedTimer fetchTimer;
+        fetchTimer.start();
+
+        QUrl image = BoxArtManager::loadBoxArtFromNetwork(m_Computer, m_AppId);
         if (image.isEmpty()) {
             // Give it another shot if it fails once
-            image = m_Bam->loadBoxArtFromNetwork(m_Computer, m_App.id);
+            image = BoxArtManager::loadBoxArtFromNetwork(m_Computer, m_AppId);
         }
-        emit boxArtFetchCompleted(m_Computer, m_App, image);
+
+        QMetaObject::invokeMethod(m_Scheduler, "handleFetchComplete", Qt::QueuedConnection,
+                                  Q_ARG(QString, m_Key),
+                                  Q_ARG(QUrl, image),
+                                  Q_ARG(qint64, fetchTimer.elapsed()));
     }
 
-    BoxArtManager* m_Bam;
-    NvComputer* m_Computer;
-    NvApp m_App;
+    BoxArtFetchScheduler* m_Scheduler;
+    NvComputer m_Computer;
+    int m_AppId;
+    QString m_Key;
 };
 
 QUrl BoxArtManager::loadBoxArt(NvComputer* computer, NvApp& app)
 {
-    // Try to open the cached file if it exists and contains data
-    QFile cacheFile(getFilePathForBoxArt(computer, app.id));
-    if (cacheFile.exists() && cacheFile.size() > 0) {
-        return QUrl::fromLocalFile(cacheFile.fileName());
+    // Use the cached image if we have it in memory or on disk
+    if (isBoxArtCached(computer->uuid, app.id)) {
+        BoxArtFetchScheduler::get()->recordCacheHit();
+        return getBoxArtUrl(computer->uuid, app.id);
     }
 
     // If we get here, we need to fetch asynchronously.
-    // Kick off a worker on our thread pool to do just that.
-    NetworkBoxArtLoadTask* netLoadTask = new NetworkBoxArtLoadTask(this, computer, app);
-    m_ThreadPool.start(netLoadTask);
+    BoxArtFetchScheduler::get()->request(this, computer, app);
 
     // Return the placeholder then we can notify the caller
     // later when the real image is ready.
     return QUrl("qrc:/res/no_app_image.png");
 }
 
+QUrl BoxArtManager::loadBoxArtFile(NvComputer* computer, NvApp& app)
+{
+    for (const char* suffix : { BOXART_ORIGINAL_SUFFIX, BOXART_LEGACY_SUFFIX }) {
+        QFileInfo cacheFile(getFilePathForBoxArt(computer->uuid, app.id, suffix));
+        if (cacheFile.exists() && cacheFile.size() > 0) {
+            return QUrl::fromLocalFile(cacheFile.filePath());
+        }
+    }
+
+    // Queue the fetch and return the placeholder
+    return loadBoxArt(computer, app);
+}
+
+void BoxArtManager::setVisibleApps(NvComputer* computer, const QVector<int>& appIds)
+{
+    BoxArtFetchScheduler::get()->setVisibleApps(this, computer, appIds);
+}
+
+void BoxArtManager::cancelPendingFetches()
+{
+    BoxArtFetchScheduler::get()->cancel(this);
+}
+
 void BoxArtManager::deleteBoxArt(NvComputer* computer)
 {
     QDir dir(Path::getBoxArtCacheDir());
@@ -95,37 +252,303 @@ void BoxArtManager::deleteBoxArt(NvComputer* computer)
     if (dir.cd(computer->uuid)) {
         dir.removeRecursively();
     }
+
+    // Drop any of its thumbnails that we're holding in memory
+    QMutexLocker locker(&s_ThumbnailCacheLock);
+    const QList<QString> cacheKeys = s_ThumbnailCache.keys();
+    for (const QString& cacheKey : cacheKeys) {
+        if (cacheKey.startsWith(computer->uuid + "/")) {
+            s_ThumbnailCache.remove(cacheKey);
+        }
+    }
 }
 
-void BoxArtManager::handleBoxArtLoadComplete(NvComputer* computer, NvApp app, QUrl image)
+void BoxArtManager::handleBoxArtLoadComplete(QString computerUuid, NvApp app, QUrl image)
 {
     if (!image.isEmpty()) {
-        emit boxArtLoadComplete(computer, app, image);
+        emit boxArtLoadComplete(computerUuid, app, image);
     }
 }
 
-QUrl BoxArtManager::loadBoxArtFromNetwork(NvComputer* computer, int appId)
+QUrl BoxArtManager::loadBoxArtFromNetwork(const NvComputer& computer, int appId)
 {
-    NvHTTP http(computer);
+    NvHTTP http(computer.activeAddress, computer.activeHttpsPort, computer.serverCert, !computer.isNvidiaServerSoftware);
 
-    QString cachePath = getFilePathForBoxArt(computer, appId);
-    QImage image;
+    QByteArray imageData;
     try {
-        image = http.getBoxArt(appId);
+        imageData = http.getBoxArt(appId);
     } catch (...) {}
 
-    // Cache the box art on disk if it loaded
-    if (!image.isNull()) {
-        if (image.save(cachePath)) {
-            return QUrl::fromLocalFile(cachePath);
+    // Make sure this is actually an image we can read before caching it
+    QBuffer imageBuffer(&imageData);
+    if (imageData.isEmpty() || !QImageReader(&imageBuffer).canRead()) {
+        return QUrl();
+    }
+
+    // Cache the box art on disk exactly as we received it
+    QSaveFile cacheFile(getFilePathForBoxArt(computer.uuid, appId, BOXART_ORIGINAL_SUFFIX));
+    if (!cacheFile.open(QIODevice::WriteOnly) ||
+            cacheFile.write(imageData) != imageData.size() ||
+            !cacheFile.commit()) {
+        return QUrl();
+    }
+
+    // Generate the thumbnail here on our worker thread, so the
+    // app grid never has to decode the full size image.
+    if (loadThumbnail(computer.uuid, appId).isNull()) {
+        QFile(cacheFile.fileName()).remove();
+        return QUrl();
+    }
+
+    return getBoxArtUrl(computer.uuid, appId);
+}
+
+BoxArtFetchScheduler* BoxArtFetchScheduler::s_Scheduler;
+
+BoxArtFetchScheduler*
+BoxArtFetchScheduler::get()
+{
+    // This will always be called first on the main thread,
+    // so it's safe to initialize without locks.
+    if (s_Scheduler == nullptr) {
+        s_Scheduler = new BoxArtFetchScheduler();
+    }
+
+    return s_Scheduler;
+}
+
+BoxArtFetchScheduler::BoxArtFetchScheduler()
+    : m_ActiveFetches(0),
+      m_NextSequence(0),
+      m_ThreadPool(this),
+      m_CacheHits(0),
+      m_CacheMisses(0),
+      m_MergedRequests(0),
+      m_CancelledFetches(0),
+      m_CompletedFetches(0),
+      m_FailedFetches(0),
+      m_TotalQueueTimeMs(0),
+      m_MaxQueueTimeMs(0),
+      m_TotalFetchTimeMs(0),
+      m_MaxFetchTimeMs(0)
+{
+    m_ThreadPool.setMaxThreadCount(BOXART_MAX_ACTIVE_FETCHES);
+}
+
+void BoxArtFetchScheduler::request(BoxArtManager* requester, NvComputer* computer, const NvApp& app)
+{
+    QString key = getThumbnailCacheKey(computer->uuid, app.id);
+
+    m_CacheMisses++;
+
+    PendingFetch* fetch = m_Fetches.value(key);
+    if (fetch != nullptr) {
+        // Someone already asked for this one, so just add ourselves to the
+        // list to notify. A repeat request means the tile was just recreated.
+        m_MergedRequests++;
+        if (!fetch->requesters.contains(requester)) {
+            fetch->requesters.append(requester);
+        }
+        int visibleRank = m_VisibleApps.value(requester).indexOf(app.id);
+        if (visibleRank >= 0) {
+            fetch->visibleRank = visibleRank;
+        }
+        fetch->sequence = m_NextSequence++;
+        return;
+    }
+
+    fetch = new PendingFetch();
+    fetch->key = key;
+    fetch->uuid = computer->uuid;
+    {
+        QReadLocker lock(&computer->lock);
+        fetch->computer = *computer;
+    }
+    fetch->app = app;
+    fetch->requesters.append(requester);
+    fetch->visibleRank = m_VisibleApps.value(requester).indexOf(app.id);
+    fetch->sequence = m_NextSequence++;
+    fetch->inFlight = false;
+    fetch->queuedTimer.start();
+    m_Fetches.insert(key, fetch);
+
+    dispatch();
+}
+
+void BoxArtFetchScheduler::setVisibleApps(BoxArtManager* requester, NvComputer* computer, const QVector<int>& appIds)
+{
+    // Remember these for requests that arrive after the range was reported
+    m_VisibleApps.insert(requester, appIds);
+
+    for (PendingFetch* fetch : std::as_const(m_Fetches)) {
+        if (fetch->uuid == computer->uuid && fetch->requesters.contains(requester)) {
+            fetch->visibleRank = appIds.indexOf(fetch->app.id);
+        }
+    }
+}
+
+void BoxArtFetchScheduler::cancel(BoxArtManager* requester)
+{
+    m_VisibleApps.remove(requester);
+
+    QMutableHashIterator<QString, PendingFetch*> i(m_Fetches);
+    while (i.hasNext()) {
+        PendingFetch* fetch = i.next().value();
+
+        fetch->requesters.removeAll(requester);
+
+        // Fetches already in progress will finish and populate the cache,
+        // but nobody will be notified unless they asked for it again.
+        if (fetch->requesters.isEmpty() && !fetch->inFlight) {
+            m_CancelledFetches++;
+            delete fetch;
+            i.remove();
+        }
+    }
+}
+
+void BoxArtFetchScheduler::cancelHost(const QString& uuid)
+{
+    QMutableHashIterator<QString, PendingFetch*> i(m_Fetches);
+    while (i.hasNext()) {
+        PendingFetch* fetch = i.next().value();
+        if (fetch->uuid != uuid) {
+            continue;
+        }
+
+        // Fetches in progress can't be stopped, but their results
+        // are for a host that no longer exists.
+        fetch->requesters.clear();
+        if (!fetch->inFlight) {
+            m_CancelledFetches++;
+            delete fetch;
+            i.remove();
+        }
+    }
+}
+
+void BoxArtFetchScheduler::recordCacheHit()
+{
+    m_CacheHits++;
+}
+
+bool BoxArtFetchScheduler::isHigherPriority(const PendingFetch* a, const PendingFetch* b)
+{
+    if ((a->visibleRank >= 0) != (b->visibleRank >= 0)) {
+        return a->visibleRank >= 0;
+    }
+    else if (a->visibleRank >= 0) {
+        return a->visibleRank < b->visibleRank;
+    }
+    else {
+        return a->sequence > b->sequence;
+    }
+}
+
+void BoxArtFetchScheduler::dispatch()
+{
+    while (m_ActiveFetches < BOXART_MAX_ACTIVE_FETCHES) {
+        PendingFetch* bestFetch = nullptr;
+
+        for (PendingFetch* fetch : std::as_const(m_Fetches)) {
+            if (fetch->inFlight ||
+                    m_ActiveFetchesPerHost.value(fetch->uuid) >= BOXART_MAX_ACTIVE_FETCHES_PER_HOST) {
+                continue;
+            }
+
+            if (bestFetch == nullptr || isHigherPriority(fetch, bestFetch)) {
+                bestFetch = fetch;
+            }
         }
-        else {
-            // A failed save() may leave a zero byte file. Make sure that's removed.
-            QFile(cachePath).remove();
+
+        if (bestFetch == nullptr) {
+            break;
         }
+
+        qint64 queueTimeMs = bestFetch->queuedTimer.elapsed();
+        m_TotalQueueTimeMs += queueTimeMs;
+        m_MaxQueueTimeMs = qMax(m_MaxQueueTimeMs, queueTimeMs);
+
+        bestFetch->inFlight = true;
+        m_ActiveFetches++;
+        m_ActiveFetchesPerHost[bestFetch->uuid]++;
+        m_ThreadPool.start(new NetworkBoxArtLoadTask(this, bestFetch->computer, bestFetch->app.id, bestFetch->key));
+    }
+}
+
+void BoxArtFetchScheduler::handleFetchComplete(QString key, QUrl image, qint64 fetchTimeMs)
+{
+    PendingFetch* fetch = m_Fetches.take(key);
+    Q_ASSERT(fetch != nullptr && fetch->inFlight);
+
+    m_ActiveFetches--;
+    if (--m_ActiveFetchesPerHost[fetch->uuid] == 0) {
+        m_ActiveFetchesPerHost.remove(fetch->uuid);
+    }
+
+    if (image.isEmpty()) {
+        m_FailedFetches++;
     }
+    else {
+        m_CompletedFetches++;
+    }
+    m_TotalFetchTimeMs += fetchTimeMs;
+    m_MaxFetchTimeMs = qMax(m_MaxFetchTimeMs, fetchTimeMs);
+
+    for (BoxArtManager* requester : std::as_const(fetch->requesters)) {
+        requester->handleBoxArtLoadComplete(fetch->uuid, fetch->app, image);
+    }
+    delete fetch;
+
+    dispatch();
+
+    if (m_Fetches.isEmpty()) {
+        qInfo().noquote() << "Box art fetch queue drained:" << stringifyStats();
+
+        m_CacheHits = m_CacheMisses = m_MergedRequests = 0;
+        m_CancelledFetches = m_CompletedFetches = m_FailedFetches = 0;
+        m_TotalQueueTimeMs = m_MaxQueueTimeMs = 0;
+        m_TotalFetchTimeMs = m_MaxFetchTimeMs = 0;
+    }
+}
+
+QString BoxArtFetchScheduler::stringifyStats()
+{
+    int fetches = m_CompletedFetches + m_FailedFetches;
 
-    return QUrl();
+    return QString("%1 hits, %2 misses (%3 merged), %4 fetched, %5 failed, %6 cancelled, "
+                   "queue time %7 ms avg / %8 ms max, fetch time %9 ms avg / %10 ms max")
+            .arg(m_CacheHits)
+            .arg(m_CacheMisses)
+            .arg(m_MergedRequests)
+            .arg(m_CompletedFetches)
+            .arg(m_FailedFetches)
+            .arg(m_CancelledFetches)
+            .arg(fetches > 0 ? m_TotalQueueTimeMs / fetches : 0)
+            .arg(m_MaxQueueTimeMs)
+            .arg(fetches > 0 ? m_TotalFetchTimeMs / fetches : 0)
+            .arg(m_MaxFetchTimeMs);
 }
 
-#include "boxartmanager.moc"
+BoxArtImageProvider::BoxArtImageProvider()
+    : QQuickImageProvider(QQuickImageProvider::Image,
+                          QQmlImageProviderBase::ForceAsynchronousImageLoading)
+{
+
+}
+
+QImage BoxArtImageProvider::requestImage(const QString& id, QSize* size, const QSize&)
+{
+    // IDs are <uuid>/<appId>
+    int separator = id.lastIndexOf('/');
+    if (separator < 0) {
+        return QImage();
+    }
+
+    QImage image = BoxArtManager::loadThumbnail(id.left(separator), id.mid(separator + 1).toInt());
+    if (size != nullptr) {
+        *size = image.size();
+    }
+
+    return image;
+}
@@ -5,40 +5,171 @@
 #include <QImage>
 #include <QThreadPool>
 #include <QRunnable>
+#include <QHash>
+#include <QElapsedTimer>
+#include <QQuickImageProvider>
 
 class BoxArtManager : public QObject
 {
     Q_OBJECT
 
     friend class NetworkBoxArtLoadTask;
+    friend class BoxArtImageProvider;
+    friend class BoxArtFetchScheduler;
 
 public:
     explicit BoxArtManager(QObject *parent = nullptr);
 
+    virtual ~BoxArtManager();
+
     QUrl
     loadBoxArt(NvComputer* computer, NvApp& app);
 
+    // Like loadBoxArt() but returns a file URL for consumers outside of QML
+    QUrl
+    loadBoxArtFile(NvComputer* computer, NvApp& app);
+
+    // Fetches for these apps (in display order) are started before any others
+    void
+    setVisibleApps(NvComputer* computer, const QVector<int>& appIds);
+
+    // Drops fetches that haven't started yet and stops notifying us
+    // about the ones that have
+    void
+    cancelPendingFetches();
+
     static
     void
     deleteBoxArt(NvComputer* computer);
 
 signals:
     void
-    boxArtLoadComplete(NvComputer* computer, NvApp app, QUrl image);
+    boxArtLoadComplete(QString computerUuid, NvApp app, QUrl image);
 
 public slots:
 
 private slots:
     void
-    handleBoxArtLoadComplete(NvComputer* computer, NvApp app, QUrl image);
+    handleBoxArtLoadComplete(QString computerUuid, NvApp app, QUrl image);
 
 private:
+    static
     QUrl
-    loadBoxArtFromNetwork(NvComputer* computer, int appId);
+    loadBoxArtFromNetwork(const NvComputer& computer, int appId);
 
+    static
     QString
-    getFilePathForBoxArt(NvComputer* computer, int appId);
+    getFilePathForBoxArt(const QString& uuid, int appId, const char* suffix);
+
+    static
+    bool
+    isBoxArtCached(const QString& uuid, int appId);
+
+    static
+    QUrl
+    getBoxArtUrl(const QString& uuid, int appId);
 
-    QDir m_BoxArtDir;
+    static
+    QImage
+    loadThumbnail(const QString& uuid, int appId);
+};
+
+// Fetches box art from hosts on behalf of all BoxArtManagers. Apps that are
+// on screen are fetched first, concurrent requests for the same app are
+// merged, and no single host gets more than a couple of requests at once.
+// This must only be used from the main thread.
+class BoxArtFetchScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    static
+    BoxArtFetchScheduler*
+    get();
+
+    void
+    request(BoxArtManager* requester, NvComputer* computer, const NvApp& app);
+
+    void
+    setVisibleApps(BoxArtManager* requester, NvComputer* computer, const QVector<int>& appIds);
+
+    // Drops all fetches that haven't started yet for this requester
+    void
+    cancel(BoxArtManager* requester);
+
+    // Drops all fetches for a host that's being deleted
+    void
+    cancelHost(const QString& uuid);
+
+    void
+    recordCacheHit();
+
+    QString
+    stringifyStats();
+
+private slots:
+    void
+    handleFetchComplete(QString key, QUrl image, qint64 fetchTimeMs);
+
+private:
+    BoxArtFetchScheduler();
+
+    struct PendingFetch
+    {
+        QString key;
+        QString uuid;
+        NvApp app;
+
+        // Copy of the host taken when the fetch was requested, since
+        // the original may be deleted before the fetch is dispatched
+        NvComputer computer;
+        QList<BoxArtManager*> requesters;
+
+        // Index in the visible range, or -1 if not on screen
+        int visibleRank;
+
+        // Later requests win among apps that aren't known to be visible,
+        // since they're usually for delegates that were just created.
+        quint64 sequence;
+
+        bool inFlight;
+        QElapsedTimer queuedTimer;
+    };
+
+    bool
+    isHigherPriority(const PendingFetch* a, const PendingFetch* b);
+
+    void
+    dispatch();
+
+    QHash<QString, PendingFetch*> m_Fetches;
+    QHash<BoxArtManager*, QVector<int>> m_VisibleApps;
+    QHash<QString, int> m_ActiveFetchesPerHost;
+    int m_ActiveFetches;
+    quint64 m_NextSequence;
     QThreadPool m_ThreadPool;
+
+    // Counters since the last time the queue drained
+    int m_CacheHits;
+    int m_CacheMisses;
+    int m_MergedRequests;
+    int m_CancelledFetches;
+    int m_CompletedFetches;
+    int m_FailedFetches;
+    qint64 m_TotalQueueTimeMs;
+    qint64 m_MaxQueueTimeMs;
+    qint64 m_TotalFetchTimeMs;
+    qint64 m_MaxFetchTimeMs;
+
+    static BoxArtFetchScheduler* s_Scheduler;
+};
+
+// Provides image://boxart/<uuid>/<appId> URLs for the app grid
+class BoxArtImageProvider : public QQuickImageProvider
+{
+public:
+    BoxArtImageProvider();
+
+    QImage
+    requestImage(const QString& id, QSize* size, const QSize& requestedSize) override;
 };
@@ -2,6 +2,8 @@
 #include "boxartmanager.h"
 #include "nvhttp.h"
 #include "nvpairingmanager.h"
+#include "hostpoller.h"
+#include "path.h"
 
 #include <Limelight.h>
 #include <QtEndian>
@@ -10,188 +12,53 @@
 #include <QThreadPool>
 #include <QCoreApplication>
 #include <QRandomGenerator>
+#include <QDir>
 
 #define SER_HOSTS "hosts"
 #define SER_HOSTS_BACKUP "hostsbackup"
 
-class PcMonitorThread : public QThread
-{
-    Q_OBJECT
-
-#define TRIES_BEFORE_OFFLINING 2
-#define POLLS_PER_APPLIST_FETCH 10
-
-public:
-    PcMonitorThread(NvComputer* computer)
-        : m_Computer(computer)
-    {
-        setObjectName("Polling thread for " + computer->name);
-    }
-
-private:
-    bool tryPollComputer(QNetworkAccessManager* nam, NvAddress address, bool& changed)
-    {
-        NvHTTP http(address, 0, m_Computer->serverCert, !m_Computer->isNvidiaServerSoftware, nam);
-
-        QString serverInfo;
-        try {
-            serverInfo = http.getServerInfo(NvHTTP::NvLogLevel::NVLL_NONE, true);
-        } catch (...) {
-            return false;
-        }
-
-        NvComputer newState(http, serverInfo);
-
-        // Ensure the machine that responded is the one we intended to contact
-        if (m_Computer->uuid != newState.uuid) {
-            qInfo() << "Found unexpected PC" << newState.name << "looking for" << m_Computer->name;
-            return false;
-        }
-
-        changed = m_Computer->update(newState);
-        return true;
-    }
-
-    bool updateAppList(QNetworkAccessManager* nam, bool& changed)
-    {
-        NvHTTP http(m_Computer, nam);
-
-        QVector<NvApp> appList;
-
-        try {
-            appList = http.getAppList();
-            if (appList.isEmpty()) {
-                return false;
-            }
-        } catch (...) {
-            return false;
-        }
-
-        QWriteLocker lock(&m_Computer->lock);
-        changed = m_Computer->updateAppList(appList);
-        return true;
-    }
-
-    void run() override
-    {
-        // Reduce the power and performance impact of our
-        // computer status polling while it's running.
-        setPriority(QThread::LowPriority);
-#if QT_VERSION >= QT_VERSION_CHECK(6, 9, 0)
-        setServiceLevel(QThread::QualityOfService::Eco);
-#endif
-
-        // Share the QNetworkAccessManager to conserve resources when polling.
-        // Each instance creates a worker thread, so sharing them ensures that
-        // we are not spamming a new thread for every single polling attempt.
-        //
-        // Since QThread inherit the priority of the current thread, this also
-        // ensures that the NAM's worker thread will inherit our lower priority.
-        QNetworkAccessManager nam;
-
-        // Always fetch the applist the first time
-        int pollsSinceLastAppListFetch = POLLS_PER_APPLIST_FETCH;
-        while (!isInterruptionRequested()) {
-            bool stateChanged = false;
-            bool online = false;
-            bool wasOnline = m_Computer->state == NvComputer::CS_ONLINE;
-            for (int i = 0; i < (wasOnline ? TRIES_BEFORE_OFFLINING : 1) && !online; i++) {
-                for (auto& address : m_Computer->uniqueAddresses()) {
-                    if (isInterruptionRequested()) {
-                        return;
-                    }
-
-                    if (tryPollComputer(&nam, address, stateChanged)) {
-                        if (!wasOnline) {
-                            qInfo() << m_Computer->name << "is now online at" << m_Computer->activeAddress.toString();
-                        }
-                        online = true;
-                        break;
-                    }
-                }
-            }
-
-            // Check if we failed after all retry attempts
-            // Note: we don't need to acquire the read lock here,
-            // because we're on the writing thread.
-            if (!online && m_Computer->state != NvComputer::CS_OFFLINE) {
-                qInfo() << m_Computer->name << "is now offline";
-                m_Computer->state = NvComputer::CS_OFFLINE;
-                stateChanged = true;
-            }
-
-            // Grab the applist if it's empty or it's been long enough that we need to refresh
-            pollsSinceLastAppListFetch++;
-            if (m_Computer->state == NvComputer::CS_ONLINE &&
-                    m_Computer->pairState == NvComputer::PS_PAIRED &&
-                    (m_Computer->appList.isEmpty() || pollsSinceLastAppListFetch >= POLLS_PER_APPLIST_FETCH)) {
-                // Notify prior to the app list poll since it may take a while, and we don't
-                // want to delay onlining of a machine, especially if we already have a cached list.
-                if (stateChanged) {
-                    emit computerStateChanged(m_Computer);
-                    stateChanged = false;
-                }
-
-                if (updateAppList(&nam, stateChanged)) {
-                    pollsSinceLastAppListFetch = 0;
-                }
-            }
-
-            if (stateChanged) {
-                // Tell anyone listening that we've changed state
-                emit computerStateChanged(m_Computer);
-            }
-
-            // Wait a bit to poll again, but do it in 100 ms chunks
-            // so we can be interrupted reasonably quickly.
-            // FIXME: QWaitCondition would be better.
-            for (int i = 0; i < 30 && !isInterruptionRequested(); i++) {
-                QThread::msleep(100);
-            }
-        }
-    }
-
-signals:
-   void computerStateChanged(NvComputer* computer);
-
-private:
-    NvComputer* m_Computer;
-};
+#define HOST_STORE_FILE "hosts.dat"
 
 ComputerManager::ComputerManager(StreamingPreferences* prefs)
     : m_Prefs(prefs),
       m_PollingRef(0),
       m_MdnsBrowser(nullptr),
       m_CompatFetcher(nullptr),
-      m_NeedsDelayedFlush(false)
+      m_HostStore(QDir(Path::getUserDataDir()).absoluteFilePath(HOST_STORE_FILE))
 {
-    QSettings settings;
+    QVector<NvComputer*> hosts;
 
-    // If there's a hosts backup copy, we must have failed to commit
-    // a previous update before exiting. Restore the backup now.
-    int hosts = settings.beginReadArray(SER_HOSTS_BACKUP);
-    if (hosts == 0) {
-        // If there's no host backup, read from the primary location.
-        settings.endArray();
-        hosts = settings.beginReadArray(SER_HOSTS);
+    if (!m_HostStore.load(hosts)) {
+        // This is our first run with the host store, so bring over any
+        // hosts that older versions saved in QSettings. Those are left
+        // in place in case the user goes back to an older version.
+        loadLegacyHosts(hosts);
+        m_HostStore.replaceAll(hosts);
+    }
+    else if (m_HostStore.isReadOnly()) {
+        // The host store is there but unreadable, so the best we can do
+        // is the hosts from before it was created. Nothing will be saved.
+        qWarning() << "Host store is unreadable. Changes to hosts will not be saved.";
+        loadLegacyHosts(hosts);
     }
 
-    // Inflate our hosts from QSettings
-    for (int i = 0; i < hosts; i++) {
-        settings.setArrayIndex(i);
-        NvComputer* computer = new NvComputer(settings);
+    for (NvComputer* computer : std::as_const(hosts)) {
         m_KnownHosts[computer->uuid] = computer;
         m_LastSerializedHosts[computer->uuid] = *computer;
     }
-    settings.endArray();
 
     // Fetch latest compatibility data asynchronously
     m_CompatFetcher.start();
 
-    // Start the delayed flush thread to handle saveHosts() calls
+    // Start the delayed flush thread to handle saveHost() calls
     m_DelayedFlushThread = new DelayedFlushThread(this);
     m_DelayedFlushThread->start();
 
+    // All hosts are polled from a single thread owned by the HostPoller
+    m_HostPoller = new HostPoller();
+    connect(m_HostPoller, &HostPoller::computerStateChanged,
+            this, &ComputerManager::handleComputerStateChanged);
+
     // To quit in a timely manner, we must block additional requests
     // after we receive the aboutToQuit() signal. This is necessary
     // because NvHTTP uses aboutToQuit() to abort requests in progress
@@ -214,7 +81,7 @@ ComputerManager::~ComputerManager()
         delete m_DelayedFlushThread;
 
         // Delayed flushes should have completed by now
-        Q_ASSERT(!m_NeedsDelayedFlush);
+        Q_ASSERT(m_DirtyHosts.isEmpty());
     }
 
     QWriteLocker lock(&m_Lock);
@@ -230,15 +97,9 @@ ComputerManager::~ComputerManager()
     delete m_MdnsBrowser;
     m_MdnsBrowser = nullptr;
 
-    // Interrupt polling
-    for (ComputerPollingEntry* entry : std::as_const(m_PollEntries)) {
-        entry->interrupt();
-    }
-
-    // Delete all polling entries (and associated threads)
-    for (ComputerPollingEntry* entry : std::as_const(m_PollEntries)) {
-        delete entry;
-    }
+    // Stop polling and tear down the polling thread
+    delete m_HostPoller;
+    m_HostPoller = nullptr;
 
     // Destroy all NvComputer objects now that polling is halted
     for (NvComputer* computer : std::as_const(m_KnownHosts)) {
@@ -246,79 +107,96 @@ ComputerManager::~ComputerManager()
     }
 }
 
+void ComputerManager::loadLegacyHosts(QVector<NvComputer*>& hosts)
+{
+    QSettings settings;
+
+    // If there's a hosts backup copy, we must have failed to commit
+    // a previous update before exiting. Restore the backup now.
+    int hostCount = settings.beginReadArray(SER_HOSTS_BACKUP);
+    if (hostCount == 0) {
+        // If there's no host backup, read from the primary location.
+        settings.endArray();
+        hostCount = settings.beginReadArray(SER_HOSTS);
+    }
+
+    for (int i = 0; i < hostCount; i++) {
+        settings.setArrayIndex(i);
+        hosts.append(new NvComputer(settings));
+    }
+    settings.endArray();
+
+    if (hostCount != 0) {
+        qInfo() << "Migrating" << hostCount << "hosts from QSettings";
+    }
+}
+
 void DelayedFlushThread::run() {
     for (;;) {
+        QSet<QString> dirtyHosts;
+
         // Wait for a delayed flush request or an interruption
         {
             QMutexLocker locker(&m_ComputerManager->m_DelayedFlushMutex);
 
-            while (!QThread::currentThread()->isInterruptionRequested() && !m_ComputerManager->m_NeedsDelayedFlush) {
+            while (!QThread::currentThread()->isInterruptionRequested() && m_ComputerManager->m_DirtyHosts.isEmpty()) {
                 m_ComputerManager->m_DelayedFlushCondition.wait(&m_ComputerManager->m_DelayedFlushMutex);
             }
 
             // Bail without flushing if we woke up for an interruption alone.
             // If we have both an interruption and a flush request, do the flush.
-            if (!m_ComputerManager->m_NeedsDelayedFlush) {
+            if (m_ComputerManager->m_DirtyHosts.isEmpty()) {
                 Q_ASSERT(QThread::currentThread()->isInterruptionRequested());
                 break;
             }
 
-            // Reset the delayed flush flag to ensure any racing saveHosts() call will set it again
-            m_ComputerManager->m_NeedsDelayedFlush = false;
-
-            // Update the last serialized hosts map under the delayed flush mutex
-            m_ComputerManager->m_LastSerializedHosts.clear();
-            for (const NvComputer* computer : std::as_const(m_ComputerManager->m_KnownHosts)) {
-                // Copy the current state of the NvComputer to allow us to check later if we need
-                // to serialize it again when attribute updates occur.
-                QReadLocker computerLock(&computer->lock);
-                m_ComputerManager->m_LastSerializedHosts[computer->uuid] = *computer;
-            }
+            // Take the dirty set to ensure any racing saveHost() call will start a new one
+            dirtyHosts.swap(m_ComputerManager->m_DirtyHosts);
         }
 
-        // Perform the flush
+        // Copy the current state of the dirty hosts. Any that aren't
+        // known anymore have been deleted since they were queued.
+        QVector<NvComputer> updatedHosts;
+        QStringList removedHosts;
         {
-            QSettings settings;
-
-            // First, write to the backup location
-            settings.beginWriteArray(SER_HOSTS_BACKUP);
-            {
-                QReadLocker lock(&m_ComputerManager->m_Lock);
-                int i = 0;
-                for (const NvComputer* computer : std::as_const(m_ComputerManager->m_KnownHosts)) {
-                    settings.setArrayIndex(i++);
-                    computer->serialize(settings, false);
+            QReadLocker lock(&m_ComputerManager->m_Lock);
+            for (const QString& uuid : std::as_const(dirtyHosts)) {
+                NvComputer* computer = m_ComputerManager->m_KnownHosts.value(uuid);
+                if (computer != nullptr) {
+                    QReadLocker computerLock(&computer->lock);
+                    updatedHosts.append(*computer);
                 }
-            }
-            settings.endArray();
-
-            // Next, write to the primary location
-            settings.remove(SER_HOSTS);
-            settings.beginWriteArray(SER_HOSTS);
-            {
-                QReadLocker lock(&m_ComputerManager->m_Lock);
-                int i = 0;
-                for (const NvComputer* computer : std::as_const(m_ComputerManager->m_KnownHosts)) {
-                    settings.setArrayIndex(i++);
-                    computer->serialize(settings, true);
+                else {
+                    removedHosts.append(uuid);
                 }
             }
-            settings.endArray();
+        }
 
-            // Finally, delete the backup copy
-            settings.remove(SER_HOSTS_BACKUP);
+        // Update the last serialized hosts map to allow us to check later
+        // if we need to serialize these hosts again when attributes change.
+        {
+            QMutexLocker locker(&m_ComputerManager->m_DelayedFlushMutex);
+            for (const NvComputer& computer : std::as_const(updatedHosts)) {
+                m_ComputerManager->m_LastSerializedHosts[computer.uuid] = computer;
+            }
+            for (const QString& uuid : std::as_const(removedHosts)) {
+                m_ComputerManager->m_LastSerializedHosts.remove(uuid);
+            }
         }
+
+        // Perform the flush
+        m_ComputerManager->m_HostStore.commit(updatedHosts, removedHosts);
     }
 }
 
-void ComputerManager::saveHosts()
+void ComputerManager::queueHostFlush(const QString& uuid)
 {
     Q_ASSERT(m_DelayedFlushThread != nullptr && m_DelayedFlushThread->isRunning());
 
-    // Punt to a worker thread because QSettings on macOS can take ages (> 500 ms)
-    // to persist our host list to disk (especially when a host has a bunch of apps).
+    // Punt to a worker thread to keep disk I/O off the caller's thread. Only
+    // the hosts queued here are rewritten when the flush happens.
     QMutexLocker locker(&m_DelayedFlushMutex);
-    m_NeedsDelayedFlush = true;
+    m_DirtyHosts.insert(uuid);
     m_DelayedFlushCondition.wakeOne();
 }
 
@@ -384,7 +262,7 @@ void ComputerManager::startPolling()
         qWarning() << "mDNS is disabled by user preference";
     }
 
-    // Start polling threads for each known host
+    // Start polling each known host
     QMapIterator<QString, NvComputer*> i(m_KnownHosts);
     while (i.hasNext()) {
         i.next();
@@ -399,22 +277,8 @@ void ComputerManager::startPollingComputer(NvComputer* computer)
         return;
     }
 
-    ComputerPollingEntry* pollingEntry;
-
-    if (!m_PollEntries.contains(computer->uuid)) {
-        pollingEntry = m_PollEntries[computer->uuid] = new ComputerPollingEntry();
-    }
-    else {
-        pollingEntry = m_PollEntries[computer->uuid];
-    }
-
-    if (!pollingEntry->isActive()) {
-        PcMonitorThread* thread = new PcMonitorThread(computer);
-        connect(thread, &PcMonitorThread::computerStateChanged,
-                this, &ComputerManager::handleComputerStateChanged);
-        pollingEntry->setActiveThread(thread);
-        thread->start();
-    }
+    // This is a no-op if we're already polling this host
+    m_HostPoller->addComputer(computer);
 }
 
 void ComputerManager::handleMdnsServiceResolved(MdnsPendingComputer* computer,
@@ -461,14 +325,15 @@ void ComputerManager::handleMdnsServiceResolved(MdnsPendingComputer* computer,
 
 void ComputerManager::saveHost(NvComputer *computer)
 {
-    // If no serializable properties changed, don't bother saving hosts
+    // If no serializable properties changed, don't bother saving this host
     QMutexLocker lock(&m_DelayedFlushMutex);
     QReadLocker computerLock(&computer->lock);
     if (!m_LastSerializedHosts.value(computer->uuid).isEqualSerialized(*computer)) {
-        // Queue a request for a delayed flush to QSettings outside of the lock
+        // Queue a request for a delayed flush to the host store outside of the lock
+        QString uuid = computer->uuid;
         computerLock.unlock();
         lock.unlock();
-        saveHosts();
+        queueHostFlush(uuid);
     }
 }
 
@@ -506,29 +371,25 @@ public:
 
     void run()
     {
-        ComputerPollingEntry* pollingEntry;
-
         // Only do the minimum amount of work while holding the writer lock.
-        // We must release it before calling saveHosts().
+        // We must release it before calling queueHostFlush().
         {
             QWriteLocker lock(&m_ComputerManager->m_Lock);
 
-            pollingEntry = m_ComputerManager->m_PollEntries.take(m_Computer->uuid);
-
             m_ComputerManager->m_KnownHosts.remove(m_Computer->uuid);
         }
 
-        // Persist the new host list with this computer deleted
-        m_ComputerManager->saveHosts();
+        // Remove this computer from the host store
+        m_ComputerManager->queueHostFlush(m_Computer->uuid);
 
-        // Delete the polling entry first. This will stop all polling threads too.
-        delete pollingEntry;
+        // Stop polling first. This waits until the poller has let go of the computer.
+        m_ComputerManager->m_HostPoller->removeComputer(m_Computer);
 
         // Delete cached box art
         BoxArtManager::deleteBoxArt(m_Computer);
 
         // Finally, delete the computer itself. This must be done
-        // last because the polling thread might be using it.
+        // last because the poller might be using it.
         delete m_Computer;
     }
 
@@ -539,6 +400,9 @@ private:
 
 void ComputerManager::deleteHost(NvComputer* computer)
 {
+    // Don't start any more box art fetches for this host
+    BoxArtFetchScheduler::get()->cancelHost(computer->uuid);
+
     // Punt to a worker thread to avoid stalling the
     // UI while waiting for the polling thread to die
     QThreadPool::globalInstance()->start(new DeferredHostDeletionTask(this, computer));
@@ -567,11 +431,9 @@ void ComputerManager::handleAboutToQuit()
 {
     QReadLocker lock(&m_Lock);
 
-    // Interrupt polling threads immediately, so they
-    // avoid making additional requests while quitting
-    for (ComputerPollingEntry* entry : std::as_const(m_PollEntries)) {
-        entry->interrupt();
-    }
+    // Stop polling immediately, so we avoid
+    // making additional requests while quitting
+    m_HostPoller->stopAll();
 }
 
 class PendingPairingTask : public QObject, public QRunnable
@@ -720,10 +582,8 @@ void ComputerManager::stopPollingAsync()
     m_MdnsBrowser = nullptr;
     m_MdnsServer.reset();
 
-    // Interrupt all threads, but don't wait for them to terminate
-    for (ComputerPollingEntry* entry : std::as_const(m_PollEntries)) {
-        entry->interrupt();
-    }
+    // Stop polling, but don't wait for in-flight requests to be torn down
+    m_HostPoller->stopAll();
 }
 
 void ComputerManager::addNewHostManually(QString address)
@@ -774,13 +634,13 @@ private:
         m_AboutToQuit = true;
     }
 
-    QString fetchServerInfo(NvHTTP& http)
+    NvServerInfo fetchServerInfo(NvHTTP& http)
     {
-        QString serverInfo;
+        NvServerInfo serverInfo;
 
         // Do nothing if we're quitting
         if (m_AboutToQuit) {
-            return QString();
+            return NvServerInfo();
         }
 
         try {
@@ -819,7 +679,7 @@ private:
 
                 emit computerAddCompleted(false, portTestResult != 0 && portTestResult != ML_TEST_RESULT_INCONCLUSIVE);
             }
-            return QString();
+            return NvServerInfo();
         }
     }
 
@@ -842,13 +702,13 @@ private:
         }
 
         // Perform initial serverinfo fetch over HTTP since we don't know which cert to use
-        QString serverInfo = fetchServerInfo(http);
-        if (serverInfo.isEmpty() && !m_MdnsIpv6Address.isNull()) {
+        NvServerInfo serverInfo = fetchServerInfo(http);
+        if (!serverInfo.isValid() && !m_MdnsIpv6Address.isNull()) {
             // Retry using the global IPv6 address if the IPv4 or link-local IPv6 address fails
             http.setAddress(m_MdnsIpv6Address);
             serverInfo = fetchServerInfo(http);
         }
-        if (serverInfo.isEmpty()) {
+        if (!serverInfo.isValid()) {
             return;
         }
 
@@ -870,7 +730,7 @@ private:
         if (existingComputer != nullptr) {
             Q_ASSERT(http.httpsPort() != 0);
             serverInfo = fetchServerInfo(http);
-            if (serverInfo.isEmpty()) {
+            if (!serverInfo.isValid()) {
                 return;
             }
 
@@ -0,0 +1,692 @@
+#include "hostpoller.h"
+#include "utils.h"
+
+#include <QDebug>
+
+#ifdef Q_OS_WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <time.h>
+#endif
+
+#define TRIES_BEFORE_OFFLINING 2
+#define POLLS_PER_APPLIST_FETCH 10
+
+#define POLL_INTERVAL_MS 3000
+#define MAX_OFFLINE_POLL_INTERVAL_MS 15000
+#define SERVERINFO_TIMEOUT_MS 2000
+#define APPLIST_TIMEOUT_MS 5000
+
+// Delay between starting probes of successive addresses (RFC 8305 section 5)
+#define PROBE_STAGGER_MS 250
+
+#define WHEEL_TICK_MS 100
+#define WHEEL_SLOTS 64
+
+#define DEFAULT_MAX_ACTIVE_POLLS 8
+
+#define STATS_INTERVAL_MS 30000
+
+// Returns -1 if thread CPU time isn't available on this platform
+static qint64 getThreadCpuTimeUs()
+{
+#if defined(Q_OS_WIN32)
+    FILETIME creationTime, exitTime, kernelTime, userTime;
+    if (!GetThreadTimes(GetCurrentThread(), &creationTime, &exitTime, &kernelTime, &userTime)) {
+        return -1;
+    }
+
+    // Both are in 100 ns units
+    ULARGE_INTEGER kernel100ns, user100ns;
+    kernel100ns.LowPart = kernelTime.dwLowDateTime;
+    kernel100ns.HighPart = kernelTime.dwHighDateTime;
+    user100ns.LowPart = userTime.dwLowDateTime;
+    user100ns.HighPart = userTime.dwHighDateTime;
+    return (qint64)((kernel100ns.QuadPart + user100ns.QuadPart) / 10);
+#elif defined(CLOCK_THREAD_CPUTIME_ID)
+    struct timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0) {
+        return -1;
+    }
+    return (qint64)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#else
+    return -1;
+#endif
+}
+
+HostPoller::HostPoller()
+    : m_Nam(nullptr),
+      m_TickTimer(nullptr),
+      m_WheelPosition(0),
+      m_ActivePolls(0),
+      m_MaxActivePolls(DEFAULT_MAX_ACTIVE_POLLS),
+      m_StatsEnabled(false),
+      m_StatsThreadCpuStartUs(0),
+      m_StatsCompletedPolls(0),
+      m_StatsFailedPolls(0),
+      m_StatsTotalPollTimeMs(0),
+      m_StatsMaxPollTimeMs(0)
+{
+    qRegisterMetaType<NvComputer*>("NvComputer*");
+
+    int maxActivePolls;
+    if (Utils::getEnvironmentVariableOverride("HOST_POLL_MAX_CONCURRENCY", &maxActivePolls) && maxActivePolls > 0) {
+        m_MaxActivePolls = maxActivePolls;
+    }
+
+    // Useful for measuring polling overhead when load testing with many hosts
+    int statsEnabled;
+    if (Utils::getEnvironmentVariableOverride("HOST_POLL_STATS", &statsEnabled)) {
+        m_StatsEnabled = statsEnabled != 0;
+    }
+
+    m_Wheel.resize(WHEEL_SLOTS);
+
+    m_Thread.setObjectName("Host polling thread");
+#if QT_VERSION >= QT_VERSION_CHECK(6, 9, 0)
+    m_Thread.setServiceLevel(QThread::QualityOfService::Eco);
+#endif
+
+    // All of our state is owned by the polling thread. initialize() is invoked
+    // directly on that thread before any queued requests are delivered.
+    moveToThread(&m_Thread);
+    connect(&m_Thread, &QThread::started, this, &HostPoller::initialize);
+
+    // Reduce the power and performance impact of polling. The NAM's
+    // worker thread will inherit this priority from our thread.
+    m_Thread.start(QThread::LowPriority);
+}
+
+HostPoller::~HostPoller()
+{
+    QMetaObject::invokeMethod(this, "shutdown", Qt::BlockingQueuedConnection);
+    m_Thread.quit();
+    m_Thread.wait();
+}
+
+void HostPoller::addComputer(NvComputer* computer)
+{
+    QMetaObject::invokeMethod(this, "handleAddComputer", Qt::QueuedConnection,
+                              Q_ARG(NvComputer*, computer));
+}
+
+void HostPoller::stopAll()
+{
+    QMetaObject::invokeMethod(this, "handleStopAll", Qt::QueuedConnection);
+}
+
+void HostPoller::removeComputer(NvComputer* computer)
+{
+    // This would deadlock
+    Q_ASSERT(QThread::currentThread() != &m_Thread);
+
+    QMetaObject::invokeMethod(this, "handleRemoveComputer", Qt::BlockingQueuedConnection,
+                              Q_ARG(NvComputer*, computer));
+}
+
+void HostPoller::initialize()
+{
+    // A single NAM is shared by all hosts, so we only have one NAM worker thread
+    m_Nam = new QNetworkAccessManager(this);
+
+    m_TickTimer = new QTimer(this);
+    m_TickTimer->setInterval(WHEEL_TICK_MS);
+    connect(m_TickTimer, &QTimer::timeout, this, &HostPoller::handleTick);
+
+    if (m_StatsEnabled) {
+        m_StatsTimer.start();
+        m_StatsThreadCpuStartUs = getThreadCpuTimeUs();
+    }
+}
+
+void HostPoller::shutdown()
+{
+    handleStopAll();
+
+    delete m_TickTimer;
+    m_TickTimer = nullptr;
+
+    delete m_Nam;
+    m_Nam = nullptr;
+}
+
+void HostPoller::handleAddComputer(NvComputer* computer)
+{
+    if (m_Targets.contains(computer)) {
+        return;
+    }
+
+    PollTarget* target = new PollTarget();
+    target->computer = computer;
+    target->wheelSlot = -1;
+    target->wheelRounds = 0;
+    target->queued = false;
+    target->consecutiveFailures = 0;
+    target->addedTimer.start();
+    target->everOnline = false;
+    target->active = false;
+    target->wasOnline = false;
+    target->stateChanged = false;
+    target->triesRemaining = 0;
+    target->nextProbe = 0;
+    target->http = nullptr;
+    target->reply = nullptr;
+
+    target->probeTimer = new QTimer(this);
+    target->probeTimer->setSingleShot(true);
+    connect(target->probeTimer, &QTimer::timeout, this, [this, target]() {
+        startNextProbe(target);
+    });
+
+    // Always fetch the applist the first time
+    target->pollsSinceLastAppListFetch = POLLS_PER_APPLIST_FETCH;
+
+    m_Targets.insert(computer, target);
+
+    // Poll new hosts right away
+    schedule(target, 0);
+    dispatchQueuedTargets();
+
+    if (!m_TickTimer->isActive()) {
+        m_TickTimer->start();
+    }
+}
+
+void HostPoller::handleRemoveComputer(NvComputer* computer)
+{
+    PollTarget* target = m_Targets.take(computer);
+    if (target == nullptr) {
+        return;
+    }
+
+    cancelPoll(target);
+    delete target->probeTimer;
+    delete target;
+
+    if (m_Targets.isEmpty()) {
+        m_TickTimer->stop();
+    }
+
+    // We may have freed up a slot for another host
+    dispatchQueuedTargets();
+}
+
+void HostPoller::handleStopAll()
+{
+    for (PollTarget* target : std::as_const(m_Targets)) {
+        cancelPoll(target);
+        delete target->probeTimer;
+        delete target;
+    }
+    m_Targets.clear();
+
+    Q_ASSERT(m_ReadyQueue.isEmpty());
+    Q_ASSERT(m_ActivePolls == 0);
+
+    if (m_TickTimer != nullptr) {
+        m_TickTimer->stop();
+    }
+}
+
+void HostPoller::handleTick()
+{
+    m_WheelPosition = (m_WheelPosition + 1) % WHEEL_SLOTS;
+
+    QMutableListIterator<PollTarget*> i(m_Wheel[m_WheelPosition]);
+    while (i.hasNext()) {
+        PollTarget* target = i.next();
+
+        // Targets scheduled more than one revolution out stay put
+        if (target->wheelRounds > 0) {
+            target->wheelRounds--;
+            continue;
+        }
+
+        i.remove();
+        target->wheelSlot = -1;
+        target->queued = true;
+        m_ReadyQueue.enqueue(target);
+    }
+
+    dispatchQueuedTargets();
+
+    if (m_StatsEnabled && m_StatsTimer.elapsed() >= STATS_INTERVAL_MS) {
+        logStats();
+    }
+}
+
+void HostPoller::schedule(PollTarget* target, int delayMs)
+{
+    Q_ASSERT(target->wheelSlot < 0 && !target->queued);
+
+    int ticks = delayMs / WHEEL_TICK_MS;
+    if (ticks <= 0) {
+        target->queued = true;
+        m_ReadyQueue.enqueue(target);
+        return;
+    }
+
+    // A target in slot N is first visited after ((ticks - 1) % WHEEL_SLOTS) + 1
+    // ticks, then once per revolution after that.
+    target->wheelSlot = (m_WheelPosition + ticks) % WHEEL_SLOTS;
+    target->wheelRounds = (ticks - 1) / WHEEL_SLOTS;
+    m_Wheel[target->wheelSlot].append(target);
+}
+
+void HostPoller::unschedule(PollTarget* target)
+{
+    if (target->wheelSlot >= 0) {
+        m_Wheel[target->wheelSlot].removeOne(target);
+        target->wheelSlot = -1;
+    }
+
+    if (target->queued) {
+        m_ReadyQueue.removeOne(target);
+        target->queued = false;
+    }
+}
+
+void HostPoller::dispatchQueuedTargets()
+{
+    // Bound the number of hosts we're talking to at once. The rest
+    // wait their turn in FIFO order so no host is starved.
+    while (m_ActivePolls < m_MaxActivePolls && !m_ReadyQueue.isEmpty()) {
+        PollTarget* target = m_ReadyQueue.dequeue();
+        target->queued = false;
+        beginPoll(target);
+    }
+}
+
+void HostPoller::beginPoll(PollTarget* target)
+{
+    Q_ASSERT(!target->active);
+
+    m_ActivePolls++;
+    target->active = true;
+
+    // Note: we don't need to acquire the read lock here,
+    // because we're on the writing thread.
+    target->wasOnline = target->computer->state == NvComputer::CS_ONLINE;
+    target->stateChanged = false;
+    target->triesRemaining = target->wasOnline ? TRIES_BEFORE_OFFLINING : 1;
+    target->pollsSinceLastAppListFetch++;
+    target->pollTimer.start();
+
+    startProbeRound(target);
+}
+
+void HostPoller::startProbeRound(PollTarget* target)
+{
+    // uniqueAddresses() puts the address that won last time first,
+    // so it gets a head start on all the others.
+    const QVector<NvAddress> addresses = target->computer->uniqueAddresses();
+    if (addresses.isEmpty()) {
+        finishPoll(target, false);
+        return;
+    }
+
+    // The probe vector must not be resized until the round is over,
+    // because requests in flight refer to their probe by index.
+    target->probes.clear();
+    target->probes.reserve(addresses.size());
+    for (const NvAddress& address : addresses) {
+        AddressProbe probe;
+        probe.address = address;
+        probe.http = nullptr;
+        probe.reply = nullptr;
+        probe.done = false;
+        target->probes.append(probe);
+    }
+    target->nextProbe = 0;
+
+    startNextProbe(target);
+}
+
+void HostPoller::startNextProbe(PollTarget* target)
+{
+    if (target->nextProbe >= target->probes.size()) {
+        return;
+    }
+
+    int probeIndex = target->nextProbe++;
+    AddressProbe& probe = target->probes[probeIndex];
+
+    // Start each address over HTTP, since we don't know the HTTPS port yet
+    probe.http = new NvHTTP(probe.address, 0,
+                            target->computer->serverCert,
+                            !target->computer->isNvidiaServerSoftware,
+                            m_Nam);
+    sendServerInfoRequest(target, probeIndex, false);
+
+    // Start the next address if this one hasn't answered in time. Unlike the
+    // request timeout, this doesn't give up on the address we just started.
+    if (target->nextProbe < target->probes.size()) {
+        target->probeTimer->start(PROBE_STAGGER_MS);
+    }
+}
+
+void HostPoller::sendServerInfoRequest(PollTarget* target, int probeIndex, bool https)
+{
+    AddressProbe& probe = target->probes[probeIndex];
+
+    QNetworkReply* reply = probe.http->startRequest(https ? probe.http->m_BaseUrlHttps : probe.http->m_BaseUrlHttp,
+                                                    "serverinfo",
+                                                    nullptr,
+                                                    SERVERINFO_TIMEOUT_MS,
+                                                    NvHTTP::NVLL_NONE);
+    probe.reply = reply;
+    connect(reply, &QNetworkReply::finished, this, [this, target, probeIndex, reply, https]() {
+        handleServerInfoReply(target, probeIndex, reply, https);
+    });
+}
+
+void HostPoller::handleServerInfoReply(PollTarget* target, int probeIndex, QNetworkReply* reply, bool https)
+{
+    AddressProbe& probe = target->probes[probeIndex];
+
+    Q_ASSERT(probe.reply == reply);
+    probe.reply = nullptr;
+    reply->deleteLater();
+
+#if QT_VERSION < QT_VERSION_CHECK(6, 3, 0)
+    // If we couldn't use fine-grained connection idle timeouts, kill them all now
+    m_Nam->clearAccessCache();
+#endif
+
+    NvServerInfo serverInfo;
+    bool certMismatch = false;
+    if (reply->error() == QNetworkReply::NoError) {
+        serverInfo = NvServerInfo::parse(QString::fromUtf8(reply->readAll()));
+
+        // The host rejected our client certificate
+        certMismatch = serverInfo.isValid() && serverInfo.statusCode == 401;
+    }
+    else if (reply->error() == QNetworkReply::SslHandshakeFailedError) {
+        // The host's certificate no longer matches the pinned one. Like NvHTTP,
+        // treat this as a 401 so the host still shows up and can be re-paired.
+        certMismatch = true;
+    }
+    bool success = serverInfo.isValid() && serverInfo.statusCode == 200;
+
+    if (!https) {
+        if (!success) {
+            handleProbeFailed(target, probeIndex);
+            return;
+        }
+
+        // Populate the HTTPS port
+        uint16_t httpsPort = serverInfo.httpsPort;
+        if (httpsPort == 0) {
+            httpsPort = DEFAULT_HTTPS_PORT;
+        }
+        probe.http->setHttpsPort(httpsPort);
+
+        if (probe.http->serverCert().isNull()) {
+            // Only use HTTP prior to pairing
+            completeServerInfo(target, probeIndex, serverInfo);
+        }
+        else {
+            // HTTPS properly reports pairing status (and a few other attributes)
+            probe.httpServerInfo = serverInfo;
+            sendServerInfoRequest(target, probeIndex, true);
+        }
+    }
+    else if (success) {
+        completeServerInfo(target, probeIndex, serverInfo);
+    }
+    else if (certMismatch) {
+        // Certificate validation error, so fall back to the HTTP serverinfo we just got
+        completeServerInfo(target, probeIndex, probe.httpServerInfo);
+    }
+    else {
+        handleProbeFailed(target, probeIndex);
+    }
+}
+
+void HostPoller::completeServerInfo(PollTarget* target, int probeIndex, const NvServerInfo& serverInfo)
+{
+    NvComputer newState(*target->probes[probeIndex].http, serverInfo);
+
+    // Ensure the machine that responded is the one we intended to contact
+    if (target->computer->uuid != newState.uuid) {
+        qInfo() << "Found unexpected PC" << newState.name << "looking for" << target->computer->name;
+        handleProbeFailed(target, probeIndex);
+        return;
+    }
+
+    // This address won, so stop probing the others. The new active
+    // address makes it the first one we try on the next poll.
+    cancelProbes(target);
+
+    target->stateChanged = target->computer->update(newState);
+    if (!target->everOnline) {
+        qInfo() << target->computer->name << "is now online at" << target->computer->activeAddress.toString()
+                << "after" << target->addedTimer.elapsed() << "ms";
+        target->everOnline = true;
+    }
+    else if (!target->wasOnline) {
+        qInfo() << target->computer->name << "is now online at" << target->computer->activeAddress.toString();
+    }
+
+    // Grab the applist if it's empty or it's been long enough that we need to refresh
+    if (target->computer->state == NvComputer::CS_ONLINE &&
+            target->computer->pairState == NvComputer::PS_PAIRED &&
+            (target->computer->appList.isEmpty() || target->pollsSinceLastAppListFetch >= POLLS_PER_APPLIST_FETCH)) {
+        // Notify prior to the app list poll since it may take a while, and we don't
+        // want to delay onlining of a machine, especially if we already have a cached list.
+        if (target->stateChanged) {
+            emit computerStateChanged(target->computer);
+            target->stateChanged = false;
+        }
+
+        sendAppListRequest(target);
+    }
+    else {
+        finishPoll(target, true);
+    }
+}
+
+void HostPoller::handleProbeFailed(PollTarget* target, int probeIndex)
+{
+    AddressProbe& probe = target->probes[probeIndex];
+
+    probe.done = true;
+    delete probe.http;
+    probe.http = nullptr;
+
+    // Don't wait out the stagger delay if we already know this address is bad
+    if (target->nextProbe < target->probes.size()) {
+        target->probeTimer->stop();
+        startNextProbe(target);
+        return;
+    }
+
+    // Wait for any other probes that are still outstanding
+    for (const AddressProbe& otherProbe : std::as_const(target->probes)) {
+        if (!otherProbe.done) {
+            return;
+        }
+    }
+
+    // Check if we failed after all retry attempts
+    if (--target->triesRemaining > 0) {
+        startProbeRound(target);
+    }
+    else {
+        finishPoll(target, false);
+    }
+}
+
+void HostPoller::cancelProbes(PollTarget* target)
+{
+    target->probeTimer->stop();
+
+    for (AddressProbe& probe : target->probes) {
+        if (probe.reply != nullptr) {
+            // Disconnect first, since abort() emits finished() synchronously
+            disconnect(probe.reply, nullptr, this, nullptr);
+            probe.reply->abort();
+            probe.reply->deleteLater();
+            probe.reply = nullptr;
+        }
+
+        delete probe.http;
+        probe.http = nullptr;
+    }
+
+    target->probes.clear();
+    target->nextProbe = 0;
+}
+
+void HostPoller::sendAppListRequest(PollTarget* target)
+{
+    delete target->http;
+    target->http = new NvHTTP(target->computer, m_Nam);
+
+    QNetworkReply* reply = target->http->startRequest(target->http->m_BaseUrlHttps,
+                                                      "applist",
+                                                      nullptr,
+                                                      APPLIST_TIMEOUT_MS,
+                                                      NvHTTP::NVLL_ERROR);
+    target->reply = reply;
+    connect(reply, &QNetworkReply::finished, this, [this, target, reply]() {
+        handleAppListReply(target, reply);
+    });
+}
+
+void HostPoller::handleAppListReply(PollTarget* target, QNetworkReply* reply)
+{
+    Q_ASSERT(target->reply == reply);
+    target->reply = nullptr;
+    reply->deleteLater();
+
+#if QT_VERSION < QT_VERSION_CHECK(6, 3, 0)
+    m_Nam->clearAccessCache();
+#endif
+
+    if (reply->error() == QNetworkReply::NoError) {
+        QString appxml = QString::fromUtf8(reply->readAll());
+
+        try {
+            NvHTTP::verifyResponseStatus(appxml);
+
+            QVector<NvApp> appList = NvHTTP::parseAppList(appxml);
+            if (!appList.isEmpty()) {
+                QWriteLocker lock(&target->computer->lock);
+                if (target->computer->updateAppList(appList)) {
+                    target->stateChanged = true;
+                }
+                target->pollsSinceLastAppListFetch = 0;
+            }
+        } catch (...) {
+            // We'll try again on the next poll
+        }
+    }
+    else {
+        qWarning() << "applist request failed with error:" << reply->error();
+    }
+
+    finishPoll(target, true);
+}
+
+void HostPoller::finishPoll(PollTarget* target, bool online)
+{
+    Q_ASSERT(target->active);
+
+    if (!online && target->computer->state != NvComputer::CS_OFFLINE) {
+        qInfo() << target->computer->name << "is now offline";
+        target->computer->state = NvComputer::CS_OFFLINE;
+        target->stateChanged = true;
+    }
+
+    if (target->stateChanged) {
+        // Tell anyone listening that we've changed state
+        emit computerStateChanged(target->computer);
+    }
+
+    delete target->http;
+    target->http = nullptr;
+    target->active = false;
+    m_ActivePolls--;
+
+    if (m_StatsEnabled) {
+        qint64 pollTimeMs = target->pollTimer.elapsed();
+        m_StatsCompletedPolls++;
+        if (!online) {
+            m_StatsFailedPolls++;
+        }
+        m_StatsTotalPollTimeMs += pollTimeMs;
+        m_StatsMaxPollTimeMs = qMax(m_StatsMaxPollTimeMs, pollTimeMs);
+    }
+
+    // Back off on hosts that keep failing to respond, so a large number
+    // of offline hosts doesn't crowd out the ones that are reachable.
+    if (online) {
+        target->consecutiveFailures = 0;
+        schedule(target, POLL_INTERVAL_MS);
+    }
+    else {
+        int shift = qMin(target->consecutiveFailures++, 3);
+        schedule(target, qMin(POLL_INTERVAL_MS << shift, MAX_OFFLINE_POLL_INTERVAL_MS));
+    }
+
+    dispatchQueuedTargets();
+}
+
+void HostPoller::cancelPoll(PollTarget* target)
+{
+    unschedule(target);
+    cancelProbes(target);
+
+    if (target->reply != nullptr) {
+        // Disconnect first, since abort() emits finished() synchronously
+        disconnect(target->reply, nullptr, this, nullptr);
+        target->reply->abort();
+        target->reply->deleteLater();
+        target->reply = nullptr;
+    }
+
+    delete target->http;
+    target->http = nullptr;
+
+    if (target->active) {
+        target->active = false;
+        m_ActivePolls--;
+    }
+}
+
+void HostPoller::logStats()
+{
+    qint64 threadCpuUs = getThreadCpuTimeUs();
+    qint64 intervalMs = m_StatsTimer.restart();
+
+    int onlineHosts = 0;
+    for (const PollTarget* target : std::as_const(m_Targets)) {
+        if (target->computer->state == NvComputer::CS_ONLINE) {
+            onlineHosts++;
+        }
+    }
+
+    QString cpuUsage = "unavailable";
+    if (threadCpuUs >= 0 && m_StatsThreadCpuStartUs >= 0 && intervalMs > 0) {
+        cpuUsage = QString::number((threadCpuUs - m_StatsThreadCpuStartUs) / 10.0 / intervalMs, 'f', 2) + "%";
+    }
+
+    qInfo().noquote() << QString("Host polling stats: %1/%2 hosts online, %3 polls (%4 failed) in %5 ms, "
+                                 "mean poll time %6 ms, max poll time %7 ms, polling thread CPU %8")
+                         .arg(onlineHosts)
+                         .arg(m_Targets.count())
+                         .arg(m_StatsCompletedPolls)
+                         .arg(m_StatsFailedPolls)
+                         .arg(intervalMs)
+                         .arg(m_StatsCompletedPolls > 0 ? m_StatsTotalPollTimeMs / m_StatsCompletedPolls : 0)
+                         .arg(m_StatsMaxPollTimeMs)
+                         .arg(cpuUsage);
+
+    m_StatsThreadCpuStartUs = threadCpuUs;
+    m_StatsCompletedPolls = 0;
+    m_StatsFailedPolls = 0;
+    m_StatsTotalPollTimeMs = 0;
+    m_StatsMaxPollTimeMs = 0;
+}
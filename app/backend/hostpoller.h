@@ -0,0 +1,148 @@
+#pragma once
+
+#include "nvcomputer.h"
+
+#include <QObject>
+#include <QThread>
+#include <QTimer>
+#include <QHash>
+#include <QList>
+#include <QQueue>
+#include <QVector>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QElapsedTimer>
+
+// Polls all known hosts from a single thread. Each host is scheduled on a
+// timer wheel and its serverinfo and applist requests are issued without
+// blocking, so thread count stays constant no matter how many hosts we have.
+// A host's candidate addresses are probed concurrently with staggered starts
+// and the first one to answer as the expected host wins.
+class HostPoller : public QObject
+{
+    Q_OBJECT
+
+public:
+    HostPoller();
+
+    virtual ~HostPoller();
+
+    // These may be called from any thread
+    void addComputer(NvComputer* computer);
+
+    void stopAll();
+
+    // Returns once the poller no longer references the computer,
+    // so it must not be called from the poller thread itself.
+    void removeComputer(NvComputer* computer);
+
+signals:
+    void computerStateChanged(NvComputer* computer);
+
+private slots:
+    void initialize();
+
+    void shutdown();
+
+    void handleAddComputer(NvComputer* computer);
+
+    void handleRemoveComputer(NvComputer* computer);
+
+    void handleStopAll();
+
+    void handleTick();
+
+private:
+    // One candidate address being probed for a host
+    struct AddressProbe
+    {
+        NvAddress address;
+        NvHTTP* http;
+        QNetworkReply* reply;
+        NvServerInfo httpServerInfo;
+        bool done;
+    };
+
+    struct PollTarget
+    {
+        NvComputer* computer;
+
+        // Timer wheel state (wheelSlot is -1 when not scheduled)
+        int wheelSlot;
+        int wheelRounds;
+        bool queued;
+
+        // Backoff state across poll cycles
+        int consecutiveFailures;
+        int pollsSinceLastAppListFetch;
+
+        // Started when the host was added, for measuring time-to-online
+        QElapsedTimer addedTimer;
+        bool everOnline;
+
+        // State for the poll cycle in progress
+        bool active;
+        bool wasOnline;
+        bool stateChanged;
+        int triesRemaining;
+        QVector<AddressProbe> probes;
+        int nextProbe;
+        QTimer* probeTimer;
+        QElapsedTimer pollTimer;
+
+        // Applist request in progress
+        NvHTTP* http;
+        QNetworkReply* reply;
+    };
+
+    void schedule(PollTarget* target, int delayMs);
+
+    void unschedule(PollTarget* target);
+
+    void dispatchQueuedTargets();
+
+    void beginPoll(PollTarget* target);
+
+    void startProbeRound(PollTarget* target);
+
+    void startNextProbe(PollTarget* target);
+
+    void sendServerInfoRequest(PollTarget* target, int probeIndex, bool https);
+
+    void handleServerInfoReply(PollTarget* target, int probeIndex, QNetworkReply* reply, bool https);
+
+    void completeServerInfo(PollTarget* target, int probeIndex, const NvServerInfo& serverInfo);
+
+    void handleProbeFailed(PollTarget* target, int probeIndex);
+
+    void cancelProbes(PollTarget* target);
+
+    void sendAppListRequest(PollTarget* target);
+
+    void handleAppListReply(PollTarget* target, QNetworkReply* reply);
+
+    void finishPoll(PollTarget* target, bool online);
+
+    void cancelPoll(PollTarget* target);
+
+    void logStats();
+
+    QThread m_Thread;
+    QNetworkAccessManager* m_Nam;
+    QTimer* m_TickTimer;
+    QHash<NvComputer*, PollTarget*> m_Targets;
+    QVector<QList<PollTarget*>> m_Wheel;
+    int m_WheelPosition;
+    QQueue<PollTarget*> m_ReadyQueue;
+    int m_ActivePolls;
+    int m_MaxActivePolls;
+
+    // Periodic polling statistics (only collected if enabled)
+    bool m_StatsEnabled;
+    QElapsedTimer m_StatsTimer;
+    qint64 m_StatsThreadCpuStartUs;
+    int m_StatsCompletedPolls;
+    int m_StatsFailedPolls;
+    qint64 m_StatsTotalPollTimeMs;
+    qint64 m_StatsMaxPollTimeMs;
+};
@@ -0,0 +1,298 @@
+#include "hoststore.h"
+
+#include <QtEndian>
+#include <QDebug>
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QElapsedTimer>
+
+#define HOST_STORE_MAGIC 0x4D4C4853 // 'MLHS'
+#define HOST_STORE_VERSION 1
+#define HOST_STORE_HEADER_SIZE 8
+
+// Each record is framed by a 32-bit length and a 16-bit checksum of the body
+#define RECORD_HEADER_SIZE 6
+
+#define OP_PUT_HOST 1
+#define OP_DELETE_HOST 2
+
+// Don't bother compacting tiny logs no matter how much of them is stale
+#define COMPACTION_MIN_BYTES (256 * 1024)
+
+#define HOST_STORE_STREAM_VERSION QDataStream::Qt_5_9
+
+HostStore::HostStore(const QString& path)
+    : m_Path(path),
+      m_LiveBytes(HOST_STORE_HEADER_SIZE),
+      m_LogBytes(0),
+      m_NeedsCompaction(true),
+      m_ReadOnly(false)
+{
+
+}
+
+quint16 HostStore::checksumRecord(const QByteArray& body)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+    return qChecksum(body);
+#else
+    return qChecksum(body.constData(), (uint)body.size());
+#endif
+}
+
+QByteArray HostStore::encodeRecord(quint8 op, const QString& uuid, const QByteArray& payload)
+{
+    QByteArray body;
+    {
+        QDataStream stream(&body, QIODevice::WriteOnly);
+        stream.setVersion(HOST_STORE_STREAM_VERSION);
+        stream << op << uuid << payload;
+    }
+
+    QByteArray record(RECORD_HEADER_SIZE, 0);
+    qToBigEndian<quint32>((quint32)body.size(), record.data());
+    qToBigEndian<quint16>(checksumRecord(body), record.data() + 4);
+    record.append(body);
+    return record;
+}
+
+static QByteArray serializeHost(const NvComputer& computer)
+{
+    QByteArray payload;
+    QDataStream stream(&payload, QIODevice::WriteOnly);
+    stream.setVersion(HOST_STORE_STREAM_VERSION);
+    computer.serialize(stream);
+    return payload;
+}
+
+bool HostStore::load(QVector<NvComputer*>& hosts)
+{
+    QFile file(m_Path);
+    if (!file.exists()) {
+        return false;
+    }
+
+    QElapsedTimer loadTimer;
+    loadTimer.start();
+
+    m_LiveRecords.clear();
+    m_LiveBytes = HOST_STORE_HEADER_SIZE;
+    m_LogBytes = 0;
+    m_NeedsCompaction = true;
+    m_ReadOnly = false;
+
+    // If we can't make sense of the store (which may have been written by a newer
+    // version), leave it alone rather than compacting it down to nothing.
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Failed to open host store:" << file.errorString();
+        m_ReadOnly = true;
+        return true;
+    }
+
+    // The whole log is read in one go and replayed from memory
+    QByteArray data = file.readAll();
+    file.close();
+
+    if (data.size() < HOST_STORE_HEADER_SIZE ||
+            qFromBigEndian<quint32>(data.constData()) != HOST_STORE_MAGIC ||
+            qFromBigEndian<quint32>(data.constData() + 4) != HOST_STORE_VERSION) {
+        qWarning() << "Ignoring host store with unrecognized header";
+        m_ReadOnly = true;
+        return true;
+    }
+
+    QHash<QString, QByteArray> payloads;
+    int offset = HOST_STORE_HEADER_SIZE;
+    while (data.size() - offset >= RECORD_HEADER_SIZE) {
+        quint32 bodyLength = qFromBigEndian<quint32>(data.constData() + offset);
+        quint16 checksum = qFromBigEndian<quint16>(data.constData() + offset + 4);
+        if (bodyLength > (quint32)(data.size() - offset - RECORD_HEADER_SIZE)) {
+            break;
+        }
+
+        QByteArray body = data.mid(offset + RECORD_HEADER_SIZE, (int)bodyLength);
+        if (checksumRecord(body) != checksum) {
+            break;
+        }
+
+        quint8 op;
+        QString uuid;
+        QByteArray payload;
+        QDataStream stream(body);
+        stream.setVersion(HOST_STORE_STREAM_VERSION);
+        stream >> op >> uuid >> payload;
+        if (stream.status() != QDataStream::Ok) {
+            break;
+        }
+
+        int recordLength = RECORD_HEADER_SIZE + (int)bodyLength;
+        if (op == OP_PUT_HOST) {
+            m_LiveBytes -= m_LiveRecords.value(uuid).size();
+            m_LiveRecords[uuid] = data.mid(offset, recordLength);
+            m_LiveBytes += recordLength;
+            payloads[uuid] = payload;
+        }
+        else if (op == OP_DELETE_HOST) {
+            m_LiveBytes -= m_LiveRecords.value(uuid).size();
+            m_LiveRecords.remove(uuid);
+            payloads.remove(uuid);
+        }
+        else {
+            qWarning() << "Skipping host store record with unknown op:" << op;
+        }
+
+        offset += recordLength;
+    }
+
+    // Anything left over is a record that we didn't finish writing. The log
+    // must be rewritten without it before we can append again.
+    bool tornRecord = offset != data.size();
+    if (tornRecord) {
+        qWarning() << "Discarding" << data.size() - offset << "bytes of incomplete host records";
+    }
+
+    for (auto it = payloads.constBegin(); it != payloads.constEnd(); ++it) {
+        QDataStream stream(it.value());
+        stream.setVersion(HOST_STORE_STREAM_VERSION);
+
+        NvComputer* computer = new NvComputer(stream);
+        if (stream.status() != QDataStream::Ok || computer->uuid != it.key()) {
+            qWarning() << "Discarding unreadable host record for" << it.key();
+            delete computer;
+
+            m_LiveBytes -= m_LiveRecords.value(it.key()).size();
+            m_LiveRecords.remove(it.key());
+            tornRecord = true;
+            continue;
+        }
+
+        hosts.append(computer);
+    }
+
+    m_LogBytes = data.size();
+    m_NeedsCompaction = tornRecord || shouldCompact(m_LogBytes);
+
+    qInfo() << "Loaded" << hosts.count() << "hosts from" << m_LogBytes << "byte host store in" << loadTimer.elapsed() << "ms";
+    return true;
+}
+
+bool HostStore::isReadOnly() const
+{
+    return m_ReadOnly;
+}
+
+bool HostStore::replaceAll(const QVector<NvComputer*>& hosts)
+{
+    if (m_ReadOnly) {
+        qWarning() << "Not overwriting unreadable host store";
+        return false;
+    }
+
+    m_LiveRecords.clear();
+    m_LiveBytes = HOST_STORE_HEADER_SIZE;
+
+    for (const NvComputer* computer : hosts) {
+        QByteArray record = encodeRecord(OP_PUT_HOST, computer->uuid, serializeHost(*computer));
+        m_LiveRecords[computer->uuid] = record;
+        m_LiveBytes += record.size();
+    }
+
+    return compact();
+}
+
+bool HostStore::commit(const QVector<NvComputer>& updatedHosts, const QStringList& removedUuids)
+{
+    if (m_ReadOnly) {
+        qWarning() << "Not overwriting unreadable host store";
+        return false;
+    }
+
+    QByteArray records;
+
+    for (const NvComputer& computer : updatedHosts) {
+        QByteArray record = encodeRecord(OP_PUT_HOST, computer.uuid, serializeHost(computer));
+        m_LiveBytes -= m_LiveRecords.value(computer.uuid).size();
+        m_LiveRecords[computer.uuid] = record;
+        m_LiveBytes += record.size();
+        records.append(record);
+    }
+
+    for (const QString& uuid : removedUuids) {
+        if (m_LiveRecords.contains(uuid)) {
+            m_LiveBytes -= m_LiveRecords.take(uuid).size();
+            records.append(encodeRecord(OP_DELETE_HOST, uuid, QByteArray()));
+        }
+    }
+
+    if (records.isEmpty()) {
+        return true;
+    }
+
+    if (m_NeedsCompaction || shouldCompact(m_LogBytes + records.size())) {
+        return compact();
+    }
+
+    QFile file(m_Path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qWarning() << "Failed to open host store for writing:" << file.errorString();
+        return compact();
+    }
+
+    // If someone else touched the log, we can't safely append to it
+    if (file.size() != m_LogBytes) {
+        qWarning() << "Host store changed unexpectedly on disk";
+        file.close();
+        return compact();
+    }
+
+    if (file.write(records) != records.size() || !file.flush()) {
+        qWarning() << "Failed to append to host store:" << file.errorString();
+        file.close();
+
+        // A partial record may have made it to disk
+        return compact();
+    }
+
+    m_LogBytes += records.size();
+    return true;
+}
+
+bool HostStore::shouldCompact(qint64 logBytes)
+{
+    return logBytes > COMPACTION_MIN_BYTES && logBytes > m_LiveBytes * 2;
+}
+
+bool HostStore::compact()
+{
+    QDir().mkpath(QFileInfo(m_Path).absolutePath());
+
+    QByteArray header(HOST_STORE_HEADER_SIZE, 0);
+    qToBigEndian<quint32>(HOST_STORE_MAGIC, header.data());
+    qToBigEndian<quint32>(HOST_STORE_VERSION, header.data() + 4);
+
+    // QSaveFile swaps in the new log only once it's fully written
+    QSaveFile file(m_Path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Failed to create host store:" << file.errorString();
+        m_NeedsCompaction = true;
+        return false;
+    }
+
+    file.write(header);
+    for (const QByteArray& record : std::as_const(m_LiveRecords)) {
+        file.write(record);
+    }
+
+    if (!file.commit()) {
+        qWarning() << "Failed to write host store:" << file.errorString();
+        m_NeedsCompaction = true;
+        return false;
+    }
+
+    m_LogBytes = m_LiveBytes;
+    m_NeedsCompaction = false;
+    return true;
+}
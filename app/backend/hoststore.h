@@ -0,0 +1,64 @@
+#pragma once
+
+#include "nvcomputer.h"
+
+#include <QHash>
+#include <QStringList>
+#include <QVector>
+
+// Persists hosts as an append-only log of per-host records. Each flush only
+// appends records for the hosts that changed, and the log is rewritten in
+// place (atomically) once it's mostly made up of superseded records. A torn
+// record at the end of the log from a crash mid-write is dropped on load.
+// A store that can't be read at all is never overwritten.
+// This class is not thread-safe.
+class HostStore
+{
+public:
+    explicit HostStore(const QString& path);
+
+    // Returns false if there's no store on disk yet
+    bool
+    load(QVector<NvComputer*>& hosts);
+
+    // True if the store on disk couldn't be read, so changes won't be saved
+    bool
+    isReadOnly() const;
+
+    // Replaces the entire contents of the store with these hosts
+    bool
+    replaceAll(const QVector<NvComputer*>& hosts);
+
+    bool
+    commit(const QVector<NvComputer>& updatedHosts, const QStringList& removedUuids);
+
+private:
+    static
+    QByteArray
+    encodeRecord(quint8 op, const QString& uuid, const QByteArray& payload);
+
+    static
+    quint16
+    checksumRecord(const QByteArray& body);
+
+    bool
+    shouldCompact(qint64 logBytes);
+
+    bool
+    compact();
+
+    QString m_Path;
+
+    // Latest encoded record for each host that's still in the store
+    QHash<QString, QByteArray> m_LiveRecords;
+    qint64 m_LiveBytes;
+
+    // Size of the log on disk, including superseded records
+    qint64 m_LogBytes;
+
+    // Set when the log on disk can't be appended to as-is
+    bool m_NeedsCompaction;
+
+    // Set when the log on disk couldn't be opened or parsed
+    bool m_ReadOnly;
+};
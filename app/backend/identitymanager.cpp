@@ -197,10 +197,16 @@ IdentityManager::getSslKey()
 QSslConfiguration
 IdentityManager::getSslConfig()
 {
-    QSslConfiguration sslConfig(QSslConfiguration::defaultConfiguration());
-    sslConfig.setLocalCertificate(getSslCertificate());
-    sslConfig.setPrivateKey(getSslKey());
-    return sslConfig;
+    QMutexLocker locker(&m_SslConfigLock);
+
+    if (!m_SslConfigInitialized) {
+        m_CachedSslConfig = QSslConfiguration::defaultConfiguration();
+        m_CachedSslConfig.setLocalCertificate(getSslCertificate());
+        m_CachedSslConfig.setPrivateKey(getSslKey());
+        m_SslConfigInitialized = true;
+    }
+
+    return m_CachedSslConfig;
 }
 
 QString
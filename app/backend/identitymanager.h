@@ -4,6 +4,7 @@
 #include <QSslCertificate>
 #include <QSslKey>
 #include <QSettings>
+#include <QMutex>
 
 class IdentityManager
 {
@@ -45,5 +46,11 @@ private:
     QSslCertificate m_CachedSslCert;
     QSslKey m_CachedSslKey;
 
+    // Built once and copied for each request, since it's used from
+    // many threads and deriving it from the PEM data isn't cheap
+    QMutex m_SslConfigLock;
+    QSslConfiguration m_CachedSslConfig;
+    bool m_SslConfigInitialized = false;
+
     static IdentityManager* s_Im;
 };
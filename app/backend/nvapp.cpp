@@ -17,12 +17,12 @@ NvApp::NvApp(QSettings& settings)
     directLaunch = settings.value(SER_DIRECTLAUNCH).toBool();
 }
 
-void NvApp::serialize(QSettings& settings) const
+NvApp::NvApp(QDataStream& stream)
 {
-    settings.setValue(SER_APPNAME, name);
-    settings.setValue(SER_APPID, id);
-    settings.setValue(SER_APPHDR, hdrSupported);
-    settings.setValue(SER_APPCOLLECTOR, isAppCollectorGame);
-    settings.setValue(SER_HIDDEN, hidden);
-    settings.setValue(SER_DIRECTLAUNCH, directLaunch);
+    stream >> name >> id >> hdrSupported >> isAppCollectorGame >> hidden >> directLaunch;
+}
+
+void NvApp::serialize(QDataStream& stream) const
+{
+    stream << name << id << hdrSupported << isAppCollectorGame << hidden << directLaunch;
 }
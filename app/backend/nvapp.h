@@ -1,12 +1,14 @@
 #pragma once
 
 #include <QSettings>
+#include <QDataStream>
 
 class NvApp
 {
 public:
     NvApp() {}
     explicit NvApp(QSettings& settings);
+    explicit NvApp(QDataStream& stream);
 
     bool operator==(const NvApp& other) const
     {
@@ -31,7 +33,7 @@ public:
     }
 
     void
-    serialize(QSettings& settings) const;
+    serialize(QDataStream& stream) const;
 
     int id = 0;
     QString name;
@@ -20,13 +20,15 @@ public:
 
 class NvComputer
 {
-    friend class PcMonitorThread;
+    friend class HostPoller;
     friend class ComputerManager;
     friend class PendingQuitTask;
 
 private:
     void sortAppList();
 
+    void initializeEphemeralState();
+
     bool updateAppList(QVector<NvApp> newAppList);
 
     bool pendingQuit;
@@ -40,10 +42,13 @@ public:
     // Caller is responsible for synchronizing read access to the other host
     NvComputer& operator=(const NvComputer &) = default;
 
-    explicit NvComputer(NvHTTP& http, QString serverInfo);
+    explicit NvComputer(NvHTTP& http, const NvServerInfo& serverInfo);
 
+    // Only used to migrate hosts persisted by older versions
     explicit NvComputer(QSettings& settings);
 
+    explicit NvComputer(QDataStream& stream);
+
     void
     setRemoteAddress(QHostAddress);
 
@@ -67,7 +72,7 @@ public:
     uniqueAddresses() const;
 
     void
-    serialize(QSettings& settings, bool serializeApps) const;
+    serialize(QDataStream& stream) const;
 
     // Caller is responsible for synchronizing read access to both hosts
     bool
@@ -113,7 +118,7 @@ public:
     QSslCertificate serverCert;
     QVector<NvApp> appList;
     bool isNvidiaServerSoftware;
-    // Remember to update isEqualSerialized() when adding fields here!
+    // Remember to update serialize() and isEqualSerialized() when adding fields here!
 
     // Synchronization
     mutable CopySafeReadWriteLock lock;
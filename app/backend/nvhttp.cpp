@@ -8,9 +8,11 @@
 #include <QTimer>
 #include <QXmlStreamReader>
 #include <QSslKey>
-#include <QImageReader>
 #include <QtEndian>
 #include <QNetworkProxy>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QHash>
 
 #define FAST_FAIL_TIMEOUT_MS 2000
 #define REQUEST_TIMEOUT_MS 5000
@@ -18,6 +20,12 @@
 #define RESUME_TIMEOUT_MS 30000
 #define QUIT_TIMEOUT_MS 30000
 
+// TLS session tickets from previous HTTPS requests, keyed by host:port. Offering
+// these lets the host do an abbreviated handshake instead of a full handshake
+// with client certificate authentication on each request.
+static QMutex s_TlsSessionLock;
+static QHash<QString, QByteArray> s_TlsSessionTickets;
+
 #if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
 #define XML_NAME_EQUALS(x, y) ((x) == (y))
 #else
@@ -115,14 +123,19 @@ NvHTTP::parseQuad(QString quad)
 
 int
 NvHTTP::getCurrentGame(QString serverInfo)
+{
+    return getCurrentGame(NvServerInfo::parse(serverInfo));
+}
+
+int
+NvHTTP::getCurrentGame(const NvServerInfo& serverInfo)
 {
     // GFE 2.8 started keeping currentgame set to the last game played. As a result, it no longer
     // has the semantics that its name would indicate. To contain the effects of this change as much
     // as possible, we'll force the current game to zero if the server isn't in a streaming session.
-    QString serverState = getXmlString(serverInfo, "state");
-    if (serverState.endsWith("_SERVER_BUSY"))
+    if (serverInfo.state.endsWith("_SERVER_BUSY"))
     {
-        return getXmlString(serverInfo, "currentgame").toInt();
+        return serverInfo.currentGame;
     }
     else
     {
@@ -130,10 +143,27 @@ NvHTTP::getCurrentGame(QString serverInfo)
     }
 }
 
-QString
+NvServerInfo
+NvHTTP::requestServerInfo(QUrl baseUrl, int timeoutMs, NvLogLevel logLevel)
+{
+    QString xml = openConnectionToString(baseUrl,
+                                         "serverinfo",
+                                         nullptr,
+                                         timeoutMs,
+                                         logLevel);
+
+    NvServerInfo serverInfo = NvServerInfo::parse(xml);
+
+    // Throws if the request failed
+    verifyResponseStatus(serverInfo);
+    return serverInfo;
+}
+
+NvServerInfo
 NvHTTP::getServerInfo(NvLogLevel logLevel, bool fastFail)
 {
-    QString serverInfo;
+    NvServerInfo serverInfo;
+    int timeoutMs = fastFail ? FAST_FAIL_TIMEOUT_MS : REQUEST_TIMEOUT_MS;
 
     // Check if we have a pinned cert and HTTPS port for this host yet
     if (!m_ServerCert.isNull() && httpsPort() != 0)
@@ -142,25 +172,14 @@ NvHTTP::getServerInfo(NvLogLevel logLevel, bool fastFail)
         {
             // Always try HTTPS first, since it properly reports
             // pairing status (and a few other attributes).
-            serverInfo = openConnectionToString(m_BaseUrlHttps,
-                                                "serverinfo",
-                                                nullptr,
-                                                fastFail ? FAST_FAIL_TIMEOUT_MS : REQUEST_TIMEOUT_MS,
-                                                logLevel);
-            // Throws if the request failed
-            verifyResponseStatus(serverInfo);
+            serverInfo = requestServerInfo(m_BaseUrlHttps, timeoutMs, logLevel);
         }
         catch (const GfeHttpResponseException& e)
         {
             if (e.getStatusCode() == 401)
             {
                 // Certificate validation error, fallback to HTTP
-                serverInfo = openConnectionToString(m_BaseUrlHttp,
-                                                    "serverinfo",
-                                                    nullptr,
-                                                    fastFail ? FAST_FAIL_TIMEOUT_MS : REQUEST_TIMEOUT_MS,
-                                                    logLevel);
-                verifyResponseStatus(serverInfo);
+                serverInfo = requestServerInfo(m_BaseUrlHttp, timeoutMs, logLevel);
             }
             else
             {
@@ -172,15 +191,10 @@ NvHTTP::getServerInfo(NvLogLevel logLevel, bool fastFail)
     else
     {
         // Only use HTTP prior to pairing or fetching HTTPS port
-        serverInfo = openConnectionToString(m_BaseUrlHttp,
-                                            "serverinfo",
-                                            nullptr,
-                                            fastFail ? FAST_FAIL_TIMEOUT_MS : REQUEST_TIMEOUT_MS,
-                                            logLevel);
-        verifyResponseStatus(serverInfo);
+        serverInfo = requestServerInfo(m_BaseUrlHttp, timeoutMs, logLevel);
 
         // Populate the HTTPS port
-        uint16_t httpsPort = getXmlString(serverInfo, "HttpsPort").toUShort();
+        uint16_t httpsPort = serverInfo.httpsPort;
         if (httpsPort == 0) {
             httpsPort = DEFAULT_HTTPS_PORT;
         }
@@ -268,35 +282,6 @@ NvHTTP::quitApp()
     }
 }
 
-QVector<NvDisplayMode>
-NvHTTP::getDisplayModeList(QString serverInfo)
-{
-    QXmlStreamReader xmlReader(serverInfo);
-    QVector<NvDisplayMode> modes;
-
-    while (!xmlReader.atEnd()) {
-        while (xmlReader.readNextStartElement()) {
-            auto name = xmlReader.name();
-            if (XML_NAME_EQUALS(name, "DisplayMode")) {
-                modes.append(NvDisplayMode());
-            }
-            else if (!modes.isEmpty()) {
-                if (XML_NAME_EQUALS(name, "Width")) {
-                    modes.last().width = xmlReader.readElementText().toInt();
-                }
-                else if (XML_NAME_EQUALS(name, "Height")) {
-                    modes.last().height = xmlReader.readElementText().toInt();
-                }
-                else if (XML_NAME_EQUALS(name, "RefreshRate")) {
-                    modes.last().refreshRate = xmlReader.readElementText().toInt();
-                }
-            }
-        }
-    }
-
-    return modes;
-}
-
 QVector<NvApp>
 NvHTTP::getAppList()
 {
@@ -307,6 +292,12 @@ NvHTTP::getAppList()
                                             NvLogLevel::NVLL_ERROR);
     verifyResponseStatus(appxml);
 
+    return parseAppList(appxml);
+}
+
+QVector<NvApp>
+NvHTTP::parseAppList(QString appxml)
+{
     QXmlStreamReader xmlReader(appxml);
     QVector<NvApp> apps;
     while (!xmlReader.atEnd()) {
@@ -361,34 +352,49 @@ NvHTTP::verifyResponseStatus(QString xml)
             // Status code can be 0xFFFFFFFF in some rare cases on GFE 3.20.3, and
             // QString::toInt() will fail in that case, so use QString::toUInt()
             // and cast the result to an int instead.
-            int statusCode = (int)xmlReader.attributes().value("status_code").toUInt();
-            if (statusCode == 200)
-            {
-                // Successful
-                return;
-            }
-            else
-            {
-                QString statusMessage = xmlReader.attributes().value("status_message").toString();
-                if (statusCode != 401) {
-                    // 401 is expected for unpaired PCs when we fetch serverinfo over HTTPS
-                    qWarning() << "Request failed:" << statusCode << statusMessage;
-                }
-                if (statusCode == -1 && statusMessage == "Invalid") {
-                    // Special case handling an audio capture error which GFE doesn't
-                    // provide any useful status message for.
-                    statusCode = 418;
-                    statusMessage = tr("Missing audio capture device. Reinstalling GeForce Experience should resolve this error.");
-                }
-                throw GfeHttpResponseException(statusCode, statusMessage);
-            }
+            throwIfErrorStatus((int)xmlReader.attributes().value("status_code").toUInt(),
+                               xmlReader.attributes().value("status_message").toString());
+            return;
         }
     }
 
     throw GfeHttpResponseException(-1, "Malformed XML (missing root element)");
 }
 
-QImage
+void
+NvHTTP::verifyResponseStatus(const NvServerInfo& serverInfo)
+{
+    if (!serverInfo.isValid())
+    {
+        throw GfeHttpResponseException(-1, "Malformed XML (missing root element)");
+    }
+
+    throwIfErrorStatus(serverInfo.statusCode, serverInfo.statusMessage);
+}
+
+void
+NvHTTP::throwIfErrorStatus(int statusCode, QString statusMessage)
+{
+    if (statusCode == 200)
+    {
+        // Successful
+        return;
+    }
+
+    if (statusCode != 401) {
+        // 401 is expected for unpaired PCs when we fetch serverinfo over HTTPS
+        qWarning() << "Request failed:" << statusCode << statusMessage;
+    }
+    if (statusCode == -1 && statusMessage == "Invalid") {
+        // Special case handling an audio capture error which GFE doesn't
+        // provide any useful status message for.
+        statusCode = 418;
+        statusMessage = tr("Missing audio capture device. Reinstalling GeForce Experience should resolve this error.");
+    }
+    throw GfeHttpResponseException(statusCode, statusMessage);
+}
+
+QByteArray
 NvHTTP::getBoxArt(int appId)
 {
     QNetworkReply* reply = openConnection(m_BaseUrlHttps,
@@ -397,10 +403,12 @@ NvHTTP::getBoxArt(int appId)
                                           "&AssetType=2&AssetIdx=0",
                                           REQUEST_TIMEOUT_MS,
                                           NvLogLevel::NVLL_VERBOSE);
-    QImage image = QImageReader(reply).read();
+    // Return the image exactly as the host encoded it. Decoding
+    // and re-encoding is slow and inflates JPEG box art.
+    QByteArray imageData = reply->readAll();
     delete reply;
 
-    return image;
+    return imageData;
 }
 
 QByteArray
@@ -432,6 +440,26 @@ NvHTTP::getXmlString(QString xml,
     return QString();
 }
 
+QByteArray
+NvHTTP::getCachedTlsSession(const QString& key)
+{
+    QMutexLocker locker(&s_TlsSessionLock);
+    return s_TlsSessionTickets.value(key);
+}
+
+void
+NvHTTP::updateCachedTlsSession(const QString& key, const QByteArray& sessionTicket)
+{
+    QMutexLocker locker(&s_TlsSessionLock);
+
+    if (sessionTicket.isEmpty()) {
+        s_TlsSessionTickets.remove(key);
+    }
+    else {
+        s_TlsSessionTickets.insert(key, sessionTicket);
+    }
+}
+
 void NvHTTP::handleSslErrors(QNetworkReply* reply, const QList<QSslError>& errors)
 {
     bool ignoreErrors = true;
@@ -479,11 +507,11 @@ NvHTTP::openConnectionToString(QUrl baseUrl,
 }
 
 QNetworkReply*
-NvHTTP::openConnection(QUrl baseUrl,
-                       QString command,
-                       QString arguments,
-                       int timeoutMs,
-                       NvLogLevel logLevel)
+NvHTTP::startRequest(QUrl baseUrl,
+                     QString command,
+                     QString arguments,
+                     int timeoutMs,
+                     NvLogLevel logLevel)
 {
     // Port must be set
     Q_ASSERT(baseUrl.port(0) != 0);
@@ -500,7 +528,23 @@ NvHTTP::openConnection(QUrl baseUrl,
     QNetworkRequest request(url);
 
     // Add our client certificate
-    request.setSslConfiguration(IdentityManager::get()->getSslConfig());
+    QSslConfiguration sslConfig = IdentityManager::get()->getSslConfig();
+
+    // We still close the socket after each request (see below), so resume the TLS
+    // session instead. Qt only exposes the session ticket if persistence is enabled.
+    QString tlsSessionKey;
+    bool offeredTlsSession = false;
+    if (url.scheme() == "https") {
+        tlsSessionKey = url.host() + ":" + QString::number(url.port());
+        sslConfig.setSslOption(QSsl::SslOptionDisableSessionPersistence, false);
+
+        QByteArray sessionTicket = getCachedTlsSession(tlsSessionKey);
+        if (!sessionTicket.isEmpty()) {
+            sslConfig.setSessionTicket(sessionTicket);
+            offeredTlsSession = true;
+        }
+    }
+    request.setSslConfiguration(sslConfig);
 
 #if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
     // Disable HTTP/2 (GFE 3.22 doesn't like it) and Qt 6 enables it by default
@@ -514,9 +558,69 @@ NvHTTP::openConnection(QUrl baseUrl,
     request.setAttribute(QNetworkRequest::ConnectionCacheExpiryTimeoutSecondsAttribute, 0);
 #endif
 
-    auto sslErrorsConnection = connect(m_Nam, &QNetworkAccessManager::sslErrors, this, &NvHTTP::handleSslErrors);
+    QElapsedTimer requestTimer;
+    requestTimer.start();
+
     QNetworkReply* reply = m_Nam->get(request);
 
+    if (!tlsSessionKey.isEmpty()) {
+        // This includes the TCP connection time, but that's small next to
+        // the handshake itself on the clients where this matters.
+        connect(reply, &QNetworkReply::encrypted,
+                this, [command, offeredTlsSession, requestTimer, logLevel]() {
+            if (logLevel >= NvLogLevel::NVLL_VERBOSE) {
+                qInfo() << "TLS handshake for" << command << "took" << requestTimer.elapsed() << "ms"
+                        << (offeredTlsSession ? "(resumption offered)" : "(full handshake)");
+            }
+            else {
+                qDebug() << "TLS handshake for" << command << "took" << requestTimer.elapsed() << "ms"
+                         << (offeredTlsSession ? "(resumption offered)" : "(full handshake)");
+            }
+        });
+
+        // TLS 1.3 tickets arrive after the handshake, so wait until the reply is done to grab it
+        connect(reply, &QNetworkReply::finished,
+                this, [reply, tlsSessionKey]() {
+            if (reply->error() == QNetworkReply::SslHandshakeFailedError) {
+                // Don't keep offering a session to a host that just rejected us
+                updateCachedTlsSession(tlsSessionKey, QByteArray());
+            }
+            else if (reply->error() == QNetworkReply::NoError) {
+                updateCachedTlsSession(tlsSessionKey, reply->sslConfiguration().sessionTicket());
+            }
+        });
+    }
+
+    // Validate against our pinned cert. This is connected per-reply rather than on the
+    // NAM, because a NAM may be shared by many NvHTTP instances with different certs.
+    connect(reply, &QNetworkReply::sslErrors,
+            this, [this, reply](const QList<QSslError>& errors) {
+        handleSslErrors(reply, errors);
+    });
+
+    // Abort the request if it doesn't finish in time. The reply
+    // will finish with QNetworkReply::OperationCanceledError.
+    if (timeoutMs) {
+        QTimer::singleShot(timeoutMs, reply, &QNetworkReply::abort);
+    }
+
+    if (logLevel >= NvLogLevel::NVLL_VERBOSE) {
+        qInfo() << "Executing request:" << url.toString();
+    }
+
+    return reply;
+}
+
+QNetworkReply*
+NvHTTP::openConnection(QUrl baseUrl,
+                       QString command,
+                       QString arguments,
+                       int timeoutMs,
+                       NvLogLevel logLevel)
+{
+    // We run the timeout ourselves so we can tell it apart from other cancellations
+    QNetworkReply* reply = startRequest(baseUrl, command, arguments, 0, logLevel);
+
     // Run the request with a timeout if requested
     QEventLoop loop;
     connect(reply, &QNetworkReply::finished, &loop, &QEventLoop::quit);
@@ -524,16 +628,13 @@ NvHTTP::openConnection(QUrl baseUrl,
     if (timeoutMs) {
         QTimer::singleShot(timeoutMs, &loop, &QEventLoop::quit);
     }
-    if (logLevel >= NvLogLevel::NVLL_VERBOSE) {
-        qInfo() << "Executing request:" << url.toString();
-    }
     loop.exec(QEventLoop::ExcludeUserInputEvents);
 
     // Abort the request if it timed out
     if (!reply->isFinished())
     {
         if (logLevel >= NvLogLevel::NVLL_ERROR) {
-            qWarning() << "Aborting timed out request for" << url.toString();
+            qWarning() << "Aborting timed out request for" << reply->url().toString();
         }
         reply->abort();
     }
@@ -542,7 +643,6 @@ NvHTTP::openConnection(QUrl baseUrl,
     // If we couldn't use fine-grained connection idle timeouts, kill them all now
     m_Nam->clearAccessCache();
 #endif
-    disconnect(sslErrorsConnection);
 
     // Handle error
     if (reply->error() != QNetworkReply::NoError)
@@ -3,6 +3,7 @@
 #include "identitymanager.h"
 #include "nvapp.h"
 #include "nvaddress.h"
+#include "nvserverinfo.h"
 
 #include <Limelight.h>
 
@@ -12,22 +13,6 @@
 
 class NvComputer;
 
-class NvDisplayMode
-{
-public:
-    bool operator==(const NvDisplayMode& other) const
-    {
-        return width == other.width &&
-                height == other.height &&
-                refreshRate == other.refreshRate;
-    }
-
-    int width;
-    int height;
-    int refreshRate;
-};
-Q_DECLARE_TYPEINFO(NvDisplayMode, Q_PRIMITIVE_TYPE);
-
 class GfeHttpResponseException : public std::exception
 {
 public:
@@ -117,13 +102,21 @@ public:
     int
     getCurrentGame(QString serverInfo);
 
-    QString
+    static
+    int
+    getCurrentGame(const NvServerInfo& serverInfo);
+
+    NvServerInfo
     getServerInfo(NvLogLevel logLevel, bool fastFail = false);
 
     static
     void
     verifyResponseStatus(QString xml);
 
+    static
+    void
+    verifyResponseStatus(const NvServerInfo& serverInfo);
+
     static
     QString
     getXmlString(QString xml,
@@ -175,12 +168,22 @@ public:
     QVector<NvApp>
     getAppList();
 
-    QImage
-    getBoxArt(int appId);
-
+    // Throws std::runtime_error if the applist is malformed
     static
-    QVector<NvDisplayMode>
-    getDisplayModeList(QString serverInfo);
+    QVector<NvApp>
+    parseAppList(QString appxml);
+
+    // Issues a request without waiting for it to complete. The caller
+    // owns the returned reply and must check it for errors itself.
+    QNetworkReply*
+    startRequest(QUrl baseUrl,
+                 QString command,
+                 QString arguments,
+                 int timeoutMs,
+                 NvLogLevel logLevel);
+
+    QByteArray
+    getBoxArt(int appId);
 
     QUrl m_BaseUrlHttp;
     QUrl m_BaseUrlHttps;
@@ -188,6 +191,15 @@ private:
     void
     handleSslErrors(QNetworkReply* reply, const QList<QSslError>& errors);
 
+    NvServerInfo
+    requestServerInfo(QUrl baseUrl,
+                      int timeoutMs,
+                      NvLogLevel logLevel);
+
+    static
+    void
+    throwIfErrorStatus(int statusCode, QString statusMessage);
+
     QNetworkReply*
     openConnection(QUrl baseUrl,
                    QString command,
@@ -195,6 +207,14 @@ private:
                    int timeoutMs,
                    NvLogLevel logLevel);
 
+    static
+    QByteArray
+    getCachedTlsSession(const QString& key);
+
+    static
+    void
+    updateCachedTlsSession(const QString& key, const QByteArray& sessionTicket);
+
     NvAddress m_Address;
     QNetworkAccessManager* m_Nam;
     QSslCertificate m_ServerCert;
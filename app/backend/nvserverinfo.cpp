@@ -0,0 +1,119 @@
+#include "nvserverinfo.h"
+
+#include <QSet>
+#include <QXmlStreamReader>
+
+#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
+#define XML_NAME_EQUALS(x, y) ((x) == (y))
+#else
+#define XML_NAME_EQUALS(x, y) ((x) == (u##y))
+#endif
+
+NvServerInfo
+NvServerInfo::parse(const QString& serverInfo)
+{
+    QXmlStreamReader xmlReader(serverInfo);
+    NvServerInfo info;
+
+    // Walk the document exactly once. Like NvHTTP::getXmlString(), we match tags
+    // regardless of nesting depth and the first occurrence of a tag wins.
+    QSet<QString> seenTags;
+    while (!xmlReader.atEnd())
+    {
+        if (xmlReader.readNext() != QXmlStreamReader::StartElement)
+        {
+            continue;
+        }
+
+        auto name = xmlReader.name();
+        if (XML_NAME_EQUALS(name, "root")) {
+            if (!info.hasRootElement) {
+                // See verifyResponseStatus() for why this is parsed as unsigned
+                info.hasRootElement = true;
+                info.statusCode = (int)xmlReader.attributes().value("status_code").toUInt();
+                info.statusMessage = xmlReader.attributes().value("status_message").toString();
+            }
+            continue;
+        }
+        else if (XML_NAME_EQUALS(name, "DisplayMode")) {
+            info.displayModes.append(NvDisplayMode());
+            continue;
+        }
+        else if (!info.displayModes.isEmpty() &&
+                 (XML_NAME_EQUALS(name, "Width") ||
+                  XML_NAME_EQUALS(name, "Height") ||
+                  XML_NAME_EQUALS(name, "RefreshRate"))) {
+            int value = xmlReader.readElementText().toInt();
+            if (XML_NAME_EQUALS(name, "Width")) {
+                info.displayModes.last().width = value;
+            }
+            else if (XML_NAME_EQUALS(name, "Height")) {
+                info.displayModes.last().height = value;
+            }
+            else {
+                info.displayModes.last().refreshRate = value;
+            }
+            continue;
+        }
+
+        QString tagName = name.toString();
+        if (seenTags.contains(tagName)) {
+            continue;
+        }
+
+        if (tagName == "hostname") {
+            info.hostname = xmlReader.readElementText();
+        }
+        else if (tagName == "uniqueid") {
+            info.uniqueId = xmlReader.readElementText();
+        }
+        else if (tagName == "mac") {
+            info.macAddress = xmlReader.readElementText();
+        }
+        else if (tagName == "ServerCodecModeSupport") {
+            QString value = xmlReader.readElementText();
+            info.hasServerCodecModeSupport = !value.isEmpty();
+            info.serverCodecModeSupport = value.toInt();
+        }
+        else if (tagName == "MaxLumaPixelsHEVC") {
+            info.maxLumaPixelsHEVC = xmlReader.readElementText().toInt();
+        }
+        else if (tagName == "LocalIP") {
+            info.localIp = xmlReader.readElementText();
+        }
+        else if (tagName == "HttpsPort") {
+            info.httpsPort = xmlReader.readElementText().toUShort();
+        }
+        else if (tagName == "ExternalPort") {
+            info.externalPort = xmlReader.readElementText().toUShort();
+        }
+        else if (tagName == "ExternalIP") {
+            info.externalIp = xmlReader.readElementText();
+        }
+        else if (tagName == "state") {
+            info.state = xmlReader.readElementText();
+        }
+        else if (tagName == "PairStatus") {
+            info.paired = xmlReader.readElementText() == "1";
+        }
+        else if (tagName == "currentgame") {
+            info.currentGame = xmlReader.readElementText().toInt();
+        }
+        else if (tagName == "appversion") {
+            info.appVersion = xmlReader.readElementText();
+        }
+        else if (tagName == "GfeVersion") {
+            info.gfeVersion = xmlReader.readElementText();
+        }
+        else if (tagName == "gputype") {
+            info.gpuModel = xmlReader.readElementText();
+        }
+        else {
+            continue;
+        }
+
+        seenTags.insert(tagName);
+    }
+
+    return info;
+}
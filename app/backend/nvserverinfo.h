@@ -0,0 +1,56 @@
+#pragma once
+
+#include <QString>
+#include <QVector>
+
+class NvDisplayMode
+{
+public:
+    bool operator==(const NvDisplayMode& other) const
+    {
+        return width == other.width &&
+                height == other.height &&
+                refreshRate == other.refreshRate;
+    }
+
+    int width;
+    int height;
+    int refreshRate;
+};
+Q_DECLARE_TYPEINFO(NvDisplayMode, Q_PRIMITIVE_TYPE);
+
+// Typed result of a single pass over a serverinfo response.
+// Fields that the host didn't report are left at their defaults.
+class NvServerInfo
+{
+public:
+    // Reads the whole response in a single pass
+    static NvServerInfo parse(const QString& serverInfo);
+
+    bool isValid() const
+    {
+        return hasRootElement;
+    }
+
+    bool hasRootElement = false;
+    int statusCode = -1;
+    QString statusMessage;
+
+    QString hostname;
+    QString uniqueId;
+    QString macAddress;
+    QString localIp;
+    QString externalIp;
+    QString state;
+    QString appVersion;
+    QString gfeVersion;
+    QString gpuModel;
+    bool hasServerCodecModeSupport = false;
+    int serverCodecModeSupport = 0;
+    int maxLumaPixelsHEVC = 0;
+    uint16_t httpsPort = 0;
+    uint16_t externalPort = 0;
+    bool paired = false;
+    int currentGame = 0;
+    QVector<NvDisplayMode> displayModes;
+};
@@ -326,6 +326,14 @@ StreamCommandLineParser::StreamCommandLineParser()
         {"software", StreamingPreferences::VDS_FORCE_SOFTWARE},
         {"hardware", StreamingPreferences::VDS_FORCE_HARDWARE},
     };
+    m_RendererMap = {
+        {"auto",   StreamingPreferences::RS_AUTO},
+        {"vulkan", StreamingPreferences::RS_VULKAN},
+        {"metal",  StreamingPreferences::RS_METAL},
+        {"avsbdl", StreamingPreferences::RS_AVSBDL},
+        {"null",   StreamingPreferences::RS_NULL},
+        {"auto-tune", StreamingPreferences::RS_AUTO_TUNE},
+    };
     m_CaptureSysKeysModeMap = {
         {"never",      StreamingPreferences::CSK_OFF},
         {"fullscreen", StreamingPreferences::CSK_FULLSCREEN},
@@ -383,6 +391,8 @@ void StreamCommandLineParser::parse(const QStringList &args, StreamingPreference
     parser.addChoiceOption("capture-system-keys", "capture system key combos", m_CaptureSysKeysModeMap.keys());
     parser.addChoiceOption("video-codec", "video codec", m_VideoCodecMap.keys());
     parser.addChoiceOption("video-decoder", "video decoder", m_VideoDecoderMap.keys());
+    parser.addChoiceOption("renderer", "video renderer", m_RendererMap.keys());
+    parser.addFlagOption("retune-renderer", "a fresh renderer benchmark instead of cached auto-tune results");
 
     if (!parser.parse(args)) {
         parser.showError(parser.errorText());
@@ -526,6 +536,17 @@ void StreamCommandLineParser::parse(const QStringList &args, StreamingPreference
         preferences->videoDecoderSelection = mapValue(m_VideoDecoderMap, parser.getChoiceOptionValue("video-decoder"));
     }
 
+    // Resolve --renderer option
+    if (parser.isSet("renderer")) {
+        preferences->rendererSelection = mapValue(m_RendererMap, parser.getChoiceOptionValue("renderer"));
+    }
+
+    // Resolve --retune-renderer option
+    m_RetuneRenderer = parser.isSet("retune-renderer");
+    if (m_RetuneRenderer) {
+        preferences->rendererSelection = StreamingPreferences::RS_AUTO_TUNE;
+    }
+
     // This method will not return and terminates the process if --version or
     // --help is specified
     parser.handleHelpAndVersionOptions();
@@ -553,6 +574,11 @@ QString StreamCommandLineParser::getAppName() const
     return m_AppName;
 }
 
+bool StreamCommandLineParser::getRetuneRenderer() const
+{
+    return m_RetuneRenderer;
+}
+
 ListCommandLineParser::ListCommandLineParser()
 {
 }
@@ -63,15 +63,18 @@ public:
 
     QString getHost() const;
     QString getAppName() const;
+    bool getRetuneRenderer() const;
 
 private:
     QString m_Host;
     QString m_AppName;
+    bool m_RetuneRenderer;
     QMap<QString, StreamingPreferences::WindowMode> m_WindowModeMap;
     QMap<QString, StreamingPreferences::AudioConfig> m_AudioConfigMap;
     QMap<QString, StreamingPreferences::SuperResolutionMode> m_SuperResolutionModeMap;
     QMap<QString, StreamingPreferences::VideoCodecConfig> m_VideoCodecMap;
     QMap<QString, StreamingPreferences::VideoDecoderSelection> m_VideoDecoderMap;
+    QMap<QString, StreamingPreferences::RendererSelection> m_RendererMap;
     QMap<QString, StreamingPreferences::CaptureSysKeysMode> m_CaptureSysKeysModeMap;
 };
 
@@ -26,6 +26,20 @@ CenteredGridView {
         stackView.pop()
     }
 
+    function updateVisibleRange()
+    {
+        // Tell the model which apps are on screen so their box art is fetched first
+        var columns = Math.max(1, Math.floor((width - leftMargin - rightMargin) / cellWidth))
+        var firstRow = Math.max(0, Math.floor((contentY - originY) / cellHeight))
+        var lastRow = Math.floor((contentY - originY + height) / cellHeight)
+        appModel.setVisibleRange(firstRow * columns, (lastRow + 1) * columns - 1)
+    }
+
+    onContentYChanged: updateVisibleRange()
+    onHeightChanged: updateVisibleRange()
+    onWidthChanged: updateVisibleRange()
+    onCountChanged: updateVisibleRange()
+
     Component.onCompleted: {
         // Don't show any highlighted item until interacting with them.
         // We do this here instead of onActivated to avoid losing the user's
@@ -61,9 +75,14 @@ CenteredGridView {
         activated = false
     }
 
+    StackView.onRemoved: {
+        // Nothing we haven't fetched yet will ever be displayed
+        appModel.cancelBoxArtFetches()
+    }
+
     function createModel()
     {
-        var model = Qt.createQmlObject('import AppModel 1.0; AppModel {}', parent, '')
+        var model = Qt.createQmlObject('import AppModel 1.0; AppModel {}', appGrid, '')
         model.initialize(ComputerManager, computerIndex, showHiddenGames)
         return model
     }
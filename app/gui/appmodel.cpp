@@ -301,9 +301,26 @@ void AppModel::handleComputerStateChanged(NvComputer* computer)
     }
 }
 
-void AppModel::handleBoxArtLoaded(NvComputer* computer, NvApp app, QUrl /* image */)
+void AppModel::setVisibleRange(int firstIndex, int lastIndex)
 {
-    Q_ASSERT(computer == m_Computer);
+    QVector<int> visibleAppIds;
+
+    // Box art for these apps will be fetched before anything else that's queued
+    for (int i = qMax(firstIndex, 0); i <= lastIndex && i < m_VisibleApps.count(); i++) {
+        visibleAppIds.append(m_VisibleApps[i].id);
+    }
+
+    m_BoxArtManager.setVisibleApps(m_Computer, visibleAppIds);
+}
+
+void AppModel::cancelBoxArtFetches()
+{
+    m_BoxArtManager.cancelPendingFetches();
+}
+
+void AppModel::handleBoxArtLoaded(QString computerUuid, NvApp app, QUrl /* image */)
+{
+    Q_ASSERT(computerUuid == m_Computer->uuid);
 
     int index = m_VisibleApps.indexOf(app);
 
@@ -41,6 +41,10 @@ public:
 
     Q_INVOKABLE void setAppDirectLaunch(int appIndex, bool directLaunch);
 
+    Q_INVOKABLE void setVisibleRange(int firstIndex, int lastIndex);
+
+    Q_INVOKABLE void cancelBoxArtFetches();
+
     QVariant data(const QModelIndex &index, int role) const override;
 
     int rowCount(const QModelIndex &parent) const override;
@@ -50,7 +54,7 @@ public:
 private slots:
     void handleComputerStateChanged(NvComputer* computer);
 
-    void handleBoxArtLoaded(NvComputer* computer, NvApp app, QUrl image);
+    void handleBoxArtLoaded(QString computerUuid, NvApp app, QUrl image);
 
 signals:
     void computerLost();
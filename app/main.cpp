@@ -46,12 +46,15 @@
 #include "cli/commandlineparser.h"
 #include "path.h"
 #include "utils.h"
+#include "asynclogger.h"
 #include "gui/computermodel.h"
 #include "gui/appmodel.h"
 #include "backend/autoupdatechecker.h"
 #include "backend/computermanager.h"
+#include "backend/boxartmanager.h"
 #include "backend/systemproperties.h"
 #include "streaming/session.h"
+#include "streaming/video/renderertuning.h"
 #include "settings/streamingpreferences.h"
 #include "gui/sdlgamepadkeynavigation.h"
 
@@ -75,7 +78,6 @@ QAtomicInt g_AsyncLoggingEnabled;
 
 static QElapsedTimer s_LoggerTime;
 static QTextStream s_LoggerStream(stderr);
-static QThreadPool s_LoggerThread;
 static QMutex s_SyncLoggerMutex;
 static bool s_SuppressVerboseOutput;
 static QRegularExpression k_RikeyRegex("&rikey=\\w+");
@@ -91,29 +93,6 @@ static QFile* s_LoggerFile;
 extern "C" bool g_DisableDrmHooks;
 #endif
 
-class LoggerTask : public QRunnable
-{
-public:
-    LoggerTask(const QString& msg) : m_Msg(msg)
-    {
-        setAutoDelete(true);
-    }
-
-    void run() override
-    {
-        // QTextStream is not thread-safe, so we must lock. This will generally
-        // only contend in synchronous logging mode or during a transition
-        // between synchronous and asynchronous. Asynchronous won't contend in
-        // the common case because we only have a single logging thread.
-        QMutexLocker locker(&s_SyncLoggerMutex);
-        s_LoggerStream << m_Msg;
-        s_LoggerStream.flush();
-    }
-
-private:
-    QString m_Msg;
-};
-
 void logToLoggerStream(QString& message)
 {
 #if defined(QT_DEBUG) && defined(Q_OS_WIN32)
@@ -143,97 +122,151 @@ void logToLoggerStream(QString& message)
     }
 #endif
 
-    if (g_AsyncLoggingEnabled) {
-        // Queue the log message to be written asynchronously
-        s_LoggerThread.start(new LoggerTask(message));
-    }
-    else {
-        // Log the message immediately
-        LoggerTask(message).run();
-    }
+    // QTextStream is not thread-safe, so we must lock. This will generally
+    // only contend in synchronous logging mode or during a transition
+    // between synchronous and asynchronous. Asynchronous won't contend in
+    // the common case because we only have a single logging thread.
+    QMutexLocker locker(&s_SyncLoggerMutex);
+    s_LoggerStream << message;
+    s_LoggerStream.flush();
 }
 
-void sdlLogToDiskHandler(void*, int category, SDL_LogPriority priority, const char* message)
+// Called on the logging thread in async mode, or the calling thread otherwise
+static void writeLogRecord(const LogRecord& record, const char* text)
 {
-    QString priorityTxt;
+    QTime logTime = QTime::fromMSecsSinceStartOfDay(record.timeMs);
+    QString txt;
 
-    switch (priority) {
-    case SDL_LOG_PRIORITY_VERBOSE:
-        if (s_SuppressVerboseOutput) {
-            return;
-        }
-        priorityTxt = "Verbose";
-        break;
-    case SDL_LOG_PRIORITY_DEBUG:
-        if (s_SuppressVerboseOutput) {
-            return;
-        }
-        priorityTxt = "Debug";
-        break;
-    case SDL_LOG_PRIORITY_INFO:
-        if (s_SuppressVerboseOutput) {
-            return;
+    switch (record.source) {
+    case LogRecord::SourceSdl:
+    {
+        const char* priorityTxt;
+        switch (record.priority) {
+        case SDL_LOG_PRIORITY_VERBOSE:
+            priorityTxt = "Verbose";
+            break;
+        case SDL_LOG_PRIORITY_DEBUG:
+            priorityTxt = "Debug";
+            break;
+        case SDL_LOG_PRIORITY_INFO:
+            priorityTxt = "Info";
+            break;
+        case SDL_LOG_PRIORITY_WARN:
+            priorityTxt = "Warn";
+            break;
+        case SDL_LOG_PRIORITY_ERROR:
+            priorityTxt = "Error";
+            break;
+        case SDL_LOG_PRIORITY_CRITICAL:
+            priorityTxt = "Critical";
+            break;
+        default:
+            priorityTxt = "Unknown";
+            break;
         }
-        priorityTxt = "Info";
+
+        txt = QString("%1 - SDL %2 (%3): %4\n").arg(logTime.toString()).arg(priorityTxt).arg(record.category).arg(text);
         break;
-    case SDL_LOG_PRIORITY_WARN:
-        if (s_SuppressVerboseOutput) {
-            return;
+    }
+
+    case LogRecord::SourceQt:
+    {
+        const char* typeTxt;
+        switch (record.priority) {
+        case QtDebugMsg:
+            typeTxt = "Debug";
+            break;
+        case QtInfoMsg:
+            typeTxt = "Info";
+            break;
+        case QtWarningMsg:
+            typeTxt = "Warning";
+            break;
+        case QtCriticalMsg:
+            typeTxt = "Critical";
+            break;
+        case QtFatalMsg:
+            typeTxt = "Fatal";
+            break;
+        default:
+            typeTxt = "Unknown";
+            break;
         }
-        priorityTxt = "Warn";
-        break;
-    case SDL_LOG_PRIORITY_ERROR:
-        priorityTxt = "Error";
+
+        txt = QString("%1 - Qt %2: %3\n").arg(logTime.toString()).arg(typeTxt).arg(QString::fromUtf8(text));
         break;
-    case SDL_LOG_PRIORITY_CRITICAL:
-        priorityTxt = "Critical";
+    }
+
+    case LogRecord::SourceFFmpeg:
+        txt = QString("%1 - FFmpeg: %2").arg(logTime.toString()).arg(text);
         break;
-    default:
-        priorityTxt = "Unknown";
+
+    case LogRecord::SourceFFmpegContinuation:
+        txt = QString(text);
         break;
     }
 
-    QTime logTime = QTime::fromMSecsSinceStartOfDay(s_LoggerTime.elapsed());
-    QString txt = QString("%1 - SDL %2 (%3): %4\n").arg(logTime.toString()).arg(priorityTxt).arg(category).arg(message);
+    logToLoggerStream(txt);
+}
 
+static void reportDroppedLogRecords(uint32_t droppedRecords)
+{
+    QTime logTime = QTime::fromMSecsSinceStartOfDay(s_LoggerTime.elapsed());
+    QString txt = QString("%1 - Logger: %2 log messages were dropped\n").arg(logTime.toString()).arg(droppedRecords);
     logToLoggerStream(txt);
 }
 
-void qtLogToDiskHandler(QtMsgType type, const QMessageLogContext&, const QString& msg)
+static AsyncLogger s_AsyncLogger(writeLogRecord, reportDroppedLogRecords);
+
+// Timestamps are taken here, but all other formatting is done when the
+// message is written. In async mode, that is on the logging thread.
+static void logMessage(LogRecord::Source source, int category, int priority,
+                       const char* text, int textLength, bool forceSync = false)
+{
+    qint64 timeMs = s_LoggerTime.elapsed();
+
+    if (g_AsyncLoggingEnabled && !forceSync) {
+        // Queue the log message to be written asynchronously. If the
+        // queue is full, it's dropped and counted by the logger.
+        s_AsyncLogger.log(source, category, priority, timeMs, text, textLength);
+    }
+    else {
+        // Log the message immediately
+        LogRecord record;
+        record.source = source;
+        record.category = category;
+        record.priority = priority;
+        record.timeMs = timeMs;
+        writeLogRecord(record, text);
+    }
+}
+
+void sdlLogToDiskHandler(void*, int category, SDL_LogPriority priority, const char* message)
 {
-    QString typeTxt;
+    if (s_SuppressVerboseOutput && priority < SDL_LOG_PRIORITY_ERROR) {
+        return;
+    }
 
+    logMessage(LogRecord::SourceSdl, category, priority, message, (int)strlen(message));
+}
+
+void qtLogToDiskHandler(QtMsgType type, const QMessageLogContext&, const QString& msg)
+{
     switch (type) {
     case QtDebugMsg:
-        if (s_SuppressVerboseOutput) {
-            return;
-        }
-        typeTxt = "Debug";
-        break;
     case QtInfoMsg:
-        if (s_SuppressVerboseOutput) {
-            return;
-        }
-        typeTxt = "Info";
-        break;
     case QtWarningMsg:
         if (s_SuppressVerboseOutput) {
             return;
         }
-        typeTxt = "Warning";
         break;
-    case QtCriticalMsg:
-        typeTxt = "Critical";
-        break;
-    case QtFatalMsg:
-        typeTxt = "Fatal";
+    default:
         break;
     }
 
-    QTime logTime = QTime::fromMSecsSinceStartOfDay(s_LoggerTime.elapsed());
-    QString txt = QString("%1 - Qt %2: %3\n").arg(logTime.toString()).arg(typeTxt).arg(msg);
-
-    logToLoggerStream(txt);
+    // Qt aborts after a fatal message, so it must be written before we return
+    QByteArray utf8Msg = msg.toUtf8();
+    logMessage(LogRecord::SourceQt, 0, type, utf8Msg.constData(), utf8Msg.size(), type == QtFatalMsg);
 }
 
 #ifdef HAVE_FFMPEG
@@ -257,15 +290,8 @@ void ffmpegLogToDiskHandler(void* ptr, int level, const char* fmt, va_list vl)
 
     av_log_format_line(ptr, level, fmt, vl, lineBuffer, sizeof(lineBuffer), &printPrefix);
 
-    if (shouldPrefixThisMessage) {
-        QTime logTime = QTime::fromMSecsSinceStartOfDay(s_LoggerTime.elapsed());
-        QString txt = QString("%1 - FFmpeg: %2").arg(logTime.toString()).arg(lineBuffer);
-        logToLoggerStream(txt);
-    }
-    else {
-        QString txt = QString(lineBuffer);
-        logToLoggerStream(txt);
-    }
+    logMessage(shouldPrefixThisMessage ? LogRecord::SourceFFmpeg : LogRecord::SourceFFmpegContinuation,
+               0, level, lineBuffer, (int)strlen(lineBuffer));
 }
 
 #endif
@@ -387,6 +413,14 @@ int SDLCALL signalHandlerThread(void* data)
             }
             break;
 
+        case SIGUSR1:
+            // Allow external tools to capture a frame snapshot
+            session = Session::get();
+            if (session != nullptr) {
+                session->requestFrameSnapshot();
+            }
+            break;
+
         default:
             Q_UNREACHABLE();
         }
@@ -414,6 +448,7 @@ void configureSignalHandlers()
     sigemptyset(&sa.sa_mask);
     sigaction(SIGINT, &sa, nullptr);
     sigaction(SIGTERM, &sa, nullptr);
+    sigaction(SIGUSR1, &sa, nullptr);
 }
 
 #endif
@@ -473,7 +508,7 @@ int main(int argc, char *argv[])
 #endif
 
     // Serialize log messages on a single thread
-    s_LoggerThread.setMaxThreadCount(1);
+    s_AsyncLogger.start();
     s_LoggerTime.start();
 
     // Register our logger with all libraries
@@ -985,6 +1020,9 @@ int main(int argc, char *argv[])
 
     QQmlApplicationEngine engine;
     QString initialView;
+
+    // Serves app grid box art from BoxArtManager's thumbnail cache
+    engine.addImageProvider("boxart", new BoxArtImageProvider());
     bool hasGUI = true;
 
     switch (commandLineParserResult) {
@@ -999,6 +1037,10 @@ int main(int argc, char *argv[])
             streamParser.parse(app.arguments(), preferences);
             QString host    = streamParser.getHost();
             QString appName = streamParser.getAppName();
+            if (streamParser.getRetuneRenderer()) {
+                // Benchmark the renderers again for the display we end up streaming on
+                RendererTuning::requestRetune();
+            }
             auto launcher   = new CliStartStream::Launcher(host, appName, preferences, &app);
             engine.rootContext()->setContextProperty("launcher", launcher);
             break;
@@ -1063,7 +1105,7 @@ int main(int argc, char *argv[])
     Q_ASSERT(g_AsyncLoggingEnabled == 0);
 
     // Wait for pending log messages to be printed
-    s_LoggerThread.waitForDone();
+    s_AsyncLogger.stop();
 
 #ifdef Q_OS_WIN32
     // Without an explicit flush, console redirection for the list command
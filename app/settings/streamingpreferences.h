@@ -57,14 +57,16 @@ public:
     };
     Q_ENUM(VideoDecoderSelection)
 
-    // Mac only (for now)
+    // Mac only (for now), except for RS_NULL and RS_AUTO_TUNE
     enum RendererSelection
     {
         RS_PROBE_ONLY = -1, // Only valid for probing decoder properties
         RS_AUTO,
         RS_VULKAN,
         RS_METAL,
-        RS_AVSBDL
+        RS_AVSBDL,
+        RS_NULL, // Decode and discard frames for benchmarking
+        RS_AUTO_TUNE // Benchmark the available renderers and use the fastest
     };
     Q_ENUM(RendererSelection)
 
@@ -1,4 +1,9 @@
+#ifdef SW_FRAME_TEXTURES
+#define PLANE_SAMPLER sampler2D
+#else
 #extension GL_OES_EGL_image_external : require
+#define PLANE_SAMPLER samplerExternalOES
+#endif
 precision mediump float;
 
 varying vec2 vTexCoord;
@@ -6,13 +11,21 @@ varying vec2 vTexCoord;
 uniform mat3 yuvmat;
 uniform vec3 offset;
 uniform vec2 chromaOffset;
-uniform samplerExternalOES plane1;
-uniform samplerExternalOES plane2;
+uniform PLANE_SAMPLER plane1;
+uniform PLANE_SAMPLER plane2;
+#ifdef SW_FRAME_PLANAR_CHROMA
+uniform PLANE_SAMPLER plane3;
+#endif
 
 void main() {
     vec3 YCbCr = vec3(
         texture2D(plane1, vTexCoord)[0],
+#ifdef SW_FRAME_PLANAR_CHROMA
+            texture2D(plane2, vTexCoord + chromaOffset)[0],
+            texture2D(plane3, vTexCoord + chromaOffset)[0]
+#else
             texture2D(plane2, vTexCoord + chromaOffset).xy
+#endif
     );
 
     YCbCr -= offset;
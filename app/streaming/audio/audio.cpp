@@ -51,48 +51,159 @@ IAudioRenderer* Session::createAudioRenderer(const POPUS_MULTISTREAM_CONFIGURATI
     return nullptr;
 }
 
-bool Session::initializeAudioRenderer()
+bool Session::initializeAudioRenderer(AudioPipeline& pipeline)
 {
     int error;
 
     SDL_assert(m_OriginalAudioConfig.channelCount > 0);
-    SDL_assert(m_AudioRenderer == nullptr);
-    SDL_assert(m_OpusDecoder == nullptr);
 
-    m_AudioRenderer = createAudioRenderer(&m_OriginalAudioConfig);
+    pipeline = {};
+    pipeline.renderer = createAudioRenderer(&m_OriginalAudioConfig);
 
     // We may be unable to create an audio renderer right now
-    if (m_AudioRenderer == nullptr) {
+    if (pipeline.renderer == nullptr) {
         return false;
     }
 
     // Allow the chosen renderer to remap Opus channels as needed to ensure proper output
-    m_ActiveAudioConfig = m_OriginalAudioConfig;
-    m_AudioRenderer->remapChannels(&m_ActiveAudioConfig);
+    pipeline.activeConfig = m_OriginalAudioConfig;
+    pipeline.renderer->remapChannels(&pipeline.activeConfig);
 
     // Create the Opus decoder with the renderer's preferred channel mapping
-    m_OpusDecoder =
-        opus_multistream_decoder_create(m_ActiveAudioConfig.sampleRate,
-                                        m_ActiveAudioConfig.channelCount,
-                                        m_ActiveAudioConfig.streams,
-                                        m_ActiveAudioConfig.coupledStreams,
-                                        m_ActiveAudioConfig.mapping,
+    pipeline.opusDecoder =
+        opus_multistream_decoder_create(pipeline.activeConfig.sampleRate,
+                                        pipeline.activeConfig.channelCount,
+                                        pipeline.activeConfig.streams,
+                                        pipeline.activeConfig.coupledStreams,
+                                        pipeline.activeConfig.mapping,
                                         &error);
-    if (m_OpusDecoder == nullptr) {
-        delete m_AudioRenderer;
-        m_AudioRenderer = nullptr;
+    if (pipeline.opusDecoder == nullptr) {
+        delete pipeline.renderer;
+        pipeline.renderer = nullptr;
         SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
                      "Failed to create decoder: %d",
                      error);
         return false;
     }
 
+    // Only renderers that can report their queue depth get drift compensation
+    if (pipeline.renderer->getTargetQueuedSampleFrames() > 0) {
+        pipeline.driftCompensator =
+                new AudioDriftCompensator(pipeline.activeConfig.sampleRate,
+                                          pipeline.activeConfig.channelCount,
+                                          pipeline.activeConfig.samplesPerFrame,
+                                          pipeline.renderer->getAudioBufferFormat() == IAudioRenderer::AudioFormat::Float32NE);
+    }
+
     SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
                 "Audio stream has %d channels",
-                m_ActiveAudioConfig.channelCount);
+                pipeline.activeConfig.channelCount);
     return true;
 }
 
+void Session::installAudioPipeline(const AudioPipeline& pipeline)
+{
+    SDL_assert(m_AudioRenderer == nullptr);
+    SDL_assert(m_AudioDriftCompensator == nullptr);
+
+    // Replace the decoder we kept running while there was no renderer
+    if (m_OpusDecoder != nullptr) {
+        opus_multistream_decoder_destroy(m_OpusDecoder);
+    }
+
+    m_AudioRenderer = pipeline.renderer;
+    m_OpusDecoder = pipeline.opusDecoder;
+    m_ActiveAudioConfig = pipeline.activeConfig;
+    m_AudioDriftCompensator = pipeline.driftCompensator;
+    SDL_AtomicSet(&m_AudioDriftCompensationActive, m_AudioDriftCompensator != nullptr);
+
+    // Renderer counters start over with each renderer
+    m_LastRendererUnderruns = 0;
+    m_LastRendererDroppedFrames = 0;
+
+    if (m_AudioSyncDelayMs != 0) {
+        m_AudioRenderer->setSyncDelayMs(m_AudioSyncDelayMs);
+    }
+}
+
+int Session::audioReinitThreadProc(void* context)
+{
+    auto me = (Session*)context;
+
+    // Closing a removed device can block for a while too
+    delete me->m_FailedAudioRenderer;
+    me->m_FailedAudioRenderer = nullptr;
+
+    // Retry once per second to avoid thrashing if no audio device is available
+    while (!SDL_AtomicGet(&me->m_AudioReinitCancelled)) {
+        Uint32 startTime = SDL_GetTicks();
+
+        if (me->initializeAudioRenderer(me->m_PendingAudioPipeline)) {
+            SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+                        "Audio reinitialization took %d ms",
+                        SDL_GetTicks() - startTime);
+            SDL_AtomicSet(&me->m_AudioReinitReady, 1);
+            break;
+        }
+
+        for (int i = 0; i < 10 && !SDL_AtomicGet(&me->m_AudioReinitCancelled); i++) {
+            SDL_Delay(100);
+        }
+    }
+
+    return 0;
+}
+
+void Session::startAudioRendererReinit(IAudioRenderer* failedRenderer)
+{
+    SDL_assert(m_AudioReinitThread == nullptr);
+
+    // Don't try to spawn the thread again for every packet if it failed before
+    if (m_AudioReinitThreadFailed) {
+        delete failedRenderer;
+        return;
+    }
+
+    // Keep decoding (and discarding) with the old decoder until the new
+    // renderer is ready, so the decoder state stays current.
+    m_AudioDiscardBuffer.resize(m_ActiveAudioConfig.samplesPerFrame * m_ActiveAudioConfig.channelCount);
+
+    m_FailedAudioRenderer = failedRenderer;
+    SDL_AtomicSet(&m_AudioReinitReady, 0);
+    SDL_AtomicSet(&m_AudioReinitCancelled, 0);
+    m_AudioReinitThread = SDL_CreateThread(Session::audioReinitThreadProc, "AudioReinit", this);
+    if (m_AudioReinitThread == nullptr) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                     "Unable to create audio reinitialization thread: %s",
+                     SDL_GetError());
+        delete m_FailedAudioRenderer;
+        m_FailedAudioRenderer = nullptr;
+
+        // Audio stays disabled for the rest of this session
+        m_AudioReinitThreadFailed = true;
+    }
+}
+
+void Session::stopAudioRendererReinit()
+{
+    if (m_AudioReinitThread == nullptr) {
+        return;
+    }
+
+    SDL_AtomicSet(&m_AudioReinitCancelled, 1);
+    SDL_WaitThread(m_AudioReinitThread, nullptr);
+    m_AudioReinitThread = nullptr;
+
+    // Discard the new pipeline if it finished but was never installed
+    if (SDL_AtomicGet(&m_AudioReinitReady)) {
+        delete m_PendingAudioPipeline.driftCompensator;
+        delete m_PendingAudioPipeline.renderer;
+        opus_multistream_decoder_destroy(m_PendingAudioPipeline.opusDecoder);
+        SDL_AtomicSet(&m_AudioReinitReady, 0);
+    }
+    m_PendingAudioPipeline = {};
+}
+
 int Session::getAudioRendererCapabilities(int audioConfiguration)
 {
     int caps = 0;
@@ -134,12 +245,53 @@ int Session::arInit(int /* audioConfiguration */,
                     void* /* arContext */, int /* arFlags */)
 {
     SDL_memcpy(&s_ActiveSession->m_OriginalAudioConfig, opusConfig, sizeof(*opusConfig));
-    s_ActiveSession->initializeAudioRenderer();
+    if (s_ActiveSession->m_StreamRecorder != nullptr) {
+        s_ActiveSession->m_StreamRecorder->setAudioConfig(opusConfig);
+    }
+
+    // If there's no usable audio device yet, the audio thread will
+    // keep retrying in the background.
+    AudioPipeline pipeline;
+    if (s_ActiveSession->initializeAudioRenderer(pipeline)) {
+        s_ActiveSession->installAudioPipeline(pipeline);
+    }
     return 0;
 }
 
 void Session::arCleanup()
 {
+    s_ActiveSession->stopAudioRendererReinit();
+
+    s_ActiveSession->updateAudioRendererStats();
+    addAudioStats(s_ActiveSession->m_ActiveWndAudioStats, s_ActiveSession->m_GlobalAudioStats);
+    if (s_ActiveSession->m_GlobalAudioStats.receivedPackets != 0) {
+        char audioStatsStr[512];
+        stringifyAudioStats(s_ActiveSession->m_GlobalAudioStats, audioStatsStr, sizeof(audioStatsStr));
+
+        SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+                    "\nGlobal audio stats\n------------------\n%s",
+                    audioStatsStr);
+    }
+
+    if (s_ActiveSession->m_AudioDriftCompensator != nullptr) {
+        SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+                    "Estimated audio clock drift: %d ppm",
+                    s_ActiveSession->m_AudioDriftCompensator->getDriftPpm());
+    }
+
+    double avOffsetMs, avStdDevMs;
+    if (s_ActiveSession->m_AVSyncMonitor.getOffset(avOffsetMs, avStdDevMs)) {
+        SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+                    "Final A/V offset: %+.1f ms (std dev: %.1f ms, audio delay: %d ms)",
+                    avOffsetMs,
+                    avStdDevMs,
+                    s_ActiveSession->m_AudioSyncDelayMs);
+    }
+
+    delete s_ActiveSession->m_AudioDriftCompensator;
+    s_ActiveSession->m_AudioDriftCompensator = nullptr;
+    SDL_AtomicSet(&s_ActiveSession->m_AudioDriftCompensationActive, 0);
+
     delete s_ActiveSession->m_AudioRenderer;
     s_ActiveSession->m_AudioRenderer = nullptr;
 
@@ -165,54 +317,131 @@ void Session::arDecodeAndPlaySample(char* sampleData, int sampleLength)
     }
 #endif
 
-    // See if we need to drop this sample
-    if (s_ActiveSession->m_DropAudioEndTime != 0) {
-        if (SDL_TICKS_PASSED(SDL_GetTicks(), s_ActiveSession->m_DropAudioEndTime)) {
-            // Avoid calling SDL_GetTicks() now
-            s_ActiveSession->m_DropAudioEndTime = 0;
+    // Record the sample even if we're not going to play it
+    if (s_ActiveSession->m_StreamRecorder != nullptr) {
+        s_ActiveSession->m_StreamRecorder->submitAudioPacket(sampleData, sampleLength);
+    }
 
-            SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
-                        "Audio drop window has ended");
-        }
-        else {
-            // We're still in the drop window
-            return;
+    // Account for time this packet spent waiting in the depacketizer
+    uint64_t arrivalTimeUs = LiGetMicroseconds() - LiGetPendingAudioDuration() * 1000;
+    uint64_t outputTimeUs = 0;
+
+    AUDIO_STATS& stats = s_ActiveSession->m_ActiveWndAudioStats;
+    if (stats.measurementStartUs == 0) {
+        stats.measurementStartUs = LiGetMicroseconds();
+    }
+    else if (LiGetMicroseconds() > stats.measurementStartUs + 1000000) {
+        // Flip stats windows roughly every second
+        s_ActiveSession->updateAudioRendererStats();
+
+        AUDIO_STATS lastTwoWndStats = {};
+        addAudioStats(s_ActiveSession->m_LastWndAudioStats, lastTwoWndStats);
+        addAudioStats(stats, lastTwoWndStats);
+        if (s_ActiveSession->m_AVSyncCorrectionEnabled) {
+            s_ActiveSession->updateAudioSyncDelay(lastTwoWndStats);
         }
+        SDL_AtomicLock(&s_ActiveSession->m_OverlayAudioStatsLock);
+        s_ActiveSession->m_OverlayAudioStats = lastTwoWndStats;
+        SDL_AtomicUnlock(&s_ActiveSession->m_OverlayAudioStatsLock);
+
+        addAudioStats(stats, s_ActiveSession->m_GlobalAudioStats);
+        s_ActiveSession->m_LastWndAudioStats = stats;
+        SDL_zero(stats);
+        stats.measurementStartUs = LiGetMicroseconds();
     }
+    stats.receivedPackets++;
 
     s_ActiveSession->m_AudioSampleCount++;
 
     // If audio is muted, don't decode or play the audio
     if (s_ActiveSession->m_AudioMuted) {
+        s_ActiveSession->m_AVSyncMonitor.reportAudioPacket(s_ActiveSession->m_OriginalAudioConfig.samplesPerFrame,
+                                                           s_ActiveSession->m_OriginalAudioConfig.sampleRate,
+                                                           arrivalTimeUs, 0);
         return;
     }
 
     if (s_ActiveSession->m_AudioRenderer != nullptr) {
+        AudioDriftCompensator* driftCompensator = s_ActiveSession->m_AudioDriftCompensator;
         int sampleSize = s_ActiveSession->m_AudioRenderer->getAudioBufferSampleSize();
         int frameSize = sampleSize * s_ActiveSession->m_ActiveAudioConfig.channelCount;
         int desiredBufferSize = frameSize * s_ActiveSession->m_ActiveAudioConfig.samplesPerFrame;
+        if (driftCompensator != nullptr) {
+            // Resampling may produce slightly more output than input
+            desiredBufferSize = frameSize * driftCompensator->getMaxOutputFrames();
+        }
+
         void* buffer = s_ActiveSession->m_AudioRenderer->getAudioBuffer(&desiredBufferSize);
         if (buffer == nullptr) {
+            s_ActiveSession->m_AVSyncMonitor.reportAudioPacket(s_ActiveSession->m_OriginalAudioConfig.samplesPerFrame,
+                                                               s_ActiveSession->m_OriginalAudioConfig.sampleRate,
+                                                               arrivalTimeUs, 0);
             return;
         }
 
+        // With drift compensation, decode into the compensator's input buffer and
+        // resample from there into the renderer's buffer.
+        void* decodeBuffer = buffer;
+        int decodeBufferSize = desiredBufferSize;
+        if (driftCompensator != nullptr) {
+            decodeBuffer = driftCompensator->getInputBuffer();
+            decodeBufferSize = frameSize * s_ActiveSession->m_ActiveAudioConfig.samplesPerFrame;
+        }
+
+        uint64_t decodeStartUs = LiGetMicroseconds();
         if (s_ActiveSession->m_AudioRenderer->getAudioBufferFormat() == IAudioRenderer::AudioFormat::Float32NE) {
             samplesDecoded = opus_multistream_decode_float(s_ActiveSession->m_OpusDecoder,
                                                            (unsigned char*)sampleData,
                                                            sampleLength,
-                                                           (float*)buffer,
-                                                           desiredBufferSize / frameSize,
+                                                           (float*)decodeBuffer,
+                                                           decodeBufferSize / frameSize,
                                                            0);
         }
         else {
             samplesDecoded = opus_multistream_decode(s_ActiveSession->m_OpusDecoder,
                                                      (unsigned char*)sampleData,
                                                      sampleLength,
-                                                     (short*)buffer,
-                                                     desiredBufferSize / frameSize,
+                                                     (short*)decodeBuffer,
+                                                     decodeBufferSize / frameSize,
                                                      0);
         }
 
+        if (samplesDecoded > 0 && driftCompensator != nullptr) {
+            // Include audio still waiting in the depacketizer in the queue depth
+            int queuedFrames = s_ActiveSession->m_AudioRenderer->getQueuedSampleFrames() +
+                    LiGetPendingAudioDuration() * (s_ActiveSession->m_ActiveAudioConfig.sampleRate / 1000);
+            driftCompensator->updateQueueDepth(queuedFrames,
+                                               s_ActiveSession->m_AudioRenderer->getTargetQueuedSampleFrames());
+            SDL_AtomicSet(&s_ActiveSession->m_AudioDriftPpm, driftCompensator->getDriftPpm());
+
+            samplesDecoded = driftCompensator->process(samplesDecoded, buffer);
+        }
+
+        if (samplesDecoded > 0) {
+            stats.decodedPackets++;
+            stats.totalDecodeTimeUs += LiGetMicroseconds() - decodeStartUs;
+        }
+
+        int queuedFrames = s_ActiveSession->m_AudioRenderer->getQueuedSampleFrames();
+        if (queuedFrames >= 0) {
+            uint32_t queueDepthUs = (uint32_t)((uint64_t)queuedFrames * 1000000 / s_ActiveSession->m_ActiveAudioConfig.sampleRate);
+            if (stats.queueDepthSamples == 0 || queueDepthUs < stats.minQueueDepthUs) {
+                stats.minQueueDepthUs = queueDepthUs;
+            }
+            stats.maxQueueDepthUs = qMax(stats.maxQueueDepthUs, queueDepthUs);
+            stats.totalQueueDepthUs += queueDepthUs;
+            stats.queueDepthSamples++;
+        }
+        stats.deviceLatencyUs = s_ActiveSession->m_AudioRenderer->getDeviceLatencyUs();
+
+        // This packet will be heard once everything queued ahead of it has played
+        if (samplesDecoded > 0) {
+            outputTimeUs = LiGetMicroseconds() + stats.deviceLatencyUs;
+            if (queuedFrames >= 0) {
+                outputTimeUs += (uint64_t)queuedFrames * 1000000 / s_ActiveSession->m_ActiveAudioConfig.sampleRate;
+            }
+        }
+
         // Update desiredSize with the number of bytes actually populated by the decoding operation
         if (samplesDecoded > 0) {
             SDL_assert(desiredBufferSize >= frameSize * samplesDecoded);
@@ -226,30 +455,233 @@ void Session::arDecodeAndPlaySample(char* sampleData, int sampleLength)
             SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION,
                         "Reinitializing audio renderer after failure");
 
-            opus_multistream_decoder_destroy(s_ActiveSession->m_OpusDecoder);
-            s_ActiveSession->m_OpusDecoder = nullptr;
+            delete s_ActiveSession->m_AudioDriftCompensator;
+            s_ActiveSession->m_AudioDriftCompensator = nullptr;
+            SDL_AtomicSet(&s_ActiveSession->m_AudioDriftCompensationActive, 0);
 
-            delete s_ActiveSession->m_AudioRenderer;
+            // Collect the last counts before the failed renderer is
+            // destroyed on the reinit thread
+            s_ActiveSession->updateAudioRendererStats();
+            IAudioRenderer* failedRenderer = s_ActiveSession->m_AudioRenderer;
             s_ActiveSession->m_AudioRenderer = nullptr;
+            s_ActiveSession->startAudioRendererReinit(failedRenderer);
+        }
+    }
+    else if (s_ActiveSession->m_AudioReinitThread != nullptr) {
+        if (SDL_AtomicGet(&s_ActiveSession->m_AudioReinitReady)) {
+            // The new renderer is ready, so start using it with the next sample
+            SDL_WaitThread(s_ActiveSession->m_AudioReinitThread, nullptr);
+            s_ActiveSession->m_AudioReinitThread = nullptr;
+            SDL_AtomicSet(&s_ActiveSession->m_AudioReinitReady, 0);
+
+            s_ActiveSession->installAudioPipeline(s_ActiveSession->m_PendingAudioPipeline);
+            s_ActiveSession->m_PendingAudioPipeline = {};
         }
+        else {
+            stats.droppedPackets++;
+            if (s_ActiveSession->m_OpusDecoder != nullptr) {
+                opus_multistream_decode_float(s_ActiveSession->m_OpusDecoder,
+                                              (unsigned char*)sampleData,
+                                              sampleLength,
+                                              s_ActiveSession->m_AudioDiscardBuffer.data(),
+                                              s_ActiveSession->m_ActiveAudioConfig.samplesPerFrame,
+                                              0);
+            }
+        }
+    }
+    else {
+        // We've never had a working renderer, so start looking for one
+        stats.droppedPackets++;
+        s_ActiveSession->startAudioRendererReinit(nullptr);
     }
 
-    // Only try to recreate the audio renderer every 200 samples (1 second)
-    // to avoid thrashing if the audio device is unavailable. It is
-    // safe to reinitialize here because we can't be torn down while
-    // the audio decoder/playback thread is still alive.
-    if (s_ActiveSession->m_AudioRenderer == nullptr && (s_ActiveSession->m_AudioSampleCount % 200) == 0) {
-        // Since we're doing this inline and audio initialization takes time, we need
-        // to drop samples to account for the time we've spent blocking audio rendering
-        // so we return to real-time playback and don't accumulate latency.
-        Uint32 audioReinitStartTime = SDL_GetTicks();
-        if (s_ActiveSession->initializeAudioRenderer()) {
-            Uint32 audioReinitStopTime = SDL_GetTicks();
+    s_ActiveSession->m_AVSyncMonitor.reportAudioPacket(s_ActiveSession->m_OriginalAudioConfig.samplesPerFrame,
+                                                       s_ActiveSession->m_OriginalAudioConfig.sampleRate,
+                                                       arrivalTimeUs, outputTimeUs);
+}
 
-            s_ActiveSession->m_DropAudioEndTime = audioReinitStopTime + (audioReinitStopTime - audioReinitStartTime);
-            SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
-                        "Audio reinitialization took %d ms - starting drop window",
-                        audioReinitStopTime - audioReinitStartTime);
+void Session::updateAudioSyncDelay(AUDIO_STATS& stats)
+{
+    double offsetMs, stdDevMs;
+
+    if (m_AudioRenderer == nullptr || stats.queueDepthSamples == 0 ||
+            !m_AVSyncMonitor.getOffset(offsetMs, stdDevMs)) {
+        return;
+    }
+
+    // Wait for the queue to reach the last delay we asked for. Otherwise
+    // the offset still reflects the old delay and we'd overshoot.
+    double avgQueueDepthMs = (double)(stats.totalQueueDepthUs / 1000.0) / stats.queueDepthSamples;
+    double targetQueueDepthMs = m_AudioRenderer->getTargetQueuedSampleFrames() * 1000.0 / m_ActiveAudioConfig.sampleRate;
+    if (qAbs(avgQueueDepthMs - targetQueueDepthMs) > 2.0) {
+        return;
+    }
+
+    // Ignore offsets that are small or buried in jitter
+    if (qAbs(offsetMs) < SDL_max(5.0, stdDevMs)) {
+        return;
+    }
+
+    int newDelayMs = qBound(0, m_AudioSyncDelayMs + (int)offsetMs, 100);
+    if (newDelayMs == m_AudioSyncDelayMs) {
+        // We're at a delay limit. Running out of delay to remove means audio
+        // is late, which would require holding video back instead.
+        if (!m_AVSyncUncorrectableLogged && offsetMs < 0) {
+            SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION,
+                        "Audio lags video by %.1f ms and cannot be corrected",
+                        -offsetMs);
+            m_AVSyncUncorrectableLogged = true;
+        }
+        return;
+    }
+
+    if (!m_AudioRenderer->setSyncDelayMs(newDelayMs)) {
+        return;
+    }
+
+    SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+                "Delaying audio by %d ms to match video (A/V offset: %.1f ms)",
+                newDelayMs,
+                offsetMs);
+    m_AudioSyncDelayMs = newDelayMs;
+}
+
+void Session::updateAudioRendererStats()
+{
+    if (m_AudioRenderer == nullptr) {
+        return;
+    }
+
+    uint32_t underruns = m_AudioRenderer->getUnderrunCount();
+    uint32_t droppedFrames = m_AudioRenderer->getDroppedFrameCount();
+
+    m_ActiveWndAudioStats.rendererUnderruns += underruns - m_LastRendererUnderruns;
+    m_ActiveWndAudioStats.rendererDroppedFrames += droppedFrames - m_LastRendererDroppedFrames;
+    m_LastRendererUnderruns = underruns;
+    m_LastRendererDroppedFrames = droppedFrames;
+}
+
+void Session::addAudioStats(AUDIO_STATS& src, AUDIO_STATS& dst)
+{
+    dst.receivedPackets += src.receivedPackets;
+    dst.decodedPackets += src.decodedPackets;
+    dst.droppedPackets += src.droppedPackets;
+    dst.rendererUnderruns += src.rendererUnderruns;
+    dst.rendererDroppedFrames += src.rendererDroppedFrames;
+    dst.totalDecodeTimeUs += src.totalDecodeTimeUs;
+
+    if (src.queueDepthSamples != 0) {
+        if (dst.queueDepthSamples == 0) {
+            dst.minQueueDepthUs = src.minQueueDepthUs;
+        }
+        else {
+            dst.minQueueDepthUs = qMin(dst.minQueueDepthUs, src.minQueueDepthUs);
+        }
+        dst.maxQueueDepthUs = qMax(dst.maxQueueDepthUs, src.maxQueueDepthUs);
+        dst.totalQueueDepthUs += src.totalQueueDepthUs;
+        dst.queueDepthSamples += src.queueDepthSamples;
+    }
+
+    if (src.deviceLatencyUs != 0) {
+        dst.deviceLatencyUs = src.deviceLatencyUs;
+    }
+
+    // Initialize the measurement start point if this is the first audio stat window
+    if (!dst.measurementStartUs) {
+        dst.measurementStartUs = src.measurementStartUs;
+    }
+}
+
+void Session::stringifyAudioStats(AUDIO_STATS& stats, char* output, int length)
+{
+    int offset = 0;
+    int ret;
+
+    // Start with an empty string
+    output[offset] = 0;
+
+    if (stats.decodedPackets != 0) {
+        ret = snprintf(&output[offset],
+                       length - offset,
+                       "Average audio decoding time: %.2f ms\n",
+                       (double)(stats.totalDecodeTimeUs / 1000.0) / stats.decodedPackets);
+        if (ret < 0 || ret >= length - offset) {
+            SDL_assert(false);
+            return;
+        }
+
+        offset += ret;
+    }
+
+    if (stats.queueDepthSamples != 0) {
+        double avgQueueDepthMs = (double)(stats.totalQueueDepthUs / 1000.0) / stats.queueDepthSamples;
+
+        ret = snprintf(&output[offset],
+                       length - offset,
+                       "Audio queue depth min/max/average: %.1f/%.1f/%.1f ms\n",
+                       stats.minQueueDepthUs / 1000.0,
+                       stats.maxQueueDepthUs / 1000.0,
+                       avgQueueDepthMs);
+        if (ret < 0 || ret >= length - offset) {
+            SDL_assert(false);
+            return;
+        }
+
+        offset += ret;
+
+        if (stats.deviceLatencyUs != 0) {
+            ret = snprintf(&output[offset],
+                           length - offset,
+                           "Estimated audio output latency: %.1f ms\n",
+                           avgQueueDepthMs + stats.deviceLatencyUs / 1000.0);
+            if (ret < 0 || ret >= length - offset) {
+                SDL_assert(false);
+                return;
+            }
+
+            offset += ret;
         }
     }
+
+    if (stats.receivedPackets != 0) {
+        ret = snprintf(&output[offset],
+                       length - offset,
+                       "Audio underruns: %u\n"
+                       "Audio frames dropped: %.2f%%\n",
+                       stats.rendererUnderruns,
+                       (float)(stats.droppedPackets + stats.rendererDroppedFrames) / stats.receivedPackets * 100);
+        if (ret < 0 || ret >= length - offset) {
+            SDL_assert(false);
+            return;
+        }
+
+        offset += ret;
+    }
+}
+
+void Session::stringifyAudioStats(char* output, int length)
+{
+    AUDIO_STATS stats;
+
+    SDL_AtomicLock(&m_OverlayAudioStatsLock);
+    stats = m_OverlayAudioStats;
+    SDL_AtomicUnlock(&m_OverlayAudioStatsLock);
+
+    stringifyAudioStats(stats, output, length);
+
+    if (SDL_AtomicGet(&m_AudioDriftCompensationActive)) {
+        int offset = (int)strlen(output);
+        snprintf(&output[offset], length - offset,
+                 "Audio clock drift: %+d ppm\n",
+                 SDL_AtomicGet(&m_AudioDriftPpm));
+    }
+
+    double avOffsetMs, avStdDevMs;
+    if (m_AVSyncMonitor.getOffset(avOffsetMs, avStdDevMs)) {
+        int offset = (int)strlen(output);
+        snprintf(&output[offset], length - offset,
+                 "A/V offset (video behind audio): %+.1f ms (std dev: %.1f ms)\n",
+                 avOffsetMs,
+                 avStdDevMs);
+    }
 }
@@ -0,0 +1,181 @@
+#include "downmixer.h"
+
+#include "SDL_compat.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define DOWNMIX_SSE2
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define DOWNMIX_NEON
+#endif
+
+// -3 dB
+#define MIX_M3DB 0.70710678f
+
+bool AudioDownmixer::isSupported(int inputChannels, int outputChannels)
+{
+    return (inputChannels == 8 && (outputChannels == 6 || outputChannels == 2)) ||
+           (inputChannels == 6 && outputChannels == 2);
+}
+
+AudioDownmixer::AudioDownmixer(int inputChannels, int outputChannels)
+    : m_InputChannels(inputChannels),
+      m_OutputChannels(outputChannels)
+{
+    SDL_assert(isSupported(inputChannels, outputChannels));
+
+    float to51[6][8] = {};
+    float to20[2][8] = {};
+
+    if (inputChannels == 8) {
+        // Fold the side channels into the back channels
+        to51[0][0] = 1.0f;
+        to51[1][1] = 1.0f;
+        to51[2][2] = 1.0f;
+        to51[3][3] = 1.0f;
+        to51[4][4] = MIX_M3DB;
+        to51[4][6] = MIX_M3DB;
+        to51[5][5] = MIX_M3DB;
+        to51[5][7] = MIX_M3DB;
+    }
+    else {
+        for (int i = 0; i < 6; i++) {
+            to51[i][i] = 1.0f;
+        }
+    }
+
+    if (outputChannels == 6) {
+        SDL_memcpy(m_Matrix, to51, sizeof(to51));
+        SDL_memset(&m_Matrix[6], 0, sizeof(m_Matrix[6]) * 2);
+        return;
+    }
+
+    // 5.1 to stereo, dropping LFE and normalized so a full scale signal
+    // on every channel doesn't clip
+    const float norm = 1.0f / (1.0f + MIX_M3DB + MIX_M3DB);
+    const float stereo[2][6] = {
+        { norm, 0.0f, MIX_M3DB * norm, 0.0f, MIX_M3DB * norm, 0.0f },
+        { 0.0f, norm, MIX_M3DB * norm, 0.0f, 0.0f, MIX_M3DB * norm },
+    };
+
+    for (int out = 0; out < 2; out++) {
+        for (int in = 0; in < 8; in++) {
+            for (int mid = 0; mid < 6; mid++) {
+                to20[out][in] += stereo[out][mid] * to51[mid][in];
+            }
+        }
+    }
+
+    SDL_memset(m_Matrix, 0, sizeof(m_Matrix));
+    SDL_memcpy(m_Matrix, to20, sizeof(to20));
+}
+
+void AudioDownmixer::processScalar(const float* input, float* output, int frames) const
+{
+    for (int i = 0; i < frames; i++) {
+        for (int out = 0; out < m_OutputChannels; out++) {
+            float sample = 0;
+            for (int in = 0; in < m_InputChannels; in++) {
+                sample += m_Matrix[out][in] * input[in];
+            }
+            output[out] = sample;
+        }
+
+        input += m_InputChannels;
+        output += m_OutputChannels;
+    }
+}
+
+void AudioDownmixer::processScalar(const short* input, short* output, int frames) const
+{
+    for (int i = 0; i < frames; i++) {
+        for (int out = 0; out < m_OutputChannels; out++) {
+            float sample = 0;
+            for (int in = 0; in < m_InputChannels; in++) {
+                sample += m_Matrix[out][in] * input[in];
+            }
+            output[out] = (short)SDL_max(-32768.0f, SDL_min(sample, 32767.0f));
+        }
+
+        input += m_InputChannels;
+        output += m_OutputChannels;
+    }
+}
+
+void AudioDownmixer::process(const float* input, float* output, int frames) const
+{
+#if defined(DOWNMIX_SSE2) || defined(DOWNMIX_NEON)
+    // Each frame is read as 8 floats. For 5.1 input, that runs into the next
+    // frame (which the zero padded matrix ignores), so the final frame must
+    // be done separately to avoid reading past the end of the input.
+    int vectorFrames = m_InputChannels == 8 ? frames : SDL_max(frames - 1, 0);
+
+    for (int i = 0; i < vectorFrames; i++) {
+#ifdef DOWNMIX_SSE2
+        __m128 lo = _mm_loadu_ps(input);
+        __m128 hi = _mm_loadu_ps(input + 4);
+
+        for (int out = 0; out < m_OutputChannels; out++) {
+            __m128 acc = _mm_add_ps(_mm_mul_ps(lo, _mm_load_ps(&m_Matrix[out][0])),
+                                    _mm_mul_ps(hi, _mm_load_ps(&m_Matrix[out][4])));
+
+            // Horizontal sum
+            acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+            acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, 1));
+            output[out] = _mm_cvtss_f32(acc);
+        }
+#else
+        float32x4_t lo = vld1q_f32(input);
+        float32x4_t hi = vld1q_f32(input + 4);
+
+        for (int out = 0; out < m_OutputChannels; out++) {
+            float32x4_t acc = vmulq_f32(lo, vld1q_f32(&m_Matrix[out][0]));
+            acc = vmlaq_f32(acc, hi, vld1q_f32(&m_Matrix[out][4]));
+            output[out] = vaddvq_f32(acc);
+        }
+#endif
+
+        input += m_InputChannels;
+        output += m_OutputChannels;
+    }
+
+    processScalar(input, output, frames - vectorFrames);
+#else
+    processScalar(input, output, frames);
+#endif
+}
+
+void AudioDownmixer::process(const short* input, short* output, int frames) const
+{
+#ifdef DOWNMIX_SSE2
+    // Same overread consideration as the float path (8 shorts per load)
+    int vectorFrames = m_InputChannels == 8 ? frames : SDL_max(frames - 1, 0);
+
+    for (int i = 0; i < vectorFrames; i++) {
+        __m128i samples = _mm_loadu_si128((const __m128i*)input);
+
+        // Sign extend to 32-bit and convert to float
+        __m128 lo = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(samples, samples), 16));
+        __m128 hi = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(samples, samples), 16));
+
+        for (int out = 0; out < m_OutputChannels; out++) {
+            __m128 acc = _mm_add_ps(_mm_mul_ps(lo, _mm_load_ps(&m_Matrix[out][0])),
+                                    _mm_mul_ps(hi, _mm_load_ps(&m_Matrix[out][4])));
+            acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+            acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, 1));
+
+            // Round and saturate back to 16-bit
+            __m128i result = _mm_cvtps_epi32(acc);
+            output[out] = (short)_mm_cvtsi128_si32(_mm_packs_epi32(result, result));
+        }
+
+        input += m_InputChannels;
+        output += m_OutputChannels;
+    }
+
+    processScalar(input, output, frames - vectorFrames);
+#else
+    processScalar(input, output, frames);
+#endif
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <QtGlobal>
+
+// Mixes 7.1 or 5.1 audio down to 5.1 or stereo using the standard ITU-R
+// BS.775 coefficients. Channels are in the default Opus/SDL order:
+// FL, FR, C, LFE, BL, BR, (SL, SR).
+class AudioDownmixer
+{
+public:
+    static bool isSupported(int inputChannels, int outputChannels);
+
+    AudioDownmixer(int inputChannels, int outputChannels);
+
+    // Input and output may not overlap
+    void process(const float* input, float* output, int frames) const;
+    void process(const short* input, short* output, int frames) const;
+
+private:
+    friend class DownmixBenchmark;
+
+    void processScalar(const float* input, float* output, int frames) const;
+    void processScalar(const short* input, short* output, int frames) const;
+
+    int m_InputChannels;
+    int m_OutputChannels;
+
+    // Row-major mixing matrix, padded to 8 inputs so each row can be
+    // processed with two 4-wide vectors
+    alignas(16) float m_Matrix[8][8];
+};
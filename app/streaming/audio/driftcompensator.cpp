@@ -0,0 +1,140 @@
+#include "driftcompensator.h"
+
+#include "SDL_compat.h"
+
+// Frames of input retained between calls for cubic interpolation
+#define HISTORY_FRAMES 3
+
+// Queue depth samples are noisy because the device drains the queue in
+// large chunks, so the error is averaged over roughly one second of packets.
+#define ERROR_SMOOTHING_FACTOR 0.005
+
+// Queue depth starts out wildly off target while the renderer primes, so
+// don't let startup transients wind up the drift estimate.
+#define WARMUP_UPDATES 400
+
+// Controller gains (ppm per ms of error, and ppm per ms per update)
+#define PROPORTIONAL_GAIN 50.0
+#define INTEGRAL_GAIN 0.01
+
+// Real clock drift is a few hundred ppm at most. Staying well under 0.5%
+// keeps the pitch change inaudible.
+#define MAX_INTEGRAL_PPM 1000.0
+#define MAX_CORRECTION_PPM 2000.0
+
+AudioDriftCompensator::AudioDriftCompensator(int sampleRate, int channelCount, int samplesPerFrame, bool isFloat)
+    : m_SampleRate(sampleRate),
+      m_ChannelCount(channelCount),
+      m_SamplesPerFrame(samplesPerFrame),
+      m_IsFloat(isFloat),
+      m_Position(1.0),
+      m_AverageErrorMs(0),
+      m_IntegralPpm(0),
+      m_CorrectionPpm(0),
+      m_Updates(0)
+{
+    m_InputBuffer.resize(samplesPerFrame * channelCount * (isFloat ? sizeof(float) : sizeof(short)));
+    m_WorkBuffer.fill(0.0f, (HISTORY_FRAMES + samplesPerFrame) * channelCount);
+}
+
+void* AudioDriftCompensator::getInputBuffer()
+{
+    return m_InputBuffer.data();
+}
+
+int AudioDriftCompensator::getMaxOutputFrames()
+{
+    // Output can exceed the input by the maximum correction plus rounding
+    return m_SamplesPerFrame + (int)(m_SamplesPerFrame * MAX_CORRECTION_PPM / 1000000.0) + 2;
+}
+
+int AudioDriftCompensator::getDriftPpm()
+{
+    return (int)m_IntegralPpm;
+}
+
+void AudioDriftCompensator::updateQueueDepth(int queuedFrames, int targetFrames)
+{
+    double errorMs = (double)(queuedFrames - targetFrames) * 1000.0 / m_SampleRate;
+
+    if (m_Updates == 0) {
+        m_AverageErrorMs = errorMs;
+    }
+    else {
+        m_AverageErrorMs += (errorMs - m_AverageErrorMs) * ERROR_SMOOTHING_FACTOR;
+    }
+    m_Updates++;
+
+    if (m_Updates < WARMUP_UPDATES) {
+        return;
+    }
+
+    // The integral term converges on the actual clock drift, while the
+    // proportional term pulls the queue back to the target depth.
+    m_IntegralPpm = SDL_max(-MAX_INTEGRAL_PPM,
+                            SDL_min(m_IntegralPpm + m_AverageErrorMs * INTEGRAL_GAIN, MAX_INTEGRAL_PPM));
+    m_CorrectionPpm = SDL_max(-MAX_CORRECTION_PPM,
+                              SDL_min(m_IntegralPpm + m_AverageErrorMs * PROPORTIONAL_GAIN, MAX_CORRECTION_PPM));
+}
+
+int AudioDriftCompensator::process(int inFrames, void* output)
+{
+    SDL_assert(inFrames <= m_SamplesPerFrame);
+
+    float* work = m_WorkBuffer.data();
+    int totalFrames = HISTORY_FRAMES + inFrames;
+
+    // Append the new input after the history from the last call
+    if (m_IsFloat) {
+        SDL_memcpy(&work[HISTORY_FRAMES * m_ChannelCount], m_InputBuffer.constData(),
+                   inFrames * m_ChannelCount * sizeof(float));
+    }
+    else {
+        const short* in = (const short*)m_InputBuffer.constData();
+        for (int i = 0; i < inFrames * m_ChannelCount; i++) {
+            work[HISTORY_FRAMES * m_ChannelCount + i] = in[i] / 32768.0f;
+        }
+    }
+
+    // Consuming input faster than real time shrinks the queue
+    double step = 1.0 + m_CorrectionPpm / 1000000.0;
+    int outFrames = 0;
+
+    while (m_Position < totalFrames - 2) {
+        int index = (int)m_Position;
+        float t = (float)(m_Position - index);
+
+        const float* p0 = &work[(index - 1) * m_ChannelCount];
+        const float* p1 = p0 + m_ChannelCount;
+        const float* p2 = p1 + m_ChannelCount;
+        const float* p3 = p2 + m_ChannelCount;
+
+        for (int ch = 0; ch < m_ChannelCount; ch++) {
+            // Catmull-Rom spline through the four neighboring samples
+            float a = -0.5f * p0[ch] + 1.5f * p1[ch] - 1.5f * p2[ch] + 0.5f * p3[ch];
+            float b = p0[ch] - 2.5f * p1[ch] + 2.0f * p2[ch] - 0.5f * p3[ch];
+            float c = -0.5f * p0[ch] + 0.5f * p2[ch];
+            float sample = ((a * t + b) * t + c) * t + p1[ch];
+
+            if (m_IsFloat) {
+                ((float*)output)[outFrames * m_ChannelCount + ch] = sample;
+            }
+            else {
+                ((short*)output)[outFrames * m_ChannelCount + ch] =
+                        (short)SDL_max(-32768.0f, SDL_min(sample * 32768.0f, 32767.0f));
+            }
+        }
+
+        outFrames++;
+        m_Position += step;
+    }
+
+    SDL_assert(outFrames <= getMaxOutputFrames());
+
+    // Keep the tail of this input as history for the next call
+    SDL_memmove(work, &work[(totalFrames - HISTORY_FRAMES) * m_ChannelCount],
+                HISTORY_FRAMES * m_ChannelCount * sizeof(float));
+    m_Position -= totalFrames - HISTORY_FRAMES;
+
+    return outFrames;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <QVector>
+
+// Compensates for the host and client audio clocks running at slightly
+// different rates. The renderer's queue depth is tracked over time and a
+// PI controller steers a fractional resampler so the queue stays at the
+// renderer's target depth, rather than slowly draining (underruns) or
+// filling up (latency creep and dropped frames).
+class AudioDriftCompensator
+{
+public:
+    AudioDriftCompensator(int sampleRate, int channelCount, int samplesPerFrame, bool isFloat);
+
+    // Buffer for the decoder to write one frame of input audio into
+    void* getInputBuffer();
+
+    // Feeds a queue depth sample (in sample frames) into the drift estimator
+    void updateQueueDepth(int queuedFrames, int targetFrames);
+
+    // Resamples inFrames from the input buffer into output and returns the
+    // number of frames written. output must hold getMaxOutputFrames().
+    int process(int inFrames, void* output);
+
+    int getMaxOutputFrames();
+
+    // The estimated clock drift in parts per million. Positive values
+    // mean the host is producing audio faster than we are playing it.
+    int getDriftPpm();
+
+private:
+    int m_SampleRate;
+    int m_ChannelCount;
+    int m_SamplesPerFrame;
+    bool m_IsFloat;
+
+    QVector<char> m_InputBuffer;
+
+    // Input history followed by the current input as float
+    QVector<float> m_WorkBuffer;
+
+    // Position of the next output sample within m_WorkBuffer in frames
+    double m_Position;
+
+    double m_AverageErrorMs;
+    double m_IntegralPpm;
+    double m_CorrectionPpm;
+    int m_Updates;
+};
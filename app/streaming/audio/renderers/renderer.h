@@ -3,6 +3,21 @@
 #include <Limelight.h>
 #include <QtGlobal>
 
+typedef struct _AUDIO_STATS {
+    uint32_t receivedPackets;
+    uint32_t decodedPackets;
+    uint32_t droppedPackets;                   // discarded while no renderer was available
+    uint32_t rendererUnderruns;
+    uint32_t rendererDroppedFrames;            // discarded by the renderer to bound latency
+    uint32_t queueDepthSamples;
+    uint32_t minQueueDepthUs;                  // high-res (1us)
+    uint32_t maxQueueDepthUs;                  // high-res (1us)
+    uint64_t totalQueueDepthUs;                // high-res (1us)
+    uint64_t totalDecodeTimeUs;                // high-res (1us)
+    uint32_t deviceLatencyUs;                  // estimated, most recent value
+    uint64_t measurementStartUs;               // microseconds
+} AUDIO_STATS, *PAUDIO_STATS;
+
 class IAudioRenderer
 {
 public:
@@ -15,6 +30,38 @@ public:
     // Return false if an unrecoverable error has occurred and the renderer must be reinitialized
     virtual bool submitAudio(int bytesWritten) = 0;
 
+    // Returns the number of sample frames waiting to be played, or -1 if
+    // the renderer can't tell. Called on the audio decoding thread.
+    virtual int getQueuedSampleFrames() {
+        return -1;
+    }
+
+    // Returns the queue depth that clock drift compensation should maintain,
+    // or -1 if the renderer doesn't support drift compensation.
+    virtual int getTargetQueuedSampleFrames() {
+        return -1;
+    }
+
+    // Cumulative counts since the renderer was created
+    virtual uint32_t getUnderrunCount() {
+        return 0;
+    }
+    virtual uint32_t getDroppedFrameCount() {
+        return 0;
+    }
+
+    // Estimated latency added by the audio device after the renderer's
+    // own queue, or 0 if unknown
+    virtual uint32_t getDeviceLatencyUs() {
+        return 0;
+    }
+
+    // Holds this much extra audio in the queue to line it up with video.
+    // Returns false if the renderer can't delay audio.
+    virtual bool setSyncDelayMs(int) {
+        return false;
+    }
+
     virtual void remapChannels(POPUS_MULTISTREAM_CONFIGURATION) {
         // Use default channel mapping:
         // 0 - Front Left
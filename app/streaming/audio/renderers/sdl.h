@@ -1,8 +1,11 @@
 #pragma once
 
 #include "renderer.h"
+#include "../downmixer.h"
 #include "SDL_compat.h"
 
+#include <atomic>
+
 class SdlAudioRenderer : public IAudioRenderer
 {
 public:
@@ -18,9 +21,50 @@ public:
 
     virtual AudioFormat getAudioBufferFormat();
 
+    virtual int getQueuedSampleFrames();
+
+    virtual int getTargetQueuedSampleFrames();
+
+    virtual uint32_t getUnderrunCount();
+
+    virtual uint32_t getDroppedFrameCount();
+
+    virtual uint32_t getDeviceLatencyUs();
+
+    virtual bool setSyncDelayMs(int delayMs);
+
 private:
+    static void SDLCALL audioCallback(void* userdata, Uint8* stream, int len);
+
     SDL_AudioDeviceID m_AudioDevice;
     void* m_AudioBuffer;
+    Uint32 m_AudioBufferSize;
     Uint32 m_FrameSize;
-    Uint32 m_FrameDurationMs;
+    Uint32 m_SampleFrameSize;
+    Uint32 m_InputSampleFrameSize;
+
+    // Used when the device has fewer channels than the stream
+    AudioDownmixer* m_Downmixer;
+    Uint32 m_DeviceLatencyUs;
+
+    // Single producer (audio decode thread), single consumer (SDL audio callback).
+    // The positions only ever increase and are reduced modulo m_RingSize on access.
+    // They're 64-bit so they can't wrap mid-session on 32-bit platforms, since
+    // m_RingSize isn't a power of two.
+    Uint8* m_RingBuffer;
+    Uint32 m_RingSize;
+    Uint32 m_RingCapacity;
+    Uint32 m_BytesPerMs;
+    Uint32 m_SyncDelayBytes;
+    Uint32 m_MaxSyncDelayMs;
+    Uint32 m_RingPrimeLevel;
+    std::atomic<uint64_t> m_RingReadPos;
+    std::atomic<uint64_t> m_RingWritePos;
+
+    // Only accessed by the audio callback
+    bool m_Priming;
+    bool m_PlaybackStarted;
+
+    std::atomic<uint32_t> m_Underruns;
+    std::atomic<uint32_t> m_Overruns;
 };
@@ -1,10 +1,39 @@
 #include "sdl.h"
+#include "utils.h"
+#include "streaming/session.h"
 
 #include <Limelight.h>
 
+// Default amount of decoded audio we allow to queue ahead of the device
+#define DEFAULT_RING_TARGET_MS 30
+
+// Extra room in the ring for delaying audio to match video, if enabled
+#define MAX_SYNC_DELAY_MS 100
+
+// Drift compensation keeps the queue near its target, so audio is only
+// dropped when the backlog in moonlight-common-c is far beyond anything
+// resampling could work off (like after the decoder thread stalls).
+#define MAX_PENDING_AUDIO_MS 500
+
 SdlAudioRenderer::SdlAudioRenderer()
     : m_AudioDevice(0),
-      m_AudioBuffer(nullptr)
+      m_AudioBuffer(nullptr),
+      m_AudioBufferSize(0),
+      m_Downmixer(nullptr),
+      m_DeviceLatencyUs(0),
+      m_RingBuffer(nullptr),
+      m_RingSize(0),
+      m_RingCapacity(0),
+      m_BytesPerMs(0),
+      m_SyncDelayBytes(0),
+      m_MaxSyncDelayMs(0),
+      m_RingPrimeLevel(0),
+      m_RingReadPos(0),
+      m_RingWritePos(0),
+      m_Priming(true),
+      m_PlaybackStarted(false),
+      m_Underruns(0),
+      m_Overruns(0)
 {
     SDL_assert(!SDL_WasInit(SDL_INIT_AUDIO));
 
@@ -19,11 +48,15 @@ SdlAudioRenderer::SdlAudioRenderer()
 bool SdlAudioRenderer::prepareForPlayback(const OPUS_MULTISTREAM_CONFIGURATION* opusConfig)
 {
     SDL_AudioSpec want, have;
+    Uint32 targetMs;
+    Uint32 devicePeriodBytes;
 
     SDL_zero(want);
     want.freq = opusConfig->sampleRate;
     want.format = AUDIO_F32SYS;
     want.channels = opusConfig->channelCount;
+    want.callback = SdlAudioRenderer::audioCallback;
+    want.userdata = this;
 
     // On PulseAudio systems, setting a value too small can cause underruns for other
     // applications sharing this output device. We impose a floor of 480 samples (10 ms)
@@ -32,12 +65,15 @@ bool SdlAudioRenderer::prepareForPlayback(const OPUS_MULTISTREAM_CONFIGURATION*
     // The buffering helps avoid audio underruns due to network jitter.
     want.samples = SDL_max(480, opusConfig->samplesPerFrame * 3);
 
-    m_FrameDurationMs = opusConfig->samplesPerFrame / (opusConfig->sampleRate / 1000);
-    m_FrameSize = opusConfig->samplesPerFrame *
-                  opusConfig->channelCount *
-                  getAudioBufferSampleSize();
-
-    m_AudioDevice = SDL_OpenAudioDevice(NULL, 0, &want, &have, 0);
+    // Let the device pick fewer channels than the stream if we can downmix
+    // to its layout ourselves. SDL's own conversion is slower and runs while
+    // holding the audio device lock.
+    m_AudioDevice = SDL_OpenAudioDevice(NULL, 0, &want, &have, SDL_AUDIO_ALLOW_CHANNELS_CHANGE);
+    if (m_AudioDevice != 0 && have.channels != want.channels &&
+            !AudioDownmixer::isSupported(want.channels, have.channels)) {
+        SDL_CloseAudioDevice(m_AudioDevice);
+        m_AudioDevice = SDL_OpenAudioDevice(NULL, 0, &want, &have, 0);
+    }
     if (m_AudioDevice == 0) {
         SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
                      "Failed to open audio device: %s",
@@ -45,13 +81,59 @@ bool SdlAudioRenderer::prepareForPlayback(const OPUS_MULTISTREAM_CONFIGURATION*
         return false;
     }
 
-    m_AudioBuffer = SDL_malloc(m_FrameSize);
+    if (have.channels != want.channels) {
+        SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+                    "Downmixing %d channel audio to %d channels",
+                    want.channels,
+                    have.channels);
+        m_Downmixer = new AudioDownmixer(want.channels, have.channels);
+    }
+
+    // The ring holds audio in the device's channel layout
+    m_InputSampleFrameSize = opusConfig->channelCount * getAudioBufferSampleSize();
+    m_SampleFrameSize = have.channels * getAudioBufferSampleSize();
+    m_FrameSize = opusConfig->samplesPerFrame * m_SampleFrameSize;
+
+    // Leave room for drift compensation to stretch a frame slightly
+    m_AudioBufferSize = opusConfig->samplesPerFrame * m_InputSampleFrameSize * 2;
+    m_AudioBuffer = SDL_malloc(m_AudioBufferSize);
     if (m_AudioBuffer == nullptr) {
         SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
                      "Failed to allocate audio buffer");
         return false;
     }
 
+    if (!Utils::getEnvironmentVariableOverride("AUDIO_BUFFER_TARGET_MS", &targetMs)) {
+        targetMs = DEFAULT_RING_TARGET_MS;
+    }
+
+    // The ring must hold at least one device period plus one frame, otherwise
+    // the callback can never be satisfied without dropping incoming frames.
+    m_BytesPerMs = (opusConfig->sampleRate / 1000) * m_SampleFrameSize;
+    devicePeriodBytes = have.samples * m_SampleFrameSize;
+    m_RingCapacity = SDL_max(targetMs * m_BytesPerMs, devicePeriodBytes + m_FrameSize);
+    m_RingCapacity = ((m_RingCapacity + m_FrameSize - 1) / m_FrameSize) * m_FrameSize;
+
+    // Audio can only be delayed for A/V sync if we leave room for it
+    Session* session = Session::get();
+    m_MaxSyncDelayMs = (session != nullptr && session->isAVSyncCorrectionEnabled()) ? MAX_SYNC_DELAY_MS : 0;
+    m_RingSize = m_RingCapacity + m_MaxSyncDelayMs * m_BytesPerMs;
+
+    // Wait for the ring to be half full (and at least a full device period) before
+    // starting or resuming playback, so a single late packet doesn't cause a
+    // cascade of underruns.
+    m_RingPrimeLevel = SDL_min(m_RingCapacity, SDL_max(m_RingCapacity / 2, devicePeriodBytes));
+
+    // SDL doesn't tell us how much the OS buffers beyond the device period
+    m_DeviceLatencyUs = (Uint32)((Uint64)have.samples * 1000000 / have.freq);
+
+    m_RingBuffer = (Uint8*)SDL_malloc(m_RingSize);
+    if (m_RingBuffer == nullptr) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                     "Failed to allocate audio ring buffer");
+        return false;
+    }
+
     SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
                 "Desired audio buffer: %u samples (%u bytes)",
                 want.samples,
@@ -62,6 +144,11 @@ bool SdlAudioRenderer::prepareForPlayback(const OPUS_MULTISTREAM_CONFIGURATION*
                 have.samples,
                 have.size);
 
+    SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+                "Audio ring buffer: %u ms (%u bytes)",
+                m_RingCapacity / m_BytesPerMs,
+                m_RingCapacity);
+
     SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
                 "SDL audio driver: %s",
                 SDL_GetCurrentAudioDriver());
@@ -84,12 +171,23 @@ SdlAudioRenderer::~SdlAudioRenderer()
         SDL_free(m_AudioBuffer);
     }
 
+    delete m_Downmixer;
+
+    if (m_RingBuffer != nullptr) {
+        SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+                    "Audio renderer underruns: %u, dropped frames: %u",
+                    m_Underruns.load(),
+                    m_Overruns.load());
+        SDL_free(m_RingBuffer);
+    }
+
     SDL_QuitSubSystem(SDL_INIT_AUDIO);
     SDL_assert(!SDL_WasInit(SDL_INIT_AUDIO));
 }
 
-void* SdlAudioRenderer::getAudioBuffer(int*)
+void* SdlAudioRenderer::getAudioBuffer(int* size)
 {
+    SDL_assert((Uint32)*size <= m_AudioBufferSize);
     return m_AudioBuffer;
 }
 
@@ -100,39 +198,127 @@ bool SdlAudioRenderer::submitAudio(int bytesWritten)
         return true;
     }
 
-    // Don't queue if there's already more than 30 ms of audio data waiting
-    // in Moonlight's audio queue.
-    if (LiGetPendingAudioDuration() > 30) {
+    // Our device may enter a permanent error status upon removal, so we need
+    // to recreate the audio device to pick up the new default audio device.
+    if (SDL_GetAudioDeviceStatus(m_AudioDevice) == SDL_AUDIO_STOPPED) {
+        return false;
+    }
+
+    if (LiGetPendingAudioDuration() > MAX_PENDING_AUDIO_MS) {
+        m_Overruns++;
+        return true;
+    }
+
+    Uint64 writePos = m_RingWritePos.load(std::memory_order_relaxed);
+    Uint64 readPos = m_RingReadPos.load(std::memory_order_acquire);
+    Uint32 frames = bytesWritten / m_InputSampleFrameSize;
+    Uint32 ringBytes = frames * m_SampleFrameSize;
+
+    // If the device isn't keeping up, drop this frame rather than
+    // letting latency build up or blocking the decoder.
+    if (writePos - readPos + ringBytes > m_RingCapacity + m_SyncDelayBytes) {
+        m_Overruns++;
         return true;
     }
 
-    // Provide backpressure on the queue to ensure too many frames don't build up
-    // in SDL's audio queue, but don't wait forever to avoid a deadlock if the
-    // audio device fails.
-    for (int i = 0; i < 100; i++) {
-        // Our device may enter a permanent error status upon removal, so we need
-        // to recreate the audio device to pick up the new default audio device.
-        if (SDL_GetAudioDeviceStatus(m_AudioDevice) == SDL_AUDIO_STOPPED) {
-            return false;
-        }
+    // The ring size is a whole number of sample frames, so it only
+    // wraps between frames.
+    Uint32 offset = (Uint32)(writePos % m_RingSize);
+    Uint32 firstChunk = SDL_min(ringBytes, m_RingSize - offset);
+    if (m_Downmixer != nullptr) {
+        Uint32 firstFrames = firstChunk / m_SampleFrameSize;
+        const float* input = (const float*)m_AudioBuffer;
+
+        m_Downmixer->process(input, (float*)(m_RingBuffer + offset), firstFrames);
+        m_Downmixer->process(input + firstFrames * (m_InputSampleFrameSize / sizeof(float)),
+                             (float*)m_RingBuffer, frames - firstFrames);
+    }
+    else {
+        SDL_memcpy(m_RingBuffer + offset, m_AudioBuffer, firstChunk);
+        SDL_memcpy(m_RingBuffer, (Uint8*)m_AudioBuffer + firstChunk, ringBytes - firstChunk);
+    }
+
+    m_RingWritePos.store(writePos + ringBytes, std::memory_order_release);
+    return true;
+}
 
-        // Only queue more samples where there is 50 ms or less in SDL's queue
-        if (SDL_GetQueuedAudioSize(m_AudioDevice) / m_FrameSize * m_FrameDurationMs <= 50) {
-            break;
+void SDLCALL SdlAudioRenderer::audioCallback(void* userdata, Uint8* stream, int len)
+{
+    auto me = (SdlAudioRenderer*)userdata;
+
+    Uint64 readPos = me->m_RingReadPos.load(std::memory_order_relaxed);
+    Uint64 writePos = me->m_RingWritePos.load(std::memory_order_acquire);
+    Uint32 available = (Uint32)(writePos - readPos);
+
+    if (me->m_Priming) {
+        if (available < me->m_RingPrimeLevel) {
+            SDL_memset(stream, 0, len);
+            return;
         }
 
-        SDL_Delay(1);
+        me->m_Priming = false;
+        me->m_PlaybackStarted = true;
     }
 
-    if (SDL_QueueAudio(m_AudioDevice, m_AudioBuffer, bytesWritten) < 0) {
-        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
-                     "Failed to queue audio sample: %s",
-                     SDL_GetError());
+    Uint32 toCopy = SDL_min(available, (Uint32)len);
+    Uint32 offset = (Uint32)(readPos % me->m_RingSize);
+    Uint32 firstChunk = SDL_min(toCopy, me->m_RingSize - offset);
+    SDL_memcpy(stream, me->m_RingBuffer + offset, firstChunk);
+    SDL_memcpy(stream + firstChunk, me->m_RingBuffer, toCopy - firstChunk);
+
+    me->m_RingReadPos.store(readPos + toCopy, std::memory_order_release);
+
+    if (toCopy < (Uint32)len) {
+        // Fill the rest with silence and rebuild our cushion before resuming
+        SDL_memset(stream + toCopy, 0, len - toCopy);
+        if (me->m_PlaybackStarted) {
+            me->m_Underruns++;
+        }
+        me->m_Priming = true;
     }
+}
+
+int SdlAudioRenderer::getQueuedSampleFrames()
+{
+    Uint64 readPos = m_RingReadPos.load(std::memory_order_acquire);
+    return (int)((m_RingWritePos.load(std::memory_order_relaxed) - readPos) / m_SampleFrameSize);
+}
 
+int SdlAudioRenderer::getTargetQueuedSampleFrames()
+{
+    // The callback drains the ring a device period at a time, so the depth
+    // seen by the decoder swings between a low point and a device period
+    // above it. Centering that range in the space left after one more frame
+    // arrives keeps equal headroom against underruns and overruns.
+    return (int)(((m_RingCapacity - m_FrameSize) / 2 + m_SyncDelayBytes) / m_SampleFrameSize);
+}
+
+bool SdlAudioRenderer::setSyncDelayMs(int delayMs)
+{
+    if (m_MaxSyncDelayMs == 0) {
+        return false;
+    }
+
+    // Drift compensation grows or shrinks the queue to the new target
+    m_SyncDelayBytes = SDL_min((Uint32)SDL_max(delayMs, 0), m_MaxSyncDelayMs) * m_BytesPerMs;
     return true;
 }
 
+uint32_t SdlAudioRenderer::getUnderrunCount()
+{
+    return m_Underruns;
+}
+
+uint32_t SdlAudioRenderer::getDroppedFrameCount()
+{
+    return m_Overruns;
+}
+
+uint32_t SdlAudioRenderer::getDeviceLatencyUs()
+{
+    return m_DeviceLatencyUs;
+}
+
 IAudioRenderer::AudioFormat SdlAudioRenderer::getAudioBufferFormat()
 {
     return AudioFormat::Float32NE;
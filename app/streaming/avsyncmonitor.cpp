@@ -0,0 +1,142 @@
+#include "avsyncmonitor.h"
+
+#include <Limelight.h>
+
+#include <cmath>
+
+// The best-case arrival time is tracked over this window
+#define CLOCK_OFFSET_WINDOW_US 5000000
+
+// Roughly a one second time constant at typical frame rates
+#define OFFSET_SMOOTHING_FACTOR 0.02
+
+// Don't report until the averages have had a chance to settle
+#define MIN_OFFSET_SAMPLES 60
+
+void AVSyncMonitor::WindowedMinimum::update(int64_t value, uint64_t nowUs)
+{
+    if (!valid) {
+        current = previous = value;
+        windowStartUs = nowUs;
+        valid = true;
+        return;
+    }
+
+    if (nowUs - windowStartUs > CLOCK_OFFSET_WINDOW_US) {
+        previous = current;
+        current = value;
+        windowStartUs = nowUs;
+    }
+    else {
+        current = SDL_min(current, value);
+    }
+}
+
+int64_t AVSyncMonitor::WindowedMinimum::get() const
+{
+    return SDL_min(current, previous);
+}
+
+AVSyncMonitor::AVSyncMonitor()
+    : m_LastRtpTimestamp(0),
+      m_VideoHostTimeUs(0),
+      m_VideoClockOffset{},
+      m_VideoRefLock(0),
+      m_VideoRefRtpTimestamp(0),
+      m_VideoRefLocalTimeUs(0),
+      m_VideoRefValid(false),
+      m_AudioHostTimeUs(0),
+      m_AudioClockOffset{},
+      m_AudioLatencyUs(0),
+      m_AudioLatencyValid(false),
+      m_OffsetLock(0),
+      m_AverageOffsetUs(0),
+      m_OffsetVariance(0),
+      m_OffsetSamples(0)
+{
+}
+
+void AVSyncMonitor::reportVideoFrameReceived(uint32_t rtpTimestamp, uint64_t receiveTimeUs)
+{
+    // Unwrap the 32-bit 90 KHz timestamp into host microseconds
+    if (m_VideoClockOffset.valid) {
+        m_VideoHostTimeUs += (int64_t)(int32_t)(rtpTimestamp - m_LastRtpTimestamp) * 1000 / 90;
+    }
+    m_LastRtpTimestamp = rtpTimestamp;
+
+    m_VideoClockOffset.update((int64_t)receiveTimeUs - m_VideoHostTimeUs, receiveTimeUs);
+
+    SDL_AtomicLock(&m_VideoRefLock);
+    m_VideoRefRtpTimestamp = rtpTimestamp;
+    m_VideoRefLocalTimeUs = m_VideoHostTimeUs + m_VideoClockOffset.get();
+    m_VideoRefValid = true;
+    SDL_AtomicUnlock(&m_VideoRefLock);
+}
+
+void AVSyncMonitor::reportVideoFramePresented(uint32_t rtpTimestamp, uint64_t presentTimeUs)
+{
+    uint32_t refRtpTimestamp;
+    uint64_t refLocalTimeUs;
+    bool refValid;
+
+    if (!m_AudioLatencyValid) {
+        return;
+    }
+
+    SDL_AtomicLock(&m_VideoRefLock);
+    refRtpTimestamp = m_VideoRefRtpTimestamp;
+    refLocalTimeUs = m_VideoRefLocalTimeUs;
+    refValid = m_VideoRefValid;
+    SDL_AtomicUnlock(&m_VideoRefLock);
+
+    if (!refValid) {
+        return;
+    }
+
+    // When this frame would have arrived with the best-case network delay
+    int64_t idealArrivalUs = (int64_t)refLocalTimeUs + (int64_t)(int32_t)(rtpTimestamp - refRtpTimestamp) * 1000 / 90;
+    int64_t videoLatencyUs = (int64_t)presentTimeUs - idealArrivalUs;
+    double offsetUs = (double)(videoLatencyUs - m_AudioLatencyUs.load());
+
+    SDL_AtomicLock(&m_OffsetLock);
+    if (m_OffsetSamples == 0) {
+        m_AverageOffsetUs = offsetUs;
+        m_OffsetVariance = 0;
+    }
+    else {
+        // Exponentially weighted mean and variance
+        double delta = offsetUs - m_AverageOffsetUs;
+        m_AverageOffsetUs += OFFSET_SMOOTHING_FACTOR * delta;
+        m_OffsetVariance = (1 - OFFSET_SMOOTHING_FACTOR) * (m_OffsetVariance + OFFSET_SMOOTHING_FACTOR * delta * delta);
+    }
+    m_OffsetSamples++;
+    SDL_AtomicUnlock(&m_OffsetLock);
+}
+
+void AVSyncMonitor::reportAudioPacket(int samplesPerFrame, int sampleRate,
+                                      uint64_t arrivalTimeUs, uint64_t outputTimeUs)
+{
+    m_AudioClockOffset.update((int64_t)arrivalTimeUs - m_AudioHostTimeUs, arrivalTimeUs);
+
+    if (outputTimeUs != 0) {
+        int64_t idealArrivalUs = m_AudioHostTimeUs + m_AudioClockOffset.get();
+        m_AudioLatencyUs = (int64_t)outputTimeUs - idealArrivalUs;
+        m_AudioLatencyValid = true;
+    }
+
+    // Every packet advances the host timeline, whether or not we play it
+    m_AudioHostTimeUs += (int64_t)samplesPerFrame * 1000000 / sampleRate;
+}
+
+bool AVSyncMonitor::getOffset(double& offsetMs, double& stdDevMs)
+{
+    bool valid;
+
+    SDL_AtomicLock(&m_OffsetLock);
+    valid = m_OffsetSamples >= MIN_OFFSET_SAMPLES;
+    offsetMs = m_AverageOffsetUs / 1000.0;
+    stdDevMs = std::sqrt(m_OffsetVariance) / 1000.0;
+    SDL_AtomicUnlock(&m_OffsetLock);
+
+    return valid;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "SDL_compat.h"
+
+#include <atomic>
+
+// Measures the offset between when video frames are presented and when
+// audio is heard, relative to when the host produced them.
+//
+// Audio packets carry no host timestamp, so the host audio timeline is
+// reconstructed from the packet count. Each stream's host timeline is
+// mapped onto the local clock using the fastest arrival seen recently,
+// which cancels out network jitter. This assumes the host captures both
+// streams together and their best-case network delay is equal.
+class AVSyncMonitor
+{
+public:
+    AVSyncMonitor();
+
+    // Called on the video decoder thread for each received frame
+    void reportVideoFrameReceived(uint32_t rtpTimestamp, uint64_t receiveTimeUs);
+
+    // Called on the render thread after a frame was presented
+    void reportVideoFramePresented(uint32_t rtpTimestamp, uint64_t presentTimeUs);
+
+    // Called on the audio thread for each audio packet. arrivalTimeUs is when
+    // the packet was received and outputTimeUs is when it will be heard, or 0
+    // if it won't be played.
+    void reportAudioPacket(int samplesPerFrame, int sampleRate,
+                           uint64_t arrivalTimeUs, uint64_t outputTimeUs);
+
+    // Returns false if there is not enough data yet. A positive offset
+    // means video is presented later than the matching audio.
+    bool getOffset(double& offsetMs, double& stdDevMs);
+
+private:
+    // Tracks the minimum of a noisy value over a sliding window so the
+    // mapping follows slow clock drift between the host and client.
+    struct WindowedMinimum {
+        int64_t current;
+        int64_t previous;
+        uint64_t windowStartUs;
+        bool valid;
+
+        void update(int64_t value, uint64_t nowUs);
+        int64_t get() const;
+    };
+
+    // Decoder thread state
+    uint32_t m_LastRtpTimestamp;
+    int64_t m_VideoHostTimeUs;
+    WindowedMinimum m_VideoClockOffset;
+
+    // Maps the most recent video RTP timestamp to the local clock
+    SDL_SpinLock m_VideoRefLock;
+    uint32_t m_VideoRefRtpTimestamp;
+    uint64_t m_VideoRefLocalTimeUs;
+    bool m_VideoRefValid;
+
+    // Audio thread state
+    int64_t m_AudioHostTimeUs;
+    WindowedMinimum m_AudioClockOffset;
+    std::atomic<int64_t> m_AudioLatencyUs;
+    std::atomic<bool> m_AudioLatencyValid;
+
+    // Render thread state, read by the overlay under the lock
+    SDL_SpinLock m_OffsetLock;
+    double m_AverageOffsetUs;
+    double m_OffsetVariance;
+    int m_OffsetSamples;
+};
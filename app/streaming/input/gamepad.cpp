@@ -75,10 +75,25 @@ void SdlInputHandler::sendGamepadState(GamepadState* state)
     short rsX = state->rsX;
     short rsY = state->rsY;
 
+    Uint64 now = SDL_GetPerformanceCounter();
+    Uint32 eventTimestamp = state->pendingEventTimestamp;
+    state->statePending = false;
+    state->lastStateSendTime = now;
+    state->pendingEventTimestamp = 0;
+
     // When in single controller mode, merge all gamepad state together
     if (!m_MultiController) {
         for (int i = 0; i < MAX_GAMEPADS; i++) {
             if (m_GamepadState[i].index == state->index) {
+                // This packet carries any pending state for the merged gamepads too
+                m_GamepadState[i].statePending = false;
+                m_GamepadState[i].lastStateSendTime = now;
+                if (m_GamepadState[i].pendingEventTimestamp != 0 &&
+                        (eventTimestamp == 0 || SDL_TICKS_PASSED(eventTimestamp, m_GamepadState[i].pendingEventTimestamp))) {
+                    eventTimestamp = m_GamepadState[i].pendingEventTimestamp;
+                }
+                m_GamepadState[i].pendingEventTimestamp = 0;
+
                 buttons |= m_GamepadState[i].buttons;
                 if (lt < m_GamepadState[i].lt) {
                     lt = m_GamepadState[i].lt;
@@ -110,6 +125,63 @@ void SdlInputHandler::sendGamepadState(GamepadState* state)
                                lsY,
                                rsX,
                                rsY);
+
+    Session::get()->getInputStats()->addGamepadPacketSent();
+    Session::get()->getInputStats()->addInputLatency(InputStats::DeviceClassGamepad, eventTimestamp);
+}
+
+void SdlInputHandler::queueGamepadState(GamepadState* state)
+{
+    if (m_GamepadCoalesceWindowMs == 0) {
+        sendGamepadState(state);
+        return;
+    }
+
+    if (state->statePending) {
+        // Already waiting to go out with the next packet
+        Session::get()->getInputStats()->addGamepadPacketCoalesced();
+        return;
+    }
+
+    Uint64 windowTicks = SDL_GetPerformanceFrequency() * m_GamepadCoalesceWindowMs / 1000;
+    if (SDL_GetPerformanceCounter() - state->lastStateSendTime >= windowTicks) {
+        // Nothing was sent recently, so don't delay this update
+        sendGamepadState(state);
+        return;
+    }
+
+    state->statePending = true;
+    if (m_GamepadFlushTimer == 0) {
+        m_GamepadFlushTimer = SDL_AddTimer(m_GamepadCoalesceWindowMs, SdlInputHandler::gamepadStateFlushTimerCallback, nullptr);
+    }
+}
+
+void SdlInputHandler::flushPendingGamepadState()
+{
+    m_GamepadFlushTimer = 0;
+
+    for (int i = 0; i < MAX_GAMEPADS; i++) {
+        GamepadState* state = &m_GamepadState[i];
+
+        if (state->statePending) {
+            // The state may have been sent already with another merged gamepad
+            // or the gamepad may have switched into mouse emulation mode.
+            if (state->mouseEmulationTimer == 0) {
+                sendGamepadState(state);
+            }
+            else {
+                state->statePending = false;
+            }
+        }
+    }
+}
+
+Uint32 SdlInputHandler::gamepadStateFlushTimerCallback(Uint32, void*)
+{
+    Session::get()->requestGamepadStateFlush();
+
+    // One-shot timer
+    return 0;
 }
 
 void SdlInputHandler::sendGamepadBatteryState(GamepadState* state, SDL_JoystickPowerLevel level)
@@ -197,6 +269,7 @@ void SdlInputHandler::handleControllerAxisEvent(SDL_ControllerAxisEvent* event)
     }
 
     // Batch all pending axis motion events for this gamepad to save CPU time
+    Uint32 timestamp = event->timestamp;
     SDL_Event nextEvent;
     for (;;) {
         switch (event->axis)
@@ -248,7 +321,10 @@ void SdlInputHandler::handleControllerAxisEvent(SDL_ControllerAxisEvent* event)
 
     // Only send the gamepad state to the host if it's not in mouse emulation mode
     if (state->mouseEmulationTimer == 0) {
-        sendGamepadState(state);
+        if (state->pendingEventTimestamp == 0) {
+            state->pendingEventTimestamp = timestamp;
+        }
+        queueGamepadState(state);
     }
 }
 
@@ -397,6 +473,9 @@ void SdlInputHandler::handleControllerButtonEvent(SDL_ControllerButtonEvent* eve
 
     // Only send the gamepad state to the host if it's not in mouse emulation mode
     if (state->mouseEmulationTimer == 0) {
+        if (state->pendingEventTimestamp == 0) {
+            state->pendingEventTimestamp = event->timestamp;
+        }
         sendGamepadState(state);
     }
 }
@@ -19,6 +19,8 @@ SdlInputHandler::SdlInputHandler(StreamingPreferences& prefs, int streamWidth, i
       m_PendingMouseButtonsAllUpOnVideoRegionLeave(false),
       m_PointerRegionLockActive(false),
       m_PointerRegionLockToggledByUser(false),
+      m_GamepadCoalesceWindowMs(1),
+      m_GamepadFlushTimer(0),
       m_FakeMouseCaptureActive(false),
       m_KeyboardCaptureActive(false),
       m_CaptureSystemKeysMode(prefs.captureSysKeysMode),
@@ -33,7 +35,12 @@ SdlInputHandler::SdlInputHandler(StreamingPreferences& prefs, int streamWidth, i
       m_RightButtonReleaseTimer(0),
       m_DragTimer(0),
       m_DragButton(0),
-      m_NumFingersDown(0)
+      m_NumFingersDown(0),
+      m_MouseMotionThread(nullptr),
+      m_MouseMotionSem(nullptr),
+      m_MouseMotionSendMutex(nullptr),
+      m_PendingMouseMotionLock(0),
+      m_MouseMotionFlushIntervalMs(0)
 {
     // System keys are always captured when running without a DE
     if (!WMUtils::isRunningDesktopEnvironment()) {
@@ -135,6 +142,11 @@ SdlInputHandler::SdlInputHandler(StreamingPreferences& prefs, int streamWidth, i
     m_SpecialKeyCombos[KeyComboToggleKeyboardGrab].scanCode = SDL_SCANCODE_K;
     m_SpecialKeyCombos[KeyComboToggleKeyboardGrab].enabled = WMUtils::isRunningDesktopEnvironment();
 
+    m_SpecialKeyCombos[KeyComboFrameSnapshot].keyCombo = KeyComboFrameSnapshot;
+    m_SpecialKeyCombos[KeyComboFrameSnapshot].keyCode = SDLK_p;
+    m_SpecialKeyCombos[KeyComboFrameSnapshot].scanCode = SDL_SCANCODE_P;
+    m_SpecialKeyCombos[KeyComboFrameSnapshot].enabled = true;
+
     m_OldIgnoreDevices = SDL_GetHint(SDL_HINT_GAMECONTROLLER_IGNORE_DEVICES);
     m_OldIgnoreDevicesExcept = SDL_GetHint(SDL_HINT_GAMECONTROLLER_IGNORE_DEVICES_EXCEPT);
 
@@ -210,14 +222,58 @@ SdlInputHandler::SdlInputHandler(StreamingPreferences& prefs, int streamWidth, i
     // during stream startup as we detect currently attached gamepads one at a time.
     m_GamepadMask = getAttachedGamepadMask();
 
+    // Analog axis updates that arrive within this window of the last packet
+    // for a gamepad are merged into a single packet. Button changes are
+    // always sent immediately. Set to 0 to disable coalescing.
+    Utils::getEnvironmentVariableOverride("GAMEPAD_COALESCE_WINDOW_MS", &m_GamepadCoalesceWindowMs);
+
     SDL_zero(m_GamepadState);
     SDL_zero(m_LastTouchDownEvent);
     SDL_zero(m_LastTouchUpEvent);
     SDL_zero(m_TouchDownEvent);
+
+    SDL_AtomicSet(&m_MouseMotionThreadStop, 0);
+    m_PendingMouseDeltaX = 0;
+    m_PendingMouseDeltaY = 0;
+    m_PendingMouseMotionTime = 0;
+
+    // By default, relative motion is sent as soon as the input thread picks it up.
+    // MOUSE_MOTION_FLUSH_RATE_HZ caps the send rate to coalesce motion from very
+    // high polling rate mice into fewer packets.
+    int flushRateHz;
+    if (Utils::getEnvironmentVariableOverride("MOUSE_MOTION_FLUSH_RATE_HZ", &flushRateHz) && flushRateHz > 0) {
+        m_MouseMotionFlushIntervalMs = 1000 / SDL_min(flushRateHz, 1000);
+        SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+                    "Flushing mouse motion every %u ms",
+                    m_MouseMotionFlushIntervalMs);
+    }
+
+    m_MouseMotionSem = SDL_CreateSemaphore(0);
+    m_MouseMotionSendMutex = SDL_CreateMutex();
+    if (m_MouseMotionSem != nullptr && m_MouseMotionSendMutex != nullptr) {
+        m_MouseMotionThread = SDL_CreateThread(SdlInputHandler::mouseMotionThreadProc, "MouseMotion", this);
+        if (m_MouseMotionThread == nullptr) {
+            SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION,
+                        "Unable to create mouse motion thread: %s",
+                        SDL_GetError());
+        }
+    }
 }
 
 SdlInputHandler::~SdlInputHandler()
 {
+    if (m_MouseMotionThread != nullptr) {
+        SDL_AtomicSet(&m_MouseMotionThreadStop, 1);
+        SDL_SemPost(m_MouseMotionSem);
+        SDL_WaitThread(m_MouseMotionThread, nullptr);
+    }
+    if (m_MouseMotionSem != nullptr) {
+        SDL_DestroySemaphore(m_MouseMotionSem);
+    }
+    if (m_MouseMotionSendMutex != nullptr) {
+        SDL_DestroyMutex(m_MouseMotionSendMutex);
+    }
+
     for (int i = 0; i < MAX_GAMEPADS; i++) {
         if (m_GamepadState[i].mouseEmulationTimer != 0) {
             Session::get()->notifyMouseEmulationMode(false);
@@ -233,6 +289,7 @@ SdlInputHandler::~SdlInputHandler()
         }
     }
 
+    SDL_RemoveTimer(m_GamepadFlushTimer);
     SDL_RemoveTimer(m_LongPressTimer);
     SDL_RemoveTimer(m_LeftButtonReleaseTimer);
     SDL_RemoveTimer(m_RightButtonReleaseTimer);
@@ -36,6 +36,13 @@ struct GamepadState {
     short lsX, lsY;
     short rsX, rsY;
     unsigned char lt, rt;
+
+    // Axis changes waiting for the coalescing window to expire
+    bool statePending;
+    Uint64 lastStateSendTime;
+
+    // SDL timestamp of the oldest event not yet sent to the host
+    Uint32 pendingEventTimestamp;
 };
 
 
@@ -104,6 +111,8 @@ public:
 
     void handleControllerDeviceEvent(SDL_ControllerDeviceEvent* event);
 
+    void flushPendingGamepadState();
+
 #if SDL_VERSION_ATLEAST(2, 0, 14)
     void handleControllerSensorEvent(SDL_ControllerSensorEvent* event);
 
@@ -168,6 +177,7 @@ private:
         KeyComboTogglePointerRegionLock,
         KeyComboQuitAndExit,
         KeyComboToggleKeyboardGrab,
+        KeyComboFrameSnapshot,
         KeyComboMax
     };
 
@@ -176,6 +186,8 @@ private:
 
     void sendGamepadState(GamepadState* state);
 
+    void queueGamepadState(GamepadState* state);
+
     void sendGamepadBatteryState(GamepadState* state, SDL_JoystickPowerLevel level);
 
     void handleAbsoluteFingerEvent(SDL_TouchFingerEvent* event);
@@ -194,6 +206,9 @@ private:
     static
     Uint32 mouseEmulationTimerCallback(Uint32 interval, void* param);
 
+    static
+    Uint32 gamepadStateFlushTimerCallback(Uint32 interval, void* param);
+
     static
     Uint32 releaseLeftButtonTimerCallback(Uint32 interval, void* param);
 
@@ -203,6 +218,11 @@ private:
     static
     Uint32 dragTimerCallback(Uint32 interval, void* param);
 
+    void flushMouseMotion();
+
+    static
+    int mouseMotionThreadProc(void* context);
+
     SDL_Window* m_Window;
     bool m_MultiController;
     bool m_GamepadMouse;
@@ -218,6 +238,8 @@ private:
 
     int m_GamepadMask;
     GamepadState m_GamepadState[MAX_GAMEPADS];
+    Uint32 m_GamepadCoalesceWindowMs;
+    SDL_TimerID m_GamepadFlushTimer;
     QSet<short> m_KeysDown;
     bool m_FakeMouseCaptureActive;
     bool m_KeyboardCaptureActive;
@@ -250,5 +272,20 @@ private:
     char m_DragButton;
     int m_NumFingersDown;
 
+    SDL_Thread* m_MouseMotionThread;
+    SDL_sem* m_MouseMotionSem;
+    SDL_atomic_t m_MouseMotionThreadStop;
+
+    // Held while sending motion to keep it in order with button and wheel events
+    SDL_mutex* m_MouseMotionSendMutex;
+
+    // Protected by m_PendingMouseMotionLock
+    SDL_SpinLock m_PendingMouseMotionLock;
+    int m_PendingMouseDeltaX;
+    int m_PendingMouseDeltaY;
+    Uint64 m_PendingMouseMotionTime;
+
+    Uint32 m_MouseMotionFlushIntervalMs;
+
     static const int k_ButtonMap[];
 };
@@ -0,0 +1,203 @@
+#include "inputstats.h"
+
+#include <limits.h>
+#include <stdio.h>
+
+static const char* k_DeviceClassNames[InputStats::DeviceClassMax] = {
+    "Keyboard",
+    "Mouse",
+    "Gamepad",
+};
+
+InputStats::InputStats()
+{
+    for (int i = 0; i < DeviceClassMax; i++) {
+        m_Latency[i].totalLock = 0;
+    }
+
+    reset();
+}
+
+void InputStats::reset()
+{
+    SDL_AtomicSet(&m_GamepadPacketsSent, 0);
+    SDL_AtomicSet(&m_GamepadPacketsCoalesced, 0);
+
+    for (int i = 0; i < DeviceClassMax; i++) {
+        for (int j = 0; j < k_LatencyBuckets; j++) {
+            SDL_AtomicSet(&m_Latency[i].buckets[j], 0);
+        }
+        SDL_AtomicSet(&m_Latency[i].count, 0);
+        SDL_AtomicSet(&m_Latency[i].maxUs, 0);
+
+        SDL_AtomicLock(&m_Latency[i].totalLock);
+        m_Latency[i].totalUs = 0;
+        SDL_AtomicUnlock(&m_Latency[i].totalLock);
+    }
+}
+
+Uint64 InputStats::getEventTime(Uint32 eventTimestamp)
+{
+    if (eventTimestamp == 0) {
+        return 0;
+    }
+
+    // Take the event's age in ticks and backdate the current counter by it
+    Uint32 now = SDL_GetTicks();
+    Uint64 ageMs = SDL_TICKS_PASSED(now, eventTimestamp) ? now - eventTimestamp : 0;
+    return SDL_GetPerformanceCounter() - ageMs * SDL_GetPerformanceFrequency() / 1000;
+}
+
+void InputStats::addInputLatencySince(DeviceClass deviceClass, Uint64 eventTime)
+{
+    LatencyHistogram& histogram = m_Latency[deviceClass];
+
+    // Synthesized events can have no timestamp, so ignore those
+    if (eventTime == 0) {
+        return;
+    }
+
+    Uint64 now = SDL_GetPerformanceCounter();
+    if (now < eventTime) {
+        return;
+    }
+
+    int latencyUs = (int)SDL_min((now - eventTime) * 1000000 / SDL_GetPerformanceFrequency(), (Uint64)INT_MAX);
+
+    int bucket = 0;
+    while (bucket < k_LatencyBuckets - 1 && latencyUs >= (k_FirstLatencyBucketUs << bucket)) {
+        bucket++;
+    }
+
+    SDL_AtomicAdd(&histogram.buckets[bucket], 1);
+    SDL_AtomicAdd(&histogram.count, 1);
+
+    SDL_AtomicLock(&histogram.totalLock);
+    histogram.totalUs += latencyUs;
+    SDL_AtomicUnlock(&histogram.totalLock);
+
+    int maxUs = SDL_AtomicGet(&histogram.maxUs);
+    while (latencyUs > maxUs && !SDL_AtomicCAS(&histogram.maxUs, maxUs, latencyUs)) {
+        maxUs = SDL_AtomicGet(&histogram.maxUs);
+    }
+}
+
+Uint64 InputStats::getLatencyTotal(LatencyHistogram& histogram)
+{
+    SDL_AtomicLock(&histogram.totalLock);
+    Uint64 totalUs = histogram.totalUs;
+    SDL_AtomicUnlock(&histogram.totalLock);
+    return totalUs;
+}
+
+// Returns the upper bound of the bucket containing the percentile
+int InputStats::getLatencyPercentile(LatencyHistogram& histogram, int count, int percentile)
+{
+    int target = (int)(((long long)count * percentile + 99) / 100);
+    int seen = 0;
+
+    for (int i = 0; i < k_LatencyBuckets - 1; i++) {
+        seen += SDL_AtomicGet(&histogram.buckets[i]);
+        if (seen >= target) {
+            return k_FirstLatencyBucketUs << i;
+        }
+    }
+
+    return SDL_AtomicGet(&histogram.maxUs);
+}
+
+void InputStats::stringify(char* output, int length)
+{
+    int offset = 0;
+    int ret;
+
+    output[0] = 0;
+
+    int sent = SDL_AtomicGet(&m_GamepadPacketsSent);
+    int coalesced = SDL_AtomicGet(&m_GamepadPacketsCoalesced);
+    if (sent != 0) {
+        ret = snprintf(&output[offset],
+                       length - offset,
+                       "Gamepad packets sent: %d (%d saved by coalescing, %.1f%%)\n",
+                       sent,
+                       coalesced,
+                       (float)coalesced * 100 / (sent + coalesced));
+        if (ret < 0 || ret >= length - offset) {
+            SDL_assert(false);
+            return;
+        }
+
+        offset += ret;
+    }
+
+    for (int i = 0; i < DeviceClassMax; i++) {
+        int count = SDL_AtomicGet(&m_Latency[i].count);
+        if (count == 0) {
+            continue;
+        }
+
+        ret = snprintf(&output[offset],
+                       length - offset,
+                       "%s input latency: %.2f ms average, 99%% under %.2f ms\n",
+                       k_DeviceClassNames[i],
+                       (float)getLatencyTotal(m_Latency[i]) / count / 1000,
+                       (float)getLatencyPercentile(m_Latency[i], count, 99) / 1000);
+        if (ret < 0 || ret >= length - offset) {
+            SDL_assert(false);
+            return;
+        }
+
+        offset += ret;
+    }
+}
+
+void InputStats::stringifyLatencyHistograms(char* output, int length)
+{
+    int offset = 0;
+    int ret;
+
+    output[0] = 0;
+
+    for (int i = 0; i < DeviceClassMax; i++) {
+        int count = SDL_AtomicGet(&m_Latency[i].count);
+        if (count == 0) {
+            continue;
+        }
+
+        ret = snprintf(&output[offset],
+                       length - offset,
+                       "%s input latency (%d events, max %.2f ms):",
+                       k_DeviceClassNames[i],
+                       count,
+                       (float)SDL_AtomicGet(&m_Latency[i].maxUs) / 1000);
+        if (ret < 0 || ret >= length - offset) {
+            SDL_assert(false);
+            return;
+        }
+
+        offset += ret;
+
+        for (int j = 0; j < k_LatencyBuckets; j++) {
+            if (j < k_LatencyBuckets - 1) {
+                ret = snprintf(&output[offset],
+                               length - offset,
+                               " <%gms=%d",
+                               (float)(k_FirstLatencyBucketUs << j) / 1000,
+                               SDL_AtomicGet(&m_Latency[i].buckets[j]));
+            }
+            else {
+                ret = snprintf(&output[offset],
+                               length - offset,
+                               " >=%gms=%d\n",
+                               (float)(k_FirstLatencyBucketUs << (j - 1)) / 1000,
+                               SDL_AtomicGet(&m_Latency[i].buckets[j]));
+            }
+            if (ret < 0 || ret >= length - offset) {
+                SDL_assert(false);
+                return;
+            }
+
+            offset += ret;
+        }
+    }
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "SDL_compat.h"
+
+// Counters for the input we send to the host. Updated on the main
+// thread and the mouse motion thread, and read by the overlay on the
+// decoder thread.
+class InputStats
+{
+public:
+    enum DeviceClass {
+        DeviceClassKeyboard,
+        DeviceClassMouse,
+        DeviceClassGamepad,
+        DeviceClassMax
+    };
+
+    InputStats();
+
+    void reset();
+
+    void addGamepadPacketSent()
+    {
+        SDL_AtomicAdd(&m_GamepadPacketsSent, 1);
+    }
+
+    // A gamepad state update was merged into a packet that was already
+    // going to be sent instead of getting its own
+    void addGamepadPacketCoalesced()
+    {
+        SDL_AtomicAdd(&m_GamepadPacketsCoalesced, 1);
+    }
+
+    // Converts an SDL event timestamp into SDL_GetPerformanceCounter() time.
+    // SDL2 event timestamps only have 1 ms resolution, so this should be
+    // called as soon as the event is handled. Returns 0 for synthesized
+    // events that have no timestamp.
+    static Uint64 getEventTime(Uint32 eventTimestamp);
+
+    // Records the time from an SDL event's timestamp until the input it
+    // produced was handed to moonlight-common-c
+    void addInputLatency(DeviceClass deviceClass, Uint32 eventTimestamp)
+    {
+        addInputLatencySince(deviceClass, getEventTime(eventTimestamp));
+    }
+
+    // Like addInputLatency() for an event time from getEventTime()
+    void addInputLatencySince(DeviceClass deviceClass, Uint64 eventTime);
+
+    // Thread-safe. Writes nothing if no input has been sent.
+    void stringify(char* output, int length);
+
+    // Thread-safe. Writes the full latency histograms for the session log.
+    void stringifyLatencyHistograms(char* output, int length);
+
+private:
+    // Bucket i holds latencies below 125 * 2^i us (up to 64 ms), and the
+    // last bucket holds the rest
+    static const int k_LatencyBuckets = 11;
+    static const int k_FirstLatencyBucketUs = 125;
+
+    struct LatencyHistogram {
+        SDL_atomic_t buckets[k_LatencyBuckets];
+        SDL_atomic_t count;
+        SDL_atomic_t maxUs;
+
+        // The total overflows 32 bits during a long session
+        SDL_SpinLock totalLock;
+        Uint64 totalUs;
+    };
+
+    static int getLatencyPercentile(LatencyHistogram& histogram, int count, int percentile);
+
+    static Uint64 getLatencyTotal(LatencyHistogram& histogram);
+
+    SDL_atomic_t m_GamepadPacketsSent;
+    SDL_atomic_t m_GamepadPacketsCoalesced;
+    LatencyHistogram m_Latency[DeviceClassMax];
+};
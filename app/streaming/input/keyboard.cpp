@@ -168,6 +168,13 @@ void SdlInputHandler::performSpecialKeyCombo(KeyCombo combo)
         updateKeyboardGrabState();
         break;
 
+    case KeyComboFrameSnapshot:
+        SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+                    "Detected frame snapshot combo");
+
+        Session::get()->requestFrameSnapshot();
+        break;
+
     default:
         Q_UNREACHABLE();
     }
@@ -477,4 +484,5 @@ void SdlInputHandler::handleKeyEvent(SDL_KeyboardEvent* event)
                             KEY_ACTION_DOWN : KEY_ACTION_UP,
                         modifiers,
                         shouldNotConvertToScanCodeOnServer ? SS_KBE_FLAG_NON_NORMALIZED : 0);
+    Session::get()->getInputStats()->addInputLatency(InputStats::DeviceClassKeyboard, event->timestamp);
 }
@@ -1,9 +1,11 @@
-#include "input.h"
+#include "streaming/session.h"
 
 #include <Limelight.h>
 #include "SDL_compat.h"
 #include "streaming/streamutils.h"
 
+#include <climits>
+
 void SdlInputHandler::handleMouseButtonEvent(SDL_MouseButtonEvent* event)
 {
     int button;
@@ -62,10 +64,15 @@ void SdlInputHandler::handleMouseButtonEvent(SDL_MouseButtonEvent* event)
             button = BUTTON_RIGHT;
     }
 
+    // Send any motion that's still waiting on the input thread first,
+    // so the click lands where the user expects it to.
+    flushMouseMotion();
+
     LiSendMouseButtonEvent(event->state == SDL_PRESSED ?
                                BUTTON_ACTION_PRESS :
                                BUTTON_ACTION_RELEASE,
                            button);
+    Session::get()->getInputStats()->addInputLatency(InputStats::DeviceClassMouse, event->timestamp);
 }
 
 void SdlInputHandler::handleMouseMotionEvent(SDL_MouseMotionEvent* event)
@@ -79,8 +86,10 @@ void SdlInputHandler::handleMouseMotionEvent(SDL_MouseMotionEvent* event)
         return;
     }
 
-    // Batch all pending mouse motion events to save CPU time
+    // Batch all pending mouse motion events to save CPU time. Latency
+    // is measured from the oldest event in the batch.
     Sint32 x = event->x, y = event->y, xrel = event->xrel, yrel = event->yrel;
+    Uint32 timestamp = event->timestamp;
     SDL_Event nextEvent;
     while (SDL_PeepEvents(&nextEvent, 1, SDL_GETEVENT, SDL_MOUSEMOTION, SDL_MOUSEMOTION) > 0) {
         event = &nextEvent.motion;
@@ -137,6 +146,7 @@ void SdlInputHandler::handleMouseMotionEvent(SDL_MouseMotionEvent* event)
         }
         if (mouseInVideoRegion || m_MouseWasInVideoRegion || m_PendingMouseButtonsAllUpOnVideoRegionLeave) {
             LiSendMousePositionEvent((short)x, (short)y, dst.w, dst.h);
+            Session::get()->getInputStats()->addInputLatency(InputStats::DeviceClassMouse, timestamp);
         }
 
         // Adjust the cursor visibility if applicable
@@ -151,9 +161,89 @@ void SdlInputHandler::handleMouseMotionEvent(SDL_MouseMotionEvent* event)
 
         m_MouseWasInVideoRegion = mouseInVideoRegion;
     }
+    else if (m_MouseMotionThread != nullptr) {
+        // Hand the motion off to the input thread so sending it is never
+        // held up behind rendering or window events on this thread.
+        Uint64 eventTime = InputStats::getEventTime(timestamp);
+
+        SDL_AtomicLock(&m_PendingMouseMotionLock);
+        m_PendingMouseDeltaX += xrel;
+        m_PendingMouseDeltaY += yrel;
+
+        // Keep the time of the oldest motion that hasn't been sent yet
+        if (m_PendingMouseMotionTime == 0) {
+            m_PendingMouseMotionTime = eventTime;
+        }
+        SDL_AtomicUnlock(&m_PendingMouseMotionLock);
+
+        SDL_SemPost(m_MouseMotionSem);
+    }
     else {
         LiSendMouseMoveEvent(xrel, yrel);
+        Session::get()->getInputStats()->addInputLatency(InputStats::DeviceClassMouse, timestamp);
+    }
+}
+
+void SdlInputHandler::flushMouseMotion()
+{
+    if (m_MouseMotionThread == nullptr) {
+        // Motion is sent directly, so there's nothing pending
+        return;
+    }
+
+    // Serialize with the input thread to keep motion and button events in order.
+    // This is only contended while the other thread is sending.
+    SDL_LockMutex(m_MouseMotionSendMutex);
+
+    // Only hold the spinlock long enough to take the pending motion, since
+    // the main thread may be waiting on it to add more.
+    SDL_AtomicLock(&m_PendingMouseMotionLock);
+    int deltaX = m_PendingMouseDeltaX;
+    int deltaY = m_PendingMouseDeltaY;
+    Uint64 eventTime = m_PendingMouseMotionTime;
+    m_PendingMouseDeltaX = m_PendingMouseDeltaY = 0;
+    m_PendingMouseMotionTime = 0;
+    SDL_AtomicUnlock(&m_PendingMouseMotionLock);
+
+    if (deltaX != 0 || deltaY != 0) {
+        Session::get()->getInputStats()->addInputLatencySince(InputStats::DeviceClassMouse, eventTime);
+    }
+
+    // The accumulated delta may not fit in a single event
+    while (deltaX != 0 || deltaY != 0) {
+        short sendX = (short)SDL_max(SDL_min(deltaX, SHRT_MAX), SHRT_MIN);
+        short sendY = (short)SDL_max(SDL_min(deltaY, SHRT_MAX), SHRT_MIN);
+
+        LiSendMouseMoveEvent(sendX, sendY);
+
+        deltaX -= sendX;
+        deltaY -= sendY;
     }
+
+    SDL_UnlockMutex(m_MouseMotionSendMutex);
+}
+
+int SdlInputHandler::mouseMotionThreadProc(void* context)
+{
+    auto me = reinterpret_cast<SdlInputHandler*>(context);
+
+    SDL_SetThreadPriority(SDL_THREAD_PRIORITY_HIGH);
+
+    while (!SDL_AtomicGet(&me->m_MouseMotionThreadStop)) {
+        SDL_SemWait(me->m_MouseMotionSem);
+
+        // Drain the extra wakeups from motion that arrived while we were sending
+        while (SDL_SemTryWait(me->m_MouseMotionSem) == 0);
+
+        me->flushMouseMotion();
+
+        // Let motion accumulate until the next flush interval
+        if (me->m_MouseMotionFlushIntervalMs != 0) {
+            SDL_Delay(me->m_MouseMotionFlushIntervalMs);
+        }
+    }
+
+    return 0;
 }
 
 void SdlInputHandler::handleMouseWheelEvent(SDL_MouseWheelEvent* event)
@@ -176,6 +266,10 @@ void SdlInputHandler::handleMouseWheelEvent(SDL_MouseWheelEvent* event)
         }
     }
 
+    // Scroll wherever the pointer ends up after any motion still waiting
+    // on the input thread
+    flushMouseMotion();
+
 #if SDL_VERSION_ATLEAST(2, 0, 18)
     if (event->preciseY != 0.0f) {
         // Invert the scroll direction if needed
@@ -235,6 +329,8 @@ void SdlInputHandler::handleMouseWheelEvent(SDL_MouseWheelEvent* event)
         LiSendHScrollEvent((signed char)event->x);
     }
 #endif
+
+    Session::get()->getInputStats()->addInputLatency(InputStats::DeviceClassMouse, event->timestamp);
 }
 
 bool SdlInputHandler::isMouseInVideoRegion(int mouseX, int mouseY, int windowWidth, int windowHeight)
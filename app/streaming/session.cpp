@@ -28,6 +28,7 @@
 #define SDL_CODE_GAMECONTROLLER_SET_MOTION_EVENT_STATE 103
 #define SDL_CODE_GAMECONTROLLER_SET_CONTROLLER_LED 104
 #define SDL_CODE_GAMECONTROLLER_SET_ADAPTIVE_TRIGGERS 105
+#define SDL_CODE_GAMECONTROLLER_FLUSH_STATE 106
 
 #include <openssl/rand.h>
 
@@ -348,9 +349,16 @@ int Session::drSetup(int videoFormat, int width, int height, int frameRate, void
     s_ActiveSession->m_ActiveVideoHeight = height;
     s_ActiveSession->m_ActiveVideoFrameRate = frameRate;
 
-    // Defer decoder setup until we've started streaming so we
-    // don't have to hide and show the SDL window (which seems to
-    // cause pointer hiding to break on Windows).
+    if (s_ActiveSession->m_StreamRecorder != nullptr) {
+        s_ActiveSession->m_StreamRecorder->setVideoFormat(videoFormat, width, height, frameRate);
+    }
+
+    // Defer decoder setup to the main thread, either in prepareForStream()
+    // or once we've started streaming, so we don't have to hide and show
+    // the SDL window (which seems to cause pointer hiding to break on
+    // Windows). prepareForStream() creates the window hidden, but it's
+    // only shown once and never hidden again. If prepareForStream()
+    // already built a decoder, exec() checks it against these values.
 
     SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "Video stream is %dx%dx%d (format 0x%x)",
                 width, height, frameRate, videoFormat);
@@ -371,6 +379,12 @@ int Session::drSubmitDecodeUnit(PDECODE_UNIT du)
     if (SDL_TryLockMutex(s_ActiveSession->m_DecoderLock) == 0) {
         IVideoDecoder* decoder = s_ActiveSession->m_VideoDecoder;
         if (decoder != nullptr) {
+            if (SDL_AtomicCAS(&s_ActiveSession->m_FirstFrameSubmitted, 0, 1)) {
+                SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+                            "First video frame submitted %u ms after launch",
+                            SDL_GetTicks() - s_ActiveSession->m_LaunchStartTime);
+            }
+
             int ret = decoder->submitDecodeUnit(du);
             SDL_UnlockMutex(s_ActiveSession->m_DecoderLock);
             return ret;
@@ -585,8 +599,42 @@ Session::Session(NvComputer* computer, NvApp& app, StreamingPreferences *prefere
       m_OpusDecoder(nullptr),
       m_AudioRenderer(nullptr),
       m_AudioSampleCount(0),
-      m_DropAudioEndTime(0)
+      m_AudioDriftCompensator(nullptr),
+      m_AudioReinitThread(nullptr),
+      m_FailedAudioRenderer(nullptr),
+      m_PendingAudioPipeline{},
+      m_AudioReinitThreadFailed(false),
+      m_LastRendererUnderruns(0),
+      m_LastRendererDroppedFrames(0),
+      m_OverlayAudioStatsLock(0),
+      m_StreamRecorder(nullptr),
+      m_AVSyncCorrectionEnabled(false),
+      m_AudioSyncDelayMs(0),
+      m_AVSyncUncorrectableLogged(false),
+      m_PreparedVideoDecoder(nullptr),
+      m_PreparedVideoFormat(0),
+      m_PreparedVideoWidth(0),
+      m_PreparedVideoHeight(0),
+      m_PreparedVideoFrameRate(0),
+      m_LaunchStartTime(0),
+      m_AppStartTimeMs(0),
+      m_ConnectionTimeMs(0),
+      m_WindowCreationTimeMs(0),
+      m_DecoderCreationTimeMs(0)
 {
+    SDL_AtomicSet(&m_AudioDriftPpm, 0);
+    SDL_AtomicSet(&m_AudioDriftCompensationActive, 0);
+    SDL_AtomicSet(&m_AudioReinitReady, 0);
+    SDL_AtomicSet(&m_AudioReinitCancelled, 0);
+    SDL_AtomicSet(&m_FirstFrameSubmitted, 0);
+
+    SDL_zero(m_ActiveWndAudioStats);
+    SDL_zero(m_LastWndAudioStats);
+    SDL_zero(m_GlobalAudioStats);
+    SDL_zero(m_OverlayAudioStats);
+
+    // Delaying audio to line up with video is opt-in
+    Utils::getEnvironmentVariableOverride("AV_SYNC_CORRECTION", &m_AVSyncCorrectionEnabled);
 }
 
 Session::~Session()
@@ -1292,6 +1340,10 @@ private:
         // Finish cleanup of the connection state
         LiStopConnection();
 
+        // No more packets can arrive, so flush and close the recording
+        delete m_Session->m_StreamRecorder;
+        m_Session->m_StreamRecorder = nullptr;
+
         // Perform a best-effort app quit
         if (shouldQuit) {
             NvHTTP http(m_Session->m_Computer);
@@ -1610,6 +1662,7 @@ bool Session::startConnectionAsync()
 
     QString rtspSessionUrl;
 
+    Uint32 appStartTime = SDL_GetTicks();
     try {
         NvHTTP http(m_Computer);
         http.startApp(m_Computer->currentGameId != 0 ? "resume" : "launch",
@@ -1627,6 +1680,7 @@ bool Session::startConnectionAsync()
         emit displayLaunchError(e.toQString());
         return false;
     }
+    m_AppStartTimeMs = SDL_GetTicks() - appStartTime;
 
     QByteArray hostnameStr = m_Computer->activeAddress.address().toUtf8();
     QByteArray siAppVersion = m_Computer->appVersion.toUtf8();
@@ -1704,10 +1758,22 @@ bool Session::startConnectionAsync()
                                                                          false);
     }
 
+    // Record the received elementary streams if requested. This must be
+    // created before LiStartConnection() so it can see the stream setup.
+    QString recordingFile = qEnvironmentVariable("STREAM_RECORDING_FILE");
+    if (!recordingFile.isEmpty()) {
+        m_StreamRecorder = new StreamRecorder(recordingFile, m_StreamConfig.bitrate);
+    }
+
+    Uint32 connectionStartTime = SDL_GetTicks();
     int err = LiStartConnection(&hostInfo, &m_StreamConfig, &k_ConnCallbacks,
                                 &m_VideoCallbacks, &m_AudioCallbacks,
                                 NULL, 0, NULL, 0);
+    m_ConnectionTimeMs = SDL_GetTicks() - connectionStartTime;
     if (err != 0) {
+        delete m_StreamRecorder;
+        m_StreamRecorder = nullptr;
+
         // We already displayed an error dialog in the stage failure
         // listener.
         return false;
@@ -1734,6 +1800,15 @@ void Session::flushWindowEvents()
     SDL_PushEvent(&flushEvent);
 }
 
+void Session::requestGamepadStateFlush()
+{
+    // Gamepad state must only be touched on the main thread
+    SDL_Event event = {};
+    event.type = SDL_USEREVENT;
+    event.user.code = SDL_CODE_GAMECONTROLLER_FLUSH_STATE;
+    SDL_PushEvent(&event);
+}
+
 void Session::setShouldExit(bool quitHostApp)
 {
     // If the caller has explicitly asked us to quit the host app,
@@ -1747,6 +1822,17 @@ void Session::setShouldExit(bool quitHostApp)
     m_ShouldExit = true;
 }
 
+void Session::requestFrameSnapshot()
+{
+    // If the decoder is being recreated, just drop the request
+    if (SDL_TryLockMutex(m_DecoderLock) == 0) {
+        if (m_VideoDecoder != nullptr) {
+            m_VideoDecoder->requestFrameSnapshot();
+        }
+        SDL_UnlockMutex(m_DecoderLock);
+    }
+}
+
 void Session::start()
 {
     // Wait for any old session to finish cleanup
@@ -1759,10 +1845,19 @@ void Session::start()
     // NB: m_InputHandler must be initialize before starting the connection.
     m_InputHandler = new SdlInputHandler(*m_Preferences, m_StreamConfig.width, m_StreamConfig.height);
 
+    m_LaunchStartTime = SDL_GetTicks();
+
     // Kick off the async connection thread then return to the caller to pump the event loop
     auto thread = new AsyncConnectionStartThread(this);
     QObject::connect(thread, &QThread::finished, this, &Session::exec);
     QObject::connect(thread, &QThread::finished, thread, &QThread::deleteLater);
+
+    // Create the window and decoder while the host launches the app. This is
+    // queued so the UI can update first. It's posted before the thread starts
+    // so it's guaranteed to run before exec(), even if the connection fails
+    // immediately.
+    QMetaObject::invokeMethod(this, "prepareForStream", Qt::QueuedConnection);
+
     thread->start();
 }
 
@@ -1778,23 +1873,9 @@ void Session::interrupt()
     SDL_PushEvent(&event);
 }
 
-void Session::exec()
+// Called on the main thread
+bool Session::createStreamWindow(bool hidden)
 {
-    // If the connection failed, clean up and abort the connection.
-    if (!m_AsyncConnectionSuccess) {
-        delete m_InputHandler;
-        m_InputHandler = nullptr;
-        SDL_QuitSubSystem(SDL_INIT_VIDEO);
-        QThreadPool::globalInstance()->start(new DeferredSessionCleanupTask(this));
-        return;
-    }
-
-    // Pump the Qt event loop one last time before we create our SDL window
-    // This is sometimes necessary for the QML code to process any signals
-    // we've emitted from the async connection thread.
-    QCoreApplication::processEvents(QEventLoop::ExcludeUserInputEvents);
-    QCoreApplication::sendPostedEvents();
-
     int x, y, width, height;
     getWindowDimensions(x, y, width, height);
 
@@ -1817,6 +1898,13 @@ void Session::exec()
     // We always want a resizable window with High DPI enabled
     Uint32 defaultWindowFlags = SDL_WINDOW_ALLOW_HIGHDPI | SDL_WINDOW_RESIZABLE;
 
+    // A window created while the app is still launching must not cover the
+    // launch progress or any error dialogs, since SDL events aren't pumped
+    // until exec().
+    if (hidden) {
+        defaultWindowFlags |= SDL_WINDOW_HIDDEN;
+    }
+
     // If we're starting in windowed mode and the Moonlight GUI is maximized or
     // minimized, match that with the streaming window.
     if (!m_IsFullScreen && m_QtWindow != nullptr) {
@@ -1868,12 +1956,7 @@ void Session::exec()
             SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
                          "SDL_CreateWindow() failed: %s",
                          SDL_GetError());
-
-            delete m_InputHandler;
-            m_InputHandler = nullptr;
-            SDL_QuitSubSystem(SDL_INIT_VIDEO);
-            QThreadPool::globalInstance()->start(new DeferredSessionCleanupTask(this));
-            return;
+            return false;
         }
     }
 
@@ -1900,6 +1983,17 @@ void Session::exec()
     }
 #endif
 
+    // SDL keeps its own copy of the icon
+    if (iconSurface != nullptr) {
+        SDL_FreeSurface(iconSurface);
+    }
+
+    return true;
+}
+
+// Called on the main thread after the window is created
+void Session::enterInitialWindowMode()
+{
     // Update the window display mode based on our current monitor
     // for if/when we enter full-screen mode.
     updateOptimalWindowDisplayMode();
@@ -1908,6 +2002,108 @@ void Session::exec()
     if (m_IsFullScreen) {
         SDL_SetWindowFullscreen(m_Window, m_FullScreenFlag);
     }
+}
+
+// Called on the main thread while startConnectionAsync() is running
+void Session::prepareForStream()
+{
+    int pipelinedStartup = 1;
+    Utils::getEnvironmentVariableOverride("PIPELINED_STARTUP", &pipelinedStartup);
+    if (!pipelinedStartup || m_Window != nullptr) {
+        return;
+    }
+
+    Uint32 startTime = SDL_GetTicks();
+    if (!createStreamWindow(true)) {
+        // We'll try again (and fail properly) in exec()
+        return;
+    }
+    m_WindowCreationTimeMs = SDL_GetTicks() - startTime;
+
+    // The decoder must be created against the final display mode, so
+    // this has to happen before chooseDecoder().
+    enterInitialWindowMode();
+
+    // Creating a decoder for a window that hasn't been mapped yet doesn't work
+    // on native Wayland, so that one waits for SDL_WINDOWEVENT_SHOWN.
+    if (strcmp(SDL_GetCurrentVideoDriver(), "wayland") == 0) {
+        return;
+    }
+
+    // Build the decoder for the format we asked for. The host normally agrees,
+    // but exec() will throw this away if drSetup() reports something else.
+    m_PreparedVideoFormat = m_StreamConfig.supportedVideoFormats;
+    m_PreparedVideoWidth = m_StreamConfig.width;
+    m_PreparedVideoHeight = m_StreamConfig.height;
+    m_PreparedVideoFrameRate = m_StreamConfig.fps;
+
+    // See the comment on the same check in exec()
+    int displayHz = StreamUtils::getDisplayRefreshRate(m_Window);
+    bool enableVsync = m_Preferences->enableVsync;
+    if (displayHz + 5 < m_StreamConfig.fps) {
+        enableVsync = false;
+    }
+
+    startTime = SDL_GetTicks();
+    if (!chooseDecoder(m_Preferences->videoDecoderSelection,
+                       m_Preferences->rendererSelection,
+                       m_Window, m_PreparedVideoFormat, m_PreparedVideoWidth,
+                       m_PreparedVideoHeight, m_PreparedVideoFrameRate,
+                       enableVsync,
+                       enableVsync && m_Preferences->framePacing,
+                       m_Preferences->videoEnhancing,
+                       false,
+                       m_PreparedVideoDecoder)) {
+        // exec() will try again and report the error
+        SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION,
+                    "Unable to prepare decoder during connection startup");
+        return;
+    }
+    m_DecoderCreationTimeMs = SDL_GetTicks() - startTime;
+}
+
+void Session::exec()
+{
+    // If the connection failed, clean up and abort the connection.
+    if (!m_AsyncConnectionSuccess) {
+        delete m_PreparedVideoDecoder;
+        m_PreparedVideoDecoder = nullptr;
+        if (m_Window != nullptr) {
+            SDL_DestroyWindow(m_Window);
+            m_Window = nullptr;
+        }
+        delete m_InputHandler;
+        m_InputHandler = nullptr;
+        SDL_QuitSubSystem(SDL_INIT_VIDEO);
+        QThreadPool::globalInstance()->start(new DeferredSessionCleanupTask(this));
+        return;
+    }
+
+    // Pump the Qt event loop one last time before we create our SDL window
+    // This is sometimes necessary for the QML code to process any signals
+    // we've emitted from the async connection thread.
+    QCoreApplication::processEvents(QEventLoop::ExcludeUserInputEvents);
+    QCoreApplication::sendPostedEvents();
+
+    bool windowPrepared = m_Window != nullptr;
+    if (!windowPrepared) {
+        // Window creation didn't happen during the connection handshake
+        Uint32 windowStartTime = SDL_GetTicks();
+        if (!createStreamWindow(false)) {
+            delete m_InputHandler;
+            m_InputHandler = nullptr;
+            SDL_QuitSubSystem(SDL_INIT_VIDEO);
+            QThreadPool::globalInstance()->start(new DeferredSessionCleanupTask(this));
+            return;
+        }
+        m_WindowCreationTimeMs = SDL_GetTicks() - windowStartTime;
+
+        enterInitialWindowMode();
+    }
+    else {
+        // The window was created hidden during the connection handshake
+        SDL_ShowWindow(m_Window);
+    }
 
     bool needsFirstEnterCapture = false;
     bool needsPostDecoderCreationCapture = false;
@@ -1947,6 +2143,57 @@ void Session::exec()
 
     int currentDisplayIndex = SDL_GetWindowDisplayIndex(m_Window);
 
+    // Use the decoder we built during the handshake if the host agreed
+    // to the format we expected. Otherwise, it's created on the first
+    // SDL_WINDOWEVENT_SHOWN as usual.
+    const char* decoderStage = "created after connection";
+    if (m_PreparedVideoDecoder != nullptr) {
+        if (m_PreparedVideoFormat == m_ActiveVideoFormat &&
+                m_PreparedVideoWidth == m_ActiveVideoWidth &&
+                m_PreparedVideoHeight == m_ActiveVideoHeight &&
+                m_PreparedVideoFrameRate == m_ActiveVideoFrameRate) {
+            SDL_LockMutex(m_DecoderLock);
+            m_VideoDecoder = m_PreparedVideoDecoder;
+            m_VideoDecoder->setHdrMode(LiGetCurrentHostDisplayHdrMode());
+            SDL_UnlockMutex(m_DecoderLock);
+
+            // Discard the window events from creating and showing the window.
+            // They would otherwise make some renderers recreate this decoder.
+            flushWindowEvents();
+
+            // Frames received before now were dropped
+            LiRequestIdrFrame();
+
+            if (needsPostDecoderCreationCapture) {
+                m_InputHandler->setCaptureActive(true);
+                needsPostDecoderCreationCapture = false;
+            }
+            m_InputHandler->updatePointerRegionLock();
+
+            decoderStage = "overlapped with connection";
+        }
+        else {
+            SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+                        "Discarding prepared decoder for %dx%dx%d (format 0x%x)",
+                        m_PreparedVideoWidth,
+                        m_PreparedVideoHeight,
+                        m_PreparedVideoFrameRate,
+                        m_PreparedVideoFormat);
+            delete m_PreparedVideoDecoder;
+            decoderStage = "discarded, recreated after connection";
+        }
+        m_PreparedVideoDecoder = nullptr;
+    }
+
+    SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+                "Launch stages: app start %u ms, connection %u ms, window %u ms (%s), decoder %u ms (%s)",
+                m_AppStartTimeMs,
+                m_ConnectionTimeMs,
+                m_WindowCreationTimeMs,
+                windowPrepared ? "overlapped with connection" : "created after connection",
+                m_DecoderCreationTimeMs,
+                decoderStage);
+
     // Now that we're about to stream, any SDL_QUIT event is expected
     // unless it comes from the connection termination callback where
     // (m_UnexpectedTermination is set back to true).
@@ -2037,6 +2284,9 @@ void Session::exec()
                 m_InputHandler->setAdaptiveTriggers((uint16_t)(uintptr_t)event.user.data1,
                                                     (DualSenseOutputReport *)event.user.data2);
                 break;
+            case SDL_CODE_GAMECONTROLLER_FLUSH_STATE:
+                m_InputHandler->flushPendingGamepadState();
+                break;
             default:
                 SDL_assert(false);
             }
@@ -2331,6 +2581,19 @@ DispatchDeferredCleanup:
     delete m_InputHandler;
     m_InputHandler = nullptr;
 
+    {
+        char inputStatsStr[1024];
+        char latencyHistogramStr[1024];
+        m_InputStats.stringify(inputStatsStr, sizeof(inputStatsStr));
+        m_InputStats.stringifyLatencyHistograms(latencyHistogramStr, sizeof(latencyHistogramStr));
+        if (inputStatsStr[0] != 0) {
+            SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+                        "\nGlobal input stats\n------------------\n%s%s",
+                        inputStatsStr,
+                        latencyHistogramStr);
+        }
+    }
+
     // Destroy the decoder, since this must be done on the main thread
     // NB: This must happen before LiStopConnection() for pull-based
     // decoders.
@@ -2368,10 +2631,6 @@ DispatchDeferredCleanup:
     // the renderer may want to interact with the window
     SDL_DestroyWindow(m_Window);
 
-    if (iconSurface != nullptr) {
-        SDL_FreeSurface(iconSurface);
-    }
-
     SDL_QuitSubSystem(SDL_INIT_VIDEO);
 
     // Cleanup can take a while, so dispatch it to a worker thread.
@@ -7,9 +7,13 @@
 #include <opus_multistream.h>
 #include "settings/streamingpreferences.h"
 #include "input/input.h"
+#include "input/inputstats.h"
 #include "video/decoder.h"
 #include "audio/renderers/renderer.h"
+#include "audio/driftcompensator.h"
 #include "video/overlaymanager.h"
+#include "streamrecorder.h"
+#include "avsyncmonitor.h"
 
 class SupportedVideoFormatList : public QList<int>
 {
@@ -123,8 +127,38 @@ public:
 
     void flushWindowEvents();
 
+    // Thread-safe. Sends coalesced gamepad state from the main thread.
+    void requestGamepadStateFlush();
+
     void setShouldExit(bool quitHostApp = false);
 
+    // Thread-safe. Captures the next rendered frame to a PNG file.
+    void requestFrameSnapshot();
+
+    // Thread-safe. Writes audio statistics for the debug overlay.
+    void stringifyAudioStats(char* output, int length);
+
+    // Non-null only while recording is enabled and the connection is up
+    StreamRecorder* getStreamRecorder()
+    {
+        return m_StreamRecorder;
+    }
+
+    AVSyncMonitor* getAVSyncMonitor()
+    {
+        return &m_AVSyncMonitor;
+    }
+
+    bool isAVSyncCorrectionEnabled()
+    {
+        return m_AVSyncCorrectionEnabled;
+    }
+
+    InputStats* getInputStats()
+    {
+        return &m_InputStats;
+    }
+
 signals:
     void stageStarting(QString stage);
 
@@ -146,6 +180,12 @@ signals:
 private:
     void exec();
 
+    Q_INVOKABLE void prepareForStream();
+
+    bool createStreamWindow(bool hidden);
+
+    void enterInitialWindowMode();
+
     bool startConnectionAsync();
 
     bool validateLaunch(SDL_Window* testWindow);
@@ -156,7 +196,34 @@ private:
 
     IAudioRenderer* createAudioRenderer(const POPUS_MULTISTREAM_CONFIGURATION opusConfig);
 
-    bool initializeAudioRenderer();
+    // Everything that is recreated together when the audio device changes
+    struct AudioPipeline {
+        IAudioRenderer* renderer;
+        OpusMSDecoder* opusDecoder;
+        OPUS_MULTISTREAM_CONFIGURATION activeConfig;
+        AudioDriftCompensator* driftCompensator;
+    };
+
+    bool initializeAudioRenderer(AudioPipeline& pipeline);
+
+    void installAudioPipeline(const AudioPipeline& pipeline);
+
+    void startAudioRendererReinit(IAudioRenderer* failedRenderer);
+
+    void stopAudioRendererReinit();
+
+    void updateAudioRendererStats();
+
+    void updateAudioSyncDelay(AUDIO_STATS& stats);
+
+    static
+    void addAudioStats(AUDIO_STATS& src, AUDIO_STATS& dst);
+
+    static
+    void stringifyAudioStats(AUDIO_STATS& stats, char* output, int length);
+
+    static
+    int audioReinitThreadProc(void* context);
 
     bool testAudio(int audioConfiguration);
 
@@ -278,7 +345,55 @@ private:
     OPUS_MULTISTREAM_CONFIGURATION m_ActiveAudioConfig;
     OPUS_MULTISTREAM_CONFIGURATION m_OriginalAudioConfig;
     int m_AudioSampleCount;
-    Uint32 m_DropAudioEndTime;
+    AudioDriftCompensator* m_AudioDriftCompensator;
+    QVector<float> m_AudioDiscardBuffer;
+
+    // Audio device reinitialization happens on this thread so the audio
+    // thread never blocks. The new pipeline is handed over once ready.
+    SDL_Thread* m_AudioReinitThread;
+    IAudioRenderer* m_FailedAudioRenderer;
+    AudioPipeline m_PendingAudioPipeline;
+    SDL_atomic_t m_AudioReinitReady;
+    SDL_atomic_t m_AudioReinitCancelled;
+    bool m_AudioReinitThreadFailed; // Only touched by the audio thread
+
+    // Accumulated on the audio thread
+    AUDIO_STATS m_ActiveWndAudioStats;
+    AUDIO_STATS m_LastWndAudioStats;
+    AUDIO_STATS m_GlobalAudioStats;
+    uint32_t m_LastRendererUnderruns;
+    uint32_t m_LastRendererDroppedFrames;
+
+    // Snapshot of the last two windows for the overlay
+    AUDIO_STATS m_OverlayAudioStats;
+    SDL_SpinLock m_OverlayAudioStatsLock;
+
+    SDL_atomic_t m_AudioDriftPpm;
+    SDL_atomic_t m_AudioDriftCompensationActive;
+
+    StreamRecorder* m_StreamRecorder;
+
+    AVSyncMonitor m_AVSyncMonitor;
+    bool m_AVSyncCorrectionEnabled;
+    int m_AudioSyncDelayMs;
+    bool m_AVSyncUncorrectableLogged;
+
+    InputStats m_InputStats;
+
+    // Decoder built while the connection was being established
+    IVideoDecoder* m_PreparedVideoDecoder;
+    int m_PreparedVideoFormat;
+    int m_PreparedVideoWidth;
+    int m_PreparedVideoHeight;
+    int m_PreparedVideoFrameRate;
+
+    // Launch stage timings for the log
+    Uint32 m_LaunchStartTime;
+    Uint32 m_AppStartTimeMs;
+    Uint32 m_ConnectionTimeMs;
+    Uint32 m_WindowCreationTimeMs;
+    Uint32 m_DecoderCreationTimeMs;
+    SDL_atomic_t m_FirstFrameSubmitted;
 
     Overlay::OverlayManager m_OverlayManager;
 
@@ -0,0 +1,526 @@
+#include "streamrecorder.h"
+
+#include <QFile>
+
+// Wake the writer at least this often to notice shutdown
+#define WRITER_WAIT_TIMEOUT_MS 100
+
+// The video ring must always fit a large keyframe, even at low bitrates
+#define MIN_VIDEO_RING_SIZE (8 * 1024 * 1024)
+
+// Several seconds of Opus audio at the highest surround bitrates
+#define AUDIO_RING_SIZE (512 * 1024)
+
+StreamRecorder::PacketRing::PacketRing(size_t capacity)
+    : m_Buffer((char*)SDL_malloc(capacity)),
+      m_Capacity(m_Buffer != nullptr ? capacity : 0),
+      m_WriteCount(0),
+      m_ReadCount(0)
+{
+}
+
+StreamRecorder::PacketRing::~PacketRing()
+{
+    SDL_free(m_Buffer);
+}
+
+bool StreamRecorder::PacketRing::write(const char* data, int length, uint64_t& start)
+{
+    if (m_Capacity == 0 || (size_t)length > m_Capacity) {
+        return false;
+    }
+
+    // Skip to the beginning of the buffer if the packet won't fit contiguously
+    start = m_WriteCount;
+    size_t offset = start % m_Capacity;
+    if (offset + length > m_Capacity) {
+        start += m_Capacity - offset;
+    }
+
+    if (start + length - m_ReadCount.load(std::memory_order_acquire) > m_Capacity) {
+        return false;
+    }
+
+    // The consumer sees this data once it sees the packet that references it
+    memcpy(m_Buffer + (start % m_Capacity), data, length);
+    m_WriteCount = start + length;
+    return true;
+}
+
+void StreamRecorder::PacketRing::unwrite(uint64_t start)
+{
+    // Any skipped space before start is harmless to keep
+    m_WriteCount = start;
+}
+
+StreamRecorder::StreamRecorder(QString fileName, int videoBitrateKbps)
+    : m_FileName(fileName),
+      m_VideoFormat(0),
+      m_Width(0),
+      m_Height(0),
+      m_FrameRate(0),
+      m_OpusConfig{},
+      m_HasAudio(false),
+      m_VideoRing(SDL_max((size_t)videoBitrateKbps * 1000 / 8, (size_t)MIN_VIDEO_RING_SIZE)),
+      m_AudioRing(AUDIO_RING_SIZE),
+      m_PacketsAvailable(SDL_CreateSemaphore(0)),
+      m_WriterThread(nullptr),
+      m_Stopping(false),
+      m_DroppedVideoPackets(0),
+      m_DroppedAudioPackets(0),
+      m_OutputOpen(false),
+      m_OutputFailed(false),
+      m_LastRtpTimestamp(0),
+      m_VideoPts(0),
+      m_FirstVideoReceiveTimeUs(0),
+      m_AudioPts(0),
+      m_AudioPtsAnchored(false),
+      m_WrittenVideoPackets(0),
+      m_WrittenAudioPackets(0),
+#ifdef HAVE_LIBAVFORMAT
+      m_FormatContext(nullptr),
+      m_VideoStream(nullptr),
+      m_AudioStream(nullptr),
+      m_Pkt(av_packet_alloc())
+#else
+      m_RawFile(nullptr)
+#endif
+{
+    m_WriterThread = SDL_CreateThread(StreamRecorder::writerThreadProc, "StreamRecorder", this);
+    if (m_WriterThread == nullptr) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                     "Unable to create stream recorder thread: %s",
+                     SDL_GetError());
+    }
+
+#ifndef HAVE_LIBAVFORMAT
+    SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION,
+                "Built without libavformat. Only the video elementary stream will be recorded.");
+#endif
+}
+
+StreamRecorder::~StreamRecorder()
+{
+    if (m_WriterThread != nullptr) {
+        m_Stopping = true;
+        SDL_SemPost(m_PacketsAvailable);
+        SDL_WaitThread(m_WriterThread, nullptr);
+    }
+
+    SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+                "Stream recording to %s finished: %u video packets (%u dropped), %u audio packets (%u dropped)",
+                qPrintable(m_FileName),
+                m_WrittenVideoPackets, m_DroppedVideoPackets.load(),
+                m_WrittenAudioPackets, m_DroppedAudioPackets.load());
+
+#ifdef HAVE_LIBAVFORMAT
+    av_packet_free(&m_Pkt);
+#endif
+    SDL_DestroySemaphore(m_PacketsAvailable);
+}
+
+void StreamRecorder::setVideoFormat(int videoFormat, int width, int height, int frameRate)
+{
+    m_VideoFormat = videoFormat;
+    m_Width = width;
+    m_Height = height;
+    m_FrameRate = frameRate;
+}
+
+void StreamRecorder::setAudioConfig(const OPUS_MULTISTREAM_CONFIGURATION* opusConfig)
+{
+#ifdef HAVE_LIBAVFORMAT
+    m_OpusConfig = *opusConfig;
+    m_HasAudio = true;
+#else
+    Q_UNUSED(opusConfig);
+#endif
+}
+
+void StreamRecorder::submitVideoPacket(const char* data, int length,
+                                       int frameNumber, int frameType,
+                                       uint32_t rtpTimestamp, uint64_t receiveTimeUs)
+{
+    if (m_WriterThread == nullptr) {
+        return;
+    }
+
+    // Copy the packet into the ring since the decoder reuses its buffer
+    Packet packet = { 0, length, frameNumber, frameType, rtpTimestamp, receiveTimeUs };
+    if (!m_VideoRing.write(data, length, packet.start)) {
+        // The writer has fallen behind (likely slow or full disk)
+        m_DroppedVideoPackets++;
+        return;
+    }
+    if (!m_VideoQueue.push(packet)) {
+        m_VideoRing.unwrite(packet.start);
+        m_DroppedVideoPackets++;
+        return;
+    }
+
+    SDL_SemPost(m_PacketsAvailable);
+}
+
+void StreamRecorder::submitAudioPacket(const char* data, int length)
+{
+    if (m_WriterThread == nullptr || !m_HasAudio) {
+        return;
+    }
+
+    Packet packet = { 0, length, 0, 0, 0, LiGetMicroseconds() };
+    if (!m_AudioRing.write(data, length, packet.start)) {
+        m_DroppedAudioPackets++;
+        return;
+    }
+    if (!m_AudioQueue.push(packet)) {
+        m_AudioRing.unwrite(packet.start);
+        m_DroppedAudioPackets++;
+        return;
+    }
+
+    SDL_SemPost(m_PacketsAvailable);
+}
+
+int StreamRecorder::writerThreadProc(void* context)
+{
+    static_cast<StreamRecorder*>(context)->writerThreadLoop();
+    return 0;
+}
+
+void StreamRecorder::writerThreadLoop()
+{
+    SDL_SetThreadPriority(SDL_THREAD_PRIORITY_LOW);
+
+    for (;;) {
+        bool stopping = m_Stopping;
+        Packet packet;
+
+        // Video goes first because the output is opened on the first keyframe
+        while (m_VideoQueue.pop(packet)) {
+            if (m_OutputFailed) {
+                m_DroppedVideoPackets++;
+            }
+            else {
+                writeVideoPacket(packet, m_VideoRing.data(packet.start));
+            }
+            m_VideoRing.release(packet.start + packet.length);
+        }
+        while (m_AudioQueue.pop(packet)) {
+            if (m_OutputFailed) {
+                m_DroppedAudioPackets++;
+            }
+            else if (m_OutputOpen) {
+                writeAudioPacket(packet, m_AudioRing.data(packet.start));
+            }
+            m_AudioRing.release(packet.start + packet.length);
+        }
+
+        if (stopping) {
+            break;
+        }
+
+        SDL_SemWaitTimeout(m_PacketsAvailable, WRITER_WAIT_TIMEOUT_MS);
+    }
+
+    closeOutput();
+}
+
+QByteArray StreamRecorder::getVideoParameterSets(int videoFormat, const char* keyFrame, int keyFrameLength)
+{
+    if (videoFormat & VIDEO_FORMAT_MASK_AV1) {
+        // The muxer extracts the sequence header OBU itself
+        return QByteArray(keyFrame, keyFrameLength);
+    }
+
+    QByteArray parameterSets;
+    const char* data = keyFrame;
+    int length = keyFrameLength;
+    int nalStart = -1;
+
+    for (int i = 0; i <= length; i++) {
+        // Find the next 3 byte start code (or the end of the buffer)
+        bool atEnd = i == length;
+        if (!atEnd && (i + 3 > length || data[i] != 0 || data[i + 1] != 0 || data[i + 2] != 1)) {
+            continue;
+        }
+
+        if (nalStart >= 0 && nalStart < length) {
+            int nalEnd = i;
+            // Exclude the leading zero of a 4 byte start code
+            while (!atEnd && nalEnd > nalStart && data[nalEnd - 1] == 0) {
+                nalEnd--;
+            }
+
+            int nalType;
+            bool isParameterSet;
+            if (videoFormat & VIDEO_FORMAT_MASK_H264) {
+                nalType = data[nalStart] & 0x1F;
+                isParameterSet = nalType == 7 || nalType == 8;
+            }
+            else {
+                nalType = (data[nalStart] & 0x7E) >> 1;
+                isParameterSet = nalType >= 32 && nalType <= 34;
+            }
+
+            if (isParameterSet) {
+                parameterSets.append("\x00\x00\x00\x01", 4);
+                parameterSets.append(data + nalStart, nalEnd - nalStart);
+            }
+        }
+
+        nalStart = i + 3;
+        i += 2;
+    }
+
+    return parameterSets;
+}
+
+bool StreamRecorder::openOutput(const char* keyFrame, int keyFrameLength)
+{
+#ifdef HAVE_LIBAVFORMAT
+    int err;
+    QByteArray extradata = getVideoParameterSets(m_VideoFormat, keyFrame, keyFrameLength);
+
+    err = avformat_alloc_output_context2(&m_FormatContext, nullptr, "matroska",
+                                         QFile::encodeName(m_FileName).constData());
+    if (err < 0) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                     "avformat_alloc_output_context2() failed: %d",
+                     err);
+        return false;
+    }
+
+    m_VideoStream = avformat_new_stream(m_FormatContext, nullptr);
+    if (m_VideoStream == nullptr) {
+        goto Fail;
+    }
+
+    m_VideoStream->time_base = AVRational { 1, 90000 };
+    m_VideoStream->avg_frame_rate = AVRational { m_FrameRate, 1 };
+    m_VideoStream->codecpar->codec_type = AVMEDIA_TYPE_VIDEO;
+    m_VideoStream->codecpar->width = m_Width;
+    m_VideoStream->codecpar->height = m_Height;
+    if (m_VideoFormat & VIDEO_FORMAT_MASK_H264) {
+        m_VideoStream->codecpar->codec_id = AV_CODEC_ID_H264;
+    }
+    else if (m_VideoFormat & VIDEO_FORMAT_MASK_H265) {
+        m_VideoStream->codecpar->codec_id = AV_CODEC_ID_HEVC;
+    }
+    else {
+        m_VideoStream->codecpar->codec_id = AV_CODEC_ID_AV1;
+    }
+
+    m_VideoStream->codecpar->extradata = (uint8_t*)av_mallocz(extradata.size() + AV_INPUT_BUFFER_PADDING_SIZE);
+    if (m_VideoStream->codecpar->extradata == nullptr) {
+        goto Fail;
+    }
+    memcpy(m_VideoStream->codecpar->extradata, extradata.constData(), extradata.size());
+    m_VideoStream->codecpar->extradata_size = extradata.size();
+
+    if (m_HasAudio) {
+        // Build the OpusHead identification header (RFC 7845 section 5.1)
+        QByteArray opusHead("OpusHead", 8);
+        bool simpleMapping = m_OpusConfig.channelCount <= 2 && m_OpusConfig.streams == 1;
+
+        opusHead.append((char)1); // Version
+        opusHead.append((char)m_OpusConfig.channelCount);
+        opusHead.append((char)0).append((char)0); // Pre-skip
+        opusHead.append((char)(m_OpusConfig.sampleRate & 0xFF));
+        opusHead.append((char)((m_OpusConfig.sampleRate >> 8) & 0xFF));
+        opusHead.append((char)((m_OpusConfig.sampleRate >> 16) & 0xFF));
+        opusHead.append((char)((m_OpusConfig.sampleRate >> 24) & 0xFF));
+        opusHead.append((char)0).append((char)0); // Output gain
+        opusHead.append((char)(simpleMapping ? 0 : 1));
+        if (!simpleMapping) {
+            opusHead.append((char)m_OpusConfig.streams);
+            opusHead.append((char)m_OpusConfig.coupledStreams);
+            opusHead.append((const char*)m_OpusConfig.mapping, m_OpusConfig.channelCount);
+        }
+
+        m_AudioStream = avformat_new_stream(m_FormatContext, nullptr);
+        if (m_AudioStream == nullptr) {
+            goto Fail;
+        }
+
+        m_AudioStream->time_base = AVRational { 1, m_OpusConfig.sampleRate };
+        m_AudioStream->codecpar->codec_type = AVMEDIA_TYPE_AUDIO;
+        m_AudioStream->codecpar->codec_id = AV_CODEC_ID_OPUS;
+        m_AudioStream->codecpar->sample_rate = m_OpusConfig.sampleRate;
+        m_AudioStream->codecpar->frame_size = m_OpusConfig.samplesPerFrame;
+#if LIBAVUTIL_VERSION_INT >= AV_VERSION_INT(57, 24, 100)
+        av_channel_layout_default(&m_AudioStream->codecpar->ch_layout, m_OpusConfig.channelCount);
+#else
+        m_AudioStream->codecpar->channels = m_OpusConfig.channelCount;
+#endif
+
+        m_AudioStream->codecpar->extradata = (uint8_t*)av_mallocz(opusHead.size() + AV_INPUT_BUFFER_PADDING_SIZE);
+        if (m_AudioStream->codecpar->extradata == nullptr) {
+            goto Fail;
+        }
+        memcpy(m_AudioStream->codecpar->extradata, opusHead.constData(), opusHead.size());
+        m_AudioStream->codecpar->extradata_size = opusHead.size();
+    }
+
+    err = avio_open(&m_FormatContext->pb, QFile::encodeName(m_FileName).constData(), AVIO_FLAG_WRITE);
+    if (err < 0) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                     "Unable to open %s for recording: %d",
+                     qPrintable(m_FileName),
+                     err);
+        goto Fail;
+    }
+
+    err = avformat_write_header(m_FormatContext, nullptr);
+    if (err < 0) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                     "avformat_write_header() failed: %d",
+                     err);
+        avio_closep(&m_FormatContext->pb);
+        goto Fail;
+    }
+
+    return true;
+
+Fail:
+    avformat_free_context(m_FormatContext);
+    m_FormatContext = nullptr;
+    m_VideoStream = m_AudioStream = nullptr;
+    return false;
+#else
+    Q_UNUSED(keyFrame);
+    Q_UNUSED(keyFrameLength);
+
+    m_RawFile = fopen(QFile::encodeName(m_FileName).constData(), "wb");
+    if (m_RawFile == nullptr) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                     "Unable to open %s for recording: %d",
+                     qPrintable(m_FileName),
+                     errno);
+        return false;
+    }
+
+    return true;
+#endif
+}
+
+void StreamRecorder::writeVideoPacket(const Packet& packet, const char* data)
+{
+    if (!m_OutputOpen) {
+        // Wait for a keyframe so the recording is decodable from the start
+        if (packet.frameType != FRAME_TYPE_IDR) {
+            return;
+        }
+
+        if (!openOutput(data, packet.length)) {
+            m_OutputFailed = true;
+            m_DroppedVideoPackets++;
+            return;
+        }
+
+        SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+                    "Recording stream to %s starting at frame %d",
+                    qPrintable(m_FileName),
+                    packet.frameNumber);
+
+        m_OutputOpen = true;
+        m_VideoPts = 0;
+        m_LastRtpTimestamp = packet.rtpTimestamp;
+        m_FirstVideoReceiveTimeUs = packet.receiveTimeUs;
+    }
+    else {
+        // Unwrap the 32-bit 90 KHz timestamp and keep it strictly increasing
+        m_VideoPts += SDL_max((int32_t)(packet.rtpTimestamp - m_LastRtpTimestamp), 1);
+        m_LastRtpTimestamp = packet.rtpTimestamp;
+    }
+
+#ifdef HAVE_LIBAVFORMAT
+    m_Pkt->data = (uint8_t*)data;
+    m_Pkt->size = packet.length;
+    m_Pkt->stream_index = m_VideoStream->index;
+    m_Pkt->pts = m_Pkt->dts = av_rescale_q(m_VideoPts, AVRational { 1, 90000 }, m_VideoStream->time_base);
+    m_Pkt->flags = packet.frameType == FRAME_TYPE_IDR ? AV_PKT_FLAG_KEY : 0;
+
+    // Our packet isn't reference counted, so av_interleaved_write_frame() copies
+    // the data if it needs to keep it. The ring space can be reused once it returns.
+    int err = av_interleaved_write_frame(m_FormatContext, m_Pkt);
+    if (err < 0) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                     "Stopping stream recording after write failure: %d",
+                     err);
+        m_OutputFailed = true;
+        m_DroppedVideoPackets++;
+        return;
+    }
+#else
+    if (fwrite(data, 1, packet.length, m_RawFile) != (size_t)packet.length) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                     "Stopping stream recording after write failure: %d",
+                     errno);
+        m_OutputFailed = true;
+        m_DroppedVideoPackets++;
+        return;
+    }
+#endif
+
+    m_WrittenVideoPackets++;
+}
+
+void StreamRecorder::writeAudioPacket(const Packet& packet, const char* data)
+{
+#ifdef HAVE_LIBAVFORMAT
+    // Audio packets carry no timestamp, so place the first one relative to the
+    // first recorded video frame by arrival time and count samples after that.
+    if (!m_AudioPtsAnchored) {
+        if (packet.receiveTimeUs < m_FirstVideoReceiveTimeUs) {
+            return;
+        }
+
+        m_AudioPts = av_rescale(packet.receiveTimeUs - m_FirstVideoReceiveTimeUs,
+                                m_OpusConfig.sampleRate, 1000000);
+        m_AudioPtsAnchored = true;
+    }
+
+    m_Pkt->data = (uint8_t*)data;
+    m_Pkt->size = packet.length;
+    m_Pkt->stream_index = m_AudioStream->index;
+    m_Pkt->pts = m_Pkt->dts = av_rescale_q(m_AudioPts, AVRational { 1, m_OpusConfig.sampleRate }, m_AudioStream->time_base);
+    m_Pkt->duration = av_rescale_q(m_OpusConfig.samplesPerFrame, AVRational { 1, m_OpusConfig.sampleRate }, m_AudioStream->time_base);
+    m_Pkt->flags = AV_PKT_FLAG_KEY;
+    m_AudioPts += m_OpusConfig.samplesPerFrame;
+
+    int err = av_interleaved_write_frame(m_FormatContext, m_Pkt);
+    if (err < 0) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                     "Stopping stream recording after write failure: %d",
+                     err);
+        m_OutputFailed = true;
+        m_DroppedAudioPackets++;
+        return;
+    }
+
+    m_WrittenAudioPackets++;
+#else
+    // Raw elementary stream output has nowhere to put audio
+    Q_UNUSED(packet);
+    Q_UNUSED(data);
+#endif
+}
+
+void StreamRecorder::closeOutput()
+{
+#ifdef HAVE_LIBAVFORMAT
+    if (m_FormatContext != nullptr) {
+        if (!m_OutputFailed) {
+            av_write_trailer(m_FormatContext);
+        }
+        avio_closep(&m_FormatContext->pb);
+        avformat_free_context(m_FormatContext);
+        m_FormatContext = nullptr;
+    }
+#else
+    if (m_RawFile != nullptr) {
+        fclose(m_RawFile);
+        m_RawFile = nullptr;
+    }
+#endif
+}
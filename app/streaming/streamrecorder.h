@@ -0,0 +1,144 @@
+#pragma once
+
+#include "spscqueue.h"
+
+#include <Limelight.h>
+#include "SDL_compat.h"
+
+#include <QByteArray>
+#include <QString>
+
+#include <atomic>
+
+#ifdef HAVE_LIBAVFORMAT
+extern "C" {
+#include <libavformat/avformat.h>
+}
+#endif
+
+// Records the received video and audio elementary streams to a file without
+// decoding or re-encoding them. The streaming threads only copy packets into
+// preallocated lock-free rings, so recording never allocates on those threads.
+// A background thread does all file I/O and drops packets rather than stalling
+// the stream if it falls behind.
+//
+// With libavformat, video and Opus audio are muxed into Matroska. Otherwise,
+// only the raw video elementary stream (Annex B or AV1 OBUs) is written.
+class StreamRecorder
+{
+public:
+    // The video ring is sized to hold about a second of video at this bitrate
+    explicit StreamRecorder(QString fileName, int videoBitrateKbps);
+    ~StreamRecorder();
+
+    // Must be called before any packets are submitted
+    void setVideoFormat(int videoFormat, int width, int height, int frameRate);
+    void setAudioConfig(const OPUS_MULTISTREAM_CONFIGURATION* opusConfig);
+
+    // Called on the video decoder thread
+    void submitVideoPacket(const char* data, int length,
+                           int frameNumber, int frameType,
+                           uint32_t rtpTimestamp, uint64_t receiveTimeUs);
+
+    // Called on the audio thread
+    void submitAudioPacket(const char* data, int length);
+
+private:
+    // Single-producer single-consumer byte ring. Each packet occupies contiguous
+    // space, so a packet that doesn't fit before the end of the buffer starts
+    // over at the beginning and the leftover space at the end is skipped.
+    class PacketRing
+    {
+    public:
+        explicit PacketRing(size_t capacity);
+        ~PacketRing();
+
+        // Called only by the producer. Returns false if the ring is full.
+        bool write(const char* data, int length, uint64_t& start);
+
+        // Called only by the producer to give back space from the last write()
+        void unwrite(uint64_t start);
+
+        // Called only by the consumer
+        const char* data(uint64_t start) const
+        {
+            return m_Buffer + (start % m_Capacity);
+        }
+
+        // Called only by the consumer once it's done with everything before end
+        void release(uint64_t end)
+        {
+            m_ReadCount.store(end, std::memory_order_release);
+        }
+
+    private:
+        char* m_Buffer;
+        size_t m_Capacity;
+        uint64_t m_WriteCount;
+        alignas(64) std::atomic<uint64_t> m_ReadCount;
+    };
+
+    struct Packet {
+        // Location in the packet's ring
+        uint64_t start;
+        int length;
+
+        int frameNumber;
+        int frameType;
+        uint32_t rtpTimestamp;
+        uint64_t receiveTimeUs;
+    };
+
+    static int writerThreadProc(void* context);
+
+    void writerThreadLoop();
+
+    bool openOutput(const char* keyFrame, int keyFrameLength);
+
+    void writeVideoPacket(const Packet& packet, const char* data);
+
+    void writeAudioPacket(const Packet& packet, const char* data);
+
+    void closeOutput();
+
+    static QByteArray getVideoParameterSets(int videoFormat, const char* keyFrame, int keyFrameLength);
+
+    QString m_FileName;
+    int m_VideoFormat;
+    int m_Width;
+    int m_Height;
+    int m_FrameRate;
+    OPUS_MULTISTREAM_CONFIGURATION m_OpusConfig;
+    bool m_HasAudio;
+
+    PacketRing m_VideoRing;
+    PacketRing m_AudioRing;
+    SpscQueue<Packet, 256> m_VideoQueue;
+    SpscQueue<Packet, 512> m_AudioQueue;
+    SDL_sem* m_PacketsAvailable;
+    SDL_Thread* m_WriterThread;
+    std::atomic<bool> m_Stopping;
+
+    std::atomic<uint32_t> m_DroppedVideoPackets;
+    std::atomic<uint32_t> m_DroppedAudioPackets;
+
+    // Only touched by the writer thread
+    bool m_OutputOpen;
+    bool m_OutputFailed;
+    uint32_t m_LastRtpTimestamp;
+    int64_t m_VideoPts;
+    uint64_t m_FirstVideoReceiveTimeUs;
+    int64_t m_AudioPts;
+    bool m_AudioPtsAnchored;
+    uint32_t m_WrittenVideoPackets;
+    uint32_t m_WrittenAudioPackets;
+
+#ifdef HAVE_LIBAVFORMAT
+    AVFormatContext* m_FormatContext;
+    AVStream* m_VideoStream;
+    AVStream* m_AudioStream;
+    AVPacket* m_Pkt;
+#else
+    FILE* m_RawFile;
+#endif
+};
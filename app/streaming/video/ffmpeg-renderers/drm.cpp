@@ -158,6 +158,8 @@ DrmRenderer::DrmRenderer(AVHWDeviceType hwDeviceType, IFFmpegRenderer *backendRe
       m_VideoFormat(0),
       m_OverlayCompositionSurface(nullptr),
       m_OverlayRects{},
+      m_OverlaySurfaces{},
+      m_OverlayMappings{},
       m_Version(nullptr),
       m_HdrOutputMetadataBlobId(0),
       m_OutputRect{},
@@ -394,6 +396,11 @@ void DrmRenderer::cleanupRenderContext()
         return;
     }
 
+    // Unmap any overlay buffers before disabling planes
+    for (int i = 0; i < Overlay::OverlayMax; i++) {
+        releaseOverlayContents((Overlay::OverlayType)i);
+    }
+
     // If we have a composition surface, unmap it before disabling planes
     if (m_OverlayCompositionSurface) {
         munmap(m_OverlayCompositionSurface->pixels, (uintptr_t)m_OverlayCompositionSurface->userdata);
@@ -1341,7 +1348,7 @@ bool DrmRenderer::createFbForDumbBuffer(struct drm_mode_create_dumb* createBuf,
     return true;
 }
 
-bool DrmRenderer::uploadSurfaceToFb(SDL_Surface *surface, uint32_t* handle, uint32_t* fbId)
+bool DrmRenderer::uploadSurfaceToFb(SDL_Surface *surface, uint32_t* handle, uint32_t* fbId, OverlayMapping* overlayMapping)
 {
     struct drm_mode_create_dumb createBuf = {};
     void* mapping;
@@ -1366,12 +1373,16 @@ bool DrmRenderer::uploadSurfaceToFb(SDL_Surface *surface, uint32_t* handle, uint
     SDL_PremultiplyAlpha(surface->w, surface->h, surface->format->format, surface->pixels, surface->pitch,
                          SDL_PIXELFORMAT_ARGB8888, mapping, createBuf.pitch);
 
-    munmap(mapping, createBuf.size);
-
     if (!createFbForDumbBuffer(&createBuf, fbId)) {
+        munmap(mapping, createBuf.size);
         goto Fail;
     }
 
+    // Keep the buffer mapped so later updates can redraw just the dirty regions
+    overlayMapping->pixels = mapping;
+    overlayMapping->size = createBuf.size;
+    overlayMapping->pitch = createBuf.pitch;
+
     *handle = createBuf.handle;
     return true;
 
@@ -1395,6 +1406,11 @@ void DrmRenderer::enterOverlayCompositionMode()
         }
     }
 
+    // Our saved overlay contents no longer match what's on screen
+    for (int i = 0; i < Overlay::OverlayMax; i++) {
+        releaseOverlayContents((Overlay::OverlayType)i);
+    }
+
     struct drm_mode_create_dumb createBuf = {};
     uint32_t fbId;
     void* mapping = nullptr;
@@ -1469,6 +1485,25 @@ void DrmRenderer::blitOverlayToCompositionSurface(Overlay::OverlayType type, SDL
                              newSurface->format->format, newSurface->pixels, newSurface->pitch,
                              newSurface->format->format, newSurface->pixels, newSurface->pitch);
 
+        // If the overlay hasn't moved or changed size, just redraw the lines that changed
+        if (SDL_RectEquals(overlayRect, &m_OverlayRects[type])) {
+            SDL_Rect dirtyRects[Overlay::OverlayManager::k_MaxDirtyRects];
+            int dirtyRectCount = Overlay::OverlayManager::getDirtyRects(m_OverlaySurfaces[type], newSurface,
+                                                                        dirtyRects, SDL_arraysize(dirtyRects));
+            if (dirtyRectCount >= 0) {
+                for (int i = 0; i < dirtyRectCount; i++) {
+                    SDL_Rect dstRect = dirtyRects[i];
+                    dstRect.x += overlayRect->x;
+                    dstRect.y += overlayRect->y;
+
+                    SDL_BlitSurface(newSurface, &dirtyRects[i], m_OverlayCompositionSurface, &dstRect);
+                    m_PropSetter.damagePlane(m_OverlayPlanes[0], dstRect);
+                }
+
+                return;
+            }
+        }
+
         // Compute the union of the current and previous overlay rects. Our draw operation
         // will need to cover this entire area to ensure the old dirty area is covered.
         SDL_Rect overlayUnionRect;
@@ -1530,6 +1565,55 @@ void DrmRenderer::blitOverlayToCompositionSurface(Overlay::OverlayType type, SDL
     }
 }
 
+bool DrmRenderer::updateOverlayPlaneDirtyRects(Overlay::OverlayType type, SDL_Surface* newSurface)
+{
+    OverlayMapping& mapping = m_OverlayMappings[type];
+
+    if (mapping.pixels == nullptr) {
+        return false;
+    }
+
+    SDL_Rect dirtyRects[Overlay::OverlayManager::k_MaxDirtyRects];
+    int dirtyRectCount = Overlay::OverlayManager::getDirtyRects(m_OverlaySurfaces[type], newSurface,
+                                                                dirtyRects, SDL_arraysize(dirtyRects));
+    if (dirtyRectCount < 0) {
+        return false;
+    }
+
+    // Draw the changed regions directly into the dumb buffer being scanned out.
+    // This is the same approach we take for the composition surface, and it's far
+    // cheaper than allocating, filling, and flipping a whole new buffer.
+    for (int i = 0; i < dirtyRectCount; i++) {
+        const SDL_Rect& rect = dirtyRects[i];
+
+        SDL_PremultiplyAlpha(rect.w, rect.h, newSurface->format->format,
+                             (uint8_t*)newSurface->pixels + (rect.y * newSurface->pitch) + (rect.x * newSurface->format->BytesPerPixel),
+                             newSurface->pitch,
+                             SDL_PIXELFORMAT_ARGB8888,
+                             (uint8_t*)mapping.pixels + (rect.y * mapping.pitch) + (rect.x * 4),
+                             mapping.pitch);
+
+        // Dirty the modified portion of the plane
+        m_PropSetter.damagePlane(m_OverlayPlanes[type], rect);
+    }
+
+    return true;
+}
+
+void DrmRenderer::releaseOverlayContents(Overlay::OverlayType type)
+{
+    if (m_OverlaySurfaces[type] != nullptr) {
+        SDL_FreeSurface(m_OverlaySurfaces[type]);
+        m_OverlaySurfaces[type] = nullptr;
+    }
+
+    // NB: The buffer itself is owned by the plane and freed when it is flipped away
+    if (m_OverlayMappings[type].pixels != nullptr) {
+        munmap(m_OverlayMappings[type].pixels, m_OverlayMappings[type].size);
+        SDL_zero(m_OverlayMappings[type]);
+    }
+}
+
 void DrmRenderer::notifyOverlayUpdated(Overlay::OverlayType type)
 {
     std::lock_guard lg { m_OverlayLock };
@@ -1557,6 +1641,7 @@ void DrmRenderer::notifyOverlayUpdated(Overlay::OverlayType type)
             memset(&m_OverlayRects[type], 0, sizeof(m_OverlayRects[type]));
         }
 
+        releaseOverlayContents(type);
         return;
     }
 
@@ -1582,11 +1667,24 @@ void DrmRenderer::notifyOverlayUpdated(Overlay::OverlayType type)
 
         // Try to let the display controller composite for us
         if (!m_OverlayCompositionSurface) {
-            if (!uploadSurfaceToFb(newSurface, &dumbBuffer, &fbId)) {
+            // If the overlay is unchanged in size, update the existing buffer in place
+            if (SDL_RectEquals(&overlayRect, &m_OverlayRects[type]) &&
+                    updateOverlayPlaneDirtyRects(type, newSurface)) {
+                SDL_FreeSurface(m_OverlaySurfaces[type]);
+                m_OverlaySurfaces[type] = newSurface;
+                return;
+            }
+
+            OverlayMapping newMapping;
+            if (!uploadSurfaceToFb(newSurface, &dumbBuffer, &fbId, &newMapping)) {
                 SDL_FreeSurface(newSurface);
                 return;
             }
 
+            // The old buffer will be freed by the flip below
+            releaseOverlayContents(type);
+            m_OverlayMappings[type] = newMapping;
+
             // If we changed our overlay rect, we need to reconfigure the plane
             if (memcmp(&m_OverlayRects[type], &overlayRect, sizeof(overlayRect)) != 0) {
                 if (m_PropSetter.testPlane(m_OverlayPlanes[type], m_Crtc.objectId(), fbId,
@@ -1628,7 +1726,9 @@ void DrmRenderer::notifyOverlayUpdated(Overlay::OverlayType type)
 
         memcpy(&m_OverlayRects[type], &overlayRect, sizeof(overlayRect));
 
-        SDL_FreeSurface(newSurface);
+        // Keep this surface around to find the dirty regions in the next update
+        SDL_FreeSurface(m_OverlaySurfaces[type]);
+        m_OverlaySurfaces[type] = newSurface;
     }
 }
 
@@ -784,7 +784,14 @@ private:
     const char* getDrmColorRangeValue(AVFrame* frame);
     bool mapSoftwareFrame(AVFrame* frame, AVDRMFrameDescriptor* mappedFrame);
     bool addFbForFrame(AVFrame* frame, uint32_t* newFbId, bool testMode);
-    bool uploadSurfaceToFb(SDL_Surface *surface, uint32_t* handle, uint32_t* fbId);
+    struct OverlayMapping {
+        void* pixels;
+        size_t size;
+        uint32_t pitch;
+    };
+    bool uploadSurfaceToFb(SDL_Surface *surface, uint32_t* handle, uint32_t* fbId, OverlayMapping* mapping);
+    bool updateOverlayPlaneDirtyRects(Overlay::OverlayType type, SDL_Surface* newSurface);
+    void releaseOverlayContents(Overlay::OverlayType type);
     bool mapDumbBuffer(uint32_t handle, size_t size, void** mapping);
     bool createFbForDumbBuffer(struct drm_mode_create_dumb* createBuf, uint32_t* fbId);
     void enterOverlayCompositionMode();
@@ -815,6 +822,12 @@ private:
     SDL_Surface* m_OverlayCompositionSurface;
     std::mutex m_OverlayLock;
     SDL_Rect m_OverlayRects[Overlay::OverlayMax];
+
+    // The last surface drawn for each overlay and, when each overlay has its
+    // own plane, a mapping of the dumb buffer being scanned out. These let us
+    // redraw only the lines of text that changed in the next update.
+    SDL_Surface* m_OverlaySurfaces[Overlay::OverlayMax];
+    OverlayMapping m_OverlayMappings[Overlay::OverlayMax];
     drmVersionPtr m_Version;
     uint32_t m_HdrOutputMetadataBlobId;
     SDL_Rect m_OutputRect;
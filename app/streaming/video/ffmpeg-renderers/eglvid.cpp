@@ -18,6 +18,38 @@
 #define GL_UNPACK_ROW_LENGTH_EXT 0x0CF2
 #endif
 
+// These are core in OpenGL ES 3.0, but we build against the GLES 2.0 headers
+#ifndef GL_PIXEL_UNPACK_BUFFER
+#define GL_PIXEL_UNPACK_BUFFER 0x88EC
+#endif
+#ifndef GL_RED
+#define GL_RED 0x1903
+#endif
+#ifndef GL_RG
+#define GL_RG 0x8227
+#endif
+#ifndef GL_R8
+#define GL_R8 0x8229
+#endif
+#ifndef GL_RG8
+#define GL_RG8 0x822B
+#endif
+#ifndef GL_MAP_WRITE_BIT
+#define GL_MAP_WRITE_BIT 0x0002
+#endif
+#ifndef GL_MAP_INVALIDATE_BUFFER_BIT
+#define GL_MAP_INVALIDATE_BUFFER_BIT 0x0008
+#endif
+#ifndef GL_MAP_UNSYNCHRONIZED_BIT
+#define GL_MAP_UNSYNCHRONIZED_BIT 0x0020
+#endif
+#ifndef GL_MAP_PERSISTENT_BIT_EXT
+#define GL_MAP_PERSISTENT_BIT_EXT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT_EXT
+#define GL_MAP_COHERENT_BIT_EXT 0x0080
+#endif
+
 typedef struct _VERTEX
 {
     float x, y;
@@ -26,7 +58,6 @@ typedef struct _VERTEX
 
 /* TODO:
  *  - handle more pixel formats
- *  - handle software decoding
  */
 
 /* DOC/misc:
@@ -75,10 +106,21 @@ EGLRenderer::EGLRenderer(IFFmpegRenderer *backendRenderer)
         m_eglClientWaitSync(nullptr),
         m_GlesMajorVersion(0),
         m_GlesMinorVersion(0),
-        m_HasExtUnpackSubimage(false)
+        m_HasExtUnpackSubimage(false),
+        m_SwFrames(backendRenderer == nullptr),
+        m_SwFramePersistentMapping(false),
+        m_SwFrameFenced(false),
+        m_SwFrameSlots{},
+        m_SwFrameSlotIndex(0),
+        m_SwFramePlanes{},
+        m_SwFramePlaneCount(0),
+        m_SwFrameBufferSize(0),
+        m_SwFrameFormat(AV_PIX_FMT_NONE),
+        m_glMapBufferRange(nullptr),
+        m_glUnmapBuffer(nullptr),
+        m_glBufferStorageEXT(nullptr)
 {
-    SDL_assert(backendRenderer);
-    SDL_assert(backendRenderer->canExportEGL());
+    SDL_assert(!backendRenderer || backendRenderer->canExportEGL());
 }
 
 EGLRenderer::~EGLRenderer()
@@ -90,6 +132,7 @@ EGLRenderer::~EGLRenderer()
             SDL_assert(m_eglDestroySync != nullptr);
             m_eglDestroySync(m_EGLDisplay, m_LastRenderSync);
         }
+        destroySwFrameRing();
         if (m_ShaderProgram) {
             glDeleteProgram(m_ShaderProgram);
         }
@@ -142,12 +185,34 @@ bool EGLRenderer::notifyWindowChanged(PWINDOW_STATE_CHANGE_INFO info)
 
 bool EGLRenderer::isPixelFormatSupported(int videoFormat, AVPixelFormat pixelFormat)
 {
+    if (m_SwFrames) {
+        // We can only upload 8-bit 4:2:0 software frames
+        if (videoFormat & (VIDEO_FORMAT_MASK_10BIT | VIDEO_FORMAT_MASK_YUV444)) {
+            return false;
+        }
+
+        // Remember to keep this in sync with EGLRenderer::setupSwFrameRing()!
+        switch (pixelFormat) {
+        case AV_PIX_FMT_YUV420P:
+        case AV_PIX_FMT_YUVJ420P:
+        case AV_PIX_FMT_NV12:
+            return true;
+
+        default:
+            return false;
+        }
+    }
+
     // Pixel format support should be determined by the backend renderer
     return m_Backend->isPixelFormatSupported(videoFormat, pixelFormat);
 }
 
 AVPixelFormat EGLRenderer::getPreferredPixelFormat(int videoFormat)
 {
+    if (m_SwFrames) {
+        return IFFmpegRenderer::getPreferredPixelFormat(videoFormat);
+    }
+
     // Pixel format preference should be determined by the backend renderer
     return m_Backend->getPreferredPixelFormat(videoFormat);
 }
@@ -267,7 +332,8 @@ void EGLRenderer::renderOverlay(Overlay::OverlayType type, int viewportWidth, in
 }
 
 int EGLRenderer::loadAndBuildShader(int shaderType,
-                                    const char *file) {
+                                    const char *file,
+                                    const char *defines) {
     GLuint shader = glCreateShader(shaderType);
     if (!shader || shader == GL_INVALID_ENUM) {
         EGL_LOG(Error, "Can't create shader: %d", glGetError());
@@ -275,10 +341,11 @@ int EGLRenderer::loadAndBuildShader(int shaderType,
     }
 
     auto sourceData = Path::readDataFile(file);
-    GLint len = sourceData.size();
-    const char *buf = sourceData.data();
+    const char *bufs[] = { defines, sourceData.data() };
+    GLint lens[] = { (GLint)strlen(defines), (GLint)sourceData.size() };
 
-    glShaderSource(shader, 1, &buf, &len);
+    // The defines are prepended to select variants of a shader
+    glShaderSource(shader, 2, bufs, lens);
     glCompileShader(shader);
     GLint status;
     glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
@@ -292,14 +359,14 @@ int EGLRenderer::loadAndBuildShader(int shaderType,
     return shader;
 }
 
-unsigned EGLRenderer::compileShader(const char* vertexShaderSrc, const char* fragmentShaderSrc) {
+unsigned EGLRenderer::compileShader(const char* vertexShaderSrc, const char* fragmentShaderSrc, const char* fragmentShaderDefines) {
     unsigned shader = 0;
 
-    GLuint vertexShader = loadAndBuildShader(GL_VERTEX_SHADER, vertexShaderSrc);
+    GLuint vertexShader = loadAndBuildShader(GL_VERTEX_SHADER, vertexShaderSrc, "");
     if (!vertexShader)
         return false;
 
-    GLuint fragmentShader = loadAndBuildShader(GL_FRAGMENT_SHADER, fragmentShaderSrc);
+    GLuint fragmentShader = loadAndBuildShader(GL_FRAGMENT_SHADER, fragmentShaderSrc, fragmentShaderDefines);
     if (!fragmentShader)
         goto fragError;
 
@@ -342,8 +409,18 @@ bool EGLRenderer::compileShaders() {
     SDL_assert(m_EGLImagePixelFormat != AV_PIX_FMT_NONE);
 
     // XXX: TODO: other formats
-    if (m_EGLImagePixelFormat == AV_PIX_FMT_NV12 || m_EGLImagePixelFormat == AV_PIX_FMT_P010) {
-        m_ShaderProgram = compileShader("egl.vert", "egl_nv12.frag");
+    if (m_EGLImagePixelFormat == AV_PIX_FMT_NV12 || m_EGLImagePixelFormat == AV_PIX_FMT_P010 ||
+            (m_SwFrames && (m_EGLImagePixelFormat == AV_PIX_FMT_YUV420P || m_EGLImagePixelFormat == AV_PIX_FMT_YUVJ420P))) {
+        const char* defines = "";
+        if (m_SwFrames) {
+            // Software frames are uploaded into regular 2D textures, with
+            // a separate texture per chroma plane for 3-plane formats.
+            defines = (m_EGLImagePixelFormat == AV_PIX_FMT_NV12) ?
+                          "#define SW_FRAME_TEXTURES\n" :
+                          "#define SW_FRAME_TEXTURES\n#define SW_FRAME_PLANAR_CHROMA\n";
+        }
+
+        m_ShaderProgram = compileShader("egl.vert", "egl_nv12.frag", defines);
         if (!m_ShaderProgram) {
             return false;
         }
@@ -353,11 +430,15 @@ bool EGLRenderer::compileShaders() {
         m_ShaderProgramParams[NV12_PARAM_CHROMA_OFFSET] = glGetUniformLocation(m_ShaderProgram, "chromaOffset");
         m_ShaderProgramParams[NV12_PARAM_PLANE1] = glGetUniformLocation(m_ShaderProgram, "plane1");
         m_ShaderProgramParams[NV12_PARAM_PLANE2] = glGetUniformLocation(m_ShaderProgram, "plane2");
+        m_ShaderProgramParams[NV12_PARAM_PLANE3] = glGetUniformLocation(m_ShaderProgram, "plane3");
 
         // Set up constant uniforms
         glUseProgram(m_ShaderProgram);
         glUniform1i(m_ShaderProgramParams[NV12_PARAM_PLANE1], 0);
         glUniform1i(m_ShaderProgramParams[NV12_PARAM_PLANE2], 1);
+        if (m_ShaderProgramParams[NV12_PARAM_PLANE3] >= 0) {
+            glUniform1i(m_ShaderProgramParams[NV12_PARAM_PLANE3], 2);
+        }
         glUseProgram(0);
     }
     else if (m_EGLImagePixelFormat == AV_PIX_FMT_DRM_PRIME) {
@@ -422,6 +503,13 @@ bool EGLRenderer::initialize(PDECODER_PARAMETERS params)
         return false;
     }
 
+    // Don't create a context for test-only software renderers. Like
+    // SdlRenderer, they might be created on a non-main thread where
+    // interaction with the window is unsafe.
+    if (m_SwFrames && params->testOnly) {
+        return true;
+    }
+
     int renderIndex;
     int maxRenderers = SDL_GetNumRenderDrivers();
     SDL_assert(maxRenderers >= 0);
@@ -513,23 +601,27 @@ bool EGLRenderer::initialize(PDECODER_PARAMETERS params)
     }
 
     const EGLExtensions eglExtensions(m_EGLDisplay);
-    if (!eglExtensions.isSupported("EGL_KHR_image_base") &&
-        !eglExtensions.isSupported("EGL_KHR_image")) {
-        EGL_LOG(Error, "EGL_KHR_image unsupported");
-        return false;
-    }
-    else if (!SDL_GL_ExtensionSupported("GL_OES_EGL_image")) {
-        EGL_LOG(Error, "GL_OES_EGL_image unsupported");
-        return false;
-    }
 
-    if (!m_Backend->initializeEGL(m_EGLDisplay, eglExtensions))
-        return false;
+    // Software frames are uploaded by us rather than imported as EGLImages
+    if (!m_SwFrames) {
+        if (!eglExtensions.isSupported("EGL_KHR_image_base") &&
+            !eglExtensions.isSupported("EGL_KHR_image")) {
+            EGL_LOG(Error, "EGL_KHR_image unsupported");
+            return false;
+        }
+        else if (!SDL_GL_ExtensionSupported("GL_OES_EGL_image")) {
+            EGL_LOG(Error, "GL_OES_EGL_image unsupported");
+            return false;
+        }
 
-    if (!(m_glEGLImageTargetTexture2DOES = (typeof(m_glEGLImageTargetTexture2DOES))eglGetProcAddress("glEGLImageTargetTexture2DOES"))) {
-        EGL_LOG(Error,
-                "EGL: cannot retrieve `glEGLImageTargetTexture2DOES` address");
-        return false;
+        if (!m_Backend->initializeEGL(m_EGLDisplay, eglExtensions))
+            return false;
+
+        if (!(m_glEGLImageTargetTexture2DOES = (typeof(m_glEGLImageTargetTexture2DOES))eglGetProcAddress("glEGLImageTargetTexture2DOES"))) {
+            EGL_LOG(Error,
+                    "EGL: cannot retrieve `glEGLImageTargetTexture2DOES` address");
+            return false;
+        }
     }
 
     // Vertex arrays are an extension on OpenGL ES 2.0
@@ -574,6 +666,10 @@ bool EGLRenderer::initialize(PDECODER_PARAMETERS params)
         m_eglClientWaitSync = nullptr;
     }
 
+    if (m_SwFrames && !initializeSwFrameUpload()) {
+        return false;
+    }
+
     // SDL always uses swap interval 0 under the hood on Wayland systems,
     // because the compositor guarantees tear-free rendering. In this
     // situation, swap interval > 0 behaves as a frame pacing option
@@ -623,14 +719,17 @@ bool EGLRenderer::initialize(PDECODER_PARAMETERS params)
 }
 
 bool EGLRenderer::setupVideoRenderingState() {
-    // Setup the video plane textures
-    glGenTextures(EGL_MAX_PLANES, m_Textures);
-    for (size_t i = 0; i < EGL_MAX_PLANES; ++i) {
-        glBindTexture(GL_TEXTURE_EXTERNAL_OES, m_Textures[i]);
-        glTexParameteri(GL_TEXTURE_EXTERNAL_OES, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_EXTERNAL_OES, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_EXTERNAL_OES, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_EXTERNAL_OES, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    // Setup the video plane textures. Software frames use the ring
+    // textures created in setupSwFrameRing() instead.
+    if (!m_SwFrames) {
+        glGenTextures(EGL_MAX_PLANES, m_Textures);
+        for (size_t i = 0; i < EGL_MAX_PLANES; ++i) {
+            glBindTexture(GL_TEXTURE_EXTERNAL_OES, m_Textures[i]);
+            glTexParameteri(GL_TEXTURE_EXTERNAL_OES, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_EXTERNAL_OES, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_EXTERNAL_OES, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_EXTERNAL_OES, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        }
     }
 
     // The viewport should have the aspect ratio of the video stream
@@ -712,6 +811,242 @@ bool EGLRenderer::setupOverlayRenderingState() {
     return err == GL_NO_ERROR;
 }
 
+bool EGLRenderer::initializeSwFrameUpload()
+{
+    // PBOs and single/dual channel textures require OpenGL ES 3.0. SDL only
+    // tells us the version we requested, so check what we actually got.
+    int major = 0, minor = 0;
+    const char* versionString = (const char*)glGetString(GL_VERSION);
+    if (versionString == nullptr ||
+            sscanf(versionString, "OpenGL ES %d.%d", &major, &minor) != 2 ||
+            major < 3) {
+        EGL_LOG(Warn, "Software frame rendering requires OpenGL ES 3.0 (context: %s)",
+                versionString != nullptr ? versionString : "unknown");
+        return false;
+    }
+
+    m_glMapBufferRange = (typeof(m_glMapBufferRange))eglGetProcAddress("glMapBufferRange");
+    m_glUnmapBuffer = (typeof(m_glUnmapBuffer))eglGetProcAddress("glUnmapBuffer");
+    if (!m_glMapBufferRange || !m_glUnmapBuffer) {
+        EGL_LOG(Error, "Failed to find buffer mapping functions");
+        return false;
+    }
+
+    // GL_EXT_buffer_storage allows our PBOs to stay mapped for their entire
+    // lifetime, so we don't need to map and unmap them for each frame.
+    if (SDL_GL_ExtensionSupported("GL_EXT_buffer_storage")) {
+        m_glBufferStorageEXT = (typeof(m_glBufferStorageEXT))eglGetProcAddress("glBufferStorageEXT");
+    }
+
+    // Without fences we have no way to know when the GPU is done reading a PBO,
+    // so we must let the driver synchronize our writes for us. That rules out
+    // both persistent mappings and unsynchronized transient mappings.
+    m_SwFrameFenced = (m_eglCreateSync || m_eglCreateSyncKHR) && m_eglClientWaitSync && m_eglDestroySync;
+    if (!m_SwFrameFenced) {
+        EGL_LOG(Warn, "EGL sync objects are unavailable, so PBO uploads will be synchronized by the driver");
+    }
+
+    m_SwFramePersistentMapping = m_glBufferStorageEXT != nullptr && m_SwFrameFenced;
+
+    EGL_LOG(Info, "Uploading software frames via %s PBOs",
+            m_SwFramePersistentMapping ? "persistently mapped" : "transiently mapped");
+    return true;
+}
+
+bool EGLRenderer::setupSwFrameRing(AVFrame* frame)
+{
+    const AVPixFmtDescriptor* formatDesc = av_pix_fmt_desc_get((AVPixelFormat)frame->format);
+    if (!formatDesc) {
+        SDL_assert(formatDesc);
+        return false;
+    }
+
+    destroySwFrameRing();
+
+    m_SwFramePlaneCount = av_pix_fmt_count_planes((AVPixelFormat)frame->format);
+    SDL_assert(m_SwFramePlaneCount >= 2 && m_SwFramePlaneCount <= SW_FRAME_MAX_PLANES);
+
+    // Each ring buffer contains all planes back to back. We copy the planes with
+    // the decoder's pitch and let GL_UNPACK_ROW_LENGTH skip the padding.
+    m_SwFrameBufferSize = 0;
+    for (int i = 0; i < m_SwFramePlaneCount; i++) {
+        SwFramePlane& plane = m_SwFramePlanes[i];
+
+        if (frame->linesize[i] <= 0) {
+            EGL_LOG(Error, "Unsupported software frame pitch: %d", frame->linesize[i]);
+            return false;
+        }
+
+        plane.width = i == 0 ? frame->width : AV_CEIL_RSHIFT(frame->width, formatDesc->log2_chroma_w);
+        plane.height = i == 0 ? frame->height : AV_CEIL_RSHIFT(frame->height, formatDesc->log2_chroma_h);
+        plane.linesize = frame->linesize[i];
+        plane.offset = m_SwFrameBufferSize;
+
+        // NV12 interleaves both chroma components in the second plane
+        plane.bytesPerPixel = (i == 1 && m_SwFramePlaneCount == 2) ? 2 : 1;
+
+        m_SwFrameBufferSize += FFALIGN(plane.linesize * plane.height, 64);
+    }
+
+    for (int i = 0; i < SW_FRAME_RING_SIZE; i++) {
+        SwFrameSlot& slot = m_SwFrameSlots[i];
+
+        glGenTextures(m_SwFramePlaneCount, slot.textures);
+        for (int j = 0; j < m_SwFramePlaneCount; j++) {
+            const SwFramePlane& plane = m_SwFramePlanes[j];
+
+            glBindTexture(GL_TEXTURE_2D, slot.textures[j]);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glTexImage2D(GL_TEXTURE_2D, 0,
+                         plane.bytesPerPixel == 2 ? GL_RG8 : GL_R8,
+                         plane.width, plane.height, 0,
+                         plane.bytesPerPixel == 2 ? GL_RG : GL_RED,
+                         GL_UNSIGNED_BYTE, nullptr);
+        }
+
+        glGenBuffers(1, &slot.pbo);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.pbo);
+        if (m_SwFramePersistentMapping) {
+            m_glBufferStorageEXT(GL_PIXEL_UNPACK_BUFFER, m_SwFrameBufferSize, nullptr,
+                                 GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT_EXT | GL_MAP_COHERENT_BIT_EXT);
+            slot.mapping = m_glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, m_SwFrameBufferSize,
+                                              GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT_EXT | GL_MAP_COHERENT_BIT_EXT);
+            if (slot.mapping == nullptr) {
+                EGL_LOG(Error, "Failed to persistently map PBO: %d", glGetError());
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+                return false;
+            }
+        }
+        else {
+            glBufferData(GL_PIXEL_UNPACK_BUFFER, m_SwFrameBufferSize, nullptr, GL_STREAM_DRAW);
+        }
+    }
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    GLenum err = glGetError();
+    if (err != GL_NO_ERROR) {
+        EGL_LOG(Error, "OpenGL error: %d", err);
+        return false;
+    }
+
+    m_SwFrameFormat = (AVPixelFormat)frame->format;
+    m_SwFrameSlotIndex = 0;
+    return true;
+}
+
+void EGLRenderer::destroySwFrameRing()
+{
+    for (int i = 0; i < SW_FRAME_RING_SIZE; i++) {
+        SwFrameSlot& slot = m_SwFrameSlots[i];
+
+        if (slot.renderSync != EGL_NO_SYNC) {
+            SDL_assert(m_eglDestroySync != nullptr);
+            m_eglDestroySync(m_EGLDisplay, slot.renderSync);
+        }
+        if (slot.pbo) {
+            if (slot.mapping != nullptr) {
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.pbo);
+                m_glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            }
+            glDeleteBuffers(1, &slot.pbo);
+        }
+        glDeleteTextures(SW_FRAME_MAX_PLANES, slot.textures);
+
+        slot = {};
+    }
+
+    m_SwFramePlaneCount = 0;
+    m_SwFrameBufferSize = 0;
+    m_SwFrameFormat = AV_PIX_FMT_NONE;
+}
+
+bool EGLRenderer::uploadSwFrame(AVFrame* frame)
+{
+    // The ring must be rebuilt if the frame layout changes
+    bool layoutChanged = frame->format != m_SwFrameFormat ||
+                         frame->width != m_SwFramePlanes[0].width ||
+                         frame->height != m_SwFramePlanes[0].height;
+    for (int i = 0; i < m_SwFramePlaneCount && !layoutChanged; i++) {
+        layoutChanged = frame->linesize[i] != m_SwFramePlanes[i].linesize;
+    }
+    if (layoutChanged && !setupSwFrameRing(frame)) {
+        destroySwFrameRing();
+        return false;
+    }
+
+    SwFrameSlot& slot = m_SwFrameSlots[m_SwFrameSlotIndex];
+
+    // Wait for the GPU to finish drawing the last frame that used this slot.
+    // With a ring of several slots, this fence has almost always signalled.
+    if (slot.renderSync != EGL_NO_SYNC) {
+        SDL_assert(m_eglClientWaitSync != nullptr);
+        m_eglClientWaitSync(m_EGLDisplay, slot.renderSync, EGL_SYNC_FLUSH_COMMANDS_BIT, EGL_FOREVER);
+        m_eglDestroySync(m_EGLDisplay, slot.renderSync);
+        slot.renderSync = EGL_NO_SYNC;
+    }
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.pbo);
+
+    uint8_t* mapping = (uint8_t*)slot.mapping;
+    if (!m_SwFramePersistentMapping) {
+        // If our fence already synchronized with the GPU, don't let the driver do it again
+        GLbitfield access = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT;
+        if (m_SwFrameFenced) {
+            access |= GL_MAP_UNSYNCHRONIZED_BIT;
+        }
+        mapping = (uint8_t*)m_glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, m_SwFrameBufferSize, access);
+        if (mapping == nullptr) {
+            EGL_LOG(Error, "Failed to map PBO: %d", glGetError());
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            return false;
+        }
+    }
+
+    for (int i = 0; i < m_SwFramePlaneCount; i++) {
+        const SwFramePlane& plane = m_SwFramePlanes[i];
+        memcpy(mapping + plane.offset, frame->data[i], plane.linesize * plane.height);
+    }
+
+    if (!m_SwFramePersistentMapping) {
+        m_glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    }
+
+    // These uploads are asynchronous DMAs from the PBO, so we don't block here
+    for (int i = 0; i < m_SwFramePlaneCount; i++) {
+        const SwFramePlane& plane = m_SwFramePlanes[i];
+
+        glActiveTexture(GL_TEXTURE0 + i);
+        glBindTexture(GL_TEXTURE_2D, slot.textures[i]);
+        glPixelStorei(GL_UNPACK_ROW_LENGTH_EXT, plane.linesize / plane.bytesPerPixel);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, plane.width, plane.height,
+                        plane.bytesPerPixel == 2 ? GL_RG : GL_RED,
+                        GL_UNSIGNED_BYTE, (const void*)(uintptr_t)plane.offset);
+    }
+
+    glPixelStorei(GL_UNPACK_ROW_LENGTH_EXT, 0);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    return true;
+}
+
+EGLSync EGLRenderer::createSync()
+{
+    if (m_eglCreateSync != nullptr) {
+        return m_eglCreateSync(m_EGLDisplay, EGL_SYNC_FENCE, nullptr);
+    }
+    else if (m_eglCreateSyncKHR != nullptr) {
+        return m_eglCreateSyncKHR(m_EGLDisplay, EGL_SYNC_FENCE, nullptr);
+    }
+    else {
+        return EGL_NO_SYNC;
+    }
+}
+
 void EGLRenderer::cleanupRenderContext()
 {
     // Detach the context from the render thread so the destructor can attach it
@@ -762,7 +1097,7 @@ void EGLRenderer::renderFrame(AVFrame* frame)
 
     // Find the native read-back format and load the shaders
     if (m_EGLImagePixelFormat == AV_PIX_FMT_NONE) {
-        m_EGLImagePixelFormat = m_Backend->getEGLImagePixelFormat();
+        m_EGLImagePixelFormat = m_SwFrames ? (AVPixelFormat)frame->format : m_Backend->getEGLImagePixelFormat();
         EGL_LOG(Info, "EGLImage pixel format: %d", m_EGLImagePixelFormat);
 
         SDL_assert(m_EGLImagePixelFormat != AV_PIX_FMT_NONE);
@@ -786,13 +1121,23 @@ void EGLRenderer::renderFrame(AVFrame* frame)
         }
     }
 
-    ssize_t plane_count = m_Backend->exportEGLImages(frame, m_EGLDisplay, imgs);
-    if (plane_count < 0)
-        return;
-    for (ssize_t i = 0; i < plane_count; ++i) {
-        glActiveTexture(GL_TEXTURE0 + i);
-        glBindTexture(GL_TEXTURE_EXTERNAL_OES, m_Textures[i]);
-        m_glEGLImageTargetTexture2DOES(GL_TEXTURE_EXTERNAL_OES, imgs[i]);
+    if (m_SwFrames) {
+        SDL_assert(frame->hw_frames_ctx == nullptr);
+        SDL_assert(frame->format == m_EGLImagePixelFormat);
+
+        if (!uploadSwFrame(frame)) {
+            return;
+        }
+    }
+    else {
+        ssize_t plane_count = m_Backend->exportEGLImages(frame, m_EGLDisplay, imgs);
+        if (plane_count < 0)
+            return;
+        for (ssize_t i = 0; i < plane_count; ++i) {
+            glActiveTexture(GL_TEXTURE0 + i);
+            glBindTexture(GL_TEXTURE_EXTERNAL_OES, m_Textures[i]);
+            m_glEGLImageTargetTexture2DOES(GL_TEXTURE_EXTERNAL_OES, imgs[i]);
+        }
     }
 
     // We already called glClear() after last frame's SDL_GL_SwapWindow()
@@ -817,7 +1162,7 @@ void EGLRenderer::renderFrame(AVFrame* frame)
     glUseProgram(m_ShaderProgram);
 
     // If the frame format has changed, we'll need to recompute the constants
-    if (hasFrameFormatChanged(frame) && (m_EGLImagePixelFormat == AV_PIX_FMT_NV12 || m_EGLImagePixelFormat == AV_PIX_FMT_P010)) {
+    if (hasFrameFormatChanged(frame) && (m_SwFrames || m_EGLImagePixelFormat == AV_PIX_FMT_NV12 || m_EGLImagePixelFormat == AV_PIX_FMT_P010)) {
         std::array<float, 9> colorMatrix;
         std::array<float, 3> yuvOffsets;
         std::array<float, 2> chromaOffset;
@@ -837,19 +1182,29 @@ void EGLRenderer::renderFrame(AVFrame* frame)
     glDrawArrays(GL_TRIANGLES, 0, 6);
     m_glBindVertexArrayOES(0);
 
+    if (m_SwFrames) {
+        // Fence this slot so the next upload into it waits for this draw,
+        // then move on to the next slot for the next frame.
+        SDL_assert(m_SwFrameSlots[m_SwFrameSlotIndex].renderSync == EGL_NO_SYNC);
+        if (m_SwFrameFenced) {
+            m_SwFrameSlots[m_SwFrameSlotIndex].renderSync = createSync();
+            if (m_SwFrameSlots[m_SwFrameSlotIndex].renderSync == EGL_NO_SYNC) {
+                // We can't leave this slot unguarded since we write it without
+                // the driver's help, so wait for the draw to finish right here.
+                EGL_LOG(Warn, "Failed to create PBO fence: %d", eglGetError());
+                glFinish();
+            }
+        }
+        m_SwFrameSlotIndex = (m_SwFrameSlotIndex + 1) % SW_FRAME_RING_SIZE;
+    }
+
     if (!m_BlockingSwapBuffers) {
         // If we aren't going to wait on the full swap buffers operation,
         // insert a fence now to let us know when the memory backing our
         // video frame is safe for Pacer to free
         if (m_eglClientWaitSync != nullptr) {
             SDL_assert(m_LastRenderSync == EGL_NO_SYNC);
-            if (m_eglCreateSync != nullptr) {
-                m_LastRenderSync = m_eglCreateSync(m_EGLDisplay, EGL_SYNC_FENCE, nullptr);
-            }
-            else {
-                SDL_assert(m_eglCreateSyncKHR != nullptr);
-                m_LastRenderSync = m_eglCreateSyncKHR(m_EGLDisplay, EGL_SYNC_FENCE, nullptr);
-            }
+            m_LastRenderSync = createSync();
         }
     }
 
@@ -867,13 +1222,7 @@ void EGLRenderer::renderFrame(AVFrame* frame)
         glClear(GL_COLOR_BUFFER_BIT);
         if (m_eglClientWaitSync != nullptr) {
             SDL_assert(m_LastRenderSync == EGL_NO_SYNC);
-            if (m_eglCreateSync != nullptr) {
-                m_LastRenderSync = m_eglCreateSync(m_EGLDisplay, EGL_SYNC_FENCE, nullptr);
-            }
-            else {
-                SDL_assert(m_eglCreateSyncKHR != nullptr);
-                m_LastRenderSync = m_eglCreateSyncKHR(m_EGLDisplay, EGL_SYNC_FENCE, nullptr);
-            }
+            m_LastRenderSync = createSync();
         }
     }
 }
@@ -882,6 +1231,22 @@ bool EGLRenderer::testRenderFrame(AVFrame* frame)
 {
     EGLImage imgs[EGL_MAX_PLANES];
 
+    // Software frames just need to be in a format we can upload
+    if (m_SwFrames) {
+        switch (frame->format) {
+        case AV_PIX_FMT_YUV420P:
+        case AV_PIX_FMT_YUVJ420P:
+        case AV_PIX_FMT_NV12:
+            return frame->hw_frames_ctx == nullptr;
+
+        default:
+            SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION,
+                        "Unsupported software frame format for EGL: %d",
+                        frame->format);
+            return false;
+        }
+    }
+
     // Make sure we can get working EGLImages from the backend renderer.
     // Some devices (Raspberry Pi) will happily decode into DRM formats that
     // its own GL implementation won't accept in eglCreateImage().
@@ -8,7 +8,8 @@
 
 class EGLRenderer : public IFFmpegRenderer {
 public:
-    EGLRenderer(IFFmpegRenderer *backendRenderer);
+    // A null backend renderer selects software frame rendering
+    EGLRenderer(IFFmpegRenderer *backendRenderer = nullptr);
     virtual ~EGLRenderer() override;
     virtual bool initialize(PDECODER_PARAMETERS params) override;
     virtual bool prepareDecoderContext(AVCodecContext* context, AVDictionary** options) override;
@@ -25,11 +26,16 @@ public:
 private:
 
     void renderOverlay(Overlay::OverlayType type, int viewportWidth, int viewportHeight);
-    unsigned compileShader(const char* vertexShaderSrc, const char* fragmentShaderSrc);
+    unsigned compileShader(const char* vertexShaderSrc, const char* fragmentShaderSrc, const char* fragmentShaderDefines = "");
     bool compileShaders();
     bool setupVideoRenderingState();
     bool setupOverlayRenderingState();
-    static int loadAndBuildShader(int shaderType, const char *filename);
+    static int loadAndBuildShader(int shaderType, const char *filename, const char *defines);
+    EGLSync createSync();
+    bool initializeSwFrameUpload();
+    bool setupSwFrameRing(AVFrame* frame);
+    void destroySwFrameRing();
+    bool uploadSwFrame(AVFrame* frame);
 
     AVPixelFormat m_EGLImagePixelFormat;
     void *m_EGLDisplay;
@@ -58,13 +64,44 @@ private:
     int m_GlesMinorVersion;
     bool m_HasExtUnpackSubimage;
 
+    // Software frames are streamed through a ring of PBOs so the CPU copy
+    // of the next frame can overlap the GPU's upload and draw of the last.
+#define SW_FRAME_RING_SIZE 3
+#define SW_FRAME_MAX_PLANES 3
+    struct SwFrameSlot {
+        unsigned pbo;
+        void* mapping;
+        unsigned textures[SW_FRAME_MAX_PLANES];
+        EGLSync renderSync;
+    };
+    struct SwFramePlane {
+        int offset;
+        int linesize;
+        int width;
+        int height;
+        int bytesPerPixel;
+    };
+    bool m_SwFrames;
+    bool m_SwFramePersistentMapping;
+    bool m_SwFrameFenced;
+    SwFrameSlot m_SwFrameSlots[SW_FRAME_RING_SIZE];
+    int m_SwFrameSlotIndex;
+    SwFramePlane m_SwFramePlanes[SW_FRAME_MAX_PLANES];
+    int m_SwFramePlaneCount;
+    int m_SwFrameBufferSize;
+    AVPixelFormat m_SwFrameFormat;
+    PFNGLMAPBUFFERRANGEEXTPROC m_glMapBufferRange;
+    PFNGLUNMAPBUFFEROESPROC m_glUnmapBuffer;
+    PFNGLBUFFERSTORAGEEXTPROC m_glBufferStorageEXT;
+
 #define NV12_PARAM_YUVMAT 0
 #define NV12_PARAM_OFFSET 1
 #define NV12_PARAM_CHROMA_OFFSET 2
 #define NV12_PARAM_PLANE1 3
 #define NV12_PARAM_PLANE2 4
+#define NV12_PARAM_PLANE3 5
 #define OPAQUE_PARAM_TEXTURE 0
-    int m_ShaderProgramParams[5];
+    int m_ShaderProgramParams[6];
 
 #define OVERLAY_PARAM_TEXTURE 0
     int m_OverlayShaderProgramParams[1];
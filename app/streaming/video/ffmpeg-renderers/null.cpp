@@ -0,0 +1,118 @@
+#include "null.h"
+#include "utils.h"
+
+#include "streaming/session.h"
+
+NullRenderer::NullRenderer(IFFmpegRenderer *backendRenderer)
+    : IFFmpegRenderer(RendererType::Null),
+      m_BackendRenderer(backendRenderer),
+      m_SwFrameMapper(this),
+      m_ReadBackFrames(false),
+      m_ReadBackChecksum(0)
+{
+
+}
+
+NullRenderer::~NullRenderer()
+{
+    if (m_ReadBackFrames) {
+        // Logging this ensures the compiler can't elide the reads
+        SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+                    "Null renderer read-back checksum: %08x",
+                    m_ReadBackChecksum);
+    }
+}
+
+bool NullRenderer::initialize(PDECODER_PARAMETERS params)
+{
+    if (!Utils::getEnvironmentVariableOverride("NULL_RENDERER_READBACK", &m_ReadBackFrames)) {
+        m_ReadBackFrames = false;
+    }
+
+    SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+                "Null renderer is discarding all frames (read-back: %s). Set NULL_RENDERER_READBACK to override.",
+                m_ReadBackFrames ? "yes" : "no");
+
+    m_SwFrameMapper.setVideoFormat(params->videoFormat);
+    return true;
+}
+
+bool NullRenderer::prepareDecoderContext(AVCodecContext*, AVDictionary**)
+{
+    // Nothing to do. Any hardware context belongs to the backend renderer.
+    return true;
+}
+
+void NullRenderer::renderFrame(AVFrame* frame)
+{
+    if (!m_ReadBackFrames) {
+        return;
+    }
+
+    AVFrame* swFrame;
+    if (frame->hw_frames_ctx != nullptr) {
+        swFrame = m_SwFrameMapper.getSwFrameFromHwFrame(frame);
+        if (swFrame == nullptr) {
+            return;
+        }
+    }
+    else {
+        swFrame = frame;
+    }
+
+    // Touch a word in each cache line of every plane so a lazily mapped frame
+    // pays the same read cost that a real renderer would when uploading it.
+    const AVPixFmtDescriptor* desc = av_pix_fmt_desc_get((AVPixelFormat)swFrame->format);
+    for (int i = 0; i < AV_NUM_DATA_POINTERS && swFrame->data[i] != nullptr; i++) {
+        int height = swFrame->height;
+        if (desc != nullptr && (i == 1 || i == 2) && !(desc->flags & AV_PIX_FMT_FLAG_RGB)) {
+            height = AV_CEIL_RSHIFT(height, desc->log2_chroma_h);
+        }
+
+        int lineSize = abs(swFrame->linesize[i]);
+        for (int y = 0; y < height; y++) {
+            const uint8_t* line = swFrame->data[i] + (y * swFrame->linesize[i]);
+            for (int x = 0; x + (int)sizeof(uint32_t) <= lineSize; x += 64) {
+                m_ReadBackChecksum += *(const uint32_t*)(line + x);
+            }
+        }
+    }
+
+    if (swFrame != frame) {
+        av_frame_free(&swFrame);
+    }
+}
+
+void NullRenderer::notifyOverlayUpdated(Overlay::OverlayType type)
+{
+    // Consume the overlay surface so the stats overlay still costs what it
+    // usually does to render, but never draw it anywhere.
+    SDL_FreeSurface(Session::get()->getOverlayManager().getUpdatedOverlaySurface(type));
+}
+
+bool NullRenderer::notifyWindowChanged(PWINDOW_STATE_CHANGE_INFO)
+{
+    // We don't render to the window, so nothing about it matters
+    return true;
+}
+
+AVPixelFormat NullRenderer::getPreferredPixelFormat(int videoFormat)
+{
+    // Pixel format preference should be determined by the backend renderer
+    if (m_BackendRenderer != nullptr) {
+        return m_BackendRenderer->getPreferredPixelFormat(videoFormat);
+    }
+
+    return IFFmpegRenderer::getPreferredPixelFormat(videoFormat);
+}
+
+bool NullRenderer::isPixelFormatSupported(int videoFormat, AVPixelFormat pixelFormat)
+{
+    if (m_BackendRenderer != nullptr && m_BackendRenderer->isPixelFormatSupported(videoFormat, pixelFormat)) {
+        return true;
+    }
+
+    // We can accept any software format, since we never draw anything
+    const AVPixFmtDescriptor* desc = av_pix_fmt_desc_get(pixelFormat);
+    return desc != nullptr && !(desc->flags & AV_PIX_FMT_FLAG_HWACCEL);
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "renderer.h"
+#include "swframemapper.h"
+
+// Accepts decoded frames and discards them without displaying anything.
+// This is useful for measuring decoding throughput on its own, optionally
+// including the cost of reading frames back into system memory.
+class NullRenderer : public IFFmpegRenderer
+{
+public:
+    NullRenderer(IFFmpegRenderer *backendRenderer = nullptr);
+    virtual ~NullRenderer() override;
+    virtual bool initialize(PDECODER_PARAMETERS params) override;
+    virtual bool prepareDecoderContext(AVCodecContext* context, AVDictionary** options) override;
+    virtual void renderFrame(AVFrame* frame) override;
+    virtual void notifyOverlayUpdated(Overlay::OverlayType type) override;
+    virtual bool notifyWindowChanged(PWINDOW_STATE_CHANGE_INFO info) override;
+    virtual AVPixelFormat getPreferredPixelFormat(int videoFormat) override;
+    virtual bool isPixelFormatSupported(int videoFormat, AVPixelFormat pixelFormat) override;
+
+private:
+    IFFmpegRenderer* m_BackendRenderer;
+    SwFrameMapper m_SwFrameMapper;
+    bool m_ReadBackFrames;
+    uint32_t m_ReadBackChecksum;
+};
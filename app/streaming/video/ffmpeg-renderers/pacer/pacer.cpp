@@ -29,16 +29,20 @@ static_assert(PACER_MAX_OUTSTANDING_FRAMES == MAX_QUEUED_FRAMES + 2,
 // V-sync happens.
 #define TIMER_SLACK_MS 3
 
-Pacer::Pacer(IFFmpegRenderer* renderer, PVIDEO_STATS videoStats) :
+Pacer::Pacer(IFFmpegRenderer* renderer, PVIDEO_STATS videoStats,
+             FrameSnapshotter* frameSnapshotter, AVSyncMonitor* avSyncMonitor) :
     m_RenderThread(nullptr),
     m_VsyncThread(nullptr),
     m_DeferredFreeFrame(nullptr),
+    m_BenchmarkRenderTimes(nullptr),
     m_Stopping(false),
     m_VsyncSource(nullptr),
     m_VsyncRenderer(renderer),
     m_MaxVideoFps(0),
     m_DisplayFps(0),
-    m_VideoStats(videoStats)
+    m_VideoStats(videoStats),
+    m_FrameSnapshotter(frameSnapshotter),
+    m_AVSyncMonitor(avSyncMonitor)
 {
 
 }
@@ -342,6 +346,15 @@ void Pacer::renderFrame(AVFrame* frame)
     m_VideoStats->totalRenderTimeUs += (afterRender - beforeRender);
     m_VideoStats->renderedFrames++;
 
+    if (m_AVSyncMonitor != nullptr && frame->pts != AV_NOPTS_VALUE) {
+        m_AVSyncMonitor->reportVideoFramePresented((uint32_t)frame->pts, afterRender);
+    }
+
+    // Hand off a reference to this frame if a snapshot was requested
+    if (m_FrameSnapshotter != nullptr) {
+        m_FrameSnapshotter->captureFrameIfRequested(frame);
+    }
+
     // Wait until after next frame to free this one to ensure the GPU
     // doesn't stall or read garbage if the backing buffer gets returned
     // to the pool and the decoder tries to write a new frame into it
@@ -351,6 +364,11 @@ void Pacer::renderFrame(AVFrame* frame)
     // Drop frames if we have too many queued up for a while
     m_FrameQueueLock.lock();
 
+    if (m_BenchmarkRenderTimes != nullptr) {
+        m_BenchmarkRenderTimes->append(afterRender - beforeRender);
+        m_BenchmarkFrameRendered.wakeOne();
+    }
+
     int frameDropTarget;
 
     if (m_RendererAttributes & RENDERER_ATTRIBUTE_NO_BUFFERING) {
@@ -391,6 +409,55 @@ void Pacer::renderFrame(AVFrame* frame)
     m_FrameQueueLock.unlock();
 }
 
+bool Pacer::benchmarkFrame(AVFrame* frame, int frameCount, QVector<uint64_t>& renderTimesUs)
+{
+    // Make sure initialize() has been called
+    SDL_assert(m_MaxVideoFps != 0);
+
+    // Frames must not be held back waiting for V-sync
+    SDL_assert(m_VsyncSource == nullptr);
+
+    renderTimesUs.clear();
+
+    for (int i = 0; i < frameCount; i++) {
+        AVFrame* benchmarkFrame = av_frame_clone(frame);
+        if (benchmarkFrame == nullptr) {
+            return false;
+        }
+
+        benchmarkFrame->pkt_dts = LiGetMicroseconds();
+
+        if (m_RenderThread != nullptr) {
+            m_FrameQueueLock.lock();
+            m_BenchmarkRenderTimes = &renderTimesUs;
+            m_RenderQueue.enqueue(benchmarkFrame);
+            m_RenderQueueNotEmpty.wakeOne();
+
+            // Wait for this frame to be rendered before submitting the next one
+            bool rendered = true;
+            while (renderTimesUs.size() <= i && rendered) {
+                rendered = m_BenchmarkFrameRendered.wait(&m_FrameQueueLock, 1000);
+            }
+
+            m_BenchmarkRenderTimes = nullptr;
+            m_FrameQueueLock.unlock();
+
+            if (!rendered) {
+                SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION,
+                            "Timed out waiting for benchmark frame to render");
+                return false;
+            }
+        }
+        else {
+            m_BenchmarkRenderTimes = &renderTimesUs;
+            renderFrame(benchmarkFrame);
+            m_BenchmarkRenderTimes = nullptr;
+        }
+    }
+
+    return true;
+}
+
 void Pacer::dropFrameForEnqueue(QQueue<AVFrame*>& queue)
 {
     SDL_assert(queue.size() <= MAX_QUEUED_FRAMES);
@@ -2,10 +2,13 @@
 
 #include "../../decoder.h"
 #include "../renderer.h"
+#include "../../framesnapshotter.h"
+#include "../../../avsyncmonitor.h"
 
 #include <QQueue>
 #include <QMutex>
 #include <QWaitCondition>
+#include <QVector>
 
 // The maximum number of frames pacer will ever hold is:
 // - 3 frames in the pacing queue
@@ -31,7 +34,8 @@ public:
 class Pacer
 {
 public:
-    Pacer(IFFmpegRenderer* renderer, PVIDEO_STATS videoStats);
+    Pacer(IFFmpegRenderer* renderer, PVIDEO_STATS videoStats,
+          FrameSnapshotter* frameSnapshotter = nullptr, AVSyncMonitor* avSyncMonitor = nullptr);
 
     ~Pacer();
 
@@ -43,6 +47,10 @@ public:
 
     void renderOnMainThread();
 
+    // Renders the frame repeatedly on the render thread (or the calling thread
+    // for main thread renderers) and returns the time taken for each render.
+    bool benchmarkFrame(AVFrame* frame, int frameCount, QVector<uint64_t>& renderTimesUs);
+
 private:
     static int vsyncThread(void* context);
 
@@ -64,9 +72,11 @@ private:
     QWaitCondition m_RenderQueueNotEmpty;
     QWaitCondition m_PacingQueueNotEmpty;
     QWaitCondition m_VsyncSignalled;
+    QWaitCondition m_BenchmarkFrameRendered;
     SDL_Thread* m_RenderThread;
     SDL_Thread* m_VsyncThread;
     AVFrame* m_DeferredFreeFrame;
+    QVector<uint64_t>* m_BenchmarkRenderTimes;
     bool m_Stopping;
 
     IVsyncSource* m_VsyncSource;
@@ -74,5 +84,7 @@ private:
     int m_MaxVideoFps;
     int m_DisplayFps;
     PVIDEO_STATS m_VideoStats;
+    FrameSnapshotter* m_FrameSnapshotter;
+    AVSyncMonitor* m_AVSyncMonitor;
     int m_RendererAttributes;
 };
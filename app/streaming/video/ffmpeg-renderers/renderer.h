@@ -154,6 +154,7 @@ public:
         VDPAU,
         VTSampleLayer,
         VTMetal,
+        Null,
     };
 
     IFFmpegRenderer(RendererType type) : m_Type(type) {}
@@ -337,6 +338,8 @@ public:
             return "VideoToolbox (AVSampleBufferDisplayLayer)";
         case RendererType::VTMetal:
             return "VideoToolbox (Metal)";
+        case RendererType::Null:
+            return "Null";
         }
     }
 
@@ -8,11 +8,27 @@ SwFrameMapper::SwFrameMapper(IFFmpegRenderer* renderer)
 {
 }
 
+SwFrameMapper::SwFrameMapper()
+    : SwFrameMapper(nullptr)
+{
+}
+
 void SwFrameMapper::setVideoFormat(int videoFormat)
 {
     m_VideoFormat = videoFormat;
 }
 
+bool SwFrameMapper::isPixelFormatSupported(AVPixelFormat pixelFormat)
+{
+    if (m_Renderer == nullptr) {
+        // Anything the hardware can give us in system memory will do
+        const AVPixFmtDescriptor* formatDesc = av_pix_fmt_desc_get(pixelFormat);
+        return formatDesc != nullptr && !(formatDesc->flags & AV_PIX_FMT_FLAG_HWACCEL);
+    }
+
+    return m_Renderer->isPixelFormatSupported(m_VideoFormat, pixelFormat);
+}
+
 bool SwFrameMapper::initializeReadBackFormat(AVBufferRef* hwFrameCtxRef, AVFrame* testFrame)
 {
     auto hwFrameCtx = (AVHWFramesContext*)hwFrameCtxRef->data;
@@ -25,12 +41,13 @@ bool SwFrameMapper::initializeReadBackFormat(AVBufferRef* hwFrameCtxRef, AVFrame
     SDL_assert(!m_MapFrame);
     SDL_assert(m_VideoFormat != 0);
 
-    // Try direct mapping before resorting to copying the frame
-    outputFrame = av_frame_alloc();
+    // Try direct mapping before resorting to copying the frame. Mapped frames
+    // keep the hardware frame alive, so we can't map without a renderer.
+    outputFrame = m_Renderer != nullptr ? av_frame_alloc() : nullptr;
     if (outputFrame != nullptr) {
         err = av_hwframe_map(outputFrame, testFrame, AV_HWFRAME_MAP_READ);
         if (err == 0) {
-            if (m_Renderer->isPixelFormatSupported(m_VideoFormat, (AVPixelFormat)outputFrame->format)) {
+            if (isPixelFormatSupported((AVPixelFormat)outputFrame->format)) {
                 m_SwPixelFormat = (AVPixelFormat)outputFrame->format;
                 m_MapFrame = true;
                 goto Exit;
@@ -63,7 +80,7 @@ bool SwFrameMapper::initializeReadBackFormat(AVBufferRef* hwFrameCtxRef, AVFrame
     // why we loop through the readback format list in order, rather than searching
     // for the format from getPreferredPixelFormat() in the list.
     for (int i = 0; formats[i] != AV_PIX_FMT_NONE; i++) {
-        if (!m_Renderer->isPixelFormatSupported(m_VideoFormat, formats[i])) {
+        if (!isPixelFormatSupported(formats[i])) {
             SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
                         "Skipping unsupported hwframe transfer format %d",
                         formats[i]);
@@ -81,7 +98,7 @@ Exit:
 
     // If we didn't find any supported formats, try hwFrameCtx->sw_format.
     if (m_SwPixelFormat == AV_PIX_FMT_NONE) {
-        if (m_Renderer->isPixelFormatSupported(m_VideoFormat, hwFrameCtx->sw_format)) {
+        if (isPixelFormatSupported(hwFrameCtx->sw_format)) {
             m_SwPixelFormat = hwFrameCtx->sw_format;
         }
         else {
@@ -6,12 +6,20 @@ class SwFrameMapper
 {
 public:
     explicit SwFrameMapper(IFFmpegRenderer* renderer);
+
+    // For reading frames back into system memory without a renderer. Any
+    // software format is accepted, and frames are always copied so the
+    // result doesn't hold a reference to the hardware surface.
+    SwFrameMapper();
+
     void setVideoFormat(int videoFormat);
     AVFrame* getSwFrameFromHwFrame(AVFrame* hwFrame);
 
 private:
     bool initializeReadBackFormat(AVBufferRef* hwFrameCtxRef, AVFrame* testFrame);
 
+    bool isPixelFormatSupported(AVPixelFormat pixelFormat);
+
     IFFmpegRenderer* m_Renderer;
     int m_VideoFormat;
     enum AVPixelFormat m_SwPixelFormat;
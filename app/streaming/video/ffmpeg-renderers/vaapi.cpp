@@ -39,8 +39,8 @@ VAAPIRenderer::VAAPIRenderer(int decoderSelectionPass)
     m_DrmFd = -1;
 #endif
 
-    SDL_zero(m_OverlayImage);
-    SDL_zero(m_OverlaySubpicture);
+    SDL_zero(m_OverlayBuffer);
+    SDL_zero(m_OverlaySpareBuffer);
     SDL_zero(m_OverlayFormat);
 }
 
@@ -54,12 +54,8 @@ VAAPIRenderer::~VAAPIRenderer()
         VADisplay display = vaDeviceContext->display;
 
         for (int i = 0; i < Overlay::OverlayMax; i++) {
-            if (m_OverlaySubpicture[i] != 0) {
-                vaDestroySubpicture(display, m_OverlaySubpicture[i]);
-            }
-            if (m_OverlayImage[i].image_id != 0) {
-                vaDestroyImage(display, m_OverlayImage[i].image_id);
-            }
+            destroyOverlayBuffer(display, m_OverlayBuffer[i]);
+            destroyOverlayBuffer(display, m_OverlaySpareBuffer[i]);
         }
 
         av_buffer_unref(&m_HwContext);
@@ -660,6 +656,82 @@ int VAAPIRenderer::getDecoderCapabilities()
     return caps;
 }
 
+void VAAPIRenderer::destroyOverlayBuffer(VADisplay display, OverlayBuffer& buffer)
+{
+    VAStatus status;
+
+    if (buffer.subpicture != 0) {
+        status = vaDestroySubpicture(display, buffer.subpicture);
+        if (status != VA_STATUS_SUCCESS) {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                         "vaDestroySubpicture() failed: %d",
+                         status);
+        }
+    }
+    if (buffer.image.image_id != 0) {
+        status = vaDestroyImage(display, buffer.image.image_id);
+        if (status != VA_STATUS_SUCCESS) {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                         "vaDestroyImage() failed: %d",
+                         status);
+        }
+    }
+    if (buffer.surface != nullptr) {
+        SDL_FreeSurface(buffer.surface);
+    }
+
+    SDL_zero(buffer);
+}
+
+bool VAAPIRenderer::updateOverlayBufferDirtyRects(VADisplay display, OverlayBuffer& buffer, SDL_Surface* newSurface)
+{
+    VAStatus status;
+
+    if (buffer.subpicture == 0) {
+        return false;
+    }
+
+    SDL_Rect dirtyRects[Overlay::OverlayManager::k_MaxDirtyRects];
+    int dirtyRectCount = Overlay::OverlayManager::getDirtyRects(buffer.surface, newSurface,
+                                                                dirtyRects, SDL_arraysize(dirtyRects));
+    if (dirtyRectCount < 0) {
+        return false;
+    }
+
+    void* imagePixels;
+    status = vaMapBuffer(display, buffer.image.buf, &imagePixels);
+    if (status != VA_STATUS_SUCCESS) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                     "vaMapBuffer() failed: %d",
+                     status);
+        return false;
+    }
+
+    // Convert only the changed regions into the image
+    for (int i = 0; i < dirtyRectCount; i++) {
+        const SDL_Rect& rect = dirtyRects[i];
+
+        SDL_ConvertPixels(rect.w, rect.h, newSurface->format->format,
+                          (Uint8*)newSurface->pixels + (rect.y * newSurface->pitch) + (rect.x * newSurface->format->BytesPerPixel),
+                          newSurface->pitch,
+                          m_OverlaySdlPixelFormat,
+                          (Uint8*)imagePixels + buffer.image.offsets[0] + (rect.y * buffer.image.pitches[0]) + (rect.x * 4),
+                          (int)buffer.image.pitches[0]);
+    }
+
+    status = vaUnmapBuffer(display, buffer.image.buf);
+    if (status != VA_STATUS_SUCCESS) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                     "vaUnmapBuffer() failed: %d",
+                     status);
+        return false;
+    }
+
+    SDL_FreeSurface(buffer.surface);
+    buffer.surface = newSurface;
+    return true;
+}
+
 void VAAPIRenderer::notifyOverlayUpdated(Overlay::OverlayType type)
 {
     AVHWDeviceContext* deviceContext = (AVHWDeviceContext*)m_HwContext->data;
@@ -678,45 +750,37 @@ void VAAPIRenderer::notifyOverlayUpdated(Overlay::OverlayType type)
         return;
     }
 
-    // Destroy the old image and subpicture
-    // NB: The mutex ensures the overlay is not currently being read for rendering.
-    // NB 2: It is safe to unlock here because this thread is the only surface producer.
-    SDL_LockMutex(m_OverlayMutex);
-    VAImageID oldImageId = m_OverlayImage[type].image_id;
-    SDL_zero(m_OverlayImage[type]);
-
-    VASubpictureID oldSubpictureId = m_OverlaySubpicture[type];
-    m_OverlaySubpicture[type] = 0;
-    SDL_UnlockMutex(m_OverlayMutex);
-
-    if (oldSubpictureId != 0) {
-        status = vaDestroySubpicture(vaDeviceContext->display, oldSubpictureId);
-        if (status != VA_STATUS_SUCCESS) {
-            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
-                         "vaDestroySubpicture() failed: %d",
-                         status);
-        }
-    }
-    if (oldImageId != 0) {
-        status = vaDestroyImage(vaDeviceContext->display, oldImageId);
-        if (status != VA_STATUS_SUCCESS) {
-            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
-                         "vaDestroyImage() failed: %d",
-                         status);
-        }
-    }
-
     if (!overlayEnabled) {
+        // Destroy the old buffers
+        // NB: The mutex ensures the overlay is not currently being read for rendering.
+        // NB 2: It is safe to unlock here because this thread is the only buffer producer.
+        SDL_LockMutex(m_OverlayMutex);
+        OverlayBuffer oldBuffer = m_OverlayBuffer[type];
+        OverlayBuffer spareBuffer = m_OverlaySpareBuffer[type];
+        SDL_zero(m_OverlayBuffer[type]);
+        SDL_zero(m_OverlaySpareBuffer[type]);
+        SDL_UnlockMutex(m_OverlayMutex);
+
+        destroyOverlayBuffer(vaDeviceContext->display, oldBuffer);
+        destroyOverlayBuffer(vaDeviceContext->display, spareBuffer);
         SDL_FreeSurface(newSurface);
         return;
     }
 
-    if (newSurface != nullptr) {
-        VAImage newImage;
+    SDL_assert(!SDL_MUSTLOCK(newSurface));
 
-        SDL_assert(!SDL_MUSTLOCK(newSurface));
+    // Take the spare buffer, since it's not displayed and we can safely write to it
+    SDL_LockMutex(m_OverlayMutex);
+    OverlayBuffer newBuffer = m_OverlaySpareBuffer[type];
+    SDL_zero(m_OverlaySpareBuffer[type]);
+    SDL_UnlockMutex(m_OverlayMutex);
+
+    // If the overlay size is unchanged, we can just redraw the lines that differ
+    // from what's already in the spare buffer. Otherwise we need a new image.
+    if (!updateOverlayBufferDirtyRects(vaDeviceContext->display, newBuffer, newSurface)) {
+        destroyOverlayBuffer(vaDeviceContext->display, newBuffer);
 
-        status = vaCreateImage(vaDeviceContext->display, &m_OverlayFormat, newSurface->w, newSurface->h, &newImage);
+        status = vaCreateImage(vaDeviceContext->display, &m_OverlayFormat, newSurface->w, newSurface->h, &newBuffer.image);
         if (status != VA_STATUS_SUCCESS) {
             SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
                          "vaCreateImage() failed: %d",
@@ -726,66 +790,77 @@ void VAAPIRenderer::notifyOverlayUpdated(Overlay::OverlayType type)
         }
 
         void* imagePixels;
-        status = vaMapBuffer(vaDeviceContext->display, newImage.buf, &imagePixels);
+        status = vaMapBuffer(vaDeviceContext->display, newBuffer.image.buf, &imagePixels);
         if (status != VA_STATUS_SUCCESS) {
             SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
                          "vaMapBuffer() failed: %d",
                          status);
             SDL_FreeSurface(newSurface);
-            vaDestroyImage(vaDeviceContext->display, newImage.image_id);
+            destroyOverlayBuffer(vaDeviceContext->display, newBuffer);
             return;
         }
 
         // Convert the surface to the proper format for the VAImage
         SDL_ConvertPixels(newSurface->w, newSurface->h, newSurface->format->format,
                           newSurface->pixels, newSurface->pitch, m_OverlaySdlPixelFormat,
-                          imagePixels, (int)newImage.pitches[0]);
+                          (Uint8*)imagePixels + newBuffer.image.offsets[0], (int)newBuffer.image.pitches[0]);
 
-        status = vaUnmapBuffer(vaDeviceContext->display, newImage.buf);
+        status = vaUnmapBuffer(vaDeviceContext->display, newBuffer.image.buf);
         if (status != VA_STATUS_SUCCESS) {
             SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
                          "vaUnmapBuffer() failed: %d",
                          status);
             SDL_FreeSurface(newSurface);
-            vaDestroyImage(vaDeviceContext->display, newImage.image_id);
+            destroyOverlayBuffer(vaDeviceContext->display, newBuffer);
             return;
         }
 
-        SDL_Rect overlayRect;
-
-        if (type == Overlay::OverlayStatusUpdate) {
-            // Bottom Left
-            overlayRect.x = 0;
-            overlayRect.y = -newSurface->h;
-        }
-        else if (type == Overlay::OverlayDebug) {
-            // Top left
-            overlayRect.x = 0;
-            overlayRect.y = 0;
-        }
-
-        overlayRect.w = newSurface->w;
-        overlayRect.h = newSurface->h;
-
-        // Surface data is no longer needed
-        SDL_FreeSurface(newSurface);
-
-        VASubpictureID newSubpicture;
-        status = vaCreateSubpicture(vaDeviceContext->display, newImage.image_id, &newSubpicture);
+        status = vaCreateSubpicture(vaDeviceContext->display, newBuffer.image.image_id, &newBuffer.subpicture);
         if (status != VA_STATUS_SUCCESS) {
             SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
                          "vaCreateSubpicture() failed: %d",
                          status);
-            vaDestroyImage(vaDeviceContext->display, newImage.image_id);
+            SDL_FreeSurface(newSurface);
+            destroyOverlayBuffer(vaDeviceContext->display, newBuffer);
             return;
         }
 
-        SDL_LockMutex(m_OverlayMutex);
-        m_OverlayImage[type] = newImage;
-        m_OverlaySubpicture[type] = newSubpicture;
-        m_OverlayRect[type] = overlayRect;
-        SDL_UnlockMutex(m_OverlayMutex);
+        // Keep the surface data to find the dirty regions in later updates
+        newBuffer.surface = newSurface;
+    }
+
+    SDL_Rect overlayRect;
+
+    if (type == Overlay::OverlayStatusUpdate) {
+        // Bottom Left
+        overlayRect.x = 0;
+        overlayRect.y = -newSurface->h;
+    }
+    else if (type == Overlay::OverlayDebug) {
+        // Top left
+        overlayRect.x = 0;
+        overlayRect.y = 0;
+    }
+
+    overlayRect.w = newSurface->w;
+    overlayRect.h = newSurface->h;
+
+    SDL_LockMutex(m_OverlayMutex);
+
+    // Swap in the new buffer. If the old buffer is currently being rendered,
+    // renderFrame() will retire it to the spare slot once it's done with it.
+    OverlayBuffer oldBuffer = m_OverlayBuffer[type];
+    m_OverlayBuffer[type] = newBuffer;
+    m_OverlayRect[type] = overlayRect;
+
+    if (oldBuffer.subpicture != 0 && m_OverlaySpareBuffer[type].subpicture == 0) {
+        m_OverlaySpareBuffer[type] = oldBuffer;
+        SDL_zero(oldBuffer);
     }
+
+    SDL_UnlockMutex(m_OverlayMutex);
+
+    destroyOverlayBuffer(vaDeviceContext->display, oldBuffer);
 }
 
 bool VAAPIRenderer::notifyWindowChanged(PWINDOW_STATE_CHANGE_INFO info)
@@ -835,14 +910,13 @@ VAAPIRenderer::renderFrame(AVFrame* frame)
 
         SDL_LockMutex(m_OverlayMutex);
 
-        VAImage associatedOverlayImages[Overlay::OverlayMax] = {};
-        VASubpictureID associatedOverlaySubpictures[Overlay::OverlayMax] = {};
+        OverlayBuffer associatedOverlayBuffers[Overlay::OverlayMax] = {};
 
         // Associate our overlay subpictures to the current surface
         for (int type = 0; type < Overlay::OverlayMax; type++) {
             VAStatus status;
 
-            if (m_OverlaySubpicture[type] == 0) {
+            if (m_OverlayBuffer[type].subpicture == 0) {
                 continue;
             }
 
@@ -857,13 +931,13 @@ VAAPIRenderer::renderFrame(AVFrame* frame)
             }
 
             status = vaAssociateSubpicture(vaDeviceContext->display,
-                                           m_OverlaySubpicture[type],
+                                           m_OverlayBuffer[type].subpicture,
                                            &surface,
                                            1,
                                            0,
                                            0,
-                                           m_OverlayImage[type].width,
-                                           m_OverlayImage[type].height,
+                                           m_OverlayBuffer[type].image.width,
+                                           m_OverlayBuffer[type].image.height,
                                            overlayRect.x,
                                            overlayRect.y,
                                            overlayRect.w,
@@ -873,11 +947,8 @@ VAAPIRenderer::renderFrame(AVFrame* frame)
                 // Take temporary ownership of the overlay to prevent notifyOverlayUpdated()
                 // from freeing them frum underneath us. We need to release the lock while
                 // we render for performance reasons.
-                associatedOverlayImages[type] = m_OverlayImage[type];
-                associatedOverlaySubpictures[type] = m_OverlaySubpicture[type];
-
-                SDL_zero(m_OverlayImage[type]);
-                m_OverlaySubpicture[type] = 0;
+                associatedOverlayBuffers[type] = m_OverlayBuffer[type];
+                SDL_zero(m_OverlayBuffer[type]);
             }
             else {
                 SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
@@ -906,44 +977,30 @@ VAAPIRenderer::renderFrame(AVFrame* frame)
         for (int type = 0; type < Overlay::OverlayMax; type++) {
             VAStatus status;
 
-            if (associatedOverlaySubpictures[type] == 0) {
+            if (associatedOverlayBuffers[type].subpicture == 0) {
                 continue;
             }
 
             // Deassociate the subpicture so it can be safely destroyed/replaced
-            status = vaDeassociateSubpicture(vaDeviceContext->display, associatedOverlaySubpictures[type], &surface, 1);
+            status = vaDeassociateSubpicture(vaDeviceContext->display, associatedOverlayBuffers[type].subpicture, &surface, 1);
             if (status != VA_STATUS_SUCCESS) {
                 SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
                              "vaDeassociateSubpicture() failed: %d",
                              status);
             }
 
-            // If a new subpicture was populated while we were unlocked, free the old one we took ownership of
-            if (m_OverlaySubpicture[type] != 0) {
-                status = vaDestroySubpicture(vaDeviceContext->display, associatedOverlaySubpictures[type]);
-                if (status != VA_STATUS_SUCCESS) {
-                    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
-                                 "vaDestroySubpicture() failed: %d",
-                                 status);
-                }
+            if (m_OverlayBuffer[type].subpicture == 0) {
+                // If no new buffer was populated, return ownership of this one
+                m_OverlayBuffer[type] = associatedOverlayBuffers[type];
             }
-            else {
-                // If no new subpicture was populated, return ownership of this one
-                m_OverlaySubpicture[type] = associatedOverlaySubpictures[type];
-            }
-
-            // If a new image was populated while we were unlocked, free the one old we took ownership of
-            if (m_OverlayImage[type].image_id != 0) {
-                status = vaDestroyImage(vaDeviceContext->display, associatedOverlayImages[type].image_id);
-                if (status != VA_STATUS_SUCCESS) {
-                    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
-                                 "vaDestroyImage() failed: %d",
-                                 status);
-                }
+            else if (m_OverlaySpareBuffer[type].subpicture == 0) {
+                // If a new buffer was populated while we were unlocked, retire the
+                // one we took ownership of so it can be reused for the next update
+                m_OverlaySpareBuffer[type] = associatedOverlayBuffers[type];
             }
             else {
-                // If no new image was populated, return ownership of this one
-                m_OverlayImage[type] = associatedOverlayImages[type];
+                // Otherwise we have no use for it anymore
+                destroyOverlayBuffer(vaDeviceContext->display, associatedOverlayBuffers[type]);
             }
         }
 
@@ -85,6 +85,16 @@ private:
     VAStatus tryVaInitialize(AVVAAPIDeviceContext* vaDeviceContext, PDECODER_PARAMETERS params, int* major, int* minor);
     void renderOverlay(VADisplay display, VASurfaceID surface, Overlay::OverlayType type);
 
+    struct OverlayBuffer {
+        VAImage image;
+        VASubpictureID subpicture;
+
+        // The overlay surface whose pixels are currently in the image
+        SDL_Surface* surface;
+    };
+    void destroyOverlayBuffer(VADisplay display, OverlayBuffer& buffer);
+    bool updateOverlayBufferDirtyRects(VADisplay display, OverlayBuffer& buffer, SDL_Surface* newSurface);
+
 #if defined(HAVE_EGL) || defined(HAVE_DRM)
     bool canExportSurfaceHandle(int layerTypeFlag, VADRMPRIMESurfaceDescriptor* descriptor);
 #endif
@@ -103,10 +113,13 @@ private:
     SDL_mutex* m_OverlayMutex;
     VAImageFormat m_OverlayFormat;
     Uint32 m_OverlaySdlPixelFormat;
-    VAImage m_OverlayImage[Overlay::OverlayMax];
-    VASubpictureID m_OverlaySubpicture[Overlay::OverlayMax];
+    OverlayBuffer m_OverlayBuffer[Overlay::OverlayMax];
     SDL_Rect m_OverlayRect[Overlay::OverlayMax];
 
+    // The last overlay buffer retired from display. We keep it around so that
+    // the next update only needs to redraw the lines that changed since then.
+    OverlayBuffer m_OverlaySpareBuffer[Overlay::OverlayMax];
+
 #ifdef HAVE_LIBVA_X11
     Display* m_XDisplay;
     Window m_XWindow;
@@ -1,8 +1,11 @@
 #include <Limelight.h>
 #include "ffmpeg.h"
+#include "renderertuning.h"
 #include "utils.h"
 #include "streaming/session.h"
 
+#include <algorithm>
+
 #include <h264_stream.h>
 
 extern "C" {
@@ -12,6 +15,7 @@ extern "C" {
 
 #include "ffmpeg-renderers/sdlvid.h"
 #include "ffmpeg-renderers/genhwaccel.h"
+#include "ffmpeg-renderers/null.h"
 
 #ifdef Q_OS_WIN32
 #include "ffmpeg-renderers/dxva2.h"
@@ -86,6 +90,13 @@ bool FFmpegVideoDecoder::notifyWindowChanged(PWINDOW_STATE_CHANGE_INFO info)
     return m_FrontendRenderer->notifyWindowChanged(info);
 }
 
+void FFmpegVideoDecoder::requestFrameSnapshot()
+{
+    if (m_FrameSnapshotter != nullptr) {
+        m_FrameSnapshotter->requestSnapshot();
+    }
+}
+
 int FFmpegVideoDecoder::getDecoderCapabilities()
 {
     int capabilities;
@@ -228,6 +239,7 @@ FFmpegVideoDecoder::FFmpegVideoDecoder(bool testOnly)
       m_FrontendRenderer(nullptr),
       m_ConsecutiveFailedDecodes(0),
       m_Pacer(nullptr),
+      m_FrameSnapshotter(nullptr),
       m_BwTracker(10, 250),
       m_FramesIn(0),
       m_FramesOut(0),
@@ -237,6 +249,8 @@ FFmpegVideoDecoder::FFmpegVideoDecoder(bool testOnly)
       m_NeedsSpsFixup(false),
       m_TestOnly(testOnly),
       m_CurrentTestMode(TestMode::TestFrameOnly),
+      m_TuningState(TuningState::Off),
+      m_BenchmarkP99RenderTimeUs(0),
       m_DecoderThread(nullptr),
       m_VideoEnhancement(&VideoEnhancement::getInstance())
 {
@@ -283,6 +297,10 @@ void FFmpegVideoDecoder::reset()
     delete m_Pacer;
     m_Pacer = nullptr;
 
+    // This must be deleted after Pacer since Pacer may still be using it
+    delete m_FrameSnapshotter;
+    m_FrameSnapshotter = nullptr;
+
     // This must be called after deleting Pacer because it
     // may be holding AVFrames to free in its destructor.
     // However, it must be called before deleting the IFFmpegRenderer
@@ -303,11 +321,11 @@ void FFmpegVideoDecoder::reset()
 
     m_FrontendRenderer = m_BackendRenderer = nullptr;
 
-    if (m_CurrentTestMode != TestMode::TestFrameOnly) {
+    if (m_CurrentTestMode != TestMode::TestFrameOnly && m_CurrentTestMode != TestMode::Benchmark) {
         logVideoStats(m_GlobalVideoStats, "Global video stats");
     }
     else {
-        // Test-only decoders can't have any frames submitted
+        // Test-only and benchmark decoders can't have any frames submitted
         SDL_assert(m_GlobalVideoStats.totalFrames == 0);
     }
 }
@@ -361,6 +379,22 @@ bool FFmpegVideoDecoder::createFrontendRenderer(PDECODER_PARAMETERS params, bool
     Q_UNUSED(glIsSlow);
     Q_UNUSED(vulkanIsSlow);
 
+    // The null renderer discards frames from any backend, so it bypasses all normal frontend selection
+    if (params->renderer == StreamingPreferences::RS_NULL) {
+        if (m_BackendRenderer->getRendererType() == IFFmpegRenderer::RendererType::Null) {
+            m_FrontendRenderer = m_BackendRenderer;
+            return true;
+        }
+
+        m_FrontendRenderer = new NullRenderer(m_BackendRenderer);
+        if (initializeRendererInternal(m_FrontendRenderer, params)) {
+            return true;
+        }
+        delete m_FrontendRenderer;
+        m_FrontendRenderer = nullptr;
+        return false;
+    }
+
     // For cases where we're already using Vulkan Video decoding, always use the Vulkan renderer too.
     // The alternate frontend logic is primarily for cases where a different renderer like EGL or DRM
     // may provide additional performance or HDR capabilities. Neither of these are true for Vulkan.
@@ -498,7 +532,15 @@ bool FFmpegVideoDecoder::completeInitialization(const AVCodec* decoder, enum AVP
 
     // Don't bother initializing Pacer if we're not actually going to render
     if (testMode != TestMode::TestFrameOnly) {
-        m_Pacer = new Pacer(m_FrontendRenderer, &m_ActiveWndVideoStats);
+        // Benchmark frames aren't worth capturing
+        if (testMode != TestMode::Benchmark) {
+            m_FrameSnapshotter = new FrameSnapshotter(params->videoFormat);
+        }
+
+        // Streaming reuses the decoder created in TestFrame mode, so only
+        // benchmark runs go without the A/V sync monitor
+        m_Pacer = new Pacer(m_FrontendRenderer, &m_ActiveWndVideoStats, m_FrameSnapshotter,
+                            testMode != TestMode::Benchmark ? Session::get()->getAVSyncMonitor() : nullptr);
         if (!m_Pacer->initialize(params->window, params->frameRate,
                                  params->enableFramePacing || (params->enableVsync && (m_FrontendRenderer->getRendererAttributes() & RENDERER_ATTRIBUTE_FORCE_PACING)))) {
             return false;
@@ -703,6 +745,14 @@ bool FFmpegVideoDecoder::completeInitialization(const AVCodec* decoder, enum AVP
             return false;
         }
 
+        // Benchmark decoders are finished after measuring the renderer
+        if (testMode == TestMode::Benchmark) {
+            m_FrontendRenderer->prepareToRender();
+            bool ret = benchmarkTestFrame(frame);
+            av_frame_free(&frame);
+            return ret;
+        }
+
         av_frame_free(&frame);
 
         // Flush the codec to prepare for the real stream if we're
@@ -1255,16 +1305,33 @@ bool FFmpegVideoDecoder::tryInitializeRenderer(const AVCodec* decoder,
 
         // Initialize the backend renderer for testing
         if (initializeRendererInternal(m_BackendRenderer, &testFrameDecoderParams)) {
-            if (completeInitialization(decoder, requiredFormat, &testFrameDecoderParams,
-                                       (m_TestOnly || separateTestDecoder) ? TestMode::TestFrameOnly : TestMode::TestFrame,
-                                        i == 0 /* EGL/DRM */)) {
-                if (m_TestOnly) {
+            if (m_TuningState == TuningState::Measuring) {
+                // Measure this renderer and keep going, so every working
+                // renderer gets a chance to be benchmarked
+                if (completeInitialization(decoder, requiredFormat, &testFrameDecoderParams,
+                                           TestMode::Benchmark, i == 0 /* EGL/DRM */)) {
+                    QString candidate = getTuningCandidateName(decoder);
+                    if (!m_TuningResults.contains(candidate)) {
+                        m_TuningResults.insert(candidate, m_BenchmarkP99RenderTimeUs);
+                    }
+                }
+            }
+            else if (completeInitialization(decoder, requiredFormat, &testFrameDecoderParams,
+                                            (m_TestOnly || separateTestDecoder) ? TestMode::TestFrameOnly : TestMode::TestFrame,
+                                            i == 0 /* EGL/DRM */)) {
+                if (m_TuningState == TuningState::Pinned &&
+                        getTuningCandidateName(decoder) != m_TunedCandidate) {
+                    SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+                                "Skipping '%s' in favor of auto-tuned '%s'",
+                                qPrintable(getTuningCandidateName(decoder)),
+                                qPrintable(m_TunedCandidate));
+                }
+                else if (m_TestOnly) {
                     // This decoder is only for testing capabilities, so don't bother
                     // creating a usable renderer
                     return true;
                 }
-
-                if (separateTestDecoder) {
+                else if (separateTestDecoder) {
                     SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
                                 "Not reusing test decoder for %s",
                                 decoder->name);
@@ -1412,6 +1479,12 @@ bool FFmpegVideoDecoder::tryInitializeRendererForUnknownDecoder(const AVCodec* d
         }
     }
 
+    // The null renderer can take any software format, so we don't need to look any further
+    if (params->renderer == StreamingPreferences::RS_NULL) {
+        return tryInitializeRenderer(decoder, AV_PIX_FMT_NONE, params, nullptr, nullptr,
+                                     []() -> IFFmpegRenderer* { return new NullRenderer(); });
+    }
+
     if (decoder_pix_fmts == NULL) {
         // Supported output pixel formats are unknown. We'll just try DRM/SDL and hope it can cope.
 
@@ -1470,6 +1543,13 @@ bool FFmpegVideoDecoder::tryInitializeRendererForUnknownDecoder(const AVCodec* d
         if (!vulkanIsSlow) {
             TRY_PREFERRED_PIXEL_FORMAT(PlVkRenderer);
         }
+#endif
+#ifdef HAVE_EGL
+        // EGLRenderer streams software frames through PBOs, which
+        // avoids SDL's texture locking and copy on GLES platforms.
+        if (!glIsSlow) {
+            TRY_PREFERRED_PIXEL_FORMAT(EGLRenderer);
+        }
 #endif
         if (!glIsSlow) {
             TRY_PREFERRED_PIXEL_FORMAT(SdlRenderer);
@@ -1485,6 +1565,11 @@ bool FFmpegVideoDecoder::tryInitializeRendererForUnknownDecoder(const AVCodec* d
         if (!vulkanIsSlow) {
             TRY_SUPPORTED_NON_PREFERRED_PIXEL_FORMAT(PlVkRenderer);
         }
+#endif
+#ifdef HAVE_EGL
+        if (!glIsSlow) {
+            TRY_SUPPORTED_NON_PREFERRED_PIXEL_FORMAT(EGLRenderer);
+        }
 #endif
         if (!glIsSlow) {
             TRY_SUPPORTED_NON_PREFERRED_PIXEL_FORMAT(SdlRenderer);
@@ -1717,11 +1802,182 @@ bool FFmpegVideoDecoder::tryInitializeNonHwAccelDecoder(PDECODER_PARAMETERS para
     return false;
 }
 
+QString FFmpegVideoDecoder::getTuningCandidateName(const AVCodec* decoder)
+{
+    return QString("%1/%2/%3").arg(decoder->name,
+                                   m_BackendRenderer->getRendererName(),
+                                   m_FrontendRenderer->getRendererName());
+}
+
+bool FFmpegVideoDecoder::benchmarkTestFrame(AVFrame* frame)
+{
+    QVector<uint64_t> renderTimesUs;
+
+    if (!m_Pacer->benchmarkFrame(frame, k_BenchmarkWarmupFrames + k_BenchmarkFrames, renderTimesUs) ||
+            renderTimesUs.size() <= k_BenchmarkWarmupFrames) {
+        SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION,
+                    "Renderer benchmark failed for '%s'",
+                    m_FrontendRenderer->getRendererName());
+        return false;
+    }
+
+    // Discard warmup frames that include one-time setup costs
+    renderTimesUs.remove(0, k_BenchmarkWarmupFrames);
+    std::sort(renderTimesUs.begin(), renderTimesUs.end());
+
+    m_BenchmarkP99RenderTimeUs = renderTimesUs[(renderTimesUs.size() - 1) * 99 / 100];
+
+    SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+                "Renderer '%s' with '%s' backend: %.2f ms median / %.2f ms p99 render time",
+                m_FrontendRenderer->getRendererName(),
+                m_BackendRenderer->getRendererName(),
+                renderTimesUs[renderTimesUs.size() / 2] / 1000.0,
+                m_BenchmarkP99RenderTimeUs / 1000.0);
+
+    // Benchmark frames must not show up in the stream's stats
+    SDL_zero(m_ActiveWndVideoStats);
+    return true;
+}
+
+bool FFmpegVideoDecoder::initializeAutoTuned(PDECODER_PARAMETERS params)
+{
+    QString tuningKey = RendererTuning::getTuningKey(params);
+    RendererTuning::Result result;
+
+    if (RendererTuning::takeRetuneRequest()) {
+        SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+                    "Discarding cached auto-tuning result for %s",
+                    qPrintable(tuningKey));
+        RendererTuning::remove(tuningKey);
+    }
+
+    if (RendererTuning::load(tuningKey, result)) {
+        SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+                    "Using auto-tuned renderer '%s' (%.2f ms p99) for %s",
+                    qPrintable(result.candidate),
+                    result.p99RenderTimeUs / 1000.0,
+                    qPrintable(tuningKey));
+    }
+    else {
+        SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+                    "Benchmarking renderers for %s",
+                    qPrintable(tuningKey));
+
+        DECODER_PARAMETERS tuningParams = *params;
+
+        // Measure raw render time without waiting for V-sync
+        tuningParams.enableVsync = false;
+        tuningParams.enableFramePacing = false;
+
+        // Render time says nothing about the cost of software decoding,
+        // so only hardware decoders compete unless software is forced.
+        if (tuningParams.vds != StreamingPreferences::VDS_FORCE_SOFTWARE) {
+            tuningParams.vds = StreamingPreferences::VDS_FORCE_HARDWARE;
+        }
+
+        // On macOS, the renderer selection chooses between otherwise
+        // equivalent renderers for the same hardware decoder.
+        QList<StreamingPreferences::RendererSelection> rendererSelections;
+#ifdef Q_OS_DARWIN
+#ifdef HAVE_LIBPLACEBO_VULKAN
+        rendererSelections.append(StreamingPreferences::RS_VULKAN);
+#endif
+        rendererSelections.append(StreamingPreferences::RS_METAL);
+        rendererSelections.append(StreamingPreferences::RS_AVSBDL);
+#else
+        rendererSelections.append(StreamingPreferences::RS_AUTO);
+#endif
+
+        QMap<QString, StreamingPreferences::RendererSelection> candidateSelections;
+
+        m_TuningState = TuningState::Measuring;
+        m_TuningResults.clear();
+        for (StreamingPreferences::RendererSelection rendererSelection : rendererSelections) {
+            tuningParams.renderer = rendererSelection;
+
+            // This never succeeds while measuring, it just collects results
+            findWorkingDecoder(&tuningParams);
+
+            for (const QString& candidate : m_TuningResults.keys()) {
+                if (!candidateSelections.contains(candidate)) {
+                    candidateSelections.insert(candidate, rendererSelection);
+                }
+            }
+        }
+        m_TuningState = TuningState::Off;
+
+        if (m_TuningResults.isEmpty()) {
+            SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION,
+                        "No renderers could be benchmarked");
+            return false;
+        }
+
+        result.candidate.clear();
+        for (auto it = m_TuningResults.cbegin(); it != m_TuningResults.cend(); ++it) {
+            if (result.candidate.isEmpty() || it.value() < result.p99RenderTimeUs) {
+                result.candidate = it.key();
+                result.p99RenderTimeUs = it.value();
+            }
+        }
+        result.rendererSelection = candidateSelections[result.candidate];
+
+        SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+                    "Auto-tuning chose '%s' (%.2f ms p99) out of %d renderers",
+                    qPrintable(result.candidate),
+                    result.p99RenderTimeUs / 1000.0,
+                    (int)m_TuningResults.size());
+
+        RendererTuning::save(tuningKey, result);
+    }
+
+    DECODER_PARAMETERS pinnedParams = *params;
+    pinnedParams.renderer = result.rendererSelection;
+
+    m_TuningState = TuningState::Pinned;
+    m_TunedCandidate = result.candidate;
+    bool ret = findWorkingDecoder(&pinnedParams);
+    m_TuningState = TuningState::Off;
+
+    if (!ret) {
+        // Benchmark again next time, since the hardware or drivers have changed
+        SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION,
+                    "Auto-tuned renderer '%s' is no longer available",
+                    qPrintable(result.candidate));
+        RendererTuning::remove(tuningKey);
+    }
+
+    return ret;
+}
+
 bool FFmpegVideoDecoder::initialize(PDECODER_PARAMETERS params)
 {
     // Increase log level until the first frame is decoded
     av_log_set_level(AV_LOG_DEBUG);
 
+    DECODER_PARAMETERS searchParams = *params;
+
+    if (params->renderer == StreamingPreferences::RS_AUTO_TUNE) {
+        // Test-only decoders are just probing capabilities, so don't benchmark them
+        if (!m_TestOnly && initializeAutoTuned(params)) {
+            return true;
+        }
+
+        // Fall back to the default renderer selection
+        searchParams.renderer = StreamingPreferences::RS_AUTO;
+    }
+
+    if (findWorkingDecoder(&searchParams)) {
+        return true;
+    }
+
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                 "Unable to find working decoder for format: %x",
+                 params->videoFormat);
+    return false;
+}
+
+bool FFmpegVideoDecoder::findWorkingDecoder(PDECODER_PARAMETERS params)
+{
     // First try decoders that the user has manually specified via environment variables.
     // These must output surfaces in one of the formats that one of our renderers supports,
     // which is currently:
@@ -1845,9 +2101,6 @@ bool FFmpegVideoDecoder::initialize(PDECODER_PARAMETERS params)
         }
     }
 
-    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
-                 "Unable to find working decoder for format: %x",
-                 params->videoFormat);
     return false;
 }
 
@@ -2151,9 +2404,16 @@ int FFmpegVideoDecoder::submitDecodeUnit(PDECODE_UNIT du)
             addVideoStats(m_LastWndVideoStats, lastTwoWndStats);
             addVideoStats(m_ActiveWndVideoStats, lastTwoWndStats);
 
-            stringifyVideoStats(lastTwoWndStats,
-                                Session::get()->getOverlayManager().getOverlayText(Overlay::OverlayDebug),
-                                Session::get()->getOverlayManager().getOverlayMaxTextLength());
+            char* overlayText = Session::get()->getOverlayManager().getOverlayText(Overlay::OverlayDebug);
+            int overlayMaxLength = Session::get()->getOverlayManager().getOverlayMaxTextLength();
+            stringifyVideoStats(lastTwoWndStats, overlayText, overlayMaxLength);
+
+            int videoStatsLength = (int)strlen(overlayText);
+            Session::get()->stringifyAudioStats(overlayText + videoStatsLength, overlayMaxLength - videoStatsLength);
+
+            int avStatsLength = (int)strlen(overlayText);
+            Session::get()->getInputStats()->stringify(overlayText + avStatsLength, overlayMaxLength - avStatsLength);
+
             Session::get()->getOverlayManager().setOverlayTextUpdated(Overlay::OverlayDebug);
         }
 
@@ -2196,6 +2456,15 @@ int FFmpegVideoDecoder::submitDecodeUnit(PDECODE_UNIT du)
         entry = entry->next;
     }
 
+    Session::get()->getAVSyncMonitor()->reportVideoFrameReceived(du->rtpTimestamp, du->receiveTimeUs);
+
+    StreamRecorder* recorder = Session::get()->getStreamRecorder();
+    if (recorder != nullptr) {
+        recorder->submitVideoPacket(m_DecodeBuffer.data(), offset,
+                                    du->frameNumber, du->frameType,
+                                    du->rtpTimestamp, du->receiveTimeUs);
+    }
+
     m_Pkt->data = reinterpret_cast<uint8_t*>(m_DecodeBuffer.data());
     m_Pkt->size = offset;
 
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <functional>
+#include <QMap>
 #include <QQueue>
 #include <set>
 
@@ -30,6 +31,7 @@ public:
     virtual void renderFrameOnMainThread() override;
     virtual void setHdrMode(bool enabled) override;
     virtual bool notifyWindowChanged(PWINDOW_STATE_CHANGE_INFO info) override;
+    virtual void requestFrameSnapshot() override;
 
     virtual IFFmpegRenderer* getBackendRenderer();
 
@@ -44,9 +46,32 @@ private:
         TestFrameOnly,
 
         // Submit the test frame and prepare for rendering
-        TestFrame
+        TestFrame,
+
+        // Render the test frame repeatedly to measure the renderer
+        // and do not prepare for streaming
+        Benchmark
+    };
+
+    enum class TuningState {
+        // Accept the first working renderer
+        Off,
+
+        // Benchmark each working renderer and keep searching
+        Measuring,
+
+        // Accept only the renderer chosen by a prior benchmark
+        Pinned
     };
 
+    bool findWorkingDecoder(PDECODER_PARAMETERS params);
+
+    bool initializeAutoTuned(PDECODER_PARAMETERS params);
+
+    QString getTuningCandidateName(const AVCodec* decoder);
+
+    bool benchmarkTestFrame(AVFrame* frame);
+
     bool completeInitialization(const AVCodec* decoder,
                                 enum AVPixelFormat requiredFormat,
                                 PDECODER_PARAMETERS params,
@@ -116,6 +141,7 @@ private:
     IFFmpegRenderer* m_FrontendRenderer;
     int m_ConsecutiveFailedDecodes;
     Pacer* m_Pacer;
+    FrameSnapshotter* m_FrameSnapshotter;
     BandwidthTracker m_BwTracker;
     VIDEO_STATS m_ActiveWndVideoStats;
     VIDEO_STATS m_LastWndVideoStats;
@@ -133,6 +159,10 @@ private:
     bool m_NeedsSpsFixup;
     bool m_TestOnly;
     TestMode m_CurrentTestMode;
+    TuningState m_TuningState;
+    QString m_TunedCandidate;
+    QMap<QString, uint64_t> m_TuningResults;
+    uint64_t m_BenchmarkP99RenderTimeUs;
     SDL_Thread* m_DecoderThread;
     SDL_atomic_t m_DecoderThreadShouldQuit;
     VideoEnhancement* m_VideoEnhancement;
@@ -140,6 +170,9 @@ private:
     // Data buffers in the queued DU are not valid
     QQueue<DECODE_UNIT> m_FrameInfoQueue;
 
+    static constexpr int k_BenchmarkWarmupFrames = 10;
+    static constexpr int k_BenchmarkFrames = 120;
+
     static const uint8_t k_H264TestFrame[];
     static const uint8_t k_HEVCMainTestFrame[];
     static const uint8_t k_HEVCMain10TestFrame[];
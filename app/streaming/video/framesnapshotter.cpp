@@ -0,0 +1,204 @@
+#include "framesnapshotter.h"
+#include "path.h"
+
+#include <QDateTime>
+#include <QDir>
+
+extern "C" {
+#include <libavutil/imgutils.h>
+#include <libswscale/swscale.h>
+}
+
+// The D3D12 renderer may also include the implementation in debug builds
+#define STB_IMAGE_WRITE_STATIC
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "stb_image_write.h"
+
+FrameSnapshotter::FrameSnapshotter(int videoFormat)
+    : m_WriterThread(nullptr),
+      m_Stopping(false)
+{
+    m_SwFrameMapper.setVideoFormat(videoFormat);
+    SDL_AtomicSet(&m_PendingRequests, 0);
+
+    m_SnapshotDir = qEnvironmentVariable("FRAME_SNAPSHOT_DIR", Path::getLogDir());
+}
+
+FrameSnapshotter::~FrameSnapshotter()
+{
+    if (m_WriterThread != nullptr) {
+        m_QueueLock.lock();
+        m_Stopping = true;
+        m_QueueLock.unlock();
+        m_QueueNotEmpty.wakeAll();
+
+        SDL_WaitThread(m_WriterThread, nullptr);
+    }
+
+    // Drop any snapshots that we didn't get to
+    while (!m_Queue.isEmpty()) {
+        AVFrame* frame = m_Queue.dequeue();
+        av_frame_free(&frame);
+    }
+}
+
+void FrameSnapshotter::requestSnapshot()
+{
+    if (SDL_AtomicAdd(&m_PendingRequests, 1) >= k_MaxQueuedSnapshots) {
+        SDL_AtomicAdd(&m_PendingRequests, -1);
+        SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION,
+                    "Dropping frame snapshot request: too many pending");
+        return;
+    }
+
+    SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+                "Frame snapshot requested");
+}
+
+void FrameSnapshotter::captureFrameIfRequested(AVFrame* frame)
+{
+    if (SDL_AtomicGet(&m_PendingRequests) == 0) {
+        return;
+    }
+
+    // Never wait on the writer thread here
+    if (!m_QueueLock.tryLock()) {
+        return;
+    }
+
+    if (m_WriterThread == nullptr) {
+        m_WriterThread = SDL_CreateThread(FrameSnapshotter::writerThreadProc, "FrameSnapshot", this);
+        if (m_WriterThread == nullptr) {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                         "Failed to create frame snapshot thread: %s",
+                         SDL_GetError());
+        }
+    }
+
+    if (m_WriterThread != nullptr && m_Queue.size() < k_MaxQueuedSnapshots) {
+        // Just take a reference here. A GPU readback would stall presentation.
+        AVFrame* snapshotFrame = av_frame_clone(frame);
+        if (snapshotFrame != nullptr) {
+            m_Queue.enqueue(snapshotFrame);
+            m_QueueNotEmpty.wakeOne();
+        }
+    }
+    else {
+        SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION,
+                    "Dropping frame snapshot: writer is busy");
+    }
+
+    m_QueueLock.unlock();
+
+    SDL_AtomicAdd(&m_PendingRequests, -1);
+}
+
+int FrameSnapshotter::writerThreadProc(void* context)
+{
+    FrameSnapshotter* me = reinterpret_cast<FrameSnapshotter*>(context);
+
+    SDL_SetThreadPriority(SDL_THREAD_PRIORITY_LOW);
+
+    me->m_QueueLock.lock();
+    while (!me->m_Stopping) {
+        if (me->m_Queue.isEmpty()) {
+            me->m_QueueNotEmpty.wait(&me->m_QueueLock);
+            continue;
+        }
+
+        AVFrame* frame = me->m_Queue.dequeue();
+        me->m_QueueLock.unlock();
+
+        me->writeSnapshot(frame);
+        av_frame_free(&frame);
+
+        me->m_QueueLock.lock();
+    }
+    me->m_QueueLock.unlock();
+
+    return 0;
+}
+
+void FrameSnapshotter::writeSnapshot(AVFrame* frame)
+{
+    AVFrame* swFrame = frame;
+    SwsContext* swsContext = nullptr;
+    uint8_t* rgbData[4] = {};
+    int rgbLinesize[4] = {};
+    int swsColorspace;
+    QString fileName;
+
+    if (frame->hw_frames_ctx != nullptr) {
+        swFrame = m_SwFrameMapper.getSwFrameFromHwFrame(frame);
+        if (swFrame == nullptr) {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                         "Unable to read back frame for snapshot");
+            return;
+        }
+    }
+
+    swsContext = sws_getContext(swFrame->width, swFrame->height, (AVPixelFormat)swFrame->format,
+                                swFrame->width, swFrame->height, AV_PIX_FMT_RGB24,
+                                SWS_BICUBIC, nullptr, nullptr, nullptr);
+    if (swsContext == nullptr) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                     "sws_getContext() failed for snapshot format: %s",
+                     av_get_pix_fmt_name((AVPixelFormat)swFrame->format));
+        goto Exit;
+    }
+
+    switch (swFrame->colorspace) {
+    case AVCOL_SPC_BT709:
+        swsColorspace = SWS_CS_ITU709;
+        break;
+    case AVCOL_SPC_BT2020_NCL:
+    case AVCOL_SPC_BT2020_CL:
+        swsColorspace = SWS_CS_BT2020;
+        break;
+    default:
+        swsColorspace = SWS_CS_ITU601;
+        break;
+    }
+
+    sws_setColorspaceDetails(swsContext,
+                             sws_getCoefficients(swsColorspace),
+                             swFrame->color_range == AVCOL_RANGE_JPEG ? 1 : 0,
+                             sws_getCoefficients(SWS_CS_DEFAULT),
+                             1, 0, 1 << 16, 1 << 16);
+
+    if (av_image_alloc(rgbData, rgbLinesize, swFrame->width, swFrame->height, AV_PIX_FMT_RGB24, 1) < 0) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                     "Failed to allocate snapshot buffer");
+        goto Exit;
+    }
+
+    sws_scale(swsContext, swFrame->data, swFrame->linesize, 0, swFrame->height, rgbData, rgbLinesize);
+
+    QDir().mkpath(m_SnapshotDir);
+    fileName = QDir(m_SnapshotDir).absoluteFilePath(
+                QString("Moonlight-Snapshot-%1-%2.png")
+                .arg(QDateTime::currentDateTime().toString("yyyyMMdd-hhmmss-zzz"))
+                .arg(swFrame->pts));
+
+    if (stbi_write_png(QFile::encodeName(fileName).constData(),
+                       swFrame->width, swFrame->height, 3,
+                       rgbData[0], rgbLinesize[0])) {
+        SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+                    "Saved %dx%d %s frame snapshot to %s",
+                    swFrame->width, swFrame->height,
+                    av_get_pix_fmt_name((AVPixelFormat)swFrame->format),
+                    qPrintable(fileName));
+    }
+    else {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                     "Failed to write frame snapshot to %s",
+                     qPrintable(fileName));
+    }
+
+Exit:
+    av_freep(&rgbData[0]);
+    sws_freeContext(swsContext);
+    if (swFrame != frame) {
+        av_frame_free(&swFrame);
+    }
+}
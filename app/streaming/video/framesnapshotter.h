@@ -0,0 +1,44 @@
+#pragma once
+
+#include "ffmpeg-renderers/swframemapper.h"
+
+#include <QMutex>
+#include <QQueue>
+#include <QWaitCondition>
+
+// Captures rendered frames to PNG files for debugging artifacts. The render
+// thread only takes a reference to the frame. Reading hardware frames back
+// into system memory, color conversion, and encoding all happen on a
+// separate writer thread.
+class FrameSnapshotter
+{
+public:
+    explicit FrameSnapshotter(int videoFormat);
+    ~FrameSnapshotter();
+
+    // Thread-safe. Requests beyond the queue limit are dropped.
+    void requestSnapshot();
+
+    // Called by Pacer on the render thread for each rendered frame
+    void captureFrameIfRequested(AVFrame* frame);
+
+private:
+    static int writerThreadProc(void* context);
+
+    void writeSnapshot(AVFrame* frame);
+
+    // Only used on the writer thread
+    SwFrameMapper m_SwFrameMapper;
+
+    SDL_atomic_t m_PendingRequests;
+    QMutex m_QueueLock;
+    QWaitCondition m_QueueNotEmpty;
+    QQueue<AVFrame*> m_Queue;
+    SDL_Thread* m_WriterThread;
+    bool m_Stopping;
+    QString m_SnapshotDir;
+
+    // Queued frames may hold decoder surfaces, so keep this small to avoid
+    // starving decoders that have a fixed-size surface pool
+    static constexpr int k_MaxQueuedSnapshots = 2;
+};
@@ -116,6 +116,73 @@ void OverlayManager::setOverlayRenderer(IOverlayRenderer* renderer)
     m_Renderer = renderer;
 }
 
+int OverlayManager::getDirtyRects(SDL_Surface* oldSurface, SDL_Surface* newSurface,
+                                  SDL_Rect* dirtyRects, int maxDirtyRects)
+{
+    if (oldSurface == nullptr || newSurface == nullptr || maxDirtyRects <= 0) {
+        return -1;
+    }
+
+    // We only handle the 32-bit formats that SDL_ttf produces
+    if (oldSurface->w != newSurface->w || oldSurface->h != newSurface->h ||
+            oldSurface->format->format != newSurface->format->format ||
+            newSurface->format->BytesPerPixel != 4 ||
+            SDL_MUSTLOCK(oldSurface) || SDL_MUSTLOCK(newSurface)) {
+        return -1;
+    }
+
+    int dirtyRectCount = 0;
+    int cleanRows = 0;
+    SDL_Rect* currentRect = nullptr;
+
+    for (int y = 0; y < newSurface->h; y++) {
+        auto oldRow = (const Uint32*)((const Uint8*)oldSurface->pixels + (y * oldSurface->pitch));
+        auto newRow = (const Uint32*)((const Uint8*)newSurface->pixels + (y * newSurface->pitch));
+
+        if (memcmp(oldRow, newRow, newSurface->w * sizeof(Uint32)) == 0) {
+            // Glyphs don't cover every row of a line of text, so we only close
+            // the current band after a gap that looks like the space between lines.
+            if (currentRect != nullptr && ++cleanRows > k_DirtyRectMergeRows) {
+                currentRect = nullptr;
+            }
+            continue;
+        }
+
+        // Narrow the row down to the changed columns
+        int left = 0;
+        while (oldRow[left] == newRow[left]) {
+            left++;
+        }
+        int right = newSurface->w;
+        while (oldRow[right - 1] == newRow[right - 1]) {
+            right--;
+        }
+
+        cleanRows = 0;
+
+        if (currentRect == nullptr) {
+            if (dirtyRectCount < maxDirtyRects) {
+                currentRect = &dirtyRects[dirtyRectCount++];
+                currentRect->x = left;
+                currentRect->y = y;
+                currentRect->w = right - left;
+                currentRect->h = 1;
+                continue;
+            }
+
+            // If we're out of rects, grow the last one to cover this band too
+            currentRect = &dirtyRects[dirtyRectCount - 1];
+        }
+
+        int x2 = SDL_max(currentRect->x + currentRect->w, right);
+        currentRect->x = SDL_min(currentRect->x, left);
+        currentRect->w = x2 - currentRect->x;
+        currentRect->h = y - currentRect->y + 1;
+    }
+
+    return dirtyRectCount;
+}
+
 void OverlayManager::notifyOverlayUpdated(OverlayType type)
 {
     if (m_Renderer == nullptr) {
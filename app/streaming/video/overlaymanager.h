@@ -39,7 +39,19 @@ public:
 
     void setOverlayRenderer(IOverlayRenderer* renderer);
 
+    // Finds the regions that differ between two overlay surfaces of the same
+    // size and format, grouped into bands that roughly match lines of text.
+    // Returns the number of rects written, or -1 if the surfaces can't be
+    // compared and the whole overlay must be uploaded again.
+    static int getDirtyRects(SDL_Surface* oldSurface, SDL_Surface* newSurface,
+                             SDL_Rect* dirtyRects, int maxDirtyRects);
+
+    static constexpr int k_MaxDirtyRects = 16;
+
 private:
+    // Clean rows tolerated inside a single dirty band before it is closed
+    static constexpr int k_DirtyRectMergeRows = 8;
+
     void notifyOverlayUpdated(OverlayType type);
     SDL_Surface* RenderTextOutlinedWrapped(TTF_Font* font, const char* text, SDL_Color textColor, SDL_Color outlineColor, int outlineWidth, int wrapWidth);
 
@@ -0,0 +1,81 @@
+#include "renderertuning.h"
+#include "utils.h"
+
+#include <QSettings>
+
+#define SER_RENDERERTUNING "renderertuning"
+#define SER_CANDIDATE "candidate"
+#define SER_RENDERERSELECTION "rendererselection"
+#define SER_P99RENDERTIME "p99rendertimeus"
+
+QAtomicInt RendererTuning::s_RetuneRequested;
+
+QString RendererTuning::getTuningKey(PDECODER_PARAMETERS params)
+{
+    QString display;
+    int displayIndex = SDL_GetWindowDisplayIndex(params->window);
+    SDL_DisplayMode mode;
+    if (displayIndex >= 0 && SDL_GetCurrentDisplayMode(displayIndex, &mode) == 0) {
+        display = QString("%1 %2x%3@%4")
+                .arg(SDL_GetDisplayName(displayIndex))
+                .arg(mode.w)
+                .arg(mode.h)
+                .arg(mode.refresh_rate);
+    }
+
+    QString tuningKey = QString("%1 [%2] %3 %4x%5")
+            .arg(display, WMUtils::getGpuIdentifier())
+            .arg(params->videoFormat, 0, 16)
+            .arg(params->width)
+            .arg(params->height);
+
+    // QSettings treats slashes as group separators
+    tuningKey.replace('/', '_');
+    tuningKey.replace('\\', '_');
+    return tuningKey;
+}
+
+bool RendererTuning::load(const QString& tuningKey, Result& result)
+{
+    QSettings settings;
+
+    settings.beginGroup(SER_RENDERERTUNING);
+    settings.beginGroup(tuningKey);
+
+    result.candidate = settings.value(SER_CANDIDATE).toString();
+    result.rendererSelection = static_cast<StreamingPreferences::RendererSelection>(
+                settings.value(SER_RENDERERSELECTION, static_cast<int>(StreamingPreferences::RS_AUTO)).toInt());
+    result.p99RenderTimeUs = settings.value(SER_P99RENDERTIME, 0).toULongLong();
+
+    return !result.candidate.isEmpty();
+}
+
+void RendererTuning::save(const QString& tuningKey, const Result& result)
+{
+    QSettings settings;
+
+    settings.beginGroup(SER_RENDERERTUNING);
+    settings.beginGroup(tuningKey);
+
+    settings.setValue(SER_CANDIDATE, result.candidate);
+    settings.setValue(SER_RENDERERSELECTION, static_cast<int>(result.rendererSelection));
+    settings.setValue(SER_P99RENDERTIME, (qulonglong)result.p99RenderTimeUs);
+}
+
+void RendererTuning::remove(const QString& tuningKey)
+{
+    QSettings settings;
+
+    settings.beginGroup(SER_RENDERERTUNING);
+    settings.remove(tuningKey);
+}
+
+void RendererTuning::requestRetune()
+{
+    s_RetuneRequested.storeRelease(1);
+}
+
+bool RendererTuning::takeRetuneRequest()
+{
+    return s_RetuneRequested.testAndSetOrdered(1, 0);
+}
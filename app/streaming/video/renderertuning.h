@@ -0,0 +1,39 @@
+#pragma once
+
+#include "decoder.h"
+
+#include <QString>
+#include <QAtomicInt>
+
+// Persists the outcome of renderer auto-tuning (RS_AUTO_TUNE) so the
+// benchmark only runs once for each display, GPU, and stream format.
+class RendererTuning
+{
+public:
+    struct Result {
+        // Decoder, backend renderer, and frontend renderer names
+        QString candidate;
+
+        // Renderer selection that produced the candidate
+        StreamingPreferences::RendererSelection rendererSelection;
+
+        uint64_t p99RenderTimeUs;
+    };
+
+    static QString getTuningKey(PDECODER_PARAMETERS params);
+
+    static bool load(const QString& tuningKey, Result& result);
+
+    static void save(const QString& tuningKey, const Result& result);
+
+    static void remove(const QString& tuningKey);
+
+    // Makes the next auto-tuned decoder initialization ignore (and replace)
+    // its cached result. Results for other displays and formats are kept.
+    static void requestRetune();
+
+    static bool takeRetuneRequest();
+
+private:
+    static QAtomicInt s_RetuneRequested;
+};
@@ -34,6 +34,9 @@ public:
         return false;
     }
 
+    // Frame snapshots are not supported by SLVideo
+    virtual void requestFrameSnapshot() override {}
+
 private:
     static void slLogCallback(void* context, ESLVideoLog logLevel, const char* message);
 
@@ -14,6 +14,7 @@ namespace WMUtils {
     bool isRunningDesktopEnvironment();
     QString getDrmCardOverride();
     bool isGpuSlow();
+    QString getGpuIdentifier();
 }
 
 namespace Utils {
@@ -260,3 +260,36 @@ QString WMUtils::getDrmCardOverride()
 
     return QString();
 }
+
+QString WMUtils::getGpuIdentifier()
+{
+#if defined(Q_OS_UNIX) && !defined(Q_OS_DARWIN)
+    // Collect the PCI vendor and device IDs of all DRM cards. This is
+    // stable across reboots and changes if the GPU is swapped out.
+    QDir dir("/sys/class/drm");
+    QStringList cardList = dir.entryList(QStringList("card*"), QDir::Dirs | QDir::System);
+    QStringList gpuIds;
+    for (const QString& card : cardList) {
+        // Skip connector nodes like card0-HDMI-A-1
+        if (card.contains('-')) {
+            continue;
+        }
+
+        QFile vendorFile(dir.filePath(card + "/device/vendor"));
+        QFile deviceFile(dir.filePath(card + "/device/device"));
+        if (!vendorFile.open(QFile::ReadOnly) || !deviceFile.open(QFile::ReadOnly)) {
+            continue;
+        }
+
+        QString gpuId = QString("%1:%2").arg(QString(vendorFile.readAll().trimmed()),
+                                             QString(deviceFile.readAll().trimmed()));
+        if (!gpuIds.contains(gpuId)) {
+            gpuIds.append(gpuId);
+        }
+    }
+
+    return gpuIds.join(',');
+#else
+    return QString();
+#endif
+}
@@ -12,6 +12,12 @@ win32:!winrt {
     app.depends += AntiHooking
 }
 
+# Developer benchmarks and test tools
+build-tools {
+    SUBDIRS += tools
+    tools.depends = moonlight-common-c
+}
+
 # Support debug and release builds from command line for CI
 CONFIG += debug_and_release
 
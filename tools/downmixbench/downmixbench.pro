@@ -0,0 +1,31 @@
+TARGET = downmixbench
+
+include(../tools.pri)
+
+win32 {
+    contains(QT_ARCH, x86_64) {
+        LIBS += -L$$PWD/../../libs/windows/lib/x64
+        INCLUDEPATH += $$PWD/../../libs/windows/include/x64 $$PWD/../../libs/windows/include/x64/SDL2
+    }
+    contains(QT_ARCH, arm64) {
+        LIBS += -L$$PWD/../../libs/windows/lib/arm64
+        INCLUDEPATH += $$PWD/../../libs/windows/include/arm64 $$PWD/../../libs/windows/include/arm64/SDL2
+    }
+
+    LIBS += -lSDL2
+}
+macx:!disable-prebuilts {
+    INCLUDEPATH += $$PWD/../../libs/mac/include $$PWD/../../libs/mac/include/SDL2
+    LIBS += -L$$PWD/../../libs/mac/lib -lSDL2
+}
+unix:if(!macx|disable-prebuilts) {
+    CONFIG += link_pkgconfig
+    PKGCONFIG += sdl2
+}
+
+SOURCES += \
+    main.cpp \
+    $$APP_SRC/streaming/audio/downmixer.cpp
+
+HEADERS += \
+    $$APP_SRC/streaming/audio/downmixer.h
@@ -0,0 +1,92 @@
+#include "streaming/audio/downmixer.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QStringList>
+
+#include <cstdio>
+#include <vector>
+
+#define DEFAULT_ITERATIONS 2000
+
+// 10 ms of audio at 48 KHz
+#define FRAMES_PER_PACKET 480
+
+// Compares the vectorized downmixing paths against the scalar ones
+class DownmixBenchmark
+{
+public:
+    static void run(int iterations)
+    {
+        const int configs[][2] = { { 8, 6 }, { 8, 2 }, { 6, 2 } };
+
+        std::vector<float> floatIn(FRAMES_PER_PACKET * 8);
+        std::vector<float> floatOut(FRAMES_PER_PACKET * 6);
+        std::vector<short> shortIn(FRAMES_PER_PACKET * 8);
+        std::vector<short> shortOut(FRAMES_PER_PACKET * 6);
+
+        for (int i = 0; i < FRAMES_PER_PACKET * 8; i++) {
+            floatIn[i] = (float)((i * 7919) % 2001 - 1000) / 1000.0f;
+            shortIn[i] = (short)(floatIn[i] * 32767);
+        }
+
+        printf("ns per %d frame packet, %d iterations\n", FRAMES_PER_PACKET, iterations);
+        printf("%-8s %10s %10s %10s %10s\n", "layout", "float", "scalar", "s16", "scalar");
+
+        for (const auto& config : configs) {
+            AudioDownmixer downmixer(config[0], config[1]);
+            QElapsedTimer timer;
+            qint64 times[4];
+
+            timer.start();
+            for (int i = 0; i < iterations; i++) {
+                downmixer.process(floatIn.data(), floatOut.data(), FRAMES_PER_PACKET);
+            }
+            times[0] = timer.nsecsElapsed();
+
+            timer.restart();
+            for (int i = 0; i < iterations; i++) {
+                downmixer.processScalar(floatIn.data(), floatOut.data(), FRAMES_PER_PACKET);
+            }
+            times[1] = timer.nsecsElapsed();
+
+            timer.restart();
+            for (int i = 0; i < iterations; i++) {
+                downmixer.process(shortIn.data(), shortOut.data(), FRAMES_PER_PACKET);
+            }
+            times[2] = timer.nsecsElapsed();
+
+            timer.restart();
+            for (int i = 0; i < iterations; i++) {
+                downmixer.processScalar(shortIn.data(), shortOut.data(), FRAMES_PER_PACKET);
+            }
+            times[3] = timer.nsecsElapsed();
+
+            printf("%d -> %d   %10.0f %10.0f %10.0f %10.0f\n",
+                   config[0], config[1],
+                   (double)times[0] / iterations,
+                   (double)times[1] / iterations,
+                   (double)times[2] / iterations,
+                   (double)times[3] / iterations);
+        }
+    }
+};
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    int iterations = DEFAULT_ITERATIONS;
+    QStringList args = app.arguments();
+    if (args.size() > 1) {
+        bool ok;
+        iterations = args[1].toInt(&ok);
+        if (!ok || iterations <= 0) {
+            fprintf(stderr, "Usage: downmixbench [iterations]\n");
+            return 1;
+        }
+    }
+
+    DownmixBenchmark::run(iterations);
+    return 0;
+}
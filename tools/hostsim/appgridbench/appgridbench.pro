@@ -0,0 +1,17 @@
+TARGET = appgridbench
+
+include(../hostsim.pri)
+include(../client.pri)
+
+# BoxArtManager uses QImage and provides images to QML
+QT += gui quick
+
+SOURCES += \
+    main.cpp \
+    $$APP_SRC/backend/boxartmanager.cpp
+
+HEADERS += \
+    $$APP_SRC/backend/boxartmanager.h
+
+# boxartmanager.h pulls in the ComputerManager declarations
+INCLUDEPATH += $$PWD/../../../qmdnsengine/qmdnsengine/src/include $$PWD/../../../qmdnsengine
@@ -0,0 +1,129 @@
+#include "benchhosts.h"
+#include "backend/boxartmanager.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QSet>
+#include <QTimer>
+
+#include <cstdio>
+
+// Measures how long it takes to populate the app grid for a host: fetching
+// the app list, then loading box art the way AppModel does, with the first
+// screenful of apps marked visible.
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    BenchHosts::initialize();
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Benchmarks app grid population against a simulated host.");
+    parser.addHelpOption();
+    BenchHosts::addOptions(parser, 1, 200);
+    parser.addOptions({
+        { "visible", "Number of apps on the first screen.", "count", "24" },
+        { "warm", "Keep box art cached by previous runs." },
+        { "timeout", "How long to wait for all box art to load.", "seconds", "120" },
+    });
+    parser.process(app);
+
+    HostSimProcess simulator;
+    if (!simulator.start(BenchHosts::getSimulatorPath(parser), BenchHosts::getSimulatorArguments(parser))) {
+        return 1;
+    }
+
+    QVector<NvComputer*> computers = BenchHosts::connectToHosts(parser);
+    if (computers.isEmpty()) {
+        return 1;
+    }
+
+    // Only the first host is used, since the grid shows one host at a time
+    NvComputer* computer = computers.first();
+    if (!parser.isSet("warm")) {
+        BoxArtManager::deleteBoxArt(computer);
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QVector<NvApp> apps;
+    try {
+        apps = NvHTTP(computer).getAppList();
+    } catch (const GfeHttpResponseException& e) {
+        fprintf(stderr, "Failed to get app list: %s\n", e.what());
+        return 1;
+    } catch (const QtNetworkReplyException& e) {
+        fprintf(stderr, "Failed to get app list: %s\n", qPrintable(e.toQString()));
+        return 1;
+    }
+
+    qint64 appListMs = timer.elapsed();
+    printf("Fetched %d apps in %lld ms\n", (int)apps.size(), (long long)appListMs);
+
+    int visibleCount = qMin(parser.value("visible").toInt(), (int)apps.size());
+    QSet<int> pendingVisible;
+    QSet<int> pending;
+    qint64 visibleLoadedMs = -1;
+    bool finished = false;
+
+    auto finish = [&]() {
+        if (finished) {
+            return;
+        }
+        finished = true;
+
+        printf("First %d apps loaded %s%lld ms after the app list, all %d in %lld ms (%d missing)\n",
+               visibleCount,
+               visibleLoadedMs < 0 ? "never, " : "",
+               (long long)qMax<qint64>(visibleLoadedMs, 0),
+               (int)apps.size(),
+               (long long)(timer.elapsed() - appListMs),
+               (int)pending.size());
+        app.quit();
+    };
+
+    BoxArtManager boxArtManager;
+    QObject::connect(&boxArtManager, &BoxArtManager::boxArtLoadComplete, &app, [&](QString, NvApp loadedApp, QUrl) {
+        pending.remove(loadedApp.id);
+        if (pendingVisible.remove(loadedApp.id) && pendingVisible.isEmpty()) {
+            visibleLoadedMs = timer.elapsed() - appListMs;
+        }
+        if (pending.isEmpty()) {
+            finish();
+        }
+    });
+
+    // AppModel reports the visible range, then the delegates request their images in order
+    QVector<int> visibleAppIds;
+    for (int i = 0; i < visibleCount; i++) {
+        visibleAppIds.append(apps[i].id);
+    }
+    boxArtManager.setVisibleApps(computer, visibleAppIds);
+
+    for (int i = 0; i < apps.size(); i++) {
+        // Cache hits come back as an image URL right away
+        if (boxArtManager.loadBoxArt(computer, apps[i]).scheme() != "image") {
+            pending.insert(apps[i].id);
+            if (i < visibleCount) {
+                pendingVisible.insert(apps[i].id);
+            }
+        }
+    }
+
+    if (pendingVisible.isEmpty()) {
+        visibleLoadedMs = timer.elapsed() - appListMs;
+    }
+
+    int ret = 0;
+    if (pending.isEmpty()) {
+        finish();
+    }
+    else {
+        QTimer::singleShot(parser.value("timeout").toInt() * 1000, &app, finish);
+        ret = app.exec();
+    }
+
+    // Fetches that timed out may still be using the hosts, so they're leaked
+    return ret;
+}
@@ -0,0 +1,42 @@
+# Builds the parts of the client backend that talk to hosts, so the
+# benchmark drivers exercise the same code as the app itself.
+
+SOURCES += \
+    $$PWD/common/benchhosts.cpp \
+    $$APP_SRC/path.cpp \
+    $$APP_SRC/backend/hostpoller.cpp \
+    $$APP_SRC/backend/identitymanager.cpp \
+    $$APP_SRC/backend/nvaddress.cpp \
+    $$APP_SRC/backend/nvapp.cpp \
+    $$APP_SRC/backend/nvcomputer.cpp \
+    $$APP_SRC/backend/nvhttp.cpp \
+    $$APP_SRC/backend/nvpairingmanager.cpp \
+    $$APP_SRC/backend/nvserverinfo.cpp \
+    $$APP_SRC/settings/compatfetcher.cpp
+
+HEADERS += \
+    $$PWD/common/benchhosts.h \
+    $$APP_SRC/path.h \
+    $$APP_SRC/backend/hostpoller.h \
+    $$APP_SRC/backend/identitymanager.h \
+    $$APP_SRC/backend/nvaddress.h \
+    $$APP_SRC/backend/nvapp.h \
+    $$APP_SRC/backend/nvcomputer.h \
+    $$APP_SRC/backend/nvhttp.h \
+    $$APP_SRC/backend/nvpairingmanager.h \
+    $$APP_SRC/backend/nvserverinfo.h \
+    $$APP_SRC/settings/compatfetcher.h
+
+INCLUDEPATH += $$PWD/common
+
+# NvHTTP uses the launch query parameters from moonlight-common-c
+win32:CONFIG(release, debug|release): LIBS += -L$$OUT_PWD/../../../moonlight-common-c/release/ -lmoonlight-common-c
+else:win32:CONFIG(debug, debug|release): LIBS += -L$$OUT_PWD/../../../moonlight-common-c/debug/ -lmoonlight-common-c
+else:unix: LIBS += -L$$OUT_PWD/../../../moonlight-common-c/ -lmoonlight-common-c
+
+INCLUDEPATH += $$PWD/../../moonlight-common-c/moonlight-common-c/src
+DEPENDPATH += $$PWD/../../moonlight-common-c/moonlight-common-c/src
+
+win32 {
+    LIBS += ws2_32.lib winmm.lib
+}
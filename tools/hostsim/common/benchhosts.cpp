@@ -0,0 +1,195 @@
+#include "benchhosts.h"
+#include "backend/nvpairingmanager.h"
+#include "path.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+
+#include <algorithm>
+#include <cstdio>
+
+#ifdef Q_OS_WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <sys/resource.h>
+#endif
+
+// Generating the simulator's certificate can take a moment
+#define SIMULATOR_START_TIMEOUT_MS 30000
+
+#define SIMULATOR_PIN "1234"
+
+HostSimProcess::~HostSimProcess()
+{
+    if (m_Process.state() != QProcess::NotRunning) {
+        m_Process.kill();
+        m_Process.waitForFinished();
+    }
+}
+
+bool HostSimProcess::start(const QString& program, const QStringList& arguments)
+{
+    // The simulator doesn't print anything after it's ready with --quiet
+    m_Process.setProcessChannelMode(QProcess::ForwardedErrorChannel);
+    m_Process.start(program, QStringList(arguments) << "--quiet");
+    if (!m_Process.waitForStarted()) {
+        fprintf(stderr, "Failed to start %s: %s\n", qPrintable(program), qPrintable(m_Process.errorString()));
+        return false;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    while (timer.elapsed() < SIMULATOR_START_TIMEOUT_MS) {
+        if (!m_Process.canReadLine() && !m_Process.waitForReadyRead(SIMULATOR_START_TIMEOUT_MS - timer.elapsed())) {
+            break;
+        }
+
+        while (m_Process.canReadLine()) {
+            QByteArray line = m_Process.readLine().trimmed();
+            if (line == "READY") {
+                return true;
+            }
+
+            printf("%s\n", line.constData());
+        }
+    }
+
+    fprintf(stderr, "Simulator didn't start\n");
+    return false;
+}
+
+void BenchHosts::initialize()
+{
+    QCoreApplication::setOrganizationName("Moonlight Game Streaming Project");
+    QCoreApplication::setOrganizationDomain("moonlight-stream.com");
+    QCoreApplication::setApplicationName("hostsim-bench");
+
+    Path::initialize(false);
+}
+
+void BenchHosts::addOptions(QCommandLineParser& parser, int defaultHosts, int defaultApps)
+{
+    parser.addOptions({
+        { "hosts", "Number of hosts to simulate.", "count", QString::number(defaultHosts) },
+        { "apps", "Number of apps on each host.", "count", QString::number(defaultApps) },
+        { "base-port", "HTTP port of the first simulated host.", "port", "50000" },
+        { "latency", "Simulated delay before every response.", "ms", "0" },
+        { "jitter", "Random extra delay of up to this much.", "ms", "0" },
+        { "failure-rate", "Fraction of requests (0-1) that fail.", "rate", "0" },
+        { "hostsim", "Path to the hostsim executable.", "path" },
+    });
+}
+
+QStringList BenchHosts::getSimulatorArguments(const QCommandLineParser& parser)
+{
+    QStringList arguments;
+
+    for (const char* option : { "hosts", "apps", "base-port", "latency", "jitter", "failure-rate" }) {
+        arguments << QString("--") + option << parser.value(option);
+    }
+    arguments << "--pin" << SIMULATOR_PIN;
+
+    return arguments;
+}
+
+QString BenchHosts::getSimulatorPath(const QCommandLineParser& parser)
+{
+    if (parser.isSet("hostsim")) {
+        return parser.value("hostsim");
+    }
+
+#ifdef Q_OS_WIN32
+    return QDir(QCoreApplication::applicationDirPath()).absoluteFilePath("hostsim.exe");
+#else
+    return QDir(QCoreApplication::applicationDirPath()).absoluteFilePath("hostsim");
+#endif
+}
+
+QVector<NvComputer*> BenchHosts::connectToHosts(const QCommandLineParser& parser)
+{
+    QVector<NvComputer*> computers;
+    int hostCount = parser.value("hosts").toInt();
+    quint16 basePort = (quint16)parser.value("base-port").toUInt();
+
+    QElapsedTimer timer;
+    timer.start();
+
+    for (int i = 0; i < hostCount; i++) {
+        NvAddress address("127.0.0.1", basePort + i * 2);
+        NvHTTP http(address, 0, QSslCertificate(), false);
+
+        // Injected failures can hit us here too, so retry a few times
+        NvComputer* computer = nullptr;
+        for (int attempt = 0; attempt < 5 && computer == nullptr; attempt++) {
+            try {
+                NvServerInfo serverInfo = http.getServerInfo(NvHTTP::NVLL_NONE);
+                computer = new NvComputer(http, serverInfo);
+                computer->manualAddress = address;
+
+                NvPairingManager pairingManager(computer);
+                if (pairingManager.pair(computer->appVersion, SIMULATOR_PIN, computer->serverCert) != NvPairingManager::PairState::PAIRED) {
+                    delete computer;
+                    computer = nullptr;
+                }
+            } catch (const GfeHttpResponseException&) {
+                delete computer;
+                computer = nullptr;
+            } catch (const QtNetworkReplyException&) {
+                delete computer;
+                computer = nullptr;
+            }
+        }
+
+        if (computer == nullptr) {
+            fprintf(stderr, "Failed to pair with simulated host %d\n", i);
+            qDeleteAll(computers);
+            return QVector<NvComputer*>();
+        }
+
+        // Start out like a host that was just loaded from disk
+        computer->pairState = NvComputer::PS_PAIRED;
+        computer->state = NvComputer::CS_UNKNOWN;
+        computers.append(computer);
+    }
+
+    printf("Paired with %d hosts in %lld ms\n", hostCount, (long long)timer.elapsed());
+    return computers;
+}
+
+qint64 BenchHosts::getProcessCpuTimeUs()
+{
+#ifdef Q_OS_WIN32
+    FILETIME creationTime, exitTime, kernelTime, userTime;
+    if (!GetProcessTimes(GetCurrentProcess(), &creationTime, &exitTime, &kernelTime, &userTime)) {
+        return 0;
+    }
+
+    // FILETIMEs are in 100 ns units
+    ULARGE_INTEGER kernel, user;
+    kernel.LowPart = kernelTime.dwLowDateTime;
+    kernel.HighPart = kernelTime.dwHighDateTime;
+    user.LowPart = userTime.dwLowDateTime;
+    user.HighPart = userTime.dwHighDateTime;
+    return (qint64)((kernel.QuadPart + user.QuadPart) / 10);
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+
+    return (qint64)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000 +
+            usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+#endif
+}
+
+qint64 BenchHosts::percentile(QVector<qint64> values, int percent)
+{
+    if (values.isEmpty()) {
+        return 0;
+    }
+
+    std::sort(values.begin(), values.end());
+    return values[qMin(values.size() - 1, values.size() * percent / 100)];
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "backend/nvcomputer.h"
+
+#include <QCommandLineParser>
+#include <QProcess>
+#include <QStringList>
+#include <QVector>
+
+// Runs the host simulator in a child process, so its CPU time
+// isn't counted against the client code being measured
+class HostSimProcess
+{
+public:
+    ~HostSimProcess();
+
+    // Returns once the simulator is accepting connections
+    bool
+    start(const QString& program, const QStringList& arguments);
+
+private:
+    QProcess m_Process;
+};
+
+namespace BenchHosts
+{
+    // Keeps the benchmarks' client identity, settings, and box art
+    // cache separate from the real app's
+    void
+    initialize();
+
+    // Options shared by every benchmark for configuring the simulator
+    void
+    addOptions(QCommandLineParser& parser, int defaultHosts, int defaultApps);
+
+    QStringList
+    getSimulatorArguments(const QCommandLineParser& parser);
+
+    QString
+    getSimulatorPath(const QCommandLineParser& parser);
+
+    // Fetches serverinfo from each simulated host and pairs with it. The
+    // hosts are returned in the same state as if they were loaded from disk.
+    QVector<NvComputer*>
+    connectToHosts(const QCommandLineParser& parser);
+
+    // User and system CPU time of this whole process
+    qint64
+    getProcessCpuTimeUs();
+
+    qint64
+    percentile(QVector<qint64> values, int percent);
+}
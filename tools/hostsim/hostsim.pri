@@ -0,0 +1,32 @@
+include(../tools.pri)
+
+QT += network
+
+# The benchmark drivers expect to find the simulator next to them
+CONFIG(debug, debug|release) {
+    DESTDIR = $$OUT_PWD/../bin/debug
+} else {
+    DESTDIR = $$OUT_PWD/../bin/release
+}
+
+win32 {
+    contains(QT_ARCH, x86_64) {
+        LIBS += -L$$PWD/../../libs/windows/lib/x64
+        INCLUDEPATH += $$PWD/../../libs/windows/include/x64
+    }
+    contains(QT_ARCH, arm64) {
+        LIBS += -L$$PWD/../../libs/windows/lib/arm64
+        INCLUDEPATH += $$PWD/../../libs/windows/include/arm64
+    }
+
+    INCLUDEPATH += $$PWD/../../libs/windows/include
+    LIBS += -llibssl -llibcrypto
+}
+macx:!disable-prebuilts {
+    INCLUDEPATH += $$PWD/../../libs/mac/include
+    LIBS += -L$$PWD/../../libs/mac/lib -lssl.3 -lcrypto.3
+}
+unix:if(!macx|disable-prebuilts) {
+    CONFIG += link_pkgconfig
+    PKGCONFIG += openssl
+}
@@ -0,0 +1,9 @@
+TEMPLATE = subdirs
+SUBDIRS = \
+    server \
+    pollbench \
+    appgridbench
+
+# The benchmark drivers launch the simulator from their own directory
+pollbench.depends = server
+appgridbench.depends = server
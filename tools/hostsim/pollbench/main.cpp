@@ -0,0 +1,117 @@
+#include "benchhosts.h"
+#include "backend/hostpoller.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QTimer>
+
+#include <cstdio>
+
+// Measures how long it takes HostPoller to bring a set of known hosts
+// online, then how much CPU it burns keeping them polled afterwards.
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    BenchHosts::initialize();
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Benchmarks host polling against simulated hosts.");
+    parser.addHelpOption();
+    BenchHosts::addOptions(parser, 50, 20);
+    parser.addOptions({
+        { "online-timeout", "How long to wait for every host to come online.", "seconds", "60" },
+        { "duration", "How long to measure steady-state polling for.", "seconds", "60" },
+    });
+    parser.process(app);
+
+    HostSimProcess simulator;
+    if (!simulator.start(BenchHosts::getSimulatorPath(parser), BenchHosts::getSimulatorArguments(parser))) {
+        return 1;
+    }
+
+    QVector<NvComputer*> computers = BenchHosts::connectToHosts(parser);
+    if (computers.isEmpty()) {
+        return 1;
+    }
+
+    HostPoller poller;
+    QElapsedTimer startTimer;
+    QHash<NvComputer*, qint64> onlineTimes;
+    bool steadyState = false;
+    int steadyStateChanges = 0;
+    qint64 steadyStartCpuUs = 0;
+    QElapsedTimer steadyTimer;
+    QTimer onlineTimeout;
+    onlineTimeout.setSingleShot(true);
+
+    auto startSteadyState = [&]() {
+        onlineTimeout.stop();
+
+        QVector<qint64> times;
+        for (qint64 time : std::as_const(onlineTimes)) {
+            times.append(time);
+        }
+
+        printf("%d/%d hosts online. Time to online: p50 %lld ms, p95 %lld ms, max %lld ms\n",
+               (int)onlineTimes.size(), (int)computers.size(),
+               (long long)BenchHosts::percentile(times, 50),
+               (long long)BenchHosts::percentile(times, 95),
+               (long long)BenchHosts::percentile(times, 100));
+        fflush(stdout);
+
+        steadyState = true;
+        steadyStartCpuUs = BenchHosts::getProcessCpuTimeUs();
+        steadyTimer.start();
+        QTimer::singleShot(parser.value("duration").toInt() * 1000, &app, [&]() {
+            qint64 cpuUs = BenchHosts::getProcessCpuTimeUs() - steadyStartCpuUs;
+            qint64 wallMs = steadyTimer.elapsed();
+
+            printf("Polling %d hosts for %lld ms used %.1f ms of CPU per second (%.2f%% of a core, %.1f us/s per host), %d state changes\n",
+                   (int)computers.size(), (long long)wallMs,
+                   cpuUs / (double)wallMs,
+                   cpuUs / (wallMs * 10.0),
+                   cpuUs * 1000.0 / wallMs / computers.size(),
+                   steadyStateChanges);
+            app.quit();
+        });
+    };
+
+    QObject::connect(&poller, &HostPoller::computerStateChanged, &app, [&](NvComputer* computer) {
+        NvComputer::ComputerState state;
+        {
+            QReadLocker locker(&computer->lock);
+            state = computer->state;
+        }
+
+        if (steadyState) {
+            // With injected failures, hosts will flap between online and offline
+            steadyStateChanges++;
+        }
+        else if (state == NvComputer::CS_ONLINE && !onlineTimes.contains(computer)) {
+            onlineTimes.insert(computer, startTimer.elapsed());
+            if (onlineTimes.size() == computers.size()) {
+                startSteadyState();
+            }
+        }
+    });
+
+    QObject::connect(&onlineTimeout, &QTimer::timeout, &app, startSteadyState);
+    onlineTimeout.start(parser.value("online-timeout").toInt() * 1000);
+
+    startTimer.start();
+    for (NvComputer* computer : std::as_const(computers)) {
+        poller.addComputer(computer);
+    }
+
+    int ret = app.exec();
+
+    poller.stopAll();
+    for (NvComputer* computer : std::as_const(computers)) {
+        poller.removeComputer(computer);
+    }
+    qDeleteAll(computers);
+
+    return ret;
+}
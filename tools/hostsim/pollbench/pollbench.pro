@@ -0,0 +1,7 @@
+TARGET = pollbench
+
+include(../hostsim.pri)
+include(../client.pri)
+
+SOURCES += \
+    main.cpp
@@ -0,0 +1,146 @@
+#include "simidentity.h"
+#include "simulatedhost.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QBuffer>
+#include <QImage>
+#include <QTimer>
+
+#include <cstdio>
+
+#define STATS_INTERVAL_MS 10000
+
+// Distinct images to hand out, so the client can't
+// get away with decoding the same one over and over
+#define BOX_ART_VARIANTS 8
+
+// Deliberately not 628x888, which the app treats as GFE's placeholder
+#define BOX_ART_WIDTH 600
+#define BOX_ART_HEIGHT 800
+
+static QVector<QByteArray> generateBoxArt()
+{
+    QVector<QByteArray> boxArt;
+
+    for (int variant = 0; variant < BOX_ART_VARIANTS; variant++) {
+        QImage image(BOX_ART_WIDTH, BOX_ART_HEIGHT, QImage::Format_RGB32);
+
+        // A gradient with some noise on top compresses about as well as real box art
+        quint32 seed = 0x9E3779B9 * (variant + 1);
+        for (int y = 0; y < image.height(); y++) {
+            QRgb* line = reinterpret_cast<QRgb*>(image.scanLine(y));
+            for (int x = 0; x < image.width(); x++) {
+                seed = seed * 1664525 + 1013904223;
+                int noise = (seed >> 24) & 0x1F;
+                line[x] = qRgb((variant * 37 + x / 4 + noise) & 0xFF,
+                               (variant * 91 + y / 4 + noise) & 0xFF,
+                               (variant * 53 + (x + y) / 8 + noise) & 0xFF);
+            }
+        }
+
+        QByteArray data;
+        QBuffer buffer(&data);
+        buffer.open(QIODevice::WriteOnly);
+        if (!image.save(&buffer, "JPG", 85)) {
+            // The JPEG plugin is optional
+            data.clear();
+            buffer.seek(0);
+            image.save(&buffer, "PNG");
+        }
+
+        boxArt.append(data);
+    }
+
+    return boxArt;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("hostsim");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Simulates GameStream hosts for testing and benchmarking Moonlight.");
+    parser.addHelpOption();
+    parser.addOptions({
+        { "hosts", "Number of hosts to simulate.", "count", "1" },
+        { "address", "Address to listen on.", "address", "127.0.0.1" },
+        { "base-port", "HTTP port of the first host. Each host uses the next two ports (HTTP then HTTPS).", "port", "50000" },
+        { "apps", "Number of apps on each host.", "count", "20" },
+        { "pin", "PIN that pairing expects.", "pin", "1234" },
+        { "latency", "Delay before every response.", "ms", "0" },
+        { "jitter", "Random extra delay of up to this much.", "ms", "0" },
+        { "failure-rate", "Fraction of requests (0-1) whose connection is reset.", "rate", "0" },
+        { "quiet", "Don't log request statistics." },
+    });
+    parser.process(app);
+
+    SimConfig config;
+    config.address = QHostAddress(parser.value("address"));
+    config.basePort = (quint16)parser.value("base-port").toUInt();
+    config.hostCount = parser.value("hosts").toInt();
+    config.appCount = parser.value("apps").toInt();
+    config.pin = parser.value("pin");
+    config.latencyMs = parser.value("latency").toInt();
+    config.jitterMs = parser.value("jitter").toInt();
+    config.failureRate = parser.value("failure-rate").toDouble();
+
+    if (config.address.isNull() || config.basePort == 0 ||
+            config.hostCount <= 0 || config.basePort + config.hostCount * 2 - 1 > 65535 ||
+            config.appCount < 0 || config.latencyMs < 0 || config.jitterMs < 0 ||
+            config.failureRate < 0 || config.failureRate > 1) {
+        fprintf(stderr, "Invalid options\n");
+        parser.showHelp(1);
+    }
+
+    // Every host shares one certificate, since generating hundreds of RSA keys takes a while
+    SimIdentity identity;
+    if (!identity.generate()) {
+        fprintf(stderr, "Failed to generate host certificate\n");
+        return 1;
+    }
+
+    QVector<QByteArray> boxArt = generateBoxArt();
+
+    QVector<SimulatedHost*> hosts;
+    for (int i = 0; i < config.hostCount; i++) {
+        SimulatedHost* host = new SimulatedHost(i, config, identity, boxArt);
+        if (!host->listen()) {
+            return 1;
+        }
+
+        hosts.append(host);
+    }
+
+    printf("Simulating %d hosts on %s ports %d-%d (PIN %s)\n",
+           config.hostCount, qPrintable(config.address.toString()),
+           config.basePort, config.basePort + config.hostCount * 2 - 1,
+           qPrintable(config.pin));
+
+    // The benchmark drivers wait for this line
+    printf("READY\n");
+    fflush(stdout);
+
+    QTimer statsTimer;
+    if (!parser.isSet("quiet")) {
+        QObject::connect(&statsTimer, &QTimer::timeout, [&hosts]() {
+            int totalRequests = 0, totalFailures = 0;
+            for (SimulatedHost* host : std::as_const(hosts)) {
+                int requests, failures;
+                host->takeStats(requests, failures);
+                totalRequests += requests;
+                totalFailures += failures;
+            }
+
+            printf("%.1f requests/s (%d failures injected)\n",
+                   totalRequests * 1000.0 / STATS_INTERVAL_MS, totalFailures);
+            fflush(stdout);
+        });
+        statsTimer.start(STATS_INTERVAL_MS);
+    }
+
+    int ret = app.exec();
+    qDeleteAll(hosts);
+    return ret;
+}
@@ -0,0 +1,15 @@
+TARGET = hostsim
+
+include(../hostsim.pri)
+
+# QImage is used to generate box art
+QT += gui
+
+SOURCES += \
+    main.cpp \
+    simidentity.cpp \
+    simulatedhost.cpp
+
+HEADERS += \
+    simidentity.h \
+    simulatedhost.h
@@ -0,0 +1,229 @@
+#include "simidentity.h"
+
+#include <openssl/pem.h>
+#include <openssl/x509.h>
+
+SimIdentity::SimIdentity()
+    : m_PrivateKey(nullptr)
+{
+
+}
+
+SimIdentity::~SimIdentity()
+{
+    EVP_PKEY_free(m_PrivateKey);
+}
+
+bool SimIdentity::generate()
+{
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+    EVP_PKEY* pk = EVP_RSA_gen(2048);
+#else
+    EVP_PKEY_CTX* ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_RSA, NULL);
+    if (ctx == nullptr) {
+        return false;
+    }
+
+    EVP_PKEY_keygen_init(ctx);
+    EVP_PKEY_CTX_set_rsa_keygen_bits(ctx, 2048);
+
+    // pk must be initialized on input
+    EVP_PKEY* pk = NULL;
+    EVP_PKEY_keygen(ctx, &pk);
+
+    EVP_PKEY_CTX_free(ctx);
+#endif
+    if (pk == nullptr) {
+        return false;
+    }
+
+    X509* cert = X509_new();
+    if (cert == nullptr) {
+        EVP_PKEY_free(pk);
+        return false;
+    }
+
+    X509_set_version(cert, 2);
+    ASN1_INTEGER_set(X509_get_serialNumber(cert), 0);
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+    X509_gmtime_adj(X509_get_notBefore(cert), 0);
+    X509_gmtime_adj(X509_get_notAfter(cert), 60 * 60 * 24 * 365 * 20); // 20 yrs
+#else
+    X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+    X509_gmtime_adj(X509_getm_notAfter(cert), 60 * 60 * 24 * 365 * 20); // 20 yrs
+#endif
+
+    X509_set_pubkey(cert, pk);
+
+    X509_NAME* name = X509_NAME_new();
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC,
+                               reinterpret_cast<unsigned char *>(const_cast<char*>("NVIDIA GameStream Server")),
+                               -1, -1, 0);
+    X509_set_subject_name(cert, name);
+    X509_set_issuer_name(cert, name);
+    X509_NAME_free(name);
+
+    X509_sign(cert, pk, EVP_sha256());
+
+    BIO* biokey = BIO_new(BIO_s_mem());
+    PEM_write_bio_PrivateKey(biokey, pk, NULL, NULL, 0, NULL, NULL);
+
+    BIO* biocert = BIO_new(BIO_s_mem());
+    PEM_write_bio_X509(biocert, cert);
+
+    BUF_MEM* mem;
+    BIO_get_mem_ptr(biokey, &mem);
+    m_PemKey = QByteArray(mem->data, (int)mem->length);
+
+    BIO_get_mem_ptr(biocert, &mem);
+    m_PemCert = QByteArray(mem->data, (int)mem->length);
+
+    BIO_free(biokey);
+    BIO_free(biocert);
+    X509_free(cert);
+
+    EVP_PKEY_free(m_PrivateKey);
+    m_PrivateKey = pk;
+
+    m_CertSignature = getSignatureFromPemCert(m_PemCert);
+    return !sslCertificate().isNull() && !sslKey().isNull();
+}
+
+const QByteArray& SimIdentity::pemCertificate() const
+{
+    return m_PemCert;
+}
+
+QSslCertificate SimIdentity::sslCertificate() const
+{
+    return QSslCertificate(m_PemCert);
+}
+
+QSslKey SimIdentity::sslKey() const
+{
+    return QSslKey(m_PemKey, QSsl::Rsa);
+}
+
+const QByteArray& SimIdentity::certificateSignature() const
+{
+    return m_CertSignature;
+}
+
+QByteArray SimIdentity::signMessage(const QByteArray& message) const
+{
+    EVP_MD_CTX* ctx = EVP_MD_CTX_create();
+    if (ctx == nullptr) {
+        return QByteArray();
+    }
+
+    EVP_DigestSignInit(ctx, NULL, EVP_sha256(), NULL, m_PrivateKey);
+    EVP_DigestSignUpdate(ctx, message.constData(), message.length());
+
+    size_t signatureLength = 0;
+    EVP_DigestSignFinal(ctx, NULL, &signatureLength);
+
+    QByteArray signature((int)signatureLength, 0);
+    EVP_DigestSignFinal(ctx, reinterpret_cast<unsigned char*>(signature.data()), &signatureLength);
+
+    EVP_MD_CTX_destroy(ctx);
+
+    return signature;
+}
+
+QByteArray SimIdentity::getSignatureFromPemCert(const QByteArray& pemCert)
+{
+    BIO* bio = BIO_new_mem_buf(pemCert.constData(), pemCert.length());
+    if (bio == nullptr) {
+        return QByteArray();
+    }
+
+    X509* cert = PEM_read_bio_X509(bio, nullptr, nullptr, nullptr);
+    BIO_free_all(bio);
+    if (cert == nullptr) {
+        return QByteArray();
+    }
+
+#if (OPENSSL_VERSION_NUMBER < 0x10100000L)
+    ASN1_BIT_STRING *asnSignature;
+    X509_get0_signature(&asnSignature, NULL, cert);
+    QByteArray signature(reinterpret_cast<const char*>(ASN1_STRING_data(asnSignature)),
+                         ASN1_STRING_length(asnSignature));
+#else
+    const ASN1_BIT_STRING *asnSignature;
+    X509_get0_signature(&asnSignature, NULL, cert);
+    QByteArray signature(reinterpret_cast<const char*>(ASN1_STRING_get0_data(asnSignature)),
+                         ASN1_STRING_length(asnSignature));
+#endif
+
+    X509_free(cert);
+    return signature;
+}
+
+bool SimIdentity::verifySignature(const QByteArray& data, const QByteArray& signature, const QByteArray& pemCert)
+{
+    BIO* bio = BIO_new_mem_buf(pemCert.constData(), pemCert.length());
+    if (bio == nullptr) {
+        return false;
+    }
+
+    X509* cert = PEM_read_bio_X509(bio, nullptr, nullptr, nullptr);
+    BIO_free_all(bio);
+    if (cert == nullptr) {
+        return false;
+    }
+
+    EVP_PKEY* pubKey = X509_get_pubkey(cert);
+    EVP_MD_CTX* mdctx = EVP_MD_CTX_create();
+    int result = 0;
+    if (pubKey != nullptr && mdctx != nullptr) {
+        EVP_DigestVerifyInit(mdctx, nullptr, EVP_sha256(), nullptr, pubKey);
+        EVP_DigestVerifyUpdate(mdctx, data.constData(), data.length());
+        result = EVP_DigestVerifyFinal(mdctx,
+                                       reinterpret_cast<const unsigned char*>(signature.constData()),
+                                       signature.length());
+    }
+
+    EVP_MD_CTX_destroy(mdctx);
+    EVP_PKEY_free(pubKey);
+    X509_free(cert);
+
+    return result > 0;
+}
+
+static QByteArray aes128Ecb(const QByteArray& input, const QByteArray& key, bool encrypt)
+{
+    // The pairing messages are always a multiple of the block size
+    if (input.isEmpty() || input.size() % 16 != 0 || key.size() != 16) {
+        return QByteArray();
+    }
+
+    EVP_CIPHER_CTX* cipher = EVP_CIPHER_CTX_new();
+    if (cipher == nullptr) {
+        return QByteArray();
+    }
+
+    EVP_CipherInit(cipher, EVP_aes_128_ecb(), reinterpret_cast<const unsigned char*>(key.constData()), NULL, encrypt ? 1 : 0);
+    EVP_CIPHER_CTX_set_padding(cipher, 0);
+
+    QByteArray output(input.size(), 0);
+    int outputLen;
+    EVP_CipherUpdate(cipher,
+                     reinterpret_cast<unsigned char*>(output.data()),
+                     &outputLen,
+                     reinterpret_cast<const unsigned char*>(input.constData()),
+                     input.length());
+
+    EVP_CIPHER_CTX_free(cipher);
+
+    return output;
+}
+
+QByteArray SimIdentity::encrypt(const QByteArray& plaintext, const QByteArray& key)
+{
+    return aes128Ecb(plaintext, key, true);
+}
+
+QByteArray SimIdentity::decrypt(const QByteArray& ciphertext, const QByteArray& key)
+{
+    return aes128Ecb(ciphertext, key, false);
+}
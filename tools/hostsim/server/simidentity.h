@@ -0,0 +1,60 @@
+#pragma once
+
+#include <QByteArray>
+#include <QSslCertificate>
+#include <QSslKey>
+
+#include <openssl/evp.h>
+
+// The certificate and key that every simulated host presents, plus the
+// crypto primitives the host side of the pairing handshake needs.
+class SimIdentity
+{
+public:
+    SimIdentity();
+
+    ~SimIdentity();
+
+    bool
+    generate();
+
+    const QByteArray&
+    pemCertificate() const;
+
+    QSslCertificate
+    sslCertificate() const;
+
+    QSslKey
+    sslKey() const;
+
+    // Signature of our own certificate, which is mixed into the pairing hashes
+    const QByteArray&
+    certificateSignature() const;
+
+    QByteArray
+    signMessage(const QByteArray& message) const;
+
+    static
+    QByteArray
+    getSignatureFromPemCert(const QByteArray& pemCert);
+
+    static
+    bool
+    verifySignature(const QByteArray& data, const QByteArray& signature, const QByteArray& pemCert);
+
+    static
+    QByteArray
+    encrypt(const QByteArray& plaintext, const QByteArray& key);
+
+    static
+    QByteArray
+    decrypt(const QByteArray& ciphertext, const QByteArray& key);
+
+private:
+    Q_DISABLE_COPY(SimIdentity)
+
+    EVP_PKEY* m_PrivateKey;
+    QByteArray m_PemCert;
+    QByteArray m_PemKey;
+    QByteArray m_CertSignature;
+};
@@ -0,0 +1,464 @@
+#include "simulatedhost.h"
+
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QPointer>
+#include <QRandomGenerator>
+#include <QSslSocket>
+#include <QTimer>
+#include <QUrl>
+
+// Nobody sends us headers this large, so something is wrong
+#define MAX_REQUEST_HEADER_SIZE (64 * 1024)
+
+// Pretend to be a recent Sunshine version. Gen 7+ pairing uses SHA-256.
+#define SIM_APP_VERSION "7.1.431.-1"
+#define SIM_GFE_VERSION "3.23.0.74"
+#define SIM_GPU_TYPE "Simulated GPU"
+
+#define SIM_FIRST_APP_ID 1000
+
+static QByteArray generateRandomBytes(int length)
+{
+    QByteArray data;
+    while (data.size() < length) {
+        quint32 value = QRandomGenerator::system()->generate();
+        data.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    data.truncate(length);
+    return data;
+}
+
+SslServer::SslServer(const SimIdentity& identity, QObject* parent)
+    : QTcpServer(parent),
+      m_Identity(identity)
+{
+
+}
+
+void SslServer::incomingConnection(qintptr socketDescriptor)
+{
+    QSslSocket* socket = new QSslSocket(this);
+    if (!socket->setSocketDescriptor(socketDescriptor)) {
+        delete socket;
+        return;
+    }
+
+    socket->setLocalCertificate(m_Identity.sslCertificate());
+    socket->setPrivateKey(m_Identity.sslKey());
+
+    // We check the client certificate against our paired clients per-request
+    socket->setPeerVerifyMode(QSslSocket::QueryPeer);
+
+    addPendingConnection(socket);
+    socket->startServerEncryption();
+}
+
+SimulatedHost::SimulatedHost(int index, const SimConfig& config, const SimIdentity& identity, const QVector<QByteArray>& boxArt)
+    : m_Index(index),
+      m_Config(config),
+      m_Identity(identity),
+      m_BoxArt(boxArt),
+      m_HttpsServer(identity),
+      m_CurrentGame(0),
+      m_Pairing(),
+      m_Requests(0),
+      m_Failures(0)
+{
+    // These are stable across runs, so a client doesn't see new hosts every time
+    m_UniqueId = QString("%1").arg(0x484F535453494D00ULL + (quint64)index, 16, 16, QChar('0')).toUpper();
+    m_Hostname = QString("hostsim-%1").arg(index, 3, 10, QChar('0'));
+    m_MacAddress = QString("02:00:00:00:%1:%2")
+            .arg((index >> 8) & 0xFF, 2, 16, QChar('0'))
+            .arg(index & 0xFF, 2, 16, QChar('0'));
+
+    connect(&m_HttpServer, &QTcpServer::newConnection,
+            this, &SimulatedHost::handleNewConnection);
+    connect(&m_HttpsServer, &QTcpServer::newConnection,
+            this, &SimulatedHost::handleNewConnection);
+}
+
+bool SimulatedHost::listen()
+{
+    if (!m_HttpServer.listen(m_Config.address, httpPort())) {
+        qWarning() << m_Hostname << "failed to listen on port" << httpPort() << ":" << m_HttpServer.errorString();
+        return false;
+    }
+
+    if (!m_HttpsServer.listen(m_Config.address, httpsPort())) {
+        qWarning() << m_Hostname << "failed to listen on port" << httpsPort() << ":" << m_HttpsServer.errorString();
+        return false;
+    }
+
+    return true;
+}
+
+quint16 SimulatedHost::httpPort() const
+{
+    return m_Config.basePort + m_Index * 2;
+}
+
+quint16 SimulatedHost::httpsPort() const
+{
+    return m_Config.basePort + m_Index * 2 + 1;
+}
+
+void SimulatedHost::takeStats(int& requests, int& failures)
+{
+    requests = m_Requests;
+    failures = m_Failures;
+    m_Requests = m_Failures = 0;
+}
+
+void SimulatedHost::handleNewConnection()
+{
+    QTcpServer* server = qobject_cast<QTcpServer*>(sender());
+
+    while (server->hasPendingConnections()) {
+        QTcpSocket* socket = server->nextPendingConnection();
+
+        connect(socket, &QTcpSocket::readyRead,
+                this, &SimulatedHost::handleReadyRead);
+        connect(socket, &QTcpSocket::disconnected,
+                this, &SimulatedHost::handleDisconnected);
+        m_PendingHeaders.insert(socket, QByteArray());
+    }
+}
+
+void SimulatedHost::handleReadyRead()
+{
+    QTcpSocket* socket = qobject_cast<QTcpSocket*>(sender());
+
+    auto it = m_PendingHeaders.find(socket);
+    if (it == m_PendingHeaders.end()) {
+        // We've already got the request. Nothing should follow it.
+        socket->readAll();
+        return;
+    }
+
+    it.value().append(socket->readAll());
+
+    int headerEnd = it.value().indexOf("\r\n\r\n");
+    if (headerEnd < 0) {
+        if (it.value().size() > MAX_REQUEST_HEADER_SIZE) {
+            m_PendingHeaders.erase(it);
+            socket->abort();
+        }
+        return;
+    }
+
+    // Like GFE, we handle a single GET per connection
+    QByteArray header = it.value().left(headerEnd);
+    m_PendingHeaders.erase(it);
+
+    handleRequest(socket, header);
+}
+
+void SimulatedHost::handleDisconnected()
+{
+    QTcpSocket* socket = qobject_cast<QTcpSocket*>(sender());
+
+    m_PendingHeaders.remove(socket);
+    socket->deleteLater();
+}
+
+void SimulatedHost::handleRequest(QTcpSocket* socket, const QByteArray& header)
+{
+    // GET /serverinfo?uniqueid=... HTTP/1.1
+    QList<QByteArray> requestLine = header.left(header.indexOf("\r\n")).split(' ');
+    if (requestLine.size() < 3 || requestLine[0] != "GET") {
+        socket->abort();
+        return;
+    }
+
+    QUrl url("http://localhost" + QString::fromUtf8(requestLine[1]));
+    QString command = url.path().mid(1);
+    QUrlQuery query(url);
+
+    QSslSocket* sslSocket = qobject_cast<QSslSocket*>(socket);
+    bool https = sslSocket != nullptr;
+    bool paired = https && !sslSocket->peerCertificate().isNull() &&
+            m_PairedClients.contains(sslSocket->peerCertificate().digest(QCryptographicHash::Sha256));
+
+    m_Requests++;
+
+    // Roll for failure up front so state-changing requests don't take effect
+    bool fail = QRandomGenerator::global()->generateDouble() < m_Config.failureRate;
+    Response response;
+    if (fail) {
+        m_Failures++;
+    }
+    else {
+        response = dispatchRequest(command, query, https, paired);
+    }
+
+    int delayMs = m_Config.latencyMs;
+    if (m_Config.jitterMs > 0) {
+        delayMs += QRandomGenerator::global()->bounded(m_Config.jitterMs + 1);
+    }
+
+    QPointer<QTcpSocket> socketRef(socket);
+    auto finish = [this, socketRef, fail, response]() {
+        if (socketRef.isNull()) {
+            // The client gave up on us
+            return;
+        }
+        else if (fail) {
+            socketRef->abort();
+        }
+        else {
+            sendResponse(socketRef, response);
+        }
+    };
+
+    if (delayMs > 0) {
+        QTimer::singleShot(delayMs, this, finish);
+    }
+    else {
+        finish();
+    }
+}
+
+void SimulatedHost::sendResponse(QTcpSocket* socket, const Response& response)
+{
+    QByteArray header;
+    if (response.body.isNull()) {
+        header = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+    }
+    else {
+        header = "HTTP/1.1 200 OK\r\n"
+                 "Content-Type: " + response.contentType + "\r\n"
+                 "Content-Length: " + QByteArray::number(response.body.size()) + "\r\n"
+                 "Connection: close\r\n\r\n";
+    }
+
+    socket->write(header);
+    socket->write(response.body);
+    socket->disconnectFromHost();
+}
+
+SimulatedHost::Response SimulatedHost::dispatchRequest(const QString& command, const QUrlQuery& query, bool https, bool paired)
+{
+    if (command == "serverinfo") {
+        return getServerInfo(https, paired);
+    }
+    else if (command == "pair") {
+        return pair(query, https, paired);
+    }
+    else if (command == "unpair") {
+        return unpair();
+    }
+
+    // Everything else requires a paired client
+    if (!paired) {
+        return xmlResponse(QString(), 401, "The client is not authorized. Certificate verification failed.");
+    }
+
+    if (command == "applist") {
+        return getAppList();
+    }
+    else if (command == "appasset") {
+        return getAppAsset(query);
+    }
+    else if (command == "launch") {
+        return launchApp(query, false);
+    }
+    else if (command == "resume") {
+        return launchApp(query, true);
+    }
+    else if (command == "cancel") {
+        return quitApp();
+    }
+
+    return Response();
+}
+
+SimulatedHost::Response SimulatedHost::getServerInfo(bool https, bool paired)
+{
+    // Like GFE, an unpaired client gets an error over HTTPS and
+    // has to fall back to HTTP for its serverinfo
+    if (https && !paired) {
+        return xmlResponse(QString(), 401, "The client is not authorized. Certificate verification failed.");
+    }
+
+    QString displayModes;
+    const int modes[][3] = { { 3840, 2160, 120 }, { 2560, 1440, 144 }, { 1920, 1080, 60 } };
+    for (const auto& mode : modes) {
+        displayModes += QString("<DisplayMode><Width>%1</Width><Height>%2</Height><RefreshRate>%3</RefreshRate></DisplayMode>")
+                .arg(mode[0]).arg(mode[1]).arg(mode[2]);
+    }
+
+    return xmlResponse(QString("<hostname>%1</hostname>"
+                               "<appversion>" SIM_APP_VERSION "</appversion>"
+                               "<GfeVersion>" SIM_GFE_VERSION "</GfeVersion>"
+                               "<uniqueid>%2</uniqueid>"
+                               "<HttpsPort>%3</HttpsPort>"
+                               "<ExternalPort>%4</ExternalPort>"
+                               "<MaxLumaPixelsHEVC>1869449984</MaxLumaPixelsHEVC>"
+                               "<mac>%5</mac>"
+                               "<LocalIP>%6</LocalIP>"
+                               "<ServerCodecModeSupport>3843</ServerCodecModeSupport>"
+                               "<SupportedDisplayMode>%7</SupportedDisplayMode>"
+                               "<PairStatus>%8</PairStatus>"
+                               "<currentgame>%9</currentgame>"
+                               "<state>%10</state>"
+                               "<gputype>" SIM_GPU_TYPE "</gputype>")
+                       .arg(m_Hostname, m_UniqueId)
+                       .arg(httpsPort())
+                       .arg(httpPort())
+                       .arg(m_MacAddress, m_Config.address.toString(), displayModes)
+                       .arg(paired ? 1 : 0)
+                       .arg(m_CurrentGame)
+                       .arg(QString(m_CurrentGame != 0 ? "SUNSHINE_SERVER_BUSY" : "SUNSHINE_SERVER_FREE")));
+}
+
+SimulatedHost::Response SimulatedHost::getAppList()
+{
+    QString apps;
+    for (int i = 0; i < m_Config.appCount; i++) {
+        apps += QString("<App><IsHdrSupported>%1</IsHdrSupported><AppTitle>Simulated App %2</AppTitle><ID>%3</ID></App>")
+                .arg(i % 4 == 0 ? 1 : 0)
+                .arg(i + 1, 3, 10, QChar('0'))
+                .arg(SIM_FIRST_APP_ID + i);
+    }
+
+    return xmlResponse(apps);
+}
+
+SimulatedHost::Response SimulatedHost::getAppAsset(const QUrlQuery& query)
+{
+    int appIndex = query.queryItemValue("appid").toInt() - SIM_FIRST_APP_ID;
+    if (appIndex < 0 || appIndex >= m_Config.appCount || m_BoxArt.isEmpty()) {
+        return Response();
+    }
+
+    Response response;
+    response.contentType = m_BoxArt[appIndex % m_BoxArt.size()].startsWith("\x89PNG") ? "image/png" : "image/jpeg";
+    response.body = m_BoxArt[appIndex % m_BoxArt.size()];
+    return response;
+}
+
+SimulatedHost::Response SimulatedHost::launchApp(const QUrlQuery& query, bool resume)
+{
+    if (resume) {
+        if (m_CurrentGame == 0) {
+            return xmlResponse(QString(), 503, "No running app to resume");
+        }
+    }
+    else {
+        int appId = query.queryItemValue("appid").toInt();
+        if (appId < SIM_FIRST_APP_ID || appId >= SIM_FIRST_APP_ID + m_Config.appCount) {
+            return xmlResponse(QString(), 404, "Unknown app");
+        }
+        else if (m_CurrentGame != 0 && m_CurrentGame != appId) {
+            return xmlResponse(QString(), 400, "An app is already running on this host");
+        }
+
+        m_CurrentGame = appId;
+    }
+
+    // There's nobody listening here. Streaming from the simulator isn't supported.
+    return xmlResponse(QString("<sessionUrl0>rtsp://%1:48010</sessionUrl0>%2")
+                       .arg(m_Config.address.toString(),
+                            QString(resume ? "<resume>1</resume>" : "<gamesession>1</gamesession>")));
+}
+
+SimulatedHost::Response SimulatedHost::quitApp()
+{
+    m_CurrentGame = 0;
+    return xmlResponse("<cancel>1</cancel>");
+}
+
+SimulatedHost::Response SimulatedHost::pair(const QUrlQuery& query, bool https, bool paired)
+{
+    // This is the host side of NvPairingManager::pair()
+    if (query.queryItemValue("phrase") == "getservercert") {
+        QByteArray clientCert = QByteArray::fromHex(query.queryItemValue("clientcert").toLatin1());
+        if (m_Pairing.active && m_Pairing.clientCert != clientCert) {
+            // Leaving out the cert tells the client that someone else is pairing
+            return xmlResponse("<paired>1</paired>");
+        }
+
+        QByteArray salt = QByteArray::fromHex(query.queryItemValue("salt").toLatin1());
+        QByteArray aesKey = QCryptographicHash::hash(salt + m_Config.pin.toUtf8(), QCryptographicHash::Sha256);
+        aesKey.truncate(16);
+
+        m_Pairing = PairingSession();
+        m_Pairing.active = true;
+        m_Pairing.clientCert = clientCert;
+        m_Pairing.aesKey = aesKey;
+        return xmlResponse("<paired>1</paired><plaincert>" + QString::fromLatin1(m_Identity.pemCertificate().toHex()) + "</plaincert>");
+    }
+    else if (query.hasQueryItem("clientchallenge") && m_Pairing.active) {
+        QByteArray challenge = SimIdentity::decrypt(QByteArray::fromHex(query.queryItemValue("clientchallenge").toLatin1()),
+                                                    m_Pairing.aesKey);
+
+        m_Pairing.serverSecret = generateRandomBytes(16);
+        m_Pairing.serverChallenge = generateRandomBytes(16);
+
+        QByteArray challengeResponse = QCryptographicHash::hash(challenge + m_Identity.certificateSignature() + m_Pairing.serverSecret,
+                                                                QCryptographicHash::Sha256);
+        challengeResponse += m_Pairing.serverChallenge;
+        return xmlResponse("<paired>1</paired><challengeresponse>" +
+                           QString::fromLatin1(SimIdentity::encrypt(challengeResponse, m_Pairing.aesKey).toHex()) +
+                           "</challengeresponse>");
+    }
+    else if (query.hasQueryItem("serverchallengeresp") && m_Pairing.active) {
+        m_Pairing.clientHash = SimIdentity::decrypt(QByteArray::fromHex(query.queryItemValue("serverchallengeresp").toLatin1()),
+                                                    m_Pairing.aesKey);
+
+        QByteArray pairingSecret = m_Pairing.serverSecret + m_Identity.signMessage(m_Pairing.serverSecret);
+        return xmlResponse("<paired>1</paired><pairingsecret>" + QString::fromLatin1(pairingSecret.toHex()) + "</pairingsecret>");
+    }
+    else if (query.hasQueryItem("clientpairingsecret") && m_Pairing.active) {
+        QByteArray clientPairingSecret = QByteArray::fromHex(query.queryItemValue("clientpairingsecret").toLatin1());
+        QByteArray clientSecret = clientPairingSecret.left(16);
+        QByteArray clientSignature = clientPairingSecret.mid(16);
+
+        // A wrong PIN shows up here as a hash mismatch
+        QByteArray expectedHash = QCryptographicHash::hash(m_Pairing.serverChallenge +
+                                                           SimIdentity::getSignatureFromPemCert(m_Pairing.clientCert) +
+                                                           clientSecret,
+                                                           QCryptographicHash::Sha256);
+        bool success = m_Pairing.clientHash.startsWith(expectedHash) &&
+                SimIdentity::verifySignature(clientSecret, clientSignature, m_Pairing.clientCert);
+        if (success) {
+            QSslCertificate clientCert(m_Pairing.clientCert);
+            m_PairedClients.insert(clientCert.digest(QCryptographicHash::Sha256));
+        }
+        else {
+            qWarning() << m_Hostname << "rejected pairing attempt";
+        }
+
+        m_Pairing = PairingSession();
+        return xmlResponse(QString("<paired>%1</paired>").arg(success ? 1 : 0));
+    }
+    else if (query.queryItemValue("phrase") == "pairchallenge" && https) {
+        return xmlResponse(QString("<paired>%1</paired>").arg(paired ? 1 : 0));
+    }
+
+    return xmlResponse("<paired>0</paired>");
+}
+
+SimulatedHost::Response SimulatedHost::unpair()
+{
+    // The client calls this to abort a pairing attempt
+    m_Pairing = PairingSession();
+    return xmlResponse(QString());
+}
+
+SimulatedHost::Response SimulatedHost::xmlResponse(const QString& content, int statusCode, const QString& statusMessage)
+{
+    // Errors are reported in the XML with a 200 OK, which the client
+    // needs to see the status code rather than a network error.
+    QString root = QString("<root status_code=\"%1\"").arg(statusCode);
+    if (!statusMessage.isEmpty()) {
+        root += " status_message=\"" + statusMessage.toHtmlEscaped() + "\"";
+    }
+
+    Response response;
+    response.contentType = "application/xml";
+    response.body = ("<?xml version=\"1.0\" encoding=\"utf-8\"?>" + root + ">" + content + "</root>").toUtf8();
+    return response;
+}
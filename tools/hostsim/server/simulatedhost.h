@@ -0,0 +1,152 @@
+#pragma once
+
+#include "simidentity.h"
+
+#include <QObject>
+#include <QTcpServer>
+#include <QHostAddress>
+#include <QHash>
+#include <QSet>
+#include <QUrlQuery>
+#include <QVector>
+
+class QTcpSocket;
+
+struct SimConfig
+{
+    QHostAddress address;
+    quint16 basePort;
+    int hostCount;
+    int appCount;
+    QString pin;
+
+    // Added to every response
+    int latencyMs;
+    int jitterMs;
+
+    // Fraction of requests that get their connection reset instead of a response
+    double failureRate;
+};
+
+// Accepts TLS connections and asks for (but doesn't validate) a client
+// certificate, which is how GameStream hosts identify paired clients.
+class SslServer : public QTcpServer
+{
+    Q_OBJECT
+
+public:
+    SslServer(const SimIdentity& identity, QObject* parent = nullptr);
+
+protected:
+    void incomingConnection(qintptr socketDescriptor) override;
+
+private:
+    const SimIdentity& m_Identity;
+};
+
+// A single fake GameStream host with its own HTTP and HTTPS ports. It
+// speaks just enough of the protocol for the client to discover, pair
+// with, poll, and launch apps on it. No stream is ever actually started.
+class SimulatedHost : public QObject
+{
+    Q_OBJECT
+
+public:
+    SimulatedHost(int index, const SimConfig& config, const SimIdentity& identity, const QVector<QByteArray>& boxArt);
+
+    bool
+    listen();
+
+    quint16
+    httpPort() const;
+
+    quint16
+    httpsPort() const;
+
+    // Requests handled and failures injected since the last call
+    void
+    takeStats(int& requests, int& failures);
+
+private slots:
+    void
+    handleNewConnection();
+
+    void
+    handleReadyRead();
+
+    void
+    handleDisconnected();
+
+private:
+    struct Response
+    {
+        QByteArray contentType;
+        QByteArray body;
+    };
+
+    struct PairingSession
+    {
+        bool active;
+        QByteArray clientCert;
+        QByteArray aesKey;
+        QByteArray serverSecret;
+        QByteArray serverChallenge;
+        QByteArray clientHash;
+    };
+
+    void
+    handleRequest(QTcpSocket* socket, const QByteArray& header);
+
+    void
+    sendResponse(QTcpSocket* socket, const Response& response);
+
+    Response
+    dispatchRequest(const QString& command, const QUrlQuery& query, bool https, bool paired);
+
+    Response
+    getServerInfo(bool https, bool paired);
+
+    Response
+    getAppList();
+
+    Response
+    getAppAsset(const QUrlQuery& query);
+
+    Response
+    launchApp(const QUrlQuery& query, bool resume);
+
+    Response
+    quitApp();
+
+    Response
+    pair(const QUrlQuery& query, bool https, bool paired);
+
+    Response
+    unpair();
+
+    static
+    Response
+    xmlResponse(const QString& content, int statusCode = 200, const QString& statusMessage = QString());
+
+    int m_Index;
+    const SimConfig& m_Config;
+    const SimIdentity& m_Identity;
+    const QVector<QByteArray>& m_BoxArt;
+
+    QString m_UniqueId;
+    QString m_Hostname;
+    QString m_MacAddress;
+
+    QTcpServer m_HttpServer;
+    SslServer m_HttpsServer;
+    QHash<QTcpSocket*, QByteArray> m_PendingHeaders;
+
+    int m_CurrentGame;
+    PairingSession m_Pairing;
+
+    // SHA-256 digests of the client certificates we're paired with
+    QSet<QByteArray> m_PairedClients;
+
+    int m_Requests;
+    int m_Failures;
+};
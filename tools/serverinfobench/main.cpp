@@ -0,0 +1,165 @@
+#include "backend/nvserverinfo.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QStringList>
+#include <QXmlStreamReader>
+
+#include <cstdio>
+
+#define DEFAULT_ITERATIONS 1000
+
+#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
+#define XML_NAME_EQUALS(x, y) ((x) == (y))
+#else
+#define XML_NAME_EQUALS(x, y) ((x) == (u##y))
+#endif
+
+// A typical response from a paired host with a handful of display modes
+static const char k_SampleServerInfo[] =
+    "<?xml version=\"1.0\" encoding=\"utf-8\"?>"
+    "<root status_code=\"200\">"
+    "<hostname>DESKTOP-BENCH</hostname>"
+    "<appversion>7.1.431.-1</appversion>"
+    "<GfeVersion>3.23.0.74</GfeVersion>"
+    "<uniqueid>0123456789ABCDEF</uniqueid>"
+    "<HttpsPort>47984</HttpsPort>"
+    "<ExternalPort>47989</ExternalPort>"
+    "<MaxLumaPixelsHEVC>1869449984</MaxLumaPixelsHEVC>"
+    "<mac>00:11:22:33:44:55</mac>"
+    "<LocalIP>192.168.1.10</LocalIP>"
+    "<ServerCodecModeSupport>3843</ServerCodecModeSupport>"
+    "<SupportedDisplayMode>"
+    "<DisplayMode><Width>3840</Width><Height>2160</Height><RefreshRate>120</RefreshRate></DisplayMode>"
+    "<DisplayMode><Width>2560</Width><Height>1440</Height><RefreshRate>144</RefreshRate></DisplayMode>"
+    "<DisplayMode><Width>1920</Width><Height>1080</Height><RefreshRate>60</RefreshRate></DisplayMode>"
+    "</SupportedDisplayMode>"
+    "<PairStatus>1</PairStatus>"
+    "<currentgame>0</currentgame>"
+    "<state>SUNSHINE_SERVER_FREE</state>"
+    "</root>";
+
+static const char* const k_Fields[] = {
+    "hostname", "uniqueid", "mac", "ServerCodecModeSupport", "MaxLumaPixelsHEVC",
+    "LocalIP", "HttpsPort", "ExternalPort", "ExternalIP", "state", "PairStatus",
+    "appversion", "GfeVersion", "gputype",
+};
+
+// The way NvComputer used to read serverinfo: a new reader for every field
+static QString getXmlString(const QString& xml, const QString& tagName)
+{
+    QXmlStreamReader xmlReader(xml);
+
+    while (!xmlReader.atEnd())
+    {
+        if (xmlReader.readNext() != QXmlStreamReader::StartElement)
+        {
+            continue;
+        }
+
+        if (xmlReader.name() == tagName)
+        {
+            return xmlReader.readElementText();
+        }
+    }
+
+    return QString();
+}
+
+static QVector<NvDisplayMode> getDisplayModeList(const QString& serverInfo)
+{
+    QXmlStreamReader xmlReader(serverInfo);
+    QVector<NvDisplayMode> modes;
+
+    while (!xmlReader.atEnd()) {
+        while (xmlReader.readNextStartElement()) {
+            auto name = xmlReader.name();
+            if (XML_NAME_EQUALS(name, "DisplayMode")) {
+                modes.append(NvDisplayMode());
+            }
+            else if (!modes.isEmpty()) {
+                if (XML_NAME_EQUALS(name, "Width")) {
+                    modes.last().width = xmlReader.readElementText().toInt();
+                }
+                else if (XML_NAME_EQUALS(name, "Height")) {
+                    modes.last().height = xmlReader.readElementText().toInt();
+                }
+                else if (XML_NAME_EQUALS(name, "RefreshRate")) {
+                    modes.last().refreshRate = xmlReader.readElementText().toInt();
+                }
+            }
+        }
+    }
+
+    return modes;
+}
+
+static void runBenchmark(const QString& name, const QString& serverInfo, int iterations)
+{
+    QElapsedTimer timer;
+    int sink = 0;
+
+    // One reader per field, then two more passes for the current game and display modes
+    timer.start();
+    for (int i = 0; i < iterations; i++) {
+        for (const char* field : k_Fields) {
+            sink += getXmlString(serverInfo, field).length();
+        }
+        sink += getXmlString(serverInfo, "currentgame").length();
+        sink += getDisplayModeList(serverInfo).length();
+    }
+    qint64 perFieldNs = timer.nsecsElapsed();
+
+    timer.restart();
+    for (int i = 0; i < iterations; i++) {
+        NvServerInfo info = NvServerInfo::parse(serverInfo);
+        sink += info.hostname.length() + info.displayModes.length();
+    }
+    qint64 singlePassNs = timer.nsecsElapsed();
+
+    // Print the sink so the loops can't be optimized away
+    printf("%s (%d chars, %d iterations): per-field %.1f us/doc, single-pass %.1f us/doc (%.1fx) [%d]\n",
+           qPrintable(name), (int)serverInfo.length(), iterations,
+           perFieldNs / iterations / 1000.0,
+           singlePassNs / iterations / 1000.0,
+           singlePassNs > 0 ? (double)perFieldNs / singlePassNs : 0.0,
+           sink);
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QStringList args = app.arguments();
+    args.removeFirst();
+
+    int iterations = DEFAULT_ITERATIONS;
+    if (args.size() >= 2 && args[0] == "-n") {
+        bool ok;
+        iterations = args[1].toInt(&ok);
+        if (!ok || iterations <= 0) {
+            fprintf(stderr, "Usage: serverinfobench [-n iterations] [serverinfo.xml ...]\n");
+            return 1;
+        }
+        args = args.mid(2);
+    }
+
+    if (args.isEmpty()) {
+        runBenchmark("built-in sample", QString::fromUtf8(k_SampleServerInfo), iterations);
+        return 0;
+    }
+
+    // Captured responses from real hosts can be passed on the command line
+    for (const QString& path : args) {
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly)) {
+            fprintf(stderr, "Failed to open %s: %s\n", qPrintable(path), qPrintable(file.errorString()));
+            return 1;
+        }
+
+        runBenchmark(path, QString::fromUtf8(file.readAll()), iterations);
+    }
+
+    return 0;
+}
@@ -0,0 +1,10 @@
+TARGET = serverinfobench
+
+include(../tools.pri)
+
+SOURCES += \
+    main.cpp \
+    $$APP_SRC/backend/nvserverinfo.cpp
+
+HEADERS += \
+    $$APP_SRC/backend/nvserverinfo.h
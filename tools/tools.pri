@@ -0,0 +1,13 @@
+# Common settings for the standalone developer tools. These are only built
+# when qmake is run with CONFIG+=build-tools and are never shipped.
+
+QT -= gui
+CONFIG += console c++17
+CONFIG -= app_bundle
+
+TEMPLATE = app
+
+include(../globaldefs.pri)
+
+APP_SRC = $$PWD/../app
+INCLUDEPATH += $$APP_SRC
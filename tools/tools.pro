@@ -0,0 +1,5 @@
+TEMPLATE = subdirs
+SUBDIRS = \
+    downmixbench \
+    serverinfobench \
+    hostsim